@@ -124,6 +124,19 @@ typedef struct {
 
 #define sz_xDamageAddReq		12
 
+/************** Version 1.2 ******************/
+
+typedef struct {
+    CARD8	reqType;
+    CARD8	damageReqType;
+    CARD16	length;
+    Damage	damage;
+    CARD16	maxRects;
+    CARD16	maxOverhead;
+} xDamageSetPolicyReq;
+
+#define sz_xDamageSetPolicyReq		12
+
 /* Events */
 
 #define DamageNotifyMore    0x80
@@ -25,7 +25,7 @@
 
 #define	DAMAGE_NAME	"DAMAGE"
 #define DAMAGE_MAJOR	1
-#define DAMAGE_MINOR	1
+#define DAMAGE_MINOR	2
 
 /************* Version 1 ****************/
 
@@ -42,7 +42,12 @@
 #define X_DamageSubtract		3
 #define X_DamageAdd			4
 
-#define XDamageNumberRequests		(X_DamageAdd + 1)
+/************* Version 1.2 ****************/
+
+/* Requests */
+#define X_DamageSetPolicy		5
+
+#define XDamageNumberRequests		(X_DamageSetPolicy + 1)
 
 /* Events */
 #define XDamageNotify			0
@@ -39,6 +39,7 @@
 #define X_RecordEnableContext   5     /* Enable interception and reporting */
 #define X_RecordDisableContext  6     /* Disable interception and reporting */
 #define X_RecordFreeContext     7     /* Free client RC */
+#define X_RecordEnableContextFd 8     /* Enable, reporting into shared memory */
 
 #define sz_XRecordRange		32
 #define sz_XRecordClientInfo 	12
@@ -298,6 +299,44 @@ typedef struct
 } xRecordFreeContextReq;
 #define sz_xRecordFreeContextReq 	8
 
+/*
+ * Enable data interception, with the data written into a ring buffer in
+ * memory shared with the recording client (version 1.14).  The request
+ * carries a file descriptor of sz_xRecordRingHeader + size bytes.
+ */
+typedef struct
+{
+    CARD8     	reqType;
+    CARD8     	recordReqType;
+    CARD16    	length;
+    RECORD_RC	context;
+    CARD32	size;		/* bytes of ring data, a power of two */
+} xRecordEnableContextFdReq;
+#define sz_xRecordEnableContextFdReq 	12
+
+/*
+ * Start of the shared memory.  The data that follows holds the same
+ * xRecordEnableContextReply messages EnableContext sends, and may wrap
+ * around the end.  head and tail count bytes written and consumed and
+ * wrap at 2^32; the server only writes the first cache line, the client
+ * only the second.  The client sets waiting before it sleeps on the
+ * connection, and the server clears it and sends an XRecordRingData
+ * reply the next time it makes data available.  Protocol elements that
+ * do not fit are dropped and counted, the server never waits for space.
+ */
+typedef struct
+{
+    CARD32	size;
+    CARD32	head;
+    CARD32	dropped;	/* protocol elements dropped */
+    CARD32	droppedBytes;
+    CARD32	pad0[12];
+    CARD32	tail;
+    CARD32	waiting;
+    CARD32	pad1[14];
+} xRecordRingHeader;
+#define sz_xRecordRingHeader	128
+
 #undef RECORD_RC
 #undef RECORD_XIDBASE
 #undef RECORD_ELEMENT_HEADER
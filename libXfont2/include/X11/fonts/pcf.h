@@ -90,6 +90,9 @@ typedef struct _PCFTable {
 
 extern int pcfReadFont ( FontPtr pFont, FontFilePtr file,
 			 int bit, int byte, int glyph, int scan );
+extern int pcfReadFontMapped ( FontPtr pFont, FontFilePtr file,
+			       const char *fileName,
+			       int bit, int byte, int glyph, int scan );
 extern int pcfReadFontInfo ( FontInfoPtr pFontInfo, FontFilePtr file );
 extern int pcfWriteFont ( FontPtr pFont, FontFilePtr file );
 extern void pcfError ( const char *, ... ) _X_ATTRIBUTE_PRINTF(1, 2);
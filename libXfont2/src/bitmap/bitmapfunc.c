@@ -53,6 +53,12 @@ typedef struct _BitmapFileFunctions {
 			     int /* glyph */, int /* scan */);
     int         (*ReadInfo) (  FontInfoPtr /* pFontInfo */,
 			       FontFilePtr /* file */ );
+    /* optional, loads glyphs as they are used */
+    int         (*ReadFontMapped) (FontPtr /* pFont */,
+				   FontFilePtr /* file */,
+				   const char * /* fileName */,
+				   int /* bit */, int /* byte */,
+				   int /* glyph */, int /* scan */);
 }           BitmapFileFunctionsRec, *BitmapFileFunctionsPtr;
 
 static int BitmapGetRenderIndex(FontRendererPtr renderer);
@@ -64,7 +70,7 @@ static int BitmapGetRenderIndex(FontRendererPtr renderer);
  */
 static BitmapFileFunctionsRec readers[] = {
 #if XFONT_PCFFORMAT
-    { pcfReadFont, pcfReadFontInfo} ,
+    { pcfReadFont, pcfReadFontInfo, pcfReadFontMapped} ,
     { pcfReadFont, pcfReadFontInfo} ,
 # ifdef X_GZIP_FONT_COMPRESSION
     { pcfReadFont, pcfReadFontInfo} ,
@@ -132,7 +138,12 @@ BitmapOpenBitmap (FontPathElementPtr fpe, FontPtr *ppFont, int flags,
     /* Fill in font record. Data format filled in by reader. */
     pFont->refcnt = 0;
 
-    ret = (*readers[i].ReadFont) (pFont, file, bit, byte, glyph, scan);
+    /* Callers that want everything loaded up front get it */
+    if (readers[i].ReadFontMapped && !(flags & FontLoadBitmaps))
+	ret = (*readers[i].ReadFontMapped) (pFont, file, fileName,
+					    bit, byte, glyph, scan);
+    else
+	ret = (*readers[i].ReadFont) (pFont, file, bit, byte, glyph, scan);
 
     FontFileClose (file);
     if (ret != Successful) {
@@ -1570,7 +1570,8 @@ BitmapOpenScalable (FontPathElementPtr fpe,
     if (!scaleFrom)
 	return BadFontName;
 
-    status = FontFileOpenBitmap(scaleFPE, &sourceFont, LoadAll, scaleFrom,
+    /* Scaling reads every glyph of the source font */
+    status = FontFileOpenBitmap(scaleFPE, &sourceFont, FontLoadAll, scaleFrom,
 				format, fmask);
 
     if (status != Successful)
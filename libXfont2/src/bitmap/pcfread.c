@@ -47,6 +47,21 @@ from The Open Group.
 #include <stdint.h>
 #include <string.h>
 
+#ifdef HAVE_MMAP
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifndef O_CLOEXEC
+#define O_CLOEXEC 0
+#endif
+#ifndef O_NOFOLLOW
+#define O_NOFOLLOW 0
+#endif
+#endif
+
 void
 pcfError(const char* message, ...)
 {
@@ -64,6 +79,78 @@ pcfError(const char* message, ...)
 static void pcfUnloadFont ( FontPtr pFont );
 static int  position;
 
+#ifdef HAVE_MMAP
+/*
+ * Uncompressed PCF files may be mapped instead of read.  Only the
+ * properties, accelerators and encoding are read when such a font is
+ * opened; the metrics and bitmap of each glyph are filled in from the
+ * mapping the first time the glyph is looked up.  When the bitmaps in
+ * the file are already in the format the server asked for, glyphs point
+ * straight into the mapping, so their pages are shared with every other
+ * open of the file, and with later server generations, through the page
+ * cache.
+ *
+ * Font files are expected to be replaced rather than rewritten in
+ * place, which leaves existing mappings intact.
+ */
+
+typedef struct _PCFMap {
+    struct _PCFMap *next;
+    dev_t	dev;
+    ino_t	ino;
+    off_t	size;
+    time_t	mtime;
+    int		refcnt;
+    unsigned char *base;
+} PCFMapRec, *PCFMapPtr;
+
+/* all mapped font files, shared by the fonts opened from them */
+static PCFMapPtr pcfMaps;
+
+#define PCF_GLYPH_CHUNK	16384
+
+typedef struct _PCFGlyphChunk {
+    struct _PCFGlyphChunk *next;
+    int		size;
+    int		used;
+    /* glyph bits follow */
+} PCFGlyphChunkRec, *PCFGlyphChunkPtr;
+
+typedef struct _PCFMappedFont {
+    BitmapFontRec bitmap;	/* must be first */
+    PCFMapPtr	map;
+    CARD32	metricsFormat;
+    unsigned char *metricsData;
+    CARD32	inkFormat;
+    unsigned char *inkData;
+    CARD32	bitmapsFormat;
+    unsigned char *offsets;
+    unsigned char *bitmapData;
+    CARD32	sizebitmaps;
+    int		bit, byte, glyph, scan;
+    Bool	convert;	/* bits can't be used from the mapping */
+    unsigned char *measured;	/* one bit per glyph with metrics */
+    unsigned char *loaded;	/* one bit per glyph with bits */
+    PCFGlyphChunkPtr chunks;	/* converted glyph bits */
+    unsigned char *scratch;
+    int		scratchSize;
+} PCFMappedFontRec, *PCFMappedFontPtr;
+
+static void pcfUnloadMappedFont ( FontPtr pFont );
+static int pcfMappedGetGlyphs ( FontPtr pFont, unsigned long count,
+				unsigned char *chars,
+				FontEncoding charEncoding,
+				unsigned long *glyphCount,
+				CharInfoPtr *glyphs );
+static int pcfMappedGetMetrics ( FontPtr pFont, unsigned long count,
+				 unsigned char *chars,
+				 FontEncoding charEncoding,
+				 unsigned long *glyphCount,
+				 xCharInfo **glyphs );
+#else
+typedef void *PCFMapPtr;
+#endif
+
 
 #define IS_EOF(file) ((file)->eof == BUFFILEEOF)
 
@@ -394,9 +481,35 @@ Bail:
     return FALSE;
 }
 
-int
-pcfReadFont(FontPtr pFont, FontFilePtr file,
-	    int bit, int byte, int glyph, int scan)
+#ifdef HAVE_MMAP
+/*
+ * Return the mapped contents of the next size bytes of the font file in
+ * *data and skip over them in the file.
+ */
+static Bool
+pcfMapTable(FontFilePtr file, PCFMapPtr map, CARD32 size,
+	    unsigned char **data)
+{
+    if (position < 0 || size > map->size - position)
+	return FALSE;
+    *data = map->base + position;
+    if (size && !FontFileSkip(file, size))
+	return FALSE;
+    position += size;
+    return TRUE;
+}
+#endif
+
+#define PCF_METRIC_SIZE(format) \
+    (PCF_FORMAT_MATCH(format, PCF_DEFAULT_FORMAT) ? 12 : 5)
+
+/*
+ * Read a font.  With a mapping of the file, the metrics and bitmaps are
+ * left in the mapping, to be loaded glyph by glyph as they are used.
+ */
+static int
+pcfReadFontTables(FontPtr pFont, FontFilePtr file, PCFMapPtr map,
+		  int bit, int byte, int glyph, int scan)
 {
     CARD32      format;
     CARD32      size;
@@ -417,6 +530,9 @@ pcfReadFont(FontPtr pFont, FontFilePtr file,
     CARD32      bitmapSizes[GLYPHPADOPTIONS];
     CARD32     *offsets = 0;
     Bool	hasBDFAccelerators;
+#ifdef HAVE_MMAP
+    PCFMappedFontPtr mapped = NULL;
+#endif
 
     pFont->info.nprops = 0;
     pFont->info.props = 0;
@@ -425,6 +541,17 @@ pcfReadFont(FontPtr pFont, FontFilePtr file,
     if (!(tables = pcfReadTOC(file, &ntables)))
 	goto Bail;
 
+#ifdef HAVE_MMAP
+    if (map) {
+	mapped = calloc(1, sizeof *mapped);
+	if (!mapped) {
+	    pcfError("pcfReadFont(): Couldn't allocate mapped font (%d)\n",
+		     (int) sizeof *mapped);
+	    goto Bail;
+	}
+    }
+#endif
+
     /* properties */
 
     if (!pcfGetProperties(&pFont->info, file, tables, ntables))
@@ -456,12 +583,21 @@ pcfReadFont(FontPtr pFont, FontFilePtr file,
 	pcfError("pcfReadFont(): invalid file format\n");
 	goto Bail;
     }
-    metrics = malloc(nmetrics * sizeof(CharInfoRec));
+    /* a mapped font fills these in as they are used */
+    metrics = calloc(nmetrics, sizeof(CharInfoRec));
     if (!metrics) {
 	pcfError("pcfReadFont(): Couldn't allocate metrics (%d*%d)\n",
 		 nmetrics, (int) sizeof(CharInfoRec));
 	goto Bail;
     }
+#ifdef HAVE_MMAP
+    if (mapped) {
+	mapped->metricsFormat = format;
+	if (!pcfMapTable(file, map, nmetrics * PCF_METRIC_SIZE(format),
+			 &mapped->metricsData))
+	    goto Bail;
+    } else
+#endif
     for (i = 0; i < nmetrics; i++)
 	if (PCF_FORMAT_MATCH(format, PCF_DEFAULT_FORMAT)) {
 	    if (!pcfGetMetric(file, format, &(metrics + i)->metrics))
@@ -482,6 +618,21 @@ pcfReadFont(FontPtr pFont, FontFilePtr file,
     nbitmaps = pcfGetINT32(file, format);
     if (nbitmaps != nmetrics || IS_EOF(file))
 	goto Bail;
+#ifdef HAVE_MMAP
+    if (mapped) {
+	mapped->bitmapsFormat = format;
+	if (!pcfMapTable(file, map, nbitmaps * 4, &mapped->offsets))
+	    goto Bail;
+	for (i = 0; i < GLYPHPADOPTIONS; i++) {
+	    bitmapSizes[i] = pcfGetINT32(file, format);
+	    if (IS_EOF(file)) goto Bail;
+	}
+	mapped->sizebitmaps = bitmapSizes[PCF_GLYPH_PAD_INDEX(format)];
+	if (!pcfMapTable(file, map, mapped->sizebitmaps, &mapped->bitmapData))
+	    goto Bail;
+	goto InkMetrics;
+    }
+#endif
     /* nmetrics is already ok, so nbitmap also is */
     offsets = malloc(nbitmaps * sizeof(CARD32));
     if (!offsets) {
@@ -558,6 +709,9 @@ pcfReadFont(FontPtr pFont, FontFilePtr file,
 
     /* ink metrics ? */
 
+#ifdef HAVE_MMAP
+ InkMetrics:
+#endif
     ink_metrics = NULL;
     if (pcfSeekToType(file, tables, ntables, PCF_INK_METRICS, &format, &size)) {
 	format = pcfGetLSB32(file);
@@ -573,12 +727,20 @@ pcfReadFont(FontPtr pFont, FontFilePtr file,
 	if (nink_metrics != nmetrics)
 	    goto Bail;
 	/* nmetrics already checked */
-	ink_metrics = malloc(nink_metrics * sizeof(xCharInfo));
+	ink_metrics = calloc(nink_metrics, sizeof(xCharInfo));
 	if (!ink_metrics) {
             pcfError("pcfReadFont(): Couldn't allocate ink_metrics (%d*%d)\n",
 		     nink_metrics, (int) sizeof(xCharInfo));
 	    goto Bail;
 	}
+#ifdef HAVE_MMAP
+	if (mapped) {
+	    mapped->inkFormat = format;
+	    if (!pcfMapTable(file, map, nink_metrics * PCF_METRIC_SIZE(format),
+			     &mapped->inkData))
+		goto Bail;
+	} else
+#endif
 	for (i = 0; i < nink_metrics; i++)
 	    if (PCF_FORMAT_MATCH(format, PCF_DEFAULT_FORMAT)) {
 		if (!pcfGetMetric(file, format, ink_metrics + i))
@@ -624,6 +786,11 @@ pcfReadFont(FontPtr pFont, FontFilePtr file,
 	if (encodingOffset == 0xFFFF) {
 	    pFont->info.allExist = FALSE;
 	} else {
+#ifdef HAVE_MMAP
+	    /* glyphs are loaded through the encoding, keep it in bounds */
+	    if (mapped && encodingOffset >= nmetrics)
+		goto Bail;
+#endif
             if(!encoding[SEGMENT_MAJOR(i)]) {
                 encoding[SEGMENT_MAJOR(i)]=
                     calloc(BITMAP_FONT_SEGMENT_SIZE, sizeof(CharInfoPtr));
@@ -640,6 +807,35 @@ pcfReadFont(FontPtr pFont, FontFilePtr file,
 	if (!pcfGetAccel (&pFont->info, file, tables, ntables, PCF_BDF_ACCELERATORS))
 	    goto Bail;
 
+#ifdef HAVE_MMAP
+    if (mapped) {
+	/* both bit arrays in one block, freed through measured */
+	mapped->measured = calloc((nmetrics + 7) / 8, 2);
+	if (!mapped->measured) {
+	    pcfError("pcfReadFont(): Couldn't allocate loaded (%d)\n",
+		     (nmetrics + 7) / 8 * 2);
+	    goto Bail;
+	}
+	mapped->loaded = mapped->measured + (nmetrics + 7) / 8;
+	mapped->map = map;
+	mapped->bit = bit;
+	mapped->byte = byte;
+	mapped->glyph = glyph;
+	mapped->scan = scan;
+	/*
+	 * Glyphs can only point into the mapping when no swapping or
+	 * repadding is needed and the bits are suitably aligned.
+	 */
+	format = mapped->bitmapsFormat;
+	mapped->convert = PCF_BIT_ORDER(format) != bit ||
+	    ((PCF_BYTE_ORDER(format) == PCF_BIT_ORDER(format)) != (bit == byte) &&
+	     (bit == byte ? PCF_SCAN_UNIT(format) : scan) != 1) ||
+	    PCF_GLYPH_PAD(format) != glyph ||
+	    ((uintptr_t) mapped->bitmapData & (glyph - 1)) != 0;
+	bitmapFont = &mapped->bitmap;
+	mapped = NULL;
+    } else
+#endif
     bitmapFont = malloc(sizeof *bitmapFont);
     if (!bitmapFont) {
 	pcfError("pcfReadFont(): Couldn't allocate bitmapFont (%d)\n",
@@ -675,6 +871,13 @@ pcfReadFont(FontPtr pFont, FontFilePtr file,
     pFont->get_glyphs = bitmapGetGlyphs;
     pFont->get_metrics = bitmapGetMetrics;
     pFont->unload_font = pcfUnloadFont;
+#ifdef HAVE_MMAP
+    if (map) {
+	pFont->get_glyphs = pcfMappedGetGlyphs;
+	pFont->get_metrics = pcfMappedGetMetrics;
+	pFont->unload_font = pcfUnloadMappedFont;
+    }
+#endif
     pFont->unload_glyphs = NULL;
     pFont->bit = bit;
     pFont->byte = byte;
@@ -696,11 +899,23 @@ Bail:
     pFont->info.props = 0;
     free (pFont->info.isStringProp);
     free(bitmapFont);
+#ifdef HAVE_MMAP
+    if (mapped)
+	free(mapped->measured);
+    free(mapped);
+#endif
     free(tables);
     free(offsets);
     return AllocError;
 }
 
+int
+pcfReadFont(FontPtr pFont, FontFilePtr file,
+	    int bit, int byte, int glyph, int scan)
+{
+    return pcfReadFontTables(pFont, file, NULL, bit, byte, glyph, scan);
+}
+
 int
 pcfReadFontInfo(FontInfoPtr pFontInfo, FontFilePtr file)
 {
@@ -797,3 +1012,335 @@ pcfUnloadFont(FontPtr pFont)
     free(bitmapFont);
     DestroyFontRec(pFont);
 }
+
+#ifdef HAVE_MMAP
+static PCFMapPtr
+pcfMapFile(const char *fileName)
+{
+    struct stat st;
+    PCFMapPtr	map;
+    void       *base;
+    int		fd;
+
+    fd = open(fileName, O_RDONLY|O_CLOEXEC|O_NOFOLLOW);
+    if (fd < 0)
+	return NULL;
+    if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) || st.st_size == 0 ||
+	st.st_size > INT32_MAX) {
+	close(fd);
+	return NULL;
+    }
+
+    for (map = pcfMaps; map; map = map->next)
+	if (map->dev == st.st_dev && map->ino == st.st_ino &&
+	    map->size == st.st_size && map->mtime == st.st_mtime) {
+	    close(fd);
+	    map->refcnt++;
+	    return map;
+	}
+
+    map = malloc(sizeof *map);
+    if (!map) {
+	close(fd);
+	return NULL;
+    }
+    base = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+	free(map);
+	return NULL;
+    }
+
+    map->dev = st.st_dev;
+    map->ino = st.st_ino;
+    map->size = st.st_size;
+    map->mtime = st.st_mtime;
+    map->refcnt = 1;
+    map->base = base;
+    map->next = pcfMaps;
+    pcfMaps = map;
+    return map;
+}
+
+static void
+pcfUnmapFile(PCFMapPtr map)
+{
+    PCFMapPtr  *prev;
+
+    if (--map->refcnt)
+	return;
+    for (prev = &pcfMaps; *prev != map; prev = &(*prev)->next)
+	;
+    *prev = map->next;
+    munmap(map->base, map->size);
+    free(map);
+}
+
+static int
+pcfMapINT16(unsigned char *p, CARD32 format)
+{
+    if (PCF_BYTE_ORDER(format) == MSBFirst)
+	return (p[0] << 8) | p[1];
+    return p[0] | (p[1] << 8);
+}
+
+static CARD32
+pcfMapCARD32(unsigned char *p, CARD32 format)
+{
+    if (PCF_BYTE_ORDER(format) == MSBFirst)
+	return ((CARD32) p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((CARD32) p[3] << 24);
+}
+
+static void
+pcfMapMetric(unsigned char *data, CARD32 format, int i, xCharInfo *metric)
+{
+    unsigned char *p = data + i * PCF_METRIC_SIZE(format);
+
+    if (PCF_FORMAT_MATCH(format, PCF_DEFAULT_FORMAT)) {
+	metric->leftSideBearing = pcfMapINT16(p, format);
+	metric->rightSideBearing = pcfMapINT16(p + 2, format);
+	metric->characterWidth = pcfMapINT16(p + 4, format);
+	metric->ascent = pcfMapINT16(p + 6, format);
+	metric->descent = pcfMapINT16(p + 8, format);
+	metric->attributes = pcfMapINT16(p + 10, format);
+    } else {
+	metric->leftSideBearing = p[0] - 0x80;
+	metric->rightSideBearing = p[1] - 0x80;
+	metric->characterWidth = p[2] - 0x80;
+	metric->ascent = p[3] - 0x80;
+	metric->descent = p[4] - 0x80;
+	metric->attributes = 0;
+    }
+}
+
+/*
+ * Allocate zeroed space for the bits of a converted glyph.  Glyphs are
+ * packed into chunks which are only freed with the font.
+ */
+static char *
+pcfMappedAllocBits(PCFMappedFontPtr font, int size)
+{
+    PCFGlyphChunkPtr chunk = font->chunks;
+    char       *bits;
+
+    /* keep every glyph aligned for the widest scanline unit */
+    size = (size + 7) & ~7;
+    if (!chunk || chunk->size - chunk->used < size) {
+	int	chunkSize = size > PCF_GLYPH_CHUNK ? size : PCF_GLYPH_CHUNK;
+
+	chunk = calloc(1, sizeof(PCFGlyphChunkRec) + chunkSize);
+	if (!chunk)
+	    return NULL;
+	chunk->size = chunkSize;
+	chunk->next = font->chunks;
+	font->chunks = chunk;
+    }
+    bits = (char *) (chunk + 1) + chunk->used;
+    chunk->used += size;
+    return bits;
+}
+
+#define PCF_GLYPH_BIT(bits, i)	((bits)[(i) >> 3] & (1 << ((i) & 7)))
+#define PCF_SET_GLYPH_BIT(bits, i) ((bits)[(i) >> 3] |= 1 << ((i) & 7))
+
+/*
+ * Fill in the metrics and ink metrics of glyph i from the mapping.
+ */
+static void
+pcfMappedLoadMetrics(PCFMappedFontPtr font, int i)
+{
+    PCF_SET_GLYPH_BIT(font->measured, i);
+    pcfMapMetric(font->metricsData, font->metricsFormat, i,
+		 &font->bitmap.metrics[i].metrics);
+    if (font->bitmap.ink_metrics)
+	pcfMapMetric(font->inkData, font->inkFormat, i,
+		     &font->bitmap.ink_metrics[i]);
+}
+
+/*
+ * Fill in the bits of glyph i from the mapping, doing the same bit and
+ * byte swapping and repadding pcfReadFont does for the whole font.
+ */
+static void
+pcfMappedLoadGlyph(PCFMappedFontPtr font, int i)
+{
+    CharInfoPtr	pci = &font->bitmap.metrics[i];
+    CARD32	format = font->bitmapsFormat;
+    CARD32	offset;
+    int		width, height;
+    int		srcSize, dstSize;
+    int		unit, start, end, avail;
+    char       *bits;
+
+    PCF_SET_GLYPH_BIT(font->loaded, i);
+    if (!PCF_GLYPH_BIT(font->measured, i))
+	pcfMappedLoadMetrics(font, i);
+
+    width = pci->metrics.rightSideBearing - pci->metrics.leftSideBearing;
+    height = pci->metrics.ascent + pci->metrics.descent;
+    if (width <= 0 || height <= 0)
+	width = height = 0;
+    srcSize = BYTES_PER_ROW(width, PCF_GLYPH_PAD(format)) * height;
+    dstSize = BYTES_PER_ROW(width, font->glyph) * height;
+
+    offset = pcfMapCARD32(font->offsets + i * 4, format);
+    if (!font->convert && offset <= font->sizebitmaps &&
+	srcSize <= font->sizebitmaps - offset) {
+	pci->bits = (char *) font->bitmapData + offset;
+	return;
+    }
+
+    bits = pcfMappedAllocBits(font, dstSize);
+    pci->bits = bits;
+    if (!bits) {
+	/* out of memory, the glyph has no ink */
+	pci->metrics.leftSideBearing = pci->metrics.rightSideBearing = 0;
+	pci->metrics.ascent = pci->metrics.descent = 0;
+	return;
+    }
+    /* broken offsets leave the glyph blank */
+    if (!srcSize || offset > font->sizebitmaps ||
+	srcSize > font->sizebitmaps - offset)
+	return;
+
+    /*
+     * Byte swapping is done in units counted from the start of the
+     * bitmaps, so work on a copy of the whole units holding the glyph.
+     */
+    unit = 1;
+    if ((PCF_BYTE_ORDER(format) == PCF_BIT_ORDER(format)) !=
+	(font->bit == font->byte))
+	unit = font->bit == font->byte ? PCF_SCAN_UNIT(format) : font->scan;
+    start = offset & ~(unit - 1);
+    end = (offset + srcSize + unit - 1) & ~(unit - 1);
+    if (end - start > font->scratchSize) {
+	unsigned char *scratch = realloc(font->scratch, end - start);
+
+	if (!scratch)
+	    return;
+	font->scratch = scratch;
+	font->scratchSize = end - start;
+    }
+    avail = font->sizebitmaps - start;
+    if (avail > end - start)
+	avail = end - start;
+    memcpy(font->scratch, font->bitmapData + start, avail);
+    memset(font->scratch + avail, 0, (end - start) - avail);
+
+    if (PCF_BIT_ORDER(format) != font->bit)
+	BitOrderInvert(font->scratch, end - start);
+    switch (unit) {
+    case 2:
+	TwoByteSwap(font->scratch, end - start);
+	break;
+    case 4:
+	FourByteSwap(font->scratch, end - start);
+	break;
+    }
+
+    if (PCF_GLYPH_PAD(format) != font->glyph)
+	RepadBitmap((char *) font->scratch + (offset - start), bits,
+		    PCF_GLYPH_PAD(format), font->glyph, width, height);
+    else
+	memcpy(bits, font->scratch + (offset - start), srcSize);
+}
+
+static void
+pcfMappedLoadGlyphs(FontPtr pFont, unsigned long count, CharInfoPtr *glyphs)
+{
+    PCFMappedFontPtr font = (PCFMappedFontPtr) pFont->fontPrivate;
+    unsigned long n;
+    int		i;
+
+    for (n = 0; n < count; n++) {
+	i = glyphs[n] - font->bitmap.metrics;
+	if (!PCF_GLYPH_BIT(font->loaded, i))
+	    pcfMappedLoadGlyph(font, i);
+    }
+}
+
+static int
+pcfMappedGetGlyphs(FontPtr pFont, unsigned long count, unsigned char *chars,
+		   FontEncoding charEncoding,
+		   unsigned long *glyphCount,	/* RETURN */
+		   CharInfoPtr *glyphs)		/* RETURN */
+{
+    int		ret;
+
+    ret = bitmapGetGlyphs(pFont, count, chars, charEncoding,
+			  glyphCount, glyphs);
+    if (ret == Successful)
+	pcfMappedLoadGlyphs(pFont, *glyphCount, glyphs);
+    return ret;
+}
+
+/*
+ * Metrics are loaded without the bits, QueryFont asks for the metrics of
+ * every glyph in the font.
+ */
+static int
+pcfMappedGetMetrics(FontPtr pFont, unsigned long count, unsigned char *chars,
+		    FontEncoding charEncoding,
+		    unsigned long *glyphCount,	/* RETURN */
+		    xCharInfo **glyphs)		/* RETURN */
+{
+    PCFMappedFontPtr font = (PCFMappedFontPtr) pFont->fontPrivate;
+    CharInfoPtr *pci = (CharInfoPtr *) glyphs;
+    unsigned long n;
+    int		ret, i;
+
+    /* find the glyphs first, using glyphs as scratch space */
+    ret = bitmapGetGlyphs(pFont, count, chars, charEncoding,
+			  glyphCount, pci);
+    if (ret != Successful)
+	return ret;
+    for (n = 0; n < *glyphCount; n++) {
+	i = pci[n] - font->bitmap.metrics;
+	if (!PCF_GLYPH_BIT(font->measured, i))
+	    pcfMappedLoadMetrics(font, i);
+    }
+    return bitmapGetMetrics(pFont, count, chars, charEncoding,
+			    glyphCount, glyphs);
+}
+
+static void
+pcfUnloadMappedFont(FontPtr pFont)
+{
+    PCFMappedFontPtr font = (PCFMappedFontPtr) pFont->fontPrivate;
+    PCFGlyphChunkPtr chunk, next;
+
+    for (chunk = font->chunks; chunk; chunk = next) {
+	next = chunk->next;
+	free(chunk);
+    }
+    free(font->scratch);
+    free(font->measured);
+    pcfUnmapFile(font->map);
+    pcfUnloadFont(pFont);
+}
+#endif
+
+/*
+ * Read a font from an uncompressed PCF file, mapping the file when
+ * possible so that glyphs are only loaded when they are used.  Falls back
+ * to pcfReadFont.
+ */
+int
+pcfReadFontMapped(FontPtr pFont, FontFilePtr file, const char *fileName,
+		  int bit, int byte, int glyph, int scan)
+{
+#ifdef HAVE_MMAP
+    PCFMapPtr	map;
+    int		ret;
+
+    map = pcfMapFile(fileName);
+    if (map) {
+	ret = pcfReadFontTables(pFont, file, map, bit, byte, glyph, scan);
+	if (ret != Successful)
+	    pcfUnmapFile(map);
+	return ret;
+    }
+#endif
+    return pcfReadFont(pFont, file, bit, byte, glyph, scan);
+}
@@ -0,0 +1,417 @@
+/*
+ * Copyright © 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Checks that fonts loaded through a mapping of the PCF file return the
+ * same glyphs and metrics as fonts read in full.  Test fonts are written
+ * in each byte order, bit order, glyph pad and scan unit, with and without
+ * compressed and ink metrics, and loaded for every layout a server may
+ * ask for.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include "libxfontint.h"
+
+#include <X11/fonts/fntfilst.h>
+#include <X11/fonts/bitmap.h>
+#include <X11/fonts/pcf.h>
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define FONT_ROWS	16
+#define FONT_COLS	40
+#define FONT_GLYPHS	(FONT_ROWS * FONT_COLS)
+#define FONT_WIDTH	13
+#define FONT_HEIGHT	17
+
+typedef struct {
+    unsigned char *data;
+    size_t	len;
+    size_t	size;
+    CARD32	format;
+} PCFTable;
+
+typedef struct {
+    short	lsb, rsb, width, ascent, descent;
+} TestMetrics;
+
+static void
+put8(PCFTable *t, int v)
+{
+    if (t->len == t->size) {
+	t->size = t->size ? t->size * 2 : 256;
+	t->data = realloc(t->data, t->size);
+	assert(t->data);
+    }
+    t->data[t->len++] = v;
+}
+
+static void
+put16(PCFTable *t, int v)
+{
+    if (PCF_BYTE_ORDER(t->format) == MSBFirst) {
+	put8(t, v >> 8);
+	put8(t, v);
+    } else {
+	put8(t, v);
+	put8(t, v >> 8);
+    }
+}
+
+static void
+put32(PCFTable *t, CARD32 v)
+{
+    if (PCF_BYTE_ORDER(t->format) == MSBFirst) {
+	put16(t, v >> 16);
+	put16(t, v);
+    } else {
+	put16(t, v);
+	put16(t, v >> 16);
+    }
+}
+
+/* table formats and the table of contents are always LSBFirst */
+static void
+putLSB32(PCFTable *t, CARD32 v)
+{
+    int i;
+
+    for (i = 0; i < 4; i++)
+	put8(t, v >> (i * 8));
+}
+
+static void
+putMetrics(PCFTable *t, const TestMetrics *m, int attributes)
+{
+    put16(t, m->lsb);
+    put16(t, m->rsb);
+    put16(t, m->width);
+    put16(t, m->ascent);
+    put16(t, m->descent);
+    put16(t, attributes);
+}
+
+static int
+rowBytes(int width, int pad)
+{
+    return (width + pad * 8 - 1) / (pad * 8) * pad;
+}
+
+/*
+ * Write a font of FONT_GLYPHS random glyphs in format to a new file and
+ * return its name.
+ */
+static char *
+writeFont(CARD32 format, Bool compressed, Bool ink)
+{
+    static const char *names[] = { "FONT", "PIXEL_SIZE" };
+    static const char fontName[] =
+	"-test-fixed-medium-r-normal--17-170-75-75-c-130-iso10646-1";
+    PCFTable tables[6];
+    CARD32 types[6];
+    TestMetrics metrics[FONT_GLYPHS];
+    TestMetrics bounds = { 0, FONT_WIDTH, FONT_WIDTH, FONT_HEIGHT - 2, 2 };
+    PCFTable *t, toc = { 0 };
+    int ntables = 0, pad = PCF_GLYPH_PAD(format);
+    CARD32 offset, size;
+    char *name;
+    int fd, i, k;
+
+    memset(tables, 0, sizeof(tables));
+
+    for (i = 0; i < FONT_GLYPHS; i++) {
+	int w = 1 + rand() % FONT_WIDTH, h = 1 + rand() % FONT_HEIGHT;
+
+	metrics[i].lsb = rand() % (FONT_WIDTH - w + 1);
+	metrics[i].rsb = metrics[i].lsb + w;
+	metrics[i].width = FONT_WIDTH;
+	metrics[i].ascent = rand() % (h + 1);
+	metrics[i].descent = h - metrics[i].ascent;
+    }
+
+    t = &tables[ntables];
+    types[ntables++] = PCF_PROPERTIES;
+    t->format = format;
+    putLSB32(t, t->format);
+    put32(t, 2);
+    put32(t, 0);
+    put8(t, TRUE);
+    put32(t, strlen(names[0]) + 1 + strlen(names[1]) + 1);
+    put32(t, strlen(names[0]) + 1);
+    put8(t, FALSE);
+    put32(t, FONT_HEIGHT);
+    put16(t, 0);
+    put32(t, strlen(names[0]) + 1 + strlen(names[1]) + 1 + sizeof(fontName));
+    for (k = 0; k < 2; k++)
+	for (i = 0; i <= strlen(names[k]); i++)
+	    put8(t, names[k][i]);
+    for (i = 0; i < sizeof(fontName); i++)
+	put8(t, fontName[i]);
+
+    t = &tables[ntables];
+    types[ntables++] = PCF_ACCELERATORS;
+    t->format = format;
+    putLSB32(t, t->format);
+    for (i = 0; i < 8; i++)
+	put8(t, 0);
+    put32(t, FONT_HEIGHT - 2);
+    put32(t, 2);
+    put32(t, 0);
+    putMetrics(t, &bounds, 0);
+    putMetrics(t, &bounds, 0);
+
+    t = &tables[ntables];
+    types[ntables++] = PCF_METRICS;
+    if (compressed) {
+	t->format = format | PCF_COMPRESSED_METRICS;
+	putLSB32(t, t->format);
+	put16(t, FONT_GLYPHS);
+	for (i = 0; i < FONT_GLYPHS; i++) {
+	    put8(t, metrics[i].lsb + 0x80);
+	    put8(t, metrics[i].rsb + 0x80);
+	    put8(t, metrics[i].width + 0x80);
+	    put8(t, metrics[i].ascent + 0x80);
+	    put8(t, metrics[i].descent + 0x80);
+	}
+    } else {
+	t->format = format;
+	putLSB32(t, t->format);
+	put32(t, FONT_GLYPHS);
+	for (i = 0; i < FONT_GLYPHS; i++)
+	    putMetrics(t, &metrics[i], 0);
+    }
+
+    t = &tables[ntables];
+    types[ntables++] = PCF_BITMAPS;
+    t->format = format;
+    putLSB32(t, t->format);
+    put32(t, FONT_GLYPHS);
+    for (i = 0, offset = 0; i < FONT_GLYPHS; i++) {
+	put32(t, offset);
+	offset += rowBytes(metrics[i].rsb - metrics[i].lsb, pad) *
+	    (metrics[i].ascent + metrics[i].descent);
+    }
+    for (k = 0; k < GLYPHPADOPTIONS; k++) {
+	for (i = 0, size = 0; i < FONT_GLYPHS; i++)
+	    size += rowBytes(metrics[i].rsb - metrics[i].lsb, 1 << k) *
+		(metrics[i].ascent + metrics[i].descent);
+	put32(t, size);
+    }
+    for (i = 0; i < offset; i++)
+	put8(t, rand());
+
+    if (ink) {
+	t = &tables[ntables];
+	types[ntables++] = PCF_INK_METRICS;
+	t->format = format;
+	putLSB32(t, t->format);
+	put32(t, FONT_GLYPHS);
+	for (i = 0; i < FONT_GLYPHS; i++) {
+	    TestMetrics m = metrics[i];
+
+	    if (m.descent)
+		m.descent--;
+	    putMetrics(t, &m, 0);
+	}
+    }
+
+    t = &tables[ntables];
+    types[ntables++] = PCF_BDF_ENCODINGS;
+    t->format = format;
+    putLSB32(t, t->format);
+    put16(t, 0x21);
+    put16(t, 0x20 + FONT_COLS);
+    put16(t, 0x21);
+    put16(t, 0x20 + FONT_ROWS);
+    put16(t, 0x2121);
+    for (i = 0; i < FONT_GLYPHS; i++)
+	put16(t, i % 97 == 5 ? 0xffff : i);
+
+    putLSB32(&toc, PCF_FILE_VERSION);
+    putLSB32(&toc, ntables);
+    offset = 8 + 16 * ntables;
+    for (k = 0; k < ntables; k++) {
+	while (tables[k].len & 3)
+	    put8(&tables[k], 0);
+	putLSB32(&toc, types[k]);
+	putLSB32(&toc, tables[k].format);
+	putLSB32(&toc, tables[k].len);
+	putLSB32(&toc, offset);
+	offset += tables[k].len;
+    }
+
+    name = strdup("/tmp/pcfmapXXXXXX");
+    assert(name);
+    fd = mkstemp(name);
+    assert(fd >= 0);
+    assert(write(fd, toc.data, toc.len) == toc.len);
+    free(toc.data);
+    for (k = 0; k < ntables; k++) {
+	assert(write(fd, tables[k].data, tables[k].len) == tables[k].len);
+	free(tables[k].data);
+    }
+    close(fd);
+    return name;
+}
+
+static FontPtr
+openFont(const char *name, Bool mapped, int bit, int byte, int glyph,
+	 int scan)
+{
+    FontFilePtr file = FontFileOpen(name);
+    FontPtr font = CreateFontRec();
+    int ret;
+
+    assert(file && font);
+    if (mapped)
+	ret = pcfReadFontMapped(font, file, name, bit, byte, glyph, scan);
+    else
+	ret = pcfReadFont(font, file, bit, byte, glyph, scan);
+    FontFileClose(file);
+    assert(ret == Successful);
+    return font;
+}
+
+static void
+compareFonts(const char *name, int bit, int byte, int glyph, int scan)
+{
+    FontPtr read = openFont(name, FALSE, bit, byte, glyph, scan);
+    FontPtr mapped = openFont(name, TRUE, bit, byte, glyph, scan);
+    FontPtr lazy = openFont(name, TRUE, bit, byte, glyph, scan);
+    unsigned char chars[2 * (FONT_COLS + 2)];
+    CharInfoPtr readGlyphs[FONT_COLS + 2], mappedGlyphs[FONT_COLS + 2];
+    xCharInfo *readMetrics[FONT_COLS + 2], *mappedMetrics[FONT_COLS + 2];
+    unsigned long nread, nmapped, i;
+    int row, col, n;
+
+#ifdef HAVE_MMAP
+    assert(mapped->get_glyphs != bitmapGetGlyphs);
+#endif
+    assert(read->info.allExist == mapped->info.allExist);
+    assert(read->info.defaultCh == mapped->info.defaultCh);
+    assert(read->info.nprops == mapped->info.nprops);
+    assert(!memcmp(&read->info.maxbounds, &mapped->info.maxbounds,
+		   sizeof(xCharInfo)));
+
+    /* a row past each end, so that missing characters are looked up too */
+    for (row = 0x20; row <= 0x21 + FONT_ROWS; row++) {
+	for (col = 0x20, n = 0; col <= 0x21 + FONT_COLS; col++, n++) {
+	    chars[2 * n] = row;
+	    chars[2 * n + 1] = col;
+	}
+
+	/* metrics first, before any glyph of the row has been loaded */
+	lazy->get_metrics(lazy, n, chars, TwoD16Bit, &nmapped, mappedMetrics);
+	read->get_metrics(read, n, chars, TwoD16Bit, &nread, readMetrics);
+	assert(nread == nmapped);
+	for (i = 0; i < nread; i++)
+	    assert(!memcmp(readMetrics[i], mappedMetrics[i], sizeof(xCharInfo)));
+
+	read->get_glyphs(read, n, chars, TwoD16Bit, &nread, readGlyphs);
+	mapped->get_glyphs(mapped, n, chars, TwoD16Bit, &nmapped, mappedGlyphs);
+	assert(nread == nmapped);
+	for (i = 0; i < nread; i++) {
+	    assert(!memcmp(&readGlyphs[i]->metrics, &mappedGlyphs[i]->metrics,
+			   sizeof(xCharInfo)));
+	    assert(!memcmp(readGlyphs[i]->bits, mappedGlyphs[i]->bits,
+			   BYTES_FOR_GLYPH(readGlyphs[i], glyph)));
+	}
+
+	lazy->get_glyphs(lazy, n, chars, TwoD16Bit, &nmapped, mappedGlyphs);
+	assert(nread == nmapped);
+	for (i = 0; i < nread; i++)
+	    assert(!memcmp(readGlyphs[i]->bits, mappedGlyphs[i]->bits,
+			   BYTES_FOR_GLYPH(readGlyphs[i], glyph)));
+
+	mapped->get_metrics(mapped, n, chars, TwoD16Bit, &nmapped,
+			    mappedMetrics);
+	read->get_metrics(read, n, chars, TwoD16Bit, &nread, readMetrics);
+	assert(nread == nmapped);
+	for (i = 0; i < nread; i++)
+	    assert(!memcmp(readMetrics[i], mappedMetrics[i], sizeof(xCharInfo)));
+    }
+
+    read->unload_font(read);
+    mapped->unload_font(mapped);
+    lazy->unload_font(lazy);
+}
+
+int
+main(int argc, char **argv)
+{
+    static const int orders[] = { MSBFirst, LSBFirst };
+    static const int units[] = { 1, 2, 4 };
+    int fileBit, fileByte, filePad, fileScan;
+    int bit, byte, glyph, scan;
+    int fonts = 0;
+
+    srand(1);
+    for (fileBit = 0; fileBit < 2; fileBit++)
+    for (fileByte = 0; fileByte < 2; fileByte++)
+    for (filePad = 0; filePad < 3; filePad++)
+    for (fileScan = 0; fileScan <= filePad; fileScan++) {
+	CARD32 format = PCF_FORMAT(orders[fileBit], orders[fileByte],
+				   units[filePad], units[fileScan]);
+	char *name = writeFont(format, fonts & 1, fonts & 2);
+
+	for (bit = 0; bit < 2; bit++)
+	for (byte = 0; byte < 2; byte++)
+	for (glyph = 0; glyph < 3; glyph++)
+	/* bitmaps are swapped in the file's pad, before they are repadded */
+	for (scan = 0; scan <= filePad && scan <= glyph; scan++)
+	    compareFonts(name, orders[bit], orders[byte],
+			 units[glyph], units[scan]);
+
+	/* two fonts in different layouts share one mapping */
+	{
+	    FontPtr a = openFont(name, TRUE, MSBFirst, MSBFirst, 4, 1);
+	    FontPtr b = openFont(name, TRUE, LSBFirst, LSBFirst, 1, 1);
+	    unsigned char ch[2] = { 0x22, 0x22 };
+	    CharInfoPtr g;
+	    unsigned long n;
+
+	    a->get_glyphs(a, 1, ch, TwoD16Bit, &n, &g);
+	    assert(n == 1);
+	    a->unload_font(a);
+	    b->get_glyphs(b, 1, ch, TwoD16Bit, &n, &g);
+	    assert(n == 1);
+	    b->unload_font(b);
+	}
+
+	unlink(name);
+	free(name);
+	fonts++;
+    }
+
+    printf("%d fonts compared\n", fonts);
+    return 0;
+}
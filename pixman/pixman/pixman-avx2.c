@@ -0,0 +1,1576 @@
+/*
+ * Copyright © 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * AVX2 versions of the most common SSE2 combiners and fast paths.  They
+ * process eight pixels per iteration and use exactly the same arithmetic
+ * as pixman-sse2.c, so the output is bit for bit identical; operations
+ * not implemented here fall through to the SSSE3 and SSE2 code.
+ *
+ * The 256 bit unpack and pack instructions work on each 128 bit half
+ * separately, so after unpacking, the low register holds pixels 0, 1, 4
+ * and 5 and the high one pixels 2, 3, 6 and 7.  Packing reverses that,
+ * which is all the per-pixel code needs.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <immintrin.h>
+#include "pixman-private.h"
+#include "pixman-combine32.h"
+#include "pixman-inlines.h"
+
+/* ------------------------------------------------------------------
+ * One pixel helpers, used for the unaligned heads and tails of spans
+ */
+
+static force_inline __m128i
+unpack_32_1x128 (uint32_t data)
+{
+    return _mm_unpacklo_epi8 (_mm_cvtsi32_si128 (data), _mm_setzero_si128 ());
+}
+
+static force_inline uint32_t
+pack_1x128_32 (__m128i data)
+{
+    return _mm_cvtsi128_si32 (_mm_packus_epi16 (data, _mm_setzero_si128 ()));
+}
+
+static force_inline __m128i
+expand_alpha_1x128 (__m128i data)
+{
+    return _mm_shufflehi_epi16 (_mm_shufflelo_epi16 (data,
+						     _MM_SHUFFLE (3, 3, 3, 3)),
+				_MM_SHUFFLE (3, 3, 3, 3));
+}
+
+static force_inline __m128i
+expand_pixel_32_1x128 (uint32_t data)
+{
+    return _mm_shuffle_epi32 (unpack_32_1x128 (data), _MM_SHUFFLE (1, 0, 1, 0));
+}
+
+static force_inline __m128i
+pix_multiply_1x128 (__m128i data,
+		    __m128i alpha)
+{
+    return _mm_mulhi_epu16 (_mm_adds_epu16 (_mm_mullo_epi16 (data, alpha),
+					    _mm_set1_epi16 (0x0080)),
+			    _mm_set1_epi16 (0x0101));
+}
+
+static force_inline __m128i
+over_1x128 (__m128i src, __m128i alpha, __m128i dst)
+{
+    __m128i ia = _mm_xor_si128 (alpha, _mm_set1_epi16 (0x00ff));
+
+    return _mm_adds_epu8 (src, pix_multiply_1x128 (dst, ia));
+}
+
+static force_inline uint32_t
+core_combine_over_u_pixel_avx2 (uint32_t src, uint32_t dst)
+{
+    uint8_t a;
+    __m128i xmms;
+
+    a = src >> 24;
+
+    if (a == 0xff)
+    {
+	return src;
+    }
+    else if (src)
+    {
+	xmms = unpack_32_1x128 (src);
+	return pack_1x128_32 (
+	    over_1x128 (xmms, expand_alpha_1x128 (xmms),
+			unpack_32_1x128 (dst)));
+    }
+
+    return dst;
+}
+
+static force_inline uint32_t
+core_combine_in_u_pixel_avx2 (uint32_t src, uint32_t dst)
+{
+    uint32_t maska = src >> 24;
+
+    if (maska == 0)
+    {
+	return 0;
+    }
+    else if (maska != 0xff)
+    {
+	return pack_1x128_32 (
+	    pix_multiply_1x128 (unpack_32_1x128 (dst),
+				expand_alpha_1x128 (unpack_32_1x128 (src))));
+    }
+
+    return dst;
+}
+
+static force_inline uint32_t
+combine1 (const uint32_t *ps, const uint32_t *pm)
+{
+    uint32_t s;
+    memcpy (&s, ps, sizeof (uint32_t));
+
+    if (pm)
+    {
+	__m128i ms, mm;
+
+	mm = unpack_32_1x128 (*pm);
+	mm = expand_alpha_1x128 (mm);
+
+	ms = unpack_32_1x128 (s);
+	ms = pix_multiply_1x128 (ms, mm);
+
+	s = pack_1x128_32 (ms);
+    }
+
+    return s;
+}
+
+static force_inline uint32_t
+add_1x32 (uint32_t s, uint32_t d)
+{
+    return _mm_cvtsi128_si32 (
+	_mm_adds_epu8 (_mm_cvtsi32_si128 (s), _mm_cvtsi32_si128 (d)));
+}
+
+static force_inline uint16_t
+over_8888_0565_pixel (uint32_t src, uint16_t dst)
+{
+    __m128i ms = unpack_32_1x128 (src);
+
+    return convert_8888_to_0565 (
+	pack_1x128_32 (
+	    over_1x128 (ms, expand_alpha_1x128 (ms),
+			unpack_32_1x128 (convert_0565_to_8888 (dst)))));
+}
+
+/* ------------------------------------------------------------------
+ * Eight pixel helpers
+ */
+
+static force_inline __m256i
+load_256_unaligned (const void *src)
+{
+    return _mm256_loadu_si256 ((const __m256i *)src);
+}
+
+static force_inline __m256i
+load_256_aligned (const void *src)
+{
+    return _mm256_load_si256 ((const __m256i *)src);
+}
+
+static force_inline void
+save_256_aligned (void *dst, __m256i data)
+{
+    _mm256_store_si256 ((__m256i *)dst, data);
+}
+
+static force_inline void
+unpack_256_2x256 (__m256i data, __m256i *data_lo, __m256i *data_hi)
+{
+    *data_lo = _mm256_unpacklo_epi8 (data, _mm256_setzero_si256 ());
+    *data_hi = _mm256_unpackhi_epi8 (data, _mm256_setzero_si256 ());
+}
+
+static force_inline __m256i
+pack_2x256_256 (__m256i lo, __m256i hi)
+{
+    return _mm256_packus_epi16 (lo, hi);
+}
+
+static force_inline __m256i
+expand_alpha_256 (__m256i data)
+{
+    return _mm256_shufflehi_epi16 (_mm256_shufflelo_epi16 (
+				       data, _MM_SHUFFLE (3, 3, 3, 3)),
+				   _MM_SHUFFLE (3, 3, 3, 3));
+}
+
+static force_inline __m256i
+pix_multiply_256 (__m256i data, __m256i alpha)
+{
+    return _mm256_mulhi_epu16 (
+	_mm256_adds_epu16 (_mm256_mullo_epi16 (data, alpha),
+			   _mm256_set1_epi16 (0x0080)),
+	_mm256_set1_epi16 (0x0101));
+}
+
+static force_inline __m256i
+over_256 (__m256i src, __m256i alpha, __m256i dst)
+{
+    __m256i ia = _mm256_xor_si256 (alpha, _mm256_set1_epi16 (0x00ff));
+
+    return _mm256_adds_epu8 (src, pix_multiply_256 (dst, ia));
+}
+
+static force_inline int
+is_opaque_256 (__m256i x)
+{
+    __m256i ffs = _mm256_cmpeq_epi8 (x, x);
+
+    return ((uint32_t)_mm256_movemask_epi8 (_mm256_cmpeq_epi8 (x, ffs)) &
+	    0x88888888) == 0x88888888;
+}
+
+static force_inline int
+is_zero_256 (__m256i x)
+{
+    return _mm256_testz_si256 (x, x);
+}
+
+static force_inline int
+is_transparent_256 (__m256i x)
+{
+    __m256i zero = _mm256_setzero_si256 ();
+
+    return ((uint32_t)_mm256_movemask_epi8 (_mm256_cmpeq_epi8 (x, zero)) &
+	    0x88888888) == 0x88888888;
+}
+
+/* Eight source pixels, multiplied by the mask alpha if there is a mask */
+static force_inline __m256i
+combine8 (const uint32_t *ps, const uint32_t *pm)
+{
+    __m256i src_lo, src_hi;
+    __m256i msk_lo, msk_hi;
+    __m256i s, m;
+
+    if (pm)
+    {
+	m = load_256_unaligned (pm);
+
+	if (is_transparent_256 (m))
+	    return _mm256_setzero_si256 ();
+    }
+
+    s = load_256_unaligned (ps);
+
+    if (pm)
+    {
+	unpack_256_2x256 (s, &src_lo, &src_hi);
+	unpack_256_2x256 (m, &msk_lo, &msk_hi);
+
+	src_lo = pix_multiply_256 (src_lo, expand_alpha_256 (msk_lo));
+	src_hi = pix_multiply_256 (src_hi, expand_alpha_256 (msk_hi));
+
+	s = pack_2x256_256 (src_lo, src_hi);
+    }
+
+    return s;
+}
+
+/* OVER of eight premultiplied pixels */
+static force_inline __m256i
+over_8x32 (__m256i src, __m256i dst)
+{
+    __m256i src_lo, src_hi, dst_lo, dst_hi;
+
+    unpack_256_2x256 (src, &src_lo, &src_hi);
+    unpack_256_2x256 (dst, &dst_lo, &dst_hi);
+
+    dst_lo = over_256 (src_lo, expand_alpha_256 (src_lo), dst_lo);
+    dst_hi = over_256 (src_hi, expand_alpha_256 (src_hi), dst_hi);
+
+    return pack_2x256_256 (dst_lo, dst_hi);
+}
+
+/* dst multiplied by the alpha of src */
+static force_inline __m256i
+in_8x32 (__m256i src, __m256i dst)
+{
+    __m256i src_lo, src_hi, dst_lo, dst_hi;
+
+    unpack_256_2x256 (src, &src_lo, &src_hi);
+    unpack_256_2x256 (dst, &dst_lo, &dst_hi);
+
+    dst_lo = pix_multiply_256 (dst_lo, expand_alpha_256 (src_lo));
+    dst_hi = pix_multiply_256 (dst_hi, expand_alpha_256 (src_hi));
+
+    return pack_2x256_256 (dst_lo, dst_hi);
+}
+
+/* Thirty-two 8 bit values multiplied by thirty-two others */
+static force_inline __m256i
+mul_32x8 (__m256i a, __m256i b)
+{
+    __m256i a_lo, a_hi, b_lo, b_hi;
+
+    unpack_256_2x256 (a, &a_lo, &a_hi);
+    unpack_256_2x256 (b, &b_lo, &b_hi);
+
+    return pack_2x256_256 (pix_multiply_256 (a_lo, b_lo),
+			   pix_multiply_256 (a_hi, b_hi));
+}
+
+/* The same for sixteen values, to get 8 bit spans to a 32-byte boundary */
+static force_inline __m128i
+mul_16x8 (__m128i a, __m128i b)
+{
+    __m128i zero = _mm_setzero_si128 ();
+
+    return _mm_packus_epi16 (
+	pix_multiply_1x128 (_mm_unpacklo_epi8 (a, zero),
+			    _mm_unpacklo_epi8 (b, zero)),
+	pix_multiply_1x128 (_mm_unpackhi_epi8 (a, zero),
+			    _mm_unpackhi_epi8 (b, zero)));
+}
+
+/* x8r8g8b8 to r5g6b5 and back, eight pixels at a time */
+static force_inline __m256i
+unpack_565_to_8888_256 (__m256i lo)
+{
+    __m256i r, g, b, rb, t;
+
+    r = _mm256_and_si256 (_mm256_slli_epi32 (lo, 8),
+			  _mm256_set1_epi32 (0x00f80000));
+    g = _mm256_and_si256 (_mm256_slli_epi32 (lo, 5),
+			  _mm256_set1_epi32 (0x0000fc00));
+    b = _mm256_and_si256 (_mm256_slli_epi32 (lo, 3),
+			  _mm256_set1_epi32 (0x000000f8));
+
+    rb = _mm256_or_si256 (r, b);
+    t  = _mm256_and_si256 (rb, _mm256_set1_epi32 (0x00e000e0));
+    t  = _mm256_srli_epi32 (t, 5);
+    rb = _mm256_or_si256 (rb, t);
+
+    t  = _mm256_and_si256 (g, _mm256_set1_epi32 (0x0000c000));
+    t  = _mm256_srli_epi32 (t, 6);
+    g  = _mm256_or_si256 (g, t);
+
+    return _mm256_or_si256 (rb, g);
+}
+
+static force_inline __m256i
+load_565_8x32 (const uint16_t *src)
+{
+    __m128i s = _mm_loadu_si128 ((const __m128i *)src);
+
+    return unpack_565_to_8888_256 (_mm256_cvtepu16_epi32 (s));
+}
+
+/* Each 32 bit lane becomes the 565 value in its low 16 bits, sign extended */
+static force_inline __m256i
+pack_565_8x32 (__m256i data)
+{
+    __m256i rb = _mm256_and_si256 (data, _mm256_set1_epi32 (0x00f800f8));
+    __m256i g = _mm256_and_si256 (data, _mm256_set1_epi32 (0x0000fc00));
+    __m256i t;
+
+    t = _mm256_madd_epi16 (rb, _mm256_set1_epi32 (0x20000004));
+    t = _mm256_or_si256 (t, g);
+    t = _mm256_slli_epi32 (t, 16 - 5);
+
+    return _mm256_srai_epi32 (t, 16);
+}
+
+/* Sixteen x8r8g8b8 pixels to sixteen r5g6b5 ones */
+static force_inline __m256i
+pack_565_2x256_256 (__m256i lo, __m256i hi)
+{
+    __m256i p = _mm256_packs_epi32 (pack_565_8x32 (lo), pack_565_8x32 (hi));
+
+    return _mm256_permute4x64_epi64 (p, _MM_SHUFFLE (3, 1, 2, 0));
+}
+
+/* Eight x8r8g8b8 pixels to eight r5g6b5 ones */
+static force_inline __m128i
+pack_565_256_128 (__m256i data)
+{
+    __m256i t = pack_565_8x32 (data);
+    __m256i p = _mm256_packs_epi32 (t, t);
+
+    return _mm256_castsi256_si128 (
+	_mm256_permute4x64_epi64 (p, _MM_SHUFFLE (3, 1, 2, 0)));
+}
+
+/* ------------------------------------------------------------------
+ * Combiners
+ */
+
+static force_inline void
+core_combine_over_u_avx2_mask (uint32_t *	  pd,
+			       const uint32_t*    ps,
+			       const uint32_t*    pm,
+			       int                w)
+{
+    uint32_t s, d;
+
+    /* Align dst on a 32-byte boundary */
+    while (w && ((uintptr_t)pd & 31))
+    {
+	d = *pd;
+	s = combine1 (ps, pm);
+
+	if (s)
+	    *pd = core_combine_over_u_pixel_avx2 (s, d);
+	pd++;
+	ps++;
+	pm++;
+	w--;
+    }
+
+    while (w >= 8)
+    {
+	__m256i mask = load_256_unaligned (pm);
+
+	if (!is_zero_256 (mask))
+	{
+	    __m256i src = load_256_unaligned (ps);
+
+	    if (is_opaque_256 (_mm256_and_si256 (src, mask)))
+		save_256_aligned (pd, src);
+	    else
+		save_256_aligned (pd, over_8x32 (combine8 (ps, pm),
+						 load_256_aligned (pd)));
+	}
+
+	pm += 8;
+	ps += 8;
+	pd += 8;
+	w -= 8;
+    }
+
+    while (w)
+    {
+	d = *pd;
+	s = combine1 (ps, pm);
+
+	if (s)
+	    *pd = core_combine_over_u_pixel_avx2 (s, d);
+	pd++;
+	ps++;
+	pm++;
+	w--;
+    }
+}
+
+static force_inline void
+core_combine_over_u_avx2_no_mask (uint32_t *	  pd,
+				  const uint32_t*    ps,
+				  int                w)
+{
+    uint32_t s, d;
+
+    /* Align dst on a 32-byte boundary */
+    while (w && ((uintptr_t)pd & 31))
+    {
+	d = *pd;
+	s = *ps;
+
+	if (s)
+	    *pd = core_combine_over_u_pixel_avx2 (s, d);
+	pd++;
+	ps++;
+	w--;
+    }
+
+    while (w >= 8)
+    {
+	__m256i src = load_256_unaligned (ps);
+
+	if (!is_zero_256 (src))
+	{
+	    if (is_opaque_256 (src))
+		save_256_aligned (pd, src);
+	    else
+		save_256_aligned (pd, over_8x32 (src, load_256_aligned (pd)));
+	}
+
+	ps += 8;
+	pd += 8;
+	w -= 8;
+    }
+
+    while (w)
+    {
+	d = *pd;
+	s = *ps;
+
+	if (s)
+	    *pd = core_combine_over_u_pixel_avx2 (s, d);
+	pd++;
+	ps++;
+	w--;
+    }
+}
+
+static force_inline void
+avx2_combine_over_u (pixman_implementation_t *imp,
+                     pixman_op_t              op,
+                     uint32_t *               pd,
+                     const uint32_t *         ps,
+                     const uint32_t *         pm,
+                     int                      w)
+{
+    if (pm)
+	core_combine_over_u_avx2_mask (pd, ps, pm, w);
+    else
+	core_combine_over_u_avx2_no_mask (pd, ps, w);
+}
+
+static void
+avx2_combine_over_reverse_u (pixman_implementation_t *imp,
+                             pixman_op_t              op,
+                             uint32_t *               pd,
+                             const uint32_t *         ps,
+                             const uint32_t *         pm,
+                             int                      w)
+{
+    uint32_t s, d;
+
+    while (w && ((uintptr_t)pd & 31))
+    {
+	d = *pd;
+	s = combine1 (ps, pm);
+
+	*pd++ = core_combine_over_u_pixel_avx2 (d, s);
+	w--;
+	ps++;
+	if (pm)
+	    pm++;
+    }
+
+    while (w >= 8)
+    {
+	save_256_aligned (pd, over_8x32 (load_256_aligned (pd),
+					 combine8 (ps, pm)));
+
+	w -= 8;
+	ps += 8;
+	pd += 8;
+	if (pm)
+	    pm += 8;
+    }
+
+    while (w)
+    {
+	d = *pd;
+	s = combine1 (ps, pm);
+
+	*pd++ = core_combine_over_u_pixel_avx2 (d, s);
+	w--;
+	ps++;
+	if (pm)
+	    pm++;
+    }
+}
+
+static void
+avx2_combine_in_u (pixman_implementation_t *imp,
+                   pixman_op_t              op,
+                   uint32_t *               pd,
+                   const uint32_t *         ps,
+                   const uint32_t *         pm,
+                   int                      w)
+{
+    uint32_t s, d;
+
+    while (w && ((uintptr_t)pd & 31))
+    {
+	s = combine1 (ps, pm);
+	d = *pd;
+
+	*pd++ = core_combine_in_u_pixel_avx2 (d, s);
+	w--;
+	ps++;
+	if (pm)
+	    pm++;
+    }
+
+    while (w >= 8)
+    {
+	save_256_aligned (pd, in_8x32 (load_256_aligned (pd),
+				       combine8 (ps, pm)));
+
+	ps += 8;
+	pd += 8;
+	w -= 8;
+	if (pm)
+	    pm += 8;
+    }
+
+    while (w)
+    {
+	s = combine1 (ps, pm);
+	d = *pd;
+
+	*pd++ = core_combine_in_u_pixel_avx2 (d, s);
+	w--;
+	ps++;
+	if (pm)
+	    pm++;
+    }
+}
+
+static void
+avx2_combine_in_reverse_u (pixman_implementation_t *imp,
+                           pixman_op_t              op,
+                           uint32_t *               pd,
+                           const uint32_t *         ps,
+                           const uint32_t *         pm,
+                           int                      w)
+{
+    uint32_t s, d;
+
+    while (w && ((uintptr_t)pd & 31))
+    {
+	s = combine1 (ps, pm);
+	d = *pd;
+
+	*pd++ = core_combine_in_u_pixel_avx2 (s, d);
+	w--;
+	ps++;
+	if (pm)
+	    pm++;
+    }
+
+    while (w >= 8)
+    {
+	save_256_aligned (pd, in_8x32 (combine8 (ps, pm),
+				       load_256_aligned (pd)));
+
+	ps += 8;
+	pd += 8;
+	w -= 8;
+	if (pm)
+	    pm += 8;
+    }
+
+    while (w)
+    {
+	s = combine1 (ps, pm);
+	d = *pd;
+
+	*pd++ = core_combine_in_u_pixel_avx2 (s, d);
+	w--;
+	ps++;
+	if (pm)
+	    pm++;
+    }
+}
+
+static force_inline void
+avx2_combine_add_u (pixman_implementation_t *imp,
+                    pixman_op_t              op,
+                    uint32_t *               pd,
+                    const uint32_t *         ps,
+                    const uint32_t *         pm,
+                    int                      w)
+{
+    while (w && ((uintptr_t)pd & 31))
+    {
+	*pd = add_1x32 (combine1 (ps, pm), *pd);
+	pd++;
+	ps++;
+	if (pm)
+	    pm++;
+	w--;
+    }
+
+    while (w >= 8)
+    {
+	save_256_aligned (pd, _mm256_adds_epu8 (combine8 (ps, pm),
+						load_256_aligned (pd)));
+
+	pd += 8;
+	ps += 8;
+	if (pm)
+	    pm += 8;
+	w -= 8;
+    }
+
+    while (w)
+    {
+	*pd = add_1x32 (combine1 (ps, pm), *pd);
+	pd++;
+	ps++;
+	if (pm)
+	    pm++;
+	w--;
+    }
+}
+
+/* ------------------------------------------------------------------
+ * Fast paths
+ */
+
+static pixman_bool_t
+avx2_fill (pixman_implementation_t *imp,
+           uint32_t *               bits,
+           int                      stride,
+           int                      bpp,
+           int                      x,
+           int                      y,
+           int                      width,
+           int                      height,
+           uint32_t		    filler)
+{
+    uint32_t byte_width;
+    uint8_t *byte_line;
+
+    __m256i ymm_def;
+
+    if (bpp == 8)
+    {
+	stride = stride * (int) sizeof (uint32_t);
+	byte_line = (uint8_t *)bits + stride * y + x;
+	byte_width = width;
+
+	filler = (filler & 0xff) * 0x01010101;
+    }
+    else if (bpp == 16)
+    {
+	stride = stride * (int) sizeof (uint32_t) / 2;
+	byte_line = (uint8_t *)(((uint16_t *)bits) + stride * y + x);
+	byte_width = 2 * width;
+	stride *= 2;
+
+	filler = (filler & 0xffff) * 0x00010001;
+    }
+    else if (bpp == 32)
+    {
+	byte_line = (uint8_t *)(bits + stride * y + x);
+	byte_width = 4 * width;
+	stride *= 4;
+    }
+    else
+    {
+	return FALSE;
+    }
+
+    ymm_def = _mm256_set1_epi32 (filler);
+
+    while (height--)
+    {
+	int w;
+	uint8_t *d = byte_line;
+	byte_line += stride;
+	w = byte_width;
+
+	if (w >= 1 && ((uintptr_t)d & 1))
+	{
+	    *(uint8_t *)d = filler & 0xff;
+	    w -= 1;
+	    d += 1;
+	}
+
+	while (w >= 2 && ((uintptr_t)d & 3))
+	{
+	    *(uint16_t *)d = filler & 0xffff;
+	    w -= 2;
+	    d += 2;
+	}
+
+	while (w >= 4 && ((uintptr_t)d & 31))
+	{
+	    *(uint32_t *)d = filler;
+	    w -= 4;
+	    d += 4;
+	}
+
+	while (w >= 128)
+	{
+	    save_256_aligned (d,      ymm_def);
+	    save_256_aligned (d + 32, ymm_def);
+	    save_256_aligned (d + 64, ymm_def);
+	    save_256_aligned (d + 96, ymm_def);
+
+	    d += 128;
+	    w -= 128;
+	}
+
+	while (w >= 32)
+	{
+	    save_256_aligned (d, ymm_def);
+
+	    d += 32;
+	    w -= 32;
+	}
+
+	while (w >= 4)
+	{
+	    *(uint32_t *)d = filler;
+	    w -= 4;
+	    d += 4;
+	}
+
+	if (w >= 2)
+	{
+	    *(uint16_t *)d = filler & 0xffff;
+	    w -= 2;
+	    d += 2;
+	}
+
+	if (w >= 1)
+	{
+	    *(uint8_t *)d = filler & 0xff;
+	    w -= 1;
+	    d += 1;
+	}
+    }
+
+    return TRUE;
+}
+
+static void
+avx2_composite_over_n_8888 (pixman_implementation_t *imp,
+                            pixman_composite_info_t *info)
+{
+    PIXMAN_COMPOSITE_ARGS (info);
+    uint32_t src;
+    uint32_t    *dst_line, *dst, d;
+    int32_t w;
+    int dst_stride;
+    __m128i xmm_src, xmm_alpha;
+    __m256i ymm_src, ymm_alpha;
+
+    src = _pixman_image_get_solid (imp, src_image, dest_image->bits.format);
+
+    if (src == 0)
+	return;
+
+    PIXMAN_IMAGE_GET_LINE (
+	dest_image, dest_x, dest_y, uint32_t, dst_stride, dst_line, 1);
+
+    xmm_src = expand_pixel_32_1x128 (src);
+    xmm_alpha = expand_alpha_1x128 (xmm_src);
+    ymm_src = _mm256_broadcastsi128_si256 (xmm_src);
+    ymm_alpha = _mm256_broadcastsi128_si256 (xmm_alpha);
+
+    while (height--)
+    {
+	dst = dst_line;
+	dst_line += dst_stride;
+	w = width;
+
+	while (w && (uintptr_t)dst & 31)
+	{
+	    d = *dst;
+	    *dst++ = pack_1x128_32 (over_1x128 (xmm_src,
+						xmm_alpha,
+						unpack_32_1x128 (d)));
+	    w--;
+	}
+
+	while (w >= 8)
+	{
+	    __m256i dst_lo, dst_hi;
+
+	    unpack_256_2x256 (load_256_aligned (dst), &dst_lo, &dst_hi);
+
+	    dst_lo = over_256 (ymm_src, ymm_alpha, dst_lo);
+	    dst_hi = over_256 (ymm_src, ymm_alpha, dst_hi);
+
+	    save_256_aligned (dst, pack_2x256_256 (dst_lo, dst_hi));
+
+	    w -= 8;
+	    dst += 8;
+	}
+
+	while (w)
+	{
+	    d = *dst;
+	    *dst++ = pack_1x128_32 (over_1x128 (xmm_src,
+						xmm_alpha,
+						unpack_32_1x128 (d)));
+	    w--;
+	}
+    }
+}
+
+static void
+avx2_composite_over_8888_8888 (pixman_implementation_t *imp,
+                               pixman_composite_info_t *info)
+{
+    PIXMAN_COMPOSITE_ARGS (info);
+    int dst_stride, src_stride;
+    uint32_t    *dst_line;
+    uint32_t    *src_line;
+
+    PIXMAN_IMAGE_GET_LINE (
+	dest_image, dest_x, dest_y, uint32_t, dst_stride, dst_line, 1);
+    PIXMAN_IMAGE_GET_LINE (
+	src_image, src_x, src_y, uint32_t, src_stride, src_line, 1);
+
+    while (height--)
+    {
+	core_combine_over_u_avx2_no_mask (dst_line, src_line, width);
+
+	dst_line += dst_stride;
+	src_line += src_stride;
+    }
+}
+
+static force_inline void
+over_8888_0565_8 (uint16_t *dst, const uint32_t *src)
+{
+    __m256i s = load_256_unaligned (src);
+
+    /* A transparent source leaves the destination as it is */
+    if (!is_zero_256 (s))
+    {
+	_mm_store_si128 ((__m128i *)dst,
+			 pack_565_256_128 (over_8x32 (s, load_565_8x32 (dst))));
+    }
+}
+
+static void
+avx2_composite_over_8888_0565 (pixman_implementation_t *imp,
+                               pixman_composite_info_t *info)
+{
+    PIXMAN_COMPOSITE_ARGS (info);
+    uint16_t    *dst_line, *dst;
+    uint32_t    *src_line, *src, s;
+    int dst_stride, src_stride;
+    int32_t w;
+
+    PIXMAN_IMAGE_GET_LINE (
+	dest_image, dest_x, dest_y, uint16_t, dst_stride, dst_line, 1);
+    PIXMAN_IMAGE_GET_LINE (
+	src_image, src_x, src_y, uint32_t, src_stride, src_line, 1);
+
+    while (height--)
+    {
+	dst = dst_line;
+	src = src_line;
+	dst_line += dst_stride;
+	src_line += src_stride;
+	w = width;
+
+	while (w && ((uintptr_t)dst & 15))
+	{
+	    s = *src++;
+	    *dst = over_8888_0565_pixel (s, *dst);
+	    dst++;
+	    w--;
+	}
+
+	if (w >= 8 && ((uintptr_t)dst & 31))
+	{
+	    over_8888_0565_8 (dst, src);
+
+	    w -= 8;
+	    src += 8;
+	    dst += 8;
+	}
+
+	while (w >= 16)
+	{
+	    __m256i src0 = load_256_unaligned (src);
+	    __m256i src1 = load_256_unaligned (src + 8);
+
+	    /* Expanding the destination and packing it again is lossless,
+	     * so only fully transparent sources need to be skipped.
+	     */
+	    if (!is_zero_256 (_mm256_or_si256 (src0, src1)))
+	    {
+		__m256i dst0 = over_8x32 (src0, load_565_8x32 (dst));
+		__m256i dst1 = over_8x32 (src1, load_565_8x32 (dst + 8));
+
+		save_256_aligned (dst, pack_565_2x256_256 (dst0, dst1));
+	    }
+
+	    w -= 16;
+	    src += 16;
+	    dst += 16;
+	}
+
+	if (w >= 8)
+	{
+	    over_8888_0565_8 (dst, src);
+
+	    w -= 8;
+	    src += 8;
+	    dst += 8;
+	}
+
+	while (w)
+	{
+	    s = *src++;
+	    *dst = over_8888_0565_pixel (s, *dst);
+	    dst++;
+	    w--;
+	}
+    }
+}
+
+static void
+avx2_composite_src_x888_0565 (pixman_implementation_t *imp,
+                              pixman_composite_info_t *info)
+{
+    PIXMAN_COMPOSITE_ARGS (info);
+    uint16_t    *dst_line, *dst;
+    uint32_t    *src_line, *src;
+    int dst_stride, src_stride;
+    int32_t w;
+
+    PIXMAN_IMAGE_GET_LINE (src_image, src_x, src_y, uint32_t, src_stride, src_line, 1);
+    PIXMAN_IMAGE_GET_LINE (dest_image, dest_x, dest_y, uint16_t, dst_stride, dst_line, 1);
+
+    while (height--)
+    {
+	dst = dst_line;
+	dst_line += dst_stride;
+	src = src_line;
+	src_line += src_stride;
+	w = width;
+
+	while (w && (uintptr_t)dst & 15)
+	{
+	    *dst++ = convert_8888_to_0565 (*src++);
+	    w--;
+	}
+
+	if (w >= 8 && ((uintptr_t)dst & 31))
+	{
+	    _mm_store_si128 ((__m128i *)dst,
+			     pack_565_256_128 (load_256_unaligned (src)));
+
+	    w -= 8;
+	    src += 8;
+	    dst += 8;
+	}
+
+	while (w >= 16)
+	{
+	    __m256i src0 = load_256_unaligned (src);
+	    __m256i src1 = load_256_unaligned (src + 8);
+
+	    save_256_aligned (dst, pack_565_2x256_256 (src0, src1));
+
+	    w -= 16;
+	    src += 16;
+	    dst += 16;
+	}
+
+	if (w >= 8)
+	{
+	    _mm_store_si128 ((__m128i *)dst,
+			     pack_565_256_128 (load_256_unaligned (src)));
+
+	    w -= 8;
+	    src += 8;
+	    dst += 8;
+	}
+
+	while (w)
+	{
+	    *dst++ = convert_8888_to_0565 (*src++);
+	    w--;
+	}
+    }
+}
+
+static void
+avx2_composite_src_x888_8888 (pixman_implementation_t *imp,
+			      pixman_composite_info_t *info)
+{
+    PIXMAN_COMPOSITE_ARGS (info);
+    uint32_t    *dst_line, *dst;
+    uint32_t    *src_line, *src;
+    int32_t w;
+    int dst_stride, src_stride;
+    __m256i ff000000 = _mm256_set1_epi32 (0xff000000);
+
+    PIXMAN_IMAGE_GET_LINE (
+	dest_image, dest_x, dest_y, uint32_t, dst_stride, dst_line, 1);
+    PIXMAN_IMAGE_GET_LINE (
+	src_image, src_x, src_y, uint32_t, src_stride, src_line, 1);
+
+    while (height--)
+    {
+	dst = dst_line;
+	dst_line += dst_stride;
+	src = src_line;
+	src_line += src_stride;
+	w = width;
+
+	while (w && (uintptr_t)dst & 31)
+	{
+	    *dst++ = *src++ | 0xff000000;
+	    w--;
+	}
+
+	while (w >= 16)
+	{
+	    __m256i src0 = load_256_unaligned (src);
+	    __m256i src1 = load_256_unaligned (src + 8);
+
+	    save_256_aligned (dst, _mm256_or_si256 (src0, ff000000));
+	    save_256_aligned (dst + 8, _mm256_or_si256 (src1, ff000000));
+
+	    w -= 16;
+	    src += 16;
+	    dst += 16;
+	}
+
+	while (w)
+	{
+	    *dst++ = *src++ | 0xff000000;
+	    w--;
+	}
+    }
+}
+
+static void
+avx2_composite_add_8_8 (pixman_implementation_t *imp,
+			pixman_composite_info_t *info)
+{
+    PIXMAN_COMPOSITE_ARGS (info);
+    uint8_t     *dst_line, *dst;
+    uint8_t     *src_line, *src;
+    int dst_stride, src_stride;
+    int32_t w;
+    uint16_t t;
+
+    PIXMAN_IMAGE_GET_LINE (
+	src_image, src_x, src_y, uint8_t, src_stride, src_line, 1);
+    PIXMAN_IMAGE_GET_LINE (
+	dest_image, dest_x, dest_y, uint8_t, dst_stride, dst_line, 1);
+
+    while (height--)
+    {
+	dst = dst_line;
+	src = src_line;
+
+	dst_line += dst_stride;
+	src_line += src_stride;
+	w = width;
+
+	/* Small head */
+	while (w && (uintptr_t)dst & 3)
+	{
+	    t = (*dst) + (*src++);
+	    *dst++ = t | (0 - (t >> 8));
+	    w--;
+	}
+
+	avx2_combine_add_u (imp, op,
+			    (uint32_t*)dst, (uint32_t*)src, NULL, w >> 2);
+
+	/* Small tail */
+	dst += w & 0xfffc;
+	src += w & 0xfffc;
+
+	w &= 3;
+
+	while (w)
+	{
+	    t = (*dst) + (*src++);
+	    *dst++ = t | (0 - (t >> 8));
+	    w--;
+	}
+    }
+}
+
+static void
+avx2_composite_add_8888_8888 (pixman_implementation_t *imp,
+                              pixman_composite_info_t *info)
+{
+    PIXMAN_COMPOSITE_ARGS (info);
+    uint32_t    *dst_line;
+    uint32_t    *src_line;
+    int dst_stride, src_stride;
+
+    PIXMAN_IMAGE_GET_LINE (
+	src_image, src_x, src_y, uint32_t, src_stride, src_line, 1);
+    PIXMAN_IMAGE_GET_LINE (
+	dest_image, dest_x, dest_y, uint32_t, dst_stride, dst_line, 1);
+
+    while (height--)
+    {
+	avx2_combine_add_u (imp, op, dst_line, src_line, NULL, width);
+
+	dst_line += dst_stride;
+	src_line += src_stride;
+    }
+}
+
+/*
+ * The IN operations on a8 destinations multiply each destination byte by
+ * a solid alpha, by the bytes of a mask (or source), or by both.  These
+ * return that factor for one, sixteen and thirty-two bytes; the one byte
+ * version returns it unpacked.
+ */
+static force_inline __m128i
+in_factor_1 (const uint8_t *mask, int has_mask, __m128i alpha, int has_alpha)
+{
+    __m128i m;
+
+    if (!has_mask)
+	return alpha;
+
+    m = unpack_32_1x128 (*mask);
+
+    return has_alpha ? pix_multiply_1x128 (alpha, m) : m;
+}
+
+static force_inline __m128i
+in_factor_16 (const uint8_t *mask, int has_mask, __m128i alpha, int has_alpha)
+{
+    __m128i m;
+
+    if (!has_mask)
+	return alpha;
+
+    m = _mm_loadu_si128 ((const __m128i *)mask);
+
+    return has_alpha ? mul_16x8 (alpha, m) : m;
+}
+
+static force_inline __m256i
+in_factor_32 (const uint8_t *mask, int has_mask, __m256i alpha, int has_alpha)
+{
+    __m256i m;
+
+    if (!has_mask)
+	return alpha;
+
+    m = load_256_unaligned (mask);
+
+    return has_alpha ? mul_32x8 (alpha, m) : m;
+}
+
+/* The head of the span is brought to a 32-byte boundary with single bytes
+ * and at most one 16 byte block, and the tail is done the same way, which
+ * keeps the scalar part short for narrow rectangles.
+ */
+static force_inline void
+in_8_span (uint8_t *dst, const uint8_t *mask, uint32_t alpha,
+	   int has_mask, int has_alpha, int w)
+{
+    __m128i alpha_1 = _mm_set1_epi16 (alpha);
+    __m128i alpha_16 = _mm_set1_epi8 (alpha);
+    __m256i alpha_32 = _mm256_set1_epi8 (alpha);
+    __m128i f;
+
+    while (w && ((uintptr_t)dst & 15))
+    {
+	f = in_factor_1 (mask++, has_mask, alpha_1, has_alpha);
+	*dst = pack_1x128_32 (pix_multiply_1x128 (f, unpack_32_1x128 (*dst)));
+	dst++;
+	w--;
+    }
+
+    if (w >= 16 && ((uintptr_t)dst & 31))
+    {
+	f = in_factor_16 (mask, has_mask, alpha_16, has_alpha);
+	_mm_store_si128 ((__m128i *)dst,
+			 mul_16x8 (f, _mm_load_si128 ((__m128i *)dst)));
+	dst += 16;
+	mask += 16;
+	w -= 16;
+    }
+
+    while (w >= 32)
+    {
+	save_256_aligned (dst, mul_32x8 (
+			      in_factor_32 (mask, has_mask, alpha_32, has_alpha),
+			      load_256_aligned (dst)));
+	dst += 32;
+	mask += 32;
+	w -= 32;
+    }
+
+    if (w >= 16)
+    {
+	f = in_factor_16 (mask, has_mask, alpha_16, has_alpha);
+	_mm_store_si128 ((__m128i *)dst,
+			 mul_16x8 (f, _mm_load_si128 ((__m128i *)dst)));
+	dst += 16;
+	mask += 16;
+	w -= 16;
+    }
+
+    while (w)
+    {
+	f = in_factor_1 (mask++, has_mask, alpha_1, has_alpha);
+	*dst = pack_1x128_32 (pix_multiply_1x128 (f, unpack_32_1x128 (*dst)));
+	dst++;
+	w--;
+    }
+}
+
+static void
+avx2_composite_in_n_8_8 (pixman_implementation_t *imp,
+                         pixman_composite_info_t *info)
+{
+    PIXMAN_COMPOSITE_ARGS (info);
+    uint8_t     *dst_line;
+    uint8_t     *mask_line;
+    int dst_stride, mask_stride;
+    uint32_t src;
+
+    PIXMAN_IMAGE_GET_LINE (
+	dest_image, dest_x, dest_y, uint8_t, dst_stride, dst_line, 1);
+    PIXMAN_IMAGE_GET_LINE (
+	mask_image, mask_x, mask_y, uint8_t, mask_stride, mask_line, 1);
+
+    src = _pixman_image_get_solid (imp, src_image, dest_image->bits.format);
+
+    while (height--)
+    {
+	in_8_span (dst_line, mask_line, src >> 24, TRUE, TRUE, width);
+
+	dst_line += dst_stride;
+	mask_line += mask_stride;
+    }
+}
+
+static void
+avx2_composite_in_n_8 (pixman_implementation_t *imp,
+		       pixman_composite_info_t *info)
+{
+    PIXMAN_COMPOSITE_ARGS (info);
+    uint8_t     *dst_line;
+    int dst_stride;
+    uint32_t src;
+
+    PIXMAN_IMAGE_GET_LINE (
+	dest_image, dest_x, dest_y, uint8_t, dst_stride, dst_line, 1);
+
+    src = _pixman_image_get_solid (imp, src_image, dest_image->bits.format);
+
+    src = src >> 24;
+
+    if (src == 0xff)
+	return;
+
+    if (src == 0x00)
+    {
+	pixman_fill (dest_image->bits.bits, dest_image->bits.rowstride,
+		     8, dest_x, dest_y, width, height, src);
+
+	return;
+    }
+
+    while (height--)
+    {
+	in_8_span (dst_line, NULL, src, FALSE, TRUE, width);
+
+	dst_line += dst_stride;
+    }
+}
+
+static void
+avx2_composite_in_8_8 (pixman_implementation_t *imp,
+                       pixman_composite_info_t *info)
+{
+    PIXMAN_COMPOSITE_ARGS (info);
+    uint8_t     *dst_line;
+    uint8_t     *src_line;
+    int src_stride, dst_stride;
+
+    PIXMAN_IMAGE_GET_LINE (
+	dest_image, dest_x, dest_y, uint8_t, dst_stride, dst_line, 1);
+    PIXMAN_IMAGE_GET_LINE (
+	src_image, src_x, src_y, uint8_t, src_stride, src_line, 1);
+
+    while (height--)
+    {
+	in_8_span (dst_line, src_line, 0, TRUE, FALSE, width);
+
+	dst_line += dst_stride;
+	src_line += src_stride;
+    }
+}
+
+static const pixman_fast_path_t avx2_fast_paths[] =
+{
+    PIXMAN_STD_FAST_PATH (OVER, solid, null, a8r8g8b8, avx2_composite_over_n_8888),
+    PIXMAN_STD_FAST_PATH (OVER, solid, null, x8r8g8b8, avx2_composite_over_n_8888),
+    PIXMAN_STD_FAST_PATH (OVER, a8r8g8b8, null, a8r8g8b8, avx2_composite_over_8888_8888),
+    PIXMAN_STD_FAST_PATH (OVER, a8r8g8b8, null, x8r8g8b8, avx2_composite_over_8888_8888),
+    PIXMAN_STD_FAST_PATH (OVER, a8b8g8r8, null, a8b8g8r8, avx2_composite_over_8888_8888),
+    PIXMAN_STD_FAST_PATH (OVER, a8b8g8r8, null, x8b8g8r8, avx2_composite_over_8888_8888),
+    PIXMAN_STD_FAST_PATH (OVER, a8r8g8b8, null, r5g6b5, avx2_composite_over_8888_0565),
+    PIXMAN_STD_FAST_PATH (OVER, a8b8g8r8, null, b5g6r5, avx2_composite_over_8888_0565),
+
+    PIXMAN_STD_FAST_PATH (ADD, a8, null, a8, avx2_composite_add_8_8),
+    PIXMAN_STD_FAST_PATH (ADD, a8r8g8b8, null, a8r8g8b8, avx2_composite_add_8888_8888),
+    PIXMAN_STD_FAST_PATH (ADD, a8b8g8r8, null, a8b8g8r8, avx2_composite_add_8888_8888),
+
+    PIXMAN_STD_FAST_PATH (SRC, a8r8g8b8, null, r5g6b5, avx2_composite_src_x888_0565),
+    PIXMAN_STD_FAST_PATH (SRC, a8b8g8r8, null, b5g6r5, avx2_composite_src_x888_0565),
+    PIXMAN_STD_FAST_PATH (SRC, x8r8g8b8, null, r5g6b5, avx2_composite_src_x888_0565),
+    PIXMAN_STD_FAST_PATH (SRC, x8b8g8r8, null, b5g6r5, avx2_composite_src_x888_0565),
+    PIXMAN_STD_FAST_PATH (SRC, x8r8g8b8, null, a8r8g8b8, avx2_composite_src_x888_8888),
+    PIXMAN_STD_FAST_PATH (SRC, x8b8g8r8, null, a8b8g8r8, avx2_composite_src_x888_8888),
+
+    PIXMAN_STD_FAST_PATH (IN, a8, null, a8, avx2_composite_in_8_8),
+    PIXMAN_STD_FAST_PATH (IN, solid, a8, a8, avx2_composite_in_n_8_8),
+    PIXMAN_STD_FAST_PATH (IN, solid, null, a8, avx2_composite_in_n_8),
+
+    { PIXMAN_OP_NONE },
+};
+
+/* ------------------------------------------------------------------
+ * Iterators
+ */
+
+static uint32_t *
+avx2_fetch_x8r8g8b8 (pixman_iter_t *iter, const uint32_t *mask)
+{
+    int w = iter->width;
+    uint32_t *dst = iter->buffer;
+    uint32_t *src = (uint32_t *)iter->bits;
+    __m256i ff000000 = _mm256_set1_epi32 (0xff000000);
+
+    iter->bits += iter->stride;
+
+    while (w && ((uintptr_t)dst) & 31)
+    {
+	*dst++ = (*src++) | 0xff000000;
+	w--;
+    }
+
+    while (w >= 8)
+    {
+	save_256_aligned (dst, _mm256_or_si256 (load_256_unaligned (src),
+						ff000000));
+
+	dst += 8;
+	src += 8;
+	w -= 8;
+    }
+
+    while (w)
+    {
+	*dst++ = (*src++) | 0xff000000;
+	w--;
+    }
+
+    return iter->buffer;
+}
+
+static uint32_t *
+avx2_fetch_r5g6b5 (pixman_iter_t *iter, const uint32_t *mask)
+{
+    int w = iter->width;
+    uint32_t *dst = iter->buffer;
+    uint16_t *src = (uint16_t *)iter->bits;
+    __m256i ff000000 = _mm256_set1_epi32 (0xff000000);
+
+    iter->bits += iter->stride;
+
+    while (w && ((uintptr_t)dst) & 31)
+    {
+	*dst++ = convert_0565_to_8888 (*src++);
+	w--;
+    }
+
+    while (w >= 8)
+    {
+	save_256_aligned (dst, _mm256_or_si256 (load_565_8x32 (src), ff000000));
+
+	dst += 8;
+	src += 8;
+	w -= 8;
+    }
+
+    while (w)
+    {
+	*dst++ = convert_0565_to_8888 (*src++);
+	w--;
+    }
+
+    return iter->buffer;
+}
+
+static uint32_t *
+avx2_fetch_a8 (pixman_iter_t *iter, const uint32_t *mask)
+{
+    int w = iter->width;
+    uint32_t *dst = iter->buffer;
+    uint8_t *src = iter->bits;
+
+    iter->bits += iter->stride;
+
+    while (w && (((uintptr_t)dst) & 31))
+    {
+	*dst++ = (uint32_t)(*(src++)) << 24;
+	w--;
+    }
+
+    while (w >= 8)
+    {
+	__m128i s = _mm_loadl_epi64 ((const __m128i *)src);
+
+	save_256_aligned (dst, _mm256_slli_epi32 (_mm256_cvtepu8_epi32 (s), 24));
+
+	dst += 8;
+	src += 8;
+	w -= 8;
+    }
+
+    while (w)
+    {
+	*dst++ = (uint32_t)(*(src++)) << 24;
+	w--;
+    }
+
+    return iter->buffer;
+}
+
+#define IMAGE_FLAGS							\
+    (FAST_PATH_STANDARD_FLAGS | FAST_PATH_ID_TRANSFORM |		\
+     FAST_PATH_BITS_IMAGE | FAST_PATH_SAMPLES_COVER_CLIP_NEAREST)
+
+static const pixman_iter_info_t avx2_iters[] =
+{
+    { PIXMAN_x8r8g8b8, IMAGE_FLAGS, ITER_NARROW,
+      _pixman_iter_init_bits_stride, avx2_fetch_x8r8g8b8, NULL
+    },
+    { PIXMAN_r5g6b5, IMAGE_FLAGS, ITER_NARROW,
+      _pixman_iter_init_bits_stride, avx2_fetch_r5g6b5, NULL
+    },
+    { PIXMAN_a8, IMAGE_FLAGS, ITER_NARROW,
+      _pixman_iter_init_bits_stride, avx2_fetch_a8, NULL
+    },
+    { PIXMAN_null },
+};
+
+pixman_implementation_t *
+_pixman_implementation_create_avx2 (pixman_implementation_t *fallback)
+{
+    pixman_implementation_t *imp = _pixman_implementation_create (fallback, avx2_fast_paths);
+
+    imp->combine_32[PIXMAN_OP_OVER] = avx2_combine_over_u;
+    imp->combine_32[PIXMAN_OP_OVER_REVERSE] = avx2_combine_over_reverse_u;
+    imp->combine_32[PIXMAN_OP_IN] = avx2_combine_in_u;
+    imp->combine_32[PIXMAN_OP_IN_REVERSE] = avx2_combine_in_reverse_u;
+    imp->combine_32[PIXMAN_OP_ADD] = avx2_combine_add_u;
+
+    imp->fill = avx2_fill;
+
+    imp->iter_info = avx2_iters;
+
+    return imp;
+}
@@ -36,12 +36,14 @@ typedef struct glyph_t glyph_t;
 
 #define TOMBSTONE ((glyph_t *)0x1)
 
-/* XXX: These numbers are arbitrary---we've never done any measurements.
+/* The cache holds as many glyphs as fit in the memory budget. The hash
+ * table grows with the number of glyphs; when it does, the entries are
+ * moved to the new table a few slots at a time by the following lookups
+ * and insertions, so no single call has to rehash the whole cache.
  */
-#define N_GLYPHS_HIGH_WATER  (16384)
-#define N_GLYPHS_LOW_WATER   (8192)
-#define HASH_SIZE (2 * N_GLYPHS_HIGH_WATER)
-#define HASH_MASK (HASH_SIZE - 1)
+#define DEFAULT_MEMORY_BUDGET	(16 * 1024 * 1024)
+#define MIN_HASH_SIZE		(256)
+#define N_MIGRATE_SLOTS		(64)
 
 struct glyph_t
 {
@@ -50,6 +52,7 @@ struct glyph_t
     int			origin_x;
     int			origin_y;
     pixman_image_t *	image;
+    uint32_t		size;
     pixman_link_t	mru_link;
 };
 
@@ -59,7 +62,21 @@ struct pixman_glyph_cache_t
     int			n_tombstones;
     int			freeze_count;
     pixman_list_t	mru;
-    glyph_t *		glyphs[HASH_SIZE];
+
+    glyph_t **		glyphs;
+    unsigned int	hash_mask;
+
+    /* The table being emptied into glyphs, or NULL */
+    glyph_t **		old_glyphs;
+    unsigned int	old_mask;
+    unsigned int	old_next;
+
+    uint64_t		memory;
+    uint64_t		memory_budget;
+    uint64_t		hits;
+    uint64_t		misses;
+    uint64_t		insertions;
+    uint64_t		evictions;
 };
 
 static void
@@ -91,23 +108,26 @@ hash (const void *font_key, const void *glyph_key)
     return key&0xffffffff;
 }
 
-static glyph_t *
-lookup_glyph (pixman_glyph_cache_t *cache,
-	      void                 *font_key,
-	      void                 *glyph_key)
+static glyph_t **
+find_slot (glyph_t      **table,
+	   unsigned int   mask,
+	   const void    *font_key,
+	   const void    *glyph_key)
 {
     unsigned idx;
     glyph_t *g;
 
     idx = hash (font_key, glyph_key);
-    while ((g = cache->glyphs[idx++ & HASH_MASK]))
+    while ((g = table[idx & mask]))
     {
 	if (g != TOMBSTONE			&&
 	    g->font_key == font_key		&&
 	    g->glyph_key == glyph_key)
 	{
-	    return g;
+	    return &table[idx & mask];
 	}
+
+	idx++;
     }
 
     return NULL;
@@ -127,36 +147,139 @@ insert_glyph (pixman_glyph_cache_t *cache,
      */
     do
     {
-	loc = &cache->glyphs[idx++ & HASH_MASK];
+	loc = &cache->glyphs[idx++ & cache->hash_mask];
     } while (*loc && *loc != TOMBSTONE);
 
     if (*loc == TOMBSTONE)
 	cache->n_tombstones--;
-    cache->n_glyphs++;
 
     *loc = glyph;
 }
 
+/* Move the entries of the next few slots of the old table. Migrated
+ * slots become tombstones so that the probe sequences of the remaining
+ * entries stay intact.
+ */
+static void
+migrate_glyphs (pixman_glyph_cache_t *cache,
+		unsigned int          n_slots)
+{
+    unsigned int end;
+
+    if (!cache->old_glyphs)
+	return;
+
+    end = cache->old_next + n_slots;
+    if (end > cache->old_mask + 1 || end < cache->old_next)
+	end = cache->old_mask + 1;
+
+    for (; cache->old_next < end; cache->old_next++)
+    {
+	glyph_t **loc = &cache->old_glyphs[cache->old_next];
+
+	if (*loc && *loc != TOMBSTONE)
+	{
+	    insert_glyph (cache, *loc);
+	    *loc = TOMBSTONE;
+	}
+    }
+
+    if (cache->old_next > cache->old_mask)
+    {
+	free (cache->old_glyphs);
+	cache->old_glyphs = NULL;
+    }
+}
+
+/* Start moving the glyphs to a table that is four times as large as
+ * needed for them. A migration that is still going on is finished
+ * first.
+ */
+static pixman_bool_t
+resize_table (pixman_glyph_cache_t *cache)
+{
+    unsigned int size = MIN_HASH_SIZE;
+    glyph_t **table;
+
+    while (size < 4 * (unsigned int)(cache->n_glyphs + 1))
+	size *= 2;
+
+    if (!(table = calloc (size, sizeof (glyph_t *))))
+	return FALSE;
+
+    migrate_glyphs (cache, ~0U);
+
+    cache->old_glyphs = cache->glyphs;
+    cache->old_mask = cache->hash_mask;
+    cache->old_next = 0;
+    cache->glyphs = table;
+    cache->hash_mask = size - 1;
+    cache->n_tombstones = 0;
+
+    return TRUE;
+}
+
+static glyph_t *
+lookup_glyph (pixman_glyph_cache_t *cache,
+	      void                 *font_key,
+	      void                 *glyph_key)
+{
+    glyph_t **loc;
+    glyph_t *g;
+
+    migrate_glyphs (cache, N_MIGRATE_SLOTS);
+
+    if ((loc = find_slot (cache->glyphs, cache->hash_mask, font_key, glyph_key)))
+	return *loc;
+
+    if (cache->old_glyphs &&
+	(loc = find_slot (cache->old_glyphs, cache->old_mask, font_key, glyph_key)))
+    {
+	/* Glyphs that are used are moved over right away */
+	g = *loc;
+	*loc = TOMBSTONE;
+	insert_glyph (cache, g);
+
+	return g;
+    }
+
+    return NULL;
+}
+
 static void
 remove_glyph (pixman_glyph_cache_t *cache,
 	      glyph_t              *glyph)
 {
     unsigned idx;
 
+    cache->n_glyphs--;
+    cache->memory -= glyph->size;
+
+    if (cache->old_glyphs)
+    {
+	glyph_t **loc = find_slot (cache->old_glyphs, cache->old_mask,
+				   glyph->font_key, glyph->glyph_key);
+
+	if (loc)
+	{
+	    *loc = TOMBSTONE;
+	    return;
+	}
+    }
+
     idx = hash (glyph->font_key, glyph->glyph_key);
-    while (cache->glyphs[idx & HASH_MASK] != glyph)
+    while (cache->glyphs[idx & cache->hash_mask] != glyph)
 	idx++;
 
-    cache->glyphs[idx & HASH_MASK] = TOMBSTONE;
+    cache->glyphs[idx & cache->hash_mask] = TOMBSTONE;
     cache->n_tombstones++;
-    cache->n_glyphs--;
 
     /* Eliminate tombstones if possible */
-    if (cache->glyphs[(idx + 1) & HASH_MASK] == NULL)
+    if (cache->glyphs[(idx + 1) & cache->hash_mask] == NULL)
     {
-	while (cache->glyphs[idx & HASH_MASK] == TOMBSTONE)
+	while (cache->glyphs[idx & cache->hash_mask] == TOMBSTONE)
 	{
-	    cache->glyphs[idx & HASH_MASK] = NULL;
+	    cache->glyphs[idx & cache->hash_mask] = NULL;
 	    cache->n_tombstones--;
 	    idx--;
 	}
@@ -166,20 +289,35 @@ remove_glyph (pixman_glyph_cache_t *cache,
 static void
 clear_table (pixman_glyph_cache_t *cache)
 {
-    int i;
+    while (cache->mru.head != (pixman_link_t *)&cache->mru)
+	free_glyph (CONTAINER_OF (glyph_t, mru_link, cache->mru.head));
 
-    for (i = 0; i < HASH_SIZE; ++i)
-    {
-	glyph_t *glyph = cache->glyphs[i];
+    free (cache->old_glyphs);
+    cache->old_glyphs = NULL;
 
-	if (glyph && glyph != TOMBSTONE)
-	    free_glyph (glyph);
-
-	cache->glyphs[i] = NULL;
-    }
+    memset (cache->glyphs, 0, (cache->hash_mask + 1) * sizeof (glyph_t *));
 
     cache->n_glyphs = 0;
     cache->n_tombstones = 0;
+    cache->memory = 0;
+}
+
+/* Free the least recently used glyphs until the cache fits in its
+ * budget. Only called when the cache is not frozen, since glyphs
+ * returned while it is frozen must stay valid.
+ */
+static void
+evict_glyphs (pixman_glyph_cache_t *cache)
+{
+    while (cache->memory > cache->memory_budget && cache->n_glyphs)
+    {
+	glyph_t *glyph = CONTAINER_OF (glyph_t, mru_link, cache->mru.tail);
+
+	remove_glyph (cache, glyph);
+	free_glyph (glyph);
+
+	cache->evictions++;
+    }
 }
 
 PIXMAN_EXPORT pixman_glyph_cache_t *
@@ -190,10 +328,21 @@ pixman_glyph_cache_create (void)
     if (!(cache = malloc (sizeof *cache)))
 	return NULL;
 
-    memset (cache->glyphs, 0, sizeof (cache->glyphs));
+    if (!(cache->glyphs = calloc (MIN_HASH_SIZE, sizeof (glyph_t *))))
+    {
+	free (cache);
+	return NULL;
+    }
+
+    cache->hash_mask = MIN_HASH_SIZE - 1;
+    cache->old_glyphs = NULL;
     cache->n_glyphs = 0;
     cache->n_tombstones = 0;
     cache->freeze_count = 0;
+    cache->memory = 0;
+    cache->memory_budget = DEFAULT_MEMORY_BUDGET;
+
+    pixman_glyph_cache_reset_stats (cache);
 
     pixman_list_init (&cache->mru);
 
@@ -207,6 +356,7 @@ pixman_glyph_cache_destroy (pixman_glyph_cache_t *cache)
 
     clear_table (cache);
 
+    free (cache->glyphs);
     free (cache);
 }
 
@@ -219,25 +369,40 @@ pixman_glyph_cache_freeze (pixman_glyph_cache_t  *cache)
 PIXMAN_EXPORT void
 pixman_glyph_cache_thaw (pixman_glyph_cache_t  *cache)
 {
-    if (--cache->freeze_count == 0					&&
-	cache->n_glyphs + cache->n_tombstones > N_GLYPHS_HIGH_WATER)
-    {
-	if (cache->n_tombstones > N_GLYPHS_HIGH_WATER)
-	{
-	    /* More than half the entries are
-	     * tombstones. Just dump the whole table.
-	     */
-	    clear_table (cache);
-	}
+    if (--cache->freeze_count == 0)
+	evict_glyphs (cache);
+}
 
-	while (cache->n_glyphs > N_GLYPHS_LOW_WATER)
-	{
-	    glyph_t *glyph = CONTAINER_OF (glyph_t, mru_link, cache->mru.tail);
+PIXMAN_EXPORT void
+pixman_glyph_cache_set_memory_budget (pixman_glyph_cache_t *cache,
+				      uint64_t              bytes)
+{
+    cache->memory_budget = bytes;
 
-	    remove_glyph (cache, glyph);
-	    free_glyph (glyph);
-	}
-    }
+    if (cache->freeze_count == 0)
+	evict_glyphs (cache);
+}
+
+PIXMAN_EXPORT void
+pixman_glyph_cache_get_stats (pixman_glyph_cache_t       *cache,
+			      pixman_glyph_cache_stats_t *stats)
+{
+    stats->hits = cache->hits;
+    stats->misses = cache->misses;
+    stats->insertions = cache->insertions;
+    stats->evictions = cache->evictions;
+    stats->n_glyphs = cache->n_glyphs;
+    stats->memory = cache->memory;
+    stats->memory_budget = cache->memory_budget;
+}
+
+PIXMAN_EXPORT void
+pixman_glyph_cache_reset_stats (pixman_glyph_cache_t *cache)
+{
+    cache->hits = 0;
+    cache->misses = 0;
+    cache->insertions = 0;
+    cache->evictions = 0;
 }
 
 PIXMAN_EXPORT const void *
@@ -245,7 +410,18 @@ pixman_glyph_cache_lookup (pixman_glyph_cache_t  *cache,
 			   void                  *font_key,
 			   void                  *glyph_key)
 {
-    return lookup_glyph (cache, font_key, glyph_key);
+    glyph_t *glyph;
+
+    if (!(glyph = lookup_glyph (cache, font_key, glyph_key)))
+    {
+	cache->misses++;
+	return NULL;
+    }
+
+    cache->hits++;
+    pixman_list_move_to_front (&cache->mru, &glyph->mru_link);
+
+    return glyph;
 }
 
 PIXMAN_EXPORT const void *
@@ -265,8 +441,14 @@ pixman_glyph_cache_insert (pixman_glyph_cache_t  *cache,
     width = image->bits.width;
     height = image->bits.height;
 
-    if (cache->n_glyphs >= HASH_SIZE)
-	return NULL;
+    migrate_glyphs (cache, N_MIGRATE_SLOTS);
+
+    /* Keep at least half of the table empty */
+    if (2 * (cache->n_glyphs + cache->n_tombstones + 1) > cache->hash_mask + 1)
+    {
+	if (!resize_table (cache))
+	    return NULL;
+    }
 
     if (!(glyph = malloc (sizeof *glyph)))
 	return NULL;
@@ -293,11 +475,18 @@ pixman_glyph_cache_insert (pixman_glyph_cache_t  *cache,
 	pixman_image_set_component_alpha (glyph->image, TRUE);
     }
 
+    glyph->size = sizeof (glyph_t) + sizeof (pixman_image_t) +
+	height * glyph->image->bits.rowstride * sizeof (uint32_t);
+
     pixman_list_prepend (&cache->mru, &glyph->mru_link);
 
     _pixman_image_validate (glyph->image);
     insert_glyph (cache, glyph);
 
+    cache->n_glyphs++;
+    cache->memory += glyph->size;
+    cache->insertions++;
+
     return glyph;
 }
 
@@ -491,7 +680,6 @@ pixman_composite_glyphs_no_mask (pixman_op_t            op,
 
 	    pbox++;
 	}
-	pixman_list_move_to_front (&cache->mru, &glyph->mru_link);
     }
 
 out:
@@ -607,8 +795,6 @@ add_glyphs (pixman_glyph_cache_t *cache,
 	    info.height = composite_box.y2 - composite_box.y1;
 
 	    func (implementation, &info);
-
-	    pixman_list_move_to_front (&cache->mru, &glyph->mru_link);
 	}
     }
 
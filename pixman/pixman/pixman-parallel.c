@@ -0,0 +1,609 @@
+/*
+ * Copyright © 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include "pixman-private.h"
+
+#include <stdlib.h>
+
+/*
+ * pixman_image_composite_parallel() splits the destination rectangle into
+ * horizontal bands and composites them with pixman_image_composite32() on
+ * the threads of a pool.  Every band goes through the normal fast path
+ * lookup, and since the pixels of a scanline are computed the same way
+ * whichever band they are in, the result is identical to that of a single
+ * pixman_image_composite32() call.
+ *
+ * The pool is either one of ours, or a function supplied by the caller that
+ * runs a set of tasks on its own threads.
+ */
+
+#if defined (HAVE_PTHREADS)
+
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+
+typedef pthread_mutex_t mutex_t;
+typedef pthread_cond_t cond_t;
+typedef pthread_t thread_t;
+
+#define mutex_init(m)		pthread_mutex_init (m, NULL)
+#define mutex_fini(m)		pthread_mutex_destroy (m)
+#define mutex_lock(m)		pthread_mutex_lock (m)
+#define mutex_unlock(m)		pthread_mutex_unlock (m)
+#define cond_init(c)		pthread_cond_init (c, NULL)
+#define cond_fini(c)		pthread_cond_destroy (c)
+#define cond_wait(c, m)		pthread_cond_wait (c, m)
+#define cond_broadcast(c)	pthread_cond_broadcast (c)
+
+#define HAVE_THREAD_POOL
+
+#elif defined (_WIN32)
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+typedef CRITICAL_SECTION mutex_t;
+typedef CONDITION_VARIABLE cond_t;
+typedef HANDLE thread_t;
+
+#define mutex_init(m)		InitializeCriticalSection (m)
+#define mutex_fini(m)		DeleteCriticalSection (m)
+#define mutex_lock(m)		EnterCriticalSection (m)
+#define mutex_unlock(m)		LeaveCriticalSection (m)
+#define cond_init(c)		InitializeConditionVariable (c)
+#define cond_fini(c)
+#define cond_wait(c, m)		SleepConditionVariableCS (c, m, INFINITE)
+#define cond_broadcast(c)	WakeAllConditionVariable (c)
+
+#define HAVE_THREAD_POOL
+
+#endif
+
+/* Bands smaller than this are not worth handing to another thread */
+#define MIN_BAND_PIXELS		(16 * 1024)
+#define MIN_BAND_ROWS		8
+#define BANDS_PER_THREAD	4
+#define MAX_THREADS		64
+
+struct pixman_thread_pool
+{
+    pixman_run_tasks_func_t	run_tasks;
+    void *			user_data;
+    int				n_threads;
+
+#ifdef HAVE_THREAD_POOL
+    mutex_t			lock;
+    cond_t			work;		/* tasks are available */
+    cond_t			done;		/* a job finished */
+    thread_t *			threads;
+    int				n_workers;
+    pixman_bool_t		quit;
+
+    /* The current job, func is NULL when there is none */
+    pixman_task_func_t		func;
+    void *			data;
+    int				next_task;
+    int				n_tasks;
+    int				pending;	/* tasks not finished yet */
+#endif
+};
+
+static int
+count_cpus (void)
+{
+#if defined (HAVE_PTHREADS) && defined (_SC_NPROCESSORS_ONLN)
+    long n = sysconf (_SC_NPROCESSORS_ONLN);
+
+    return n > 0 ? n : 1;
+#elif defined (_WIN32)
+    SYSTEM_INFO info;
+
+    GetSystemInfo (&info);
+    return info.dwNumberOfProcessors;
+#else
+    return 1;
+#endif
+}
+
+#ifdef HAVE_THREAD_POOL
+
+/*
+ * Run the next task of the current job, if there is one left.  Called and
+ * returns with the lock held.
+ */
+static pixman_bool_t
+pool_run_one_task (pixman_thread_pool_t *pool)
+{
+    pixman_task_func_t func = pool->func;
+    void *data = pool->data;
+    int task;
+
+    if (!func || pool->next_task == pool->n_tasks)
+	return FALSE;
+
+    task = pool->next_task++;
+
+    mutex_unlock (&pool->lock);
+    func (data, task);
+    mutex_lock (&pool->lock);
+
+    if (--pool->pending == 0)
+	cond_broadcast (&pool->done);
+
+    return TRUE;
+}
+
+#ifdef HAVE_PTHREADS
+static void *
+pool_thread (void *data)
+#else
+static DWORD WINAPI
+pool_thread (LPVOID data)
+#endif
+{
+    pixman_thread_pool_t *pool = data;
+
+#ifdef HAVE_PTHREADS
+    sigset_t set;
+
+    /* Signals are for the threads of the application */
+    sigfillset (&set);
+    pthread_sigmask (SIG_BLOCK, &set, NULL);
+#endif
+
+    mutex_lock (&pool->lock);
+
+    while (!pool->quit)
+    {
+	if (!pool_run_one_task (pool))
+	    cond_wait (&pool->work, &pool->lock);
+    }
+
+    mutex_unlock (&pool->lock);
+
+    return 0;
+}
+
+/*
+ * The run_tasks function of our own pools.  The calling thread runs tasks
+ * too, and jobs from several threads sharing a pool run one after the
+ * other.
+ */
+static void
+pool_run_tasks (void *		    user_data,
+		pixman_task_func_t  func,
+		void *		    data,
+		int		    n_tasks)
+{
+    pixman_thread_pool_t *pool = user_data;
+
+    mutex_lock (&pool->lock);
+
+    while (pool->func)
+	cond_wait (&pool->done, &pool->lock);
+
+    pool->func = func;
+    pool->data = data;
+    pool->next_task = 0;
+    pool->n_tasks = n_tasks;
+    pool->pending = n_tasks;
+
+    cond_broadcast (&pool->work);
+
+    while (pool_run_one_task (pool))
+	;
+
+    while (pool->pending)
+	cond_wait (&pool->done, &pool->lock);
+
+    pool->func = NULL;
+    cond_broadcast (&pool->done);
+
+    mutex_unlock (&pool->lock);
+}
+
+static void
+pool_stop_workers (pixman_thread_pool_t *pool)
+{
+    int i;
+
+    mutex_lock (&pool->lock);
+    pool->quit = TRUE;
+    cond_broadcast (&pool->work);
+    mutex_unlock (&pool->lock);
+
+    for (i = 0; i < pool->n_workers; ++i)
+    {
+#ifdef HAVE_PTHREADS
+	pthread_join (pool->threads[i], NULL);
+#else
+	WaitForSingleObject (pool->threads[i], INFINITE);
+	CloseHandle (pool->threads[i]);
+#endif
+    }
+}
+
+static void
+pool_start_workers (pixman_thread_pool_t *pool)
+{
+    int i;
+
+    pool->threads = pixman_malloc_ab (pool->n_threads, sizeof (thread_t));
+    if (!pool->threads)
+	return;
+
+    mutex_init (&pool->lock);
+    cond_init (&pool->work);
+    cond_init (&pool->done);
+
+    /* The thread calling pool_run_tasks() is one of the n_threads */
+    for (i = 0; i < pool->n_threads - 1; ++i)
+    {
+#ifdef HAVE_PTHREADS
+	if (pthread_create (&pool->threads[i], NULL, pool_thread, pool) != 0)
+	    break;
+#else
+	pool->threads[i] = CreateThread (NULL, 0, pool_thread, pool, 0, NULL);
+	if (!pool->threads[i])
+	    break;
+#endif
+    }
+
+    pool->n_workers = i;
+}
+
+#endif /* HAVE_THREAD_POOL */
+
+static void
+run_tasks_serially (void *		user_data,
+		    pixman_task_func_t	func,
+		    void *		data,
+		    int			n_tasks)
+{
+    int i;
+
+    for (i = 0; i < n_tasks; ++i)
+	func (data, i);
+}
+
+PIXMAN_EXPORT pixman_thread_pool_t *
+pixman_thread_pool_create (int n_threads)
+{
+    pixman_thread_pool_t *pool;
+
+    if (!(pool = calloc (1, sizeof *pool)))
+	return NULL;
+
+    if (n_threads <= 0)
+	n_threads = count_cpus ();
+
+    pool->n_threads = MIN (n_threads, MAX_THREADS);
+    pool->run_tasks = run_tasks_serially;
+
+#ifdef HAVE_THREAD_POOL
+    if (pool->n_threads > 1)
+    {
+	pool_start_workers (pool);
+
+	if (pool->n_workers)
+	{
+	    pool->run_tasks = pool_run_tasks;
+	    pool->user_data = pool;
+	}
+	pool->n_threads = pool->n_workers + 1;
+    }
+#else
+    pool->n_threads = 1;
+#endif
+
+    return pool;
+}
+
+PIXMAN_EXPORT pixman_thread_pool_t *
+pixman_thread_pool_create_custom (pixman_run_tasks_func_t  run_tasks,
+				  void *		   user_data,
+				  int			   n_threads)
+{
+    pixman_thread_pool_t *pool;
+
+    if (!run_tasks || n_threads <= 0)
+	return NULL;
+
+    if (!(pool = calloc (1, sizeof *pool)))
+	return NULL;
+
+    pool->run_tasks = run_tasks;
+    pool->user_data = user_data;
+    pool->n_threads = MIN (n_threads, MAX_THREADS);
+
+    return pool;
+}
+
+PIXMAN_EXPORT void
+pixman_thread_pool_destroy (pixman_thread_pool_t *pool)
+{
+    if (!pool)
+	return;
+
+#ifdef HAVE_THREAD_POOL
+    if (pool->threads)
+    {
+	pool_stop_workers (pool);
+
+	cond_fini (&pool->done);
+	cond_fini (&pool->work);
+	mutex_fini (&pool->lock);
+	free (pool->threads);
+    }
+#endif
+
+    free (pool);
+}
+
+/*
+ * The pool used when the caller passes NULL.  It is created the first time
+ * it is needed and stays around.
+ */
+static pixman_thread_pool_t *default_pool;
+
+#if defined (HAVE_PTHREADS)
+
+static pthread_once_t default_pool_once = PTHREAD_ONCE_INIT;
+
+static void
+create_default_pool (void)
+{
+    default_pool = pixman_thread_pool_create (0);
+}
+
+static pixman_thread_pool_t *
+get_default_pool (void)
+{
+    pthread_once (&default_pool_once, create_default_pool);
+
+    return default_pool;
+}
+
+#elif defined (_WIN32)
+
+static pixman_thread_pool_t *
+get_default_pool (void)
+{
+    pixman_thread_pool_t *pool = default_pool;
+
+    if (!pool)
+    {
+	pool = pixman_thread_pool_create (0);
+
+	if (InterlockedCompareExchangePointer (
+		(PVOID *)&default_pool, pool, NULL) != NULL)
+	{
+	    pixman_thread_pool_destroy (pool);
+	    pool = default_pool;
+	}
+    }
+
+    return pool;
+}
+
+#else
+
+static pixman_thread_pool_t *
+get_default_pool (void)
+{
+    return NULL;
+}
+
+#endif
+
+typedef struct
+{
+    pixman_op_t		op;
+    pixman_image_t *	src;
+    pixman_image_t *	mask;
+    pixman_image_t *	dest;
+    int32_t		src_x;
+    int32_t		src_y;
+    int32_t		mask_x;
+    int32_t		mask_y;
+    int32_t		dest_x;
+    int32_t		dest_y;
+    int32_t		width;
+
+    /* The bands split the rows y1 to y2 of the destination */
+    int32_t		y1, y2;
+    int32_t		band_height;
+} composite_job_t;
+
+static void
+composite_band (void *data, int band)
+{
+    composite_job_t *job = data;
+    int32_t y = job->y1 + band * job->band_height;
+    int32_t dy = y - job->dest_y;
+
+    pixman_image_composite32 (job->op, job->src, job->mask, job->dest,
+			      job->src_x, job->src_y + dy,
+			      job->mask_x, job->mask_y + dy,
+			      job->dest_x, y, job->width,
+			      MIN (job->band_height, job->y2 - y));
+}
+
+static void
+get_memory (pixman_image_t *image, uint8_t **start, uint8_t **end)
+{
+    bits_image_t *bits = &image->bits;
+    uint8_t *first = (uint8_t *)bits->bits;
+    uint8_t *last = (uint8_t *)(bits->bits + bits->rowstride * (bits->height - 1));
+    int stride = abs (bits->rowstride) * sizeof (uint32_t);
+
+    /* Rows can go up in memory when the stride is negative */
+    *start = MIN (first, last);
+    *end = MAX (first, last) + stride;
+}
+
+static pixman_bool_t
+overlaps (pixman_image_t *image, pixman_image_t *dest)
+{
+    uint8_t *s1, *e1, *s2, *e2;
+
+    if (!image || image->type != BITS || !image->bits.bits)
+	return FALSE;
+
+    if (image == dest)
+	return TRUE;
+
+    get_memory (image, &s1, &e1);
+    get_memory (dest, &s2, &e2);
+
+    return s1 < e2 && s2 < e1;
+}
+
+/*
+ * Bands can only be run concurrently when they don't share any state
+ * besides read-only source pixels.  Accessors are functions of the
+ * application, so they are not known to be thread safe, and when a source
+ * is also written by the operation, bands could read pixels that an
+ * earlier band has not written yet.
+ */
+static pixman_bool_t
+can_split (pixman_image_t *src, pixman_image_t *mask, pixman_image_t *dest)
+{
+    pixman_image_t *images[] = { src, mask, dest };
+    pixman_image_t *dest_alpha = (pixman_image_t *)dest->common.alpha_map;
+    int i;
+
+    for (i = 0; i < 3; ++i)
+    {
+	pixman_image_t *image = images[i];
+	pixman_image_t *alpha;
+
+	if (!image)
+	    continue;
+
+	if (!(image->common.flags & FAST_PATH_NO_ACCESSORS))
+	    return FALSE;
+
+	alpha = (pixman_image_t *)image->common.alpha_map;
+	if (alpha && !(alpha->common.flags & FAST_PATH_NO_ACCESSORS))
+	    return FALSE;
+
+	/* Only the sources are checked against the destination, which may
+	 * well be one of them.
+	 */
+	if (i == 2)
+	    continue;
+
+	if (overlaps (image, dest) || overlaps (alpha, dest) ||
+	    (dest_alpha &&
+	     (overlaps (image, dest_alpha) || overlaps (alpha, dest_alpha))))
+	{
+	    return FALSE;
+	}
+    }
+
+    return TRUE;
+}
+
+PIXMAN_EXPORT void
+pixman_image_composite_parallel (pixman_thread_pool_t *pool,
+				 pixman_op_t           op,
+				 pixman_image_t *      src,
+				 pixman_image_t *      mask,
+				 pixman_image_t *      dest,
+				 int32_t               src_x,
+				 int32_t               src_y,
+				 int32_t               mask_x,
+				 int32_t               mask_y,
+				 int32_t               dest_x,
+				 int32_t               dest_y,
+				 int32_t               width,
+				 int32_t               height)
+{
+    composite_job_t job;
+    int32_t y1, y2, rows;
+    int n_bands;
+
+    if (!pool)
+	pool = get_default_pool ();
+
+    /* The bands only read the images, so they must be validated here */
+    _pixman_image_validate (src);
+    if (mask)
+	_pixman_image_validate (mask);
+    _pixman_image_validate (dest);
+    get_implementation ();
+
+    /* Only the rows that can be written are split */
+    y1 = MAX (dest_y, 0);
+    y2 = dest_y + height;
+    if (dest->type == BITS)
+	y2 = MIN (y2, dest->bits.height);
+    if (dest->common.have_clip_region)
+    {
+	const pixman_box32_t *clip =
+	    pixman_region32_extents (&dest->common.clip_region);
+
+	y1 = MAX (y1, clip->y1);
+	y2 = MIN (y2, clip->y2);
+    }
+    rows = y2 - y1;
+
+    n_bands = 1;
+    if (pool && pool->n_threads > 1 && width > 0 && rows > 0)
+    {
+	n_bands = MIN (pool->n_threads * BANDS_PER_THREAD, rows / MIN_BAND_ROWS);
+	n_bands = MIN (n_bands, (int64_t)width * rows / MIN_BAND_PIXELS);
+    }
+
+    if (n_bands <= 1 || !can_split (src, mask, dest))
+    {
+	pixman_image_composite32 (op, src, mask, dest,
+				  src_x, src_y, mask_x, mask_y,
+				  dest_x, dest_y, width, height);
+	return;
+    }
+
+    job.op = op;
+    job.src = src;
+    job.mask = mask;
+    job.dest = dest;
+    job.src_x = src_x;
+    job.src_y = src_y;
+    job.mask_x = mask_x;
+    job.mask_y = mask_y;
+    job.dest_x = dest_x;
+    job.dest_y = dest_y;
+    job.width = width;
+    job.y1 = y1;
+    job.y2 = y2;
+    job.band_height = (rows + n_bands - 1) / n_bands;
+
+    n_bands = (rows + job.band_height - 1) / job.band_height;
+
+    pool->run_tasks (pool->user_data, composite_band, &job, n_bands);
+}
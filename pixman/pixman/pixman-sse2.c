@@ -33,6 +33,7 @@
 /* PSHUFD is slow on a lot of old processors, and new processors have SSSE3 */
 #define PSHUFD_IS_FAST 0
 
+#include <math.h>
 #include <xmmintrin.h> /* for _mm_shuffle_pi16 and _MM_SHUFFLE */
 #include <emmintrin.h> /* for SSE2 intrinsics */
 #include "pixman-private.h"
@@ -6448,6 +6449,1049 @@ sse2_fetch_a8 (pixman_iter_t *iter, const uint32_t *mask)
     return iter->buffer;
 }
 
+/*
+ * Bilinear and separable convolution fetchers for affine transforms.
+ * They compute exactly the same integer sums as the C versions in
+ * pixman-fast-path.c, only with the four channels of a pixel in one
+ * register, so the results are identical.
+ */
+static force_inline uint32_t
+sse2_affine_fetch_pixel (bits_image_t *bits, pixman_format_code_t format,
+			 int x, int y)
+{
+    const uint8_t *row = (uint8_t *)(bits->bits + bits->rowstride * y);
+
+    if (format == PIXMAN_a8)
+	return (uint32_t)row[x] << 24;
+    else if (format == PIXMAN_x8r8g8b8)
+	return ((uint32_t *)row)[x] | 0xff000000;
+    else
+	return ((uint32_t *)row)[x];
+}
+
+/* tltr and blbr hold the two top and the two bottom pixels in their low
+ * 64 bits.
+ */
+static force_inline uint32_t
+sse2_bilinear_interpolation (__m128i tltr, __m128i blbr, int distx, int disty)
+{
+    __m128i zero = _mm_setzero_si128 ();
+    __m128i v, h;
+
+    /* vertical interpolation, then pair up left and right for pmaddwd */
+    v = _mm_add_epi16 (
+	_mm_mullo_epi16 (_mm_unpacklo_epi8 (tltr, zero),
+			 _mm_set1_epi16 (BILINEAR_INTERPOLATION_RANGE - disty)),
+	_mm_mullo_epi16 (_mm_unpacklo_epi8 (blbr, zero),
+			 _mm_set1_epi16 (disty)));
+    h = _mm_madd_epi16 (
+	_mm_unpacklo_epi16 (v, _mm_srli_si128 (v, 8)),
+	_mm_set1_epi32 ((distx << 16) | (BILINEAR_INTERPOLATION_RANGE - distx)));
+
+    h = _mm_srli_epi32 (h, BILINEAR_INTERPOLATION_BITS * 2);
+    h = _mm_packs_epi32 (h, h);
+
+    return _mm_cvtsi128_si32 (_mm_packus_epi16 (h, h));
+}
+
+static force_inline uint32_t
+sse2_bilinear_interpolation_a8 (uint32_t tl, uint32_t tr,
+				uint32_t bl, uint32_t br,
+				int distx, int disty)
+{
+    int distix = BILINEAR_INTERPOLATION_RANGE - distx;
+    int distiy = BILINEAR_INTERPOLATION_RANGE - disty;
+    uint32_t a;
+
+    a = ((tl >> 24) * distix + (tr >> 24) * distx) * distiy +
+	((bl >> 24) * distix + (br >> 24) * distx) * disty;
+
+    return (a >> (BILINEAR_INTERPOLATION_BITS * 2)) << 24;
+}
+
+static force_inline void
+sse2_fetch_bilinear_affine (pixman_iter_t *       iter,
+			    const uint32_t *      mask,
+			    pixman_format_code_t  format,
+			    pixman_repeat_t       repeat_mode)
+{
+    pixman_image_t *image = iter->image;
+    bits_image_t *bits = &image->bits;
+    int width = bits->width;
+    int height = bits->height;
+    uint32_t *buffer = iter->buffer;
+    pixman_fixed_t x, y, ux, uy;
+    pixman_vector_t v;
+    int i;
+
+    /* reference point is the center of the pixel */
+    v.vector[0] = pixman_int_to_fixed (iter->x) + pixman_fixed_1 / 2;
+    v.vector[1] = pixman_int_to_fixed (iter->y++) + pixman_fixed_1 / 2;
+    v.vector[2] = pixman_fixed_1;
+
+    if (!pixman_transform_point_3d (image->common.transform, &v))
+	return;
+
+    ux = image->common.transform->matrix[0][0];
+    uy = image->common.transform->matrix[1][0];
+
+    x = v.vector[0] - pixman_fixed_1 / 2;
+    y = v.vector[1] - pixman_fixed_1 / 2;
+
+    for (i = 0; i < iter->width; ++i, x += ux, y += uy)
+    {
+	uint32_t tl, tr, bl, br;
+	int x1, y1, x2, y2;
+	int distx, disty;
+
+	if (mask && !mask[i])
+	    continue;
+
+	distx = pixman_fixed_to_bilinear_weight (x);
+	disty = pixman_fixed_to_bilinear_weight (y);
+
+	x1 = pixman_fixed_to_int (x);
+	y1 = pixman_fixed_to_int (y);
+	x2 = x1 + 1;
+	y2 = y1 + 1;
+
+	if (x1 >= 0 && x2 < width && y1 >= 0 && y2 < height)
+	{
+	    /* Inside the image, whatever the repeat mode */
+	    if (format != PIXMAN_a8)
+	    {
+		uint32_t *row = bits->bits + bits->rowstride * y1 + x1;
+		__m128i amask = _mm_set1_epi32 (
+		    format == PIXMAN_x8r8g8b8 ? 0xff000000 : 0);
+
+		buffer[i] = sse2_bilinear_interpolation (
+		    _mm_or_si128 (_mm_loadl_epi64 ((__m128i *)row), amask),
+		    _mm_or_si128 (_mm_loadl_epi64 (
+				      (__m128i *)(row + bits->rowstride)), amask),
+		    distx, disty);
+		continue;
+	    }
+
+	    tl = sse2_affine_fetch_pixel (bits, format, x1, y1);
+	    tr = sse2_affine_fetch_pixel (bits, format, x2, y1);
+	    bl = sse2_affine_fetch_pixel (bits, format, x1, y2);
+	    br = sse2_affine_fetch_pixel (bits, format, x2, y2);
+	}
+	else if (repeat_mode != PIXMAN_REPEAT_NONE)
+	{
+	    repeat (repeat_mode, &x1, width);
+	    repeat (repeat_mode, &y1, height);
+	    repeat (repeat_mode, &x2, width);
+	    repeat (repeat_mode, &y2, height);
+
+	    tl = sse2_affine_fetch_pixel (bits, format, x1, y1);
+	    tr = sse2_affine_fetch_pixel (bits, format, x2, y1);
+	    bl = sse2_affine_fetch_pixel (bits, format, x1, y2);
+	    br = sse2_affine_fetch_pixel (bits, format, x2, y2);
+	}
+	else if (x1 >= width || x2 < 0 || y1 >= height || y2 < 0)
+	{
+	    buffer[i] = 0;
+	    continue;
+	}
+	else
+	{
+	    /* On the edge; the pixels outside the image are transparent */
+	    tl = tr = bl = br = 0;
+
+	    if (y1 >= 0)
+	    {
+		if (x1 >= 0)
+		    tl = sse2_affine_fetch_pixel (bits, format, x1, y1);
+		if (x2 < width)
+		    tr = sse2_affine_fetch_pixel (bits, format, x2, y1);
+	    }
+	    if (y2 < height)
+	    {
+		if (x1 >= 0)
+		    bl = sse2_affine_fetch_pixel (bits, format, x1, y2);
+		if (x2 < width)
+		    br = sse2_affine_fetch_pixel (bits, format, x2, y2);
+	    }
+	}
+
+	if (format == PIXMAN_a8)
+	    buffer[i] = sse2_bilinear_interpolation_a8 (tl, tr, bl, br, distx, disty);
+	else
+	    buffer[i] = sse2_bilinear_interpolation (
+		_mm_unpacklo_epi32 (_mm_cvtsi32_si128 (tl), _mm_cvtsi32_si128 (tr)),
+		_mm_unpacklo_epi32 (_mm_cvtsi32_si128 (bl), _mm_cvtsi32_si128 (br)),
+		distx, disty);
+    }
+}
+
+/*
+ * Add pixel * f to the four 32 bit sums in acc.  Kernels can be scaled
+ * far beyond 1.0, so f may take all 32 bits.  SSE2 has no 32 bit
+ * multiply, so the products are put together from the low and high
+ * halves of f; like the C code they wrap around on overflow.
+ */
+static force_inline __m128i
+sse2_convolution_accumulate (__m128i acc, uint32_t pixel, int32_t f)
+{
+    __m128i p = _mm_unpacklo_epi8 (_mm_cvtsi32_si128 (pixel),
+				   _mm_setzero_si128 ());
+    __m128i f_lo = _mm_set1_epi16 ((int16_t)(f & 0xffff));
+    __m128i f_hi = _mm_set1_epi16 ((int16_t)((uint32_t)f >> 16));
+    __m128i lo = _mm_mullo_epi16 (p, f_lo);
+    __m128i hi = _mm_add_epi16 (_mm_mulhi_epu16 (p, f_lo),
+				_mm_mullo_epi16 (p, f_hi));
+
+    return _mm_add_epi32 (acc, _mm_unpacklo_epi16 (lo, hi));
+}
+
+/*
+ * Add up one row of the kernel.  When the kernel is inside the image the
+ * columns need no repeat handling.
+ */
+static force_inline void
+sse2_convolution_row (bits_image_t *          bits,
+		      pixman_format_code_t    format,
+		      pixman_repeat_t         repeat_mode,
+		      pixman_bool_t           inside,
+		      const pixman_fixed_t *  x_params,
+		      pixman_fixed_t          fy,
+		      int                     x1,
+		      int                     ry,
+		      int                     cwidth,
+		      __m128i *               acc,
+		      int32_t *               atot)
+{
+    const uint8_t *row = (uint8_t *)(bits->bits + bits->rowstride * ry);
+    uint32_t amask = format == PIXMAN_x8r8g8b8 ? 0xff000000 : 0;
+    int j;
+
+    for (j = 0; j < cwidth; ++j)
+    {
+	pixman_fixed_t fx = x_params[j];
+	int rx = x1 + j;
+	int32_t f;
+
+	if (!fx)
+	    continue;
+
+	if (!inside && !repeat (repeat_mode, &rx, bits->width))
+	    continue;
+
+	f = ((pixman_fixed_32_32_t)fx * fy + 0x8000) >> 16;
+
+	if (format == PIXMAN_a8)
+	    *atot += (int32_t)row[rx] * f;
+	else
+	    *acc = sse2_convolution_accumulate (
+		*acc, ((uint32_t *)row)[rx] | amask, f);
+    }
+}
+
+static force_inline void
+sse2_fetch_separable_convolution_affine (pixman_iter_t *       iter,
+					 const uint32_t *      mask,
+					 pixman_format_code_t  format,
+					 pixman_repeat_t       repeat_mode)
+{
+    pixman_image_t *image = iter->image;
+    bits_image_t *bits = &image->bits;
+    pixman_fixed_t *params = image->common.filter_params;
+    int cwidth = pixman_fixed_to_int (params[0]);
+    int cheight = pixman_fixed_to_int (params[1]);
+    int x_off = ((cwidth << 16) - pixman_fixed_1) >> 1;
+    int y_off = ((cheight << 16) - pixman_fixed_1) >> 1;
+    int x_phase_bits = pixman_fixed_to_int (params[2]);
+    int y_phase_bits = pixman_fixed_to_int (params[3]);
+    int x_phase_shift = 16 - x_phase_bits;
+    int y_phase_shift = 16 - y_phase_bits;
+    uint32_t *buffer = iter->buffer;
+    pixman_fixed_t vx, vy, ux, uy;
+    pixman_vector_t v;
+    int k;
+
+    /* reference point is the center of the pixel */
+    v.vector[0] = pixman_int_to_fixed (iter->x) + pixman_fixed_1 / 2;
+    v.vector[1] = pixman_int_to_fixed (iter->y++) + pixman_fixed_1 / 2;
+    v.vector[2] = pixman_fixed_1;
+
+    if (!pixman_transform_point_3d (image->common.transform, &v))
+	return;
+
+    ux = image->common.transform->matrix[0][0];
+    uy = image->common.transform->matrix[1][0];
+
+    vx = v.vector[0];
+    vy = v.vector[1];
+
+    for (k = 0; k < iter->width; ++k, vx += ux, vy += uy)
+    {
+	pixman_fixed_t *x_params, *y_params;
+	pixman_fixed_t x, y;
+	int32_t x1, y1, px, py;
+	pixman_bool_t inside;
+	__m128i acc = _mm_setzero_si128 ();
+	int32_t atot = 0;
+	int i;
+
+	if (mask && !mask[k])
+	    continue;
+
+	/* Round x and y to the middle of the closest phase, as in
+	 * bits_image_fetch_separable_convolution_affine().
+	 */
+	x = ((vx >> x_phase_shift) << x_phase_shift) + ((1 << x_phase_shift) >> 1);
+	y = ((vy >> y_phase_shift) << y_phase_shift) + ((1 << y_phase_shift) >> 1);
+
+	px = (x & 0xffff) >> x_phase_shift;
+	py = (y & 0xffff) >> y_phase_shift;
+
+	x1 = pixman_fixed_to_int (x - pixman_fixed_e - x_off);
+	y1 = pixman_fixed_to_int (y - pixman_fixed_e - y_off);
+
+	x_params = params + 4 + px * cwidth;
+	y_params = params + 4 + (1 << x_phase_bits) * cwidth + py * cheight;
+
+	/* Most of the time the whole kernel is inside the image and the
+	 * coordinates need no repeat handling.
+	 */
+	inside = x1 >= 0 && y1 >= 0 &&
+	    x1 + cwidth <= bits->width && y1 + cheight <= bits->height;
+
+	for (i = 0; i < cheight; ++i)
+	{
+	    pixman_fixed_t fy = y_params[i];
+	    int ry = y1 + i;
+
+	    if (!fy)
+		continue;
+
+	    if (inside)
+	    {
+		sse2_convolution_row (bits, format, repeat_mode, TRUE,
+				      x_params, fy, x1, ry, cwidth, &acc, &atot);
+	    }
+	    /* With REPEAT_NONE, rows outside the image add nothing */
+	    else if (repeat (repeat_mode, &ry, bits->height))
+	    {
+		sse2_convolution_row (bits, format, repeat_mode, FALSE,
+				      x_params, fy, x1, ry, cwidth, &acc, &atot);
+	    }
+	}
+
+	if (format == PIXMAN_a8)
+	{
+	    atot = (atot + 0x8000) >> 16;
+
+	    buffer[k] = CLIP (atot, 0, 0xff) << 24;
+	}
+	else
+	{
+	    acc = _mm_srai_epi32 (_mm_add_epi32 (acc, _mm_set1_epi32 (0x8000)), 16);
+	    acc = _mm_packs_epi32 (acc, acc);
+
+	    buffer[k] = _mm_cvtsi128_si32 (_mm_packus_epi16 (acc, acc));
+	}
+    }
+}
+
+#define MAKE_SSE2_AFFINE_FETCHERS(name, format, repeat_mode)		\
+    static uint32_t *							\
+    sse2_fetch_bilinear_affine_ ## name (pixman_iter_t   *iter,		\
+					 const uint32_t  *mask)		\
+    {									\
+	sse2_fetch_bilinear_affine (iter, mask,				\
+				    PIXMAN_ ## format, repeat_mode);	\
+	return iter->buffer;						\
+    }									\
+									\
+    static uint32_t *							\
+    sse2_fetch_separable_convolution_affine_ ## name (pixman_iter_t  *iter, \
+						      const uint32_t *mask) \
+    {									\
+	sse2_fetch_separable_convolution_affine (iter, mask,		\
+						 PIXMAN_ ## format,	\
+						 repeat_mode);		\
+	return iter->buffer;						\
+    }
+
+MAKE_SSE2_AFFINE_FETCHERS (pad_a8r8g8b8,     a8r8g8b8, PIXMAN_REPEAT_PAD)
+MAKE_SSE2_AFFINE_FETCHERS (none_a8r8g8b8,    a8r8g8b8, PIXMAN_REPEAT_NONE)
+MAKE_SSE2_AFFINE_FETCHERS (reflect_a8r8g8b8, a8r8g8b8, PIXMAN_REPEAT_REFLECT)
+MAKE_SSE2_AFFINE_FETCHERS (normal_a8r8g8b8,  a8r8g8b8, PIXMAN_REPEAT_NORMAL)
+MAKE_SSE2_AFFINE_FETCHERS (pad_x8r8g8b8,     x8r8g8b8, PIXMAN_REPEAT_PAD)
+MAKE_SSE2_AFFINE_FETCHERS (none_x8r8g8b8,    x8r8g8b8, PIXMAN_REPEAT_NONE)
+MAKE_SSE2_AFFINE_FETCHERS (reflect_x8r8g8b8, x8r8g8b8, PIXMAN_REPEAT_REFLECT)
+MAKE_SSE2_AFFINE_FETCHERS (normal_x8r8g8b8,  x8r8g8b8, PIXMAN_REPEAT_NORMAL)
+MAKE_SSE2_AFFINE_FETCHERS (pad_a8,           a8,       PIXMAN_REPEAT_PAD)
+MAKE_SSE2_AFFINE_FETCHERS (none_a8,          a8,       PIXMAN_REPEAT_NONE)
+MAKE_SSE2_AFFINE_FETCHERS (reflect_a8,       a8,       PIXMAN_REPEAT_REFLECT)
+MAKE_SSE2_AFFINE_FETCHERS (normal_a8,        a8,       PIXMAN_REPEAT_NORMAL)
+
+/* Gradients
+ *
+ * These compute four pixels at a time with the same arithmetic as the C
+ * fetchers: the positions in double precision and the colors in float, as
+ * the gradient walker does. The one difference is that conical gradients
+ * use a polynomial atan2() that is within about an ulp of the libm one, so
+ * a conical pixel whose position falls right on a rounding boundary may
+ * be off by one. Only the tolerance checked by gradient-test is promised,
+ * even though no such pixel has turned up in its cases.
+ */
+typedef struct
+{
+    __m128	a_s, a_b;
+    __m128	r_s, r_b;
+    __m128	g_s, g_b;
+    __m128	b_s, b_b;
+    __m128i	left_x;
+    __m128i	right_x;
+} sse2_gradient_walker_t;
+
+static force_inline void
+sse2_gradient_walker_load (sse2_gradient_walker_t         *sw,
+			   const pixman_gradient_walker_t *walker)
+{
+    sw->a_s = _mm_set1_ps (walker->a_s);
+    sw->a_b = _mm_set1_ps (walker->a_b);
+    sw->r_s = _mm_set1_ps (walker->r_s);
+    sw->r_b = _mm_set1_ps (walker->r_b);
+    sw->g_s = _mm_set1_ps (walker->g_s);
+    sw->g_b = _mm_set1_ps (walker->g_b);
+    sw->b_s = _mm_set1_ps (walker->b_s);
+    sw->b_b = _mm_set1_ps (walker->b_b);
+
+    sw->left_x = _mm_set1_epi32 (CLIP (walker->left_x, INT32_MIN, INT32_MAX));
+    sw->right_x = _mm_set1_epi32 (CLIP (walker->right_x, INT32_MIN, INT32_MAX));
+}
+
+/* Returns the colors at four positions. When they all lie between the
+ * two stops the walker is set up for, the colors are interpolated in
+ * parallel; otherwise the positions go through the C walker one by one,
+ * which moves it to the stops around the last one.
+ */
+static force_inline __m128i
+sse2_gradient_walker_pixels (pixman_gradient_walker_t *walker,
+			     sse2_gradient_walker_t   *sw,
+			     __m128i                   x)
+{
+    __m128i inside = _mm_andnot_si128 (_mm_cmplt_epi32 (x, sw->left_x),
+				       _mm_cmplt_epi32 (x, sw->right_x));
+
+    if (!walker->need_reset && _mm_movemask_epi8 (inside) == 0xffff)
+    {
+	__m128i mask_ff = _mm_set1_epi32 (0xff);
+	__m128 half = _mm_set1_ps (0.5f);
+	__m128 y, a, r, g, b;
+	__m128i ai, ri, gi, bi;
+
+	y = _mm_mul_ps (_mm_cvtepi32_ps (x), _mm_set1_ps (1.0f / 65536.0f));
+
+	a = _mm_mul_ps (_mm_set1_ps (255.f),
+			_mm_add_ps (_mm_mul_ps (sw->a_s, y), sw->a_b));
+	r = _mm_mul_ps (a, _mm_add_ps (_mm_mul_ps (sw->r_s, y), sw->r_b));
+	g = _mm_mul_ps (a, _mm_add_ps (_mm_mul_ps (sw->g_s, y), sw->g_b));
+	b = _mm_mul_ps (a, _mm_add_ps (_mm_mul_ps (sw->b_s, y), sw->b_b));
+
+	ai = _mm_cvttps_epi32 (_mm_add_ps (a, half));
+	ri = _mm_and_si128 (_mm_cvttps_epi32 (_mm_add_ps (r, half)), mask_ff);
+	gi = _mm_and_si128 (_mm_cvttps_epi32 (_mm_add_ps (g, half)), mask_ff);
+	bi = _mm_and_si128 (_mm_cvttps_epi32 (_mm_add_ps (b, half)), mask_ff);
+
+	return _mm_or_si128 (
+	    _mm_or_si128 (_mm_slli_epi32 (ai, 24), _mm_slli_epi32 (ri, 16)),
+	    _mm_or_si128 (_mm_slli_epi32 (gi, 8), bi));
+    }
+    else
+    {
+	int32_t pos[4];
+	uint32_t pixels[4];
+	int i;
+
+	_mm_storeu_si128 ((__m128i *)pos, x);
+
+	for (i = 0; i < 4; ++i)
+	    _pixman_gradient_walker_write_narrow (walker, pos[i], &pixels[i]);
+
+	sse2_gradient_walker_load (sw, walker);
+
+	return _mm_loadu_si128 ((__m128i *)pixels);
+    }
+}
+
+static force_inline void
+sse2_gradient_store (uint32_t *buffer, __m128i pixels, int n)
+{
+    if (n == 4)
+    {
+	_mm_storeu_si128 ((__m128i *)buffer, pixels);
+    }
+    else
+    {
+	uint32_t tmp[4];
+
+	_mm_storeu_si128 ((__m128i *)tmp, pixels);
+	memcpy (buffer, tmp, n * sizeof (uint32_t));
+    }
+}
+
+static force_inline pixman_bool_t
+sse2_gradient_mask_is_zero (const uint32_t *mask, int n)
+{
+    int i;
+
+    if (!mask)
+	return FALSE;
+
+    for (i = 0; i < n; ++i)
+    {
+	if (mask[i])
+	    return FALSE;
+    }
+
+    return TRUE;
+}
+
+static uint32_t *
+sse2_fetch_linear_gradient (pixman_iter_t *iter, const uint32_t *mask)
+{
+    pixman_image_t *image = iter->image;
+    linear_gradient_t *linear = (linear_gradient_t *)image;
+    int width = iter->width;
+    uint32_t *buffer = iter->buffer;
+    pixman_gradient_walker_t walker;
+    sse2_gradient_walker_t sw;
+    pixman_vector_t v;
+    pixman_fixed_t ux, uy;
+    pixman_fixed_48_16_t dx, dy;
+    pixman_fixed_32_32_t l, t;
+    double inc;
+    int i;
+
+    _pixman_gradient_walker_init (&walker, &linear->common,
+				  image->common.repeat);
+
+    /* reference point is the center of the pixel */
+    v.vector[0] = pixman_int_to_fixed (iter->x) + pixman_fixed_1 / 2;
+    v.vector[1] = pixman_int_to_fixed (iter->y) + pixman_fixed_1 / 2;
+    v.vector[2] = pixman_fixed_1;
+
+    ux = pixman_fixed_1;
+    uy = 0;
+
+    if (image->common.transform)
+    {
+	if (!pixman_transform_point_3d (image->common.transform, &v))
+	    return iter->buffer;
+
+	ux = image->common.transform->matrix[0][0];
+	uy = image->common.transform->matrix[1][0];
+    }
+
+    dx = linear->p2.x - linear->p1.x;
+    dy = linear->p2.y - linear->p1.y;
+
+    l = dx * dx + dy * dy;
+
+    if (l == 0 || v.vector[2] == 0)
+    {
+	t = 0;
+	inc = 0;
+    }
+    else
+    {
+	double invden, v2;
+
+	invden = pixman_fixed_1 * (double) pixman_fixed_1 /
+	    (l * (double) v.vector[2]);
+	v2 = v.vector[2] * (1. / pixman_fixed_1);
+	t = ((dx * v.vector[0] + dy * v.vector[1]) -
+	     (dx * linear->p1.x + dy * linear->p1.y) * v2) * invden;
+	inc = (dx * ux + dy * uy) * invden;
+    }
+
+    if (((pixman_fixed_32_32_t )(inc * width)) == 0)
+    {
+	_pixman_gradient_walker_fill_narrow (&walker, t, buffer, buffer + width);
+    }
+    else if (t > -0x40000000 && t < 0x40000000 &&
+	     inc * (width + 4) > -0x40000000 && inc * (width + 4) < 0x40000000)
+    {
+	/* All the positions fit in 32 bits */
+	__m128d inc2 = _mm_set1_pd (inc);
+	__m128d i01 = _mm_set_pd (1, 0);
+	__m128d i23 = _mm_set_pd (3, 2);
+	__m128i t4 = _mm_set1_epi32 (t);
+
+	sse2_gradient_walker_load (&sw, &walker);
+
+	for (i = 0; i < width; i += 4)
+	{
+	    int n = MIN (width - i, 4);
+
+	    if (!sse2_gradient_mask_is_zero (mask ? mask + i : NULL, n))
+	    {
+		__m128i x = _mm_unpacklo_epi64 (
+		    _mm_cvttpd_epi32 (_mm_mul_pd (inc2, i01)),
+		    _mm_cvttpd_epi32 (_mm_mul_pd (inc2, i23)));
+
+		x = _mm_add_epi32 (t4, x);
+
+		sse2_gradient_store (
+		    buffer + i, sse2_gradient_walker_pixels (&walker, &sw, x), n);
+	    }
+
+	    i01 = _mm_add_pd (i01, _mm_set1_pd (4));
+	    i23 = _mm_add_pd (i23, _mm_set1_pd (4));
+	}
+    }
+    else
+    {
+	for (i = 0; i < width; ++i)
+	{
+	    if (!mask || mask[i])
+	    {
+		_pixman_gradient_walker_write_narrow (
+		    &walker, t + (pixman_fixed_32_32_t)(inc * i), buffer + i);
+	    }
+	}
+    }
+
+    iter->y++;
+
+    return iter->buffer;
+}
+
+static force_inline pixman_fixed_32_32_t
+sse2_radial_dot (pixman_fixed_48_16_t x1,
+		 pixman_fixed_48_16_t y1,
+		 pixman_fixed_48_16_t z1,
+		 pixman_fixed_48_16_t x2,
+		 pixman_fixed_48_16_t y2,
+		 pixman_fixed_48_16_t z2)
+{
+    return x1 * x2 + y1 * y2 + z1 * z2;
+}
+
+/* Converts two 64 bit integers to doubles with a single rounding, which
+ * gives the same results as the scalar conversion
+ */
+static force_inline __m128d
+sse2_cvtepi64_pd (__m128i v)
+{
+    __m128d two_32 = _mm_set1_pd (4294967296.0);
+    __m128d hi = _mm_cvtepi32_pd (_mm_shuffle_epi32 (v, _MM_SHUFFLE (3, 1, 3, 1)));
+    __m128d lo = _mm_cvtepi32_pd (_mm_shuffle_epi32 (v, _MM_SHUFFLE (2, 0, 2, 0)));
+
+    lo = _mm_add_pd (
+	lo, _mm_and_pd (_mm_cmplt_pd (lo, _mm_setzero_pd ()), two_32));
+
+    return _mm_add_pd (_mm_mul_pd (hi, two_32), lo);
+}
+
+/* radial_write_color() for two pixels with a != 0: returns t and sets
+ * @valid for the pixels that are not transparent black
+ */
+static force_inline __m128d
+sse2_radial_t (const radial_gradient_t *radial,
+	       pixman_repeat_t          repeat,
+	       __m128i                  b64,
+	       __m128i                  c64,
+	       __m128d                 *valid)
+{
+    __m128d zero = _mm_setzero_pd ();
+    __m128d b = sse2_cvtepi64_pd (b64);
+    __m128d c = sse2_cvtepi64_pd (c64);
+    __m128d inva = _mm_set1_pd (radial->inva);
+    __m128d discr, sqrtdiscr, t0, t1, valid0, valid1;
+
+    discr = _mm_sub_pd (_mm_mul_pd (b, b),
+			_mm_mul_pd (_mm_set1_pd (radial->a), c));
+    sqrtdiscr = _mm_sqrt_pd (_mm_max_pd (discr, zero));
+
+    t0 = _mm_mul_pd (_mm_add_pd (b, sqrtdiscr), inva);
+    t1 = _mm_mul_pd (_mm_sub_pd (b, sqrtdiscr), inva);
+
+    if (repeat == PIXMAN_REPEAT_NONE)
+    {
+	__m128d one = _mm_set1_pd (pixman_fixed_1);
+
+	valid0 = _mm_and_pd (_mm_cmple_pd (zero, t0), _mm_cmple_pd (t0, one));
+	valid1 = _mm_and_pd (_mm_cmple_pd (zero, t1), _mm_cmple_pd (t1, one));
+    }
+    else
+    {
+	__m128d dr = _mm_set1_pd (radial->delta.radius);
+	__m128d mindr = _mm_set1_pd (radial->mindr);
+
+	valid0 = _mm_cmpge_pd (_mm_mul_pd (t0, dr), mindr);
+	valid1 = _mm_cmpge_pd (_mm_mul_pd (t1, dr), mindr);
+    }
+
+    *valid = _mm_and_pd (_mm_cmpge_pd (discr, zero),
+			 _mm_or_pd (valid0, valid1));
+
+    return _mm_or_pd (_mm_and_pd (valid0, t0), _mm_andnot_pd (valid0, t1));
+}
+
+static force_inline __m128i
+sse2_pack_pd_mask (__m128d lo, __m128d hi)
+{
+    return _mm_unpacklo_epi64 (
+	_mm_shuffle_epi32 (_mm_castpd_si128 (lo), _MM_SHUFFLE (2, 0, 2, 0)),
+	_mm_shuffle_epi32 (_mm_castpd_si128 (hi), _MM_SHUFFLE (2, 0, 2, 0)));
+}
+
+static uint32_t *
+sse2_fetch_radial_gradient (pixman_iter_t *iter, const uint32_t *mask)
+{
+    pixman_image_t *image = iter->image;
+    radial_gradient_t *radial = (radial_gradient_t *)image;
+    pixman_repeat_t repeat = image->common.repeat;
+    int width = iter->width;
+    uint32_t *buffer = iter->buffer;
+    pixman_gradient_walker_t walker;
+    sse2_gradient_walker_t sw;
+    pixman_vector_t v;
+    pixman_fixed_48_16_t ux, uy;
+    pixman_fixed_32_32_t b, db, c, dc, ddc;
+    pixman_fixed_32_32_t bs[4], cs[4], dcs[4], steps[6];
+    __m128i b01, b23, c01, c23, dc01, dc23;
+    __m128i db4, ddc4, ddc6;
+    int i;
+
+    /* reference point is the center of the pixel */
+    v.vector[0] = pixman_int_to_fixed (iter->x) + pixman_fixed_1 / 2;
+    v.vector[1] = pixman_int_to_fixed (iter->y) + pixman_fixed_1 / 2;
+    v.vector[2] = pixman_fixed_1;
+
+    _pixman_gradient_walker_init (&walker, &radial->common, repeat);
+
+    ux = pixman_fixed_1;
+    uy = 0;
+
+    if (image->common.transform)
+    {
+	if (!pixman_transform_point_3d (image->common.transform, &v))
+	    return iter->buffer;
+
+	ux = image->common.transform->matrix[0][0];
+	uy = image->common.transform->matrix[1][0];
+    }
+
+    /* B and C are computed exactly as in the affine case of
+     * radial_get_scanline(), then stepped four pixels at a time
+     */
+    v.vector[0] -= radial->c1.x;
+    v.vector[1] -= radial->c1.y;
+
+    b = sse2_radial_dot (v.vector[0], v.vector[1], radial->c1.radius,
+			 radial->delta.x, radial->delta.y,
+			 radial->delta.radius);
+    db = sse2_radial_dot (ux, uy, 0, radial->delta.x, radial->delta.y, 0);
+
+    c = sse2_radial_dot (v.vector[0], v.vector[1],
+			 -((pixman_fixed_48_16_t) radial->c1.radius),
+			 v.vector[0], v.vector[1], radial->c1.radius);
+    dc = sse2_radial_dot (2 * (pixman_fixed_48_16_t) v.vector[0] + ux,
+			  2 * (pixman_fixed_48_16_t) v.vector[1] + uy,
+			  0, ux, uy, 0);
+    ddc = 2 * sse2_radial_dot (ux, uy, 0, ux, uy, 0);
+
+    for (i = 0; i < 4; ++i)
+    {
+	bs[i] = b;
+	cs[i] = c;
+	dcs[i] = dc;
+
+	b += db;
+	c += dc;
+	dc += ddc;
+    }
+
+    steps[0] = steps[1] = 4 * db;
+    steps[2] = steps[3] = 4 * ddc;
+    steps[4] = steps[5] = 6 * ddc;
+
+    b01 = _mm_loadu_si128 ((__m128i *)&bs[0]);
+    b23 = _mm_loadu_si128 ((__m128i *)&bs[2]);
+    c01 = _mm_loadu_si128 ((__m128i *)&cs[0]);
+    c23 = _mm_loadu_si128 ((__m128i *)&cs[2]);
+    dc01 = _mm_loadu_si128 ((__m128i *)&dcs[0]);
+    dc23 = _mm_loadu_si128 ((__m128i *)&dcs[2]);
+    db4 = _mm_loadu_si128 ((__m128i *)&steps[0]);
+    ddc4 = _mm_loadu_si128 ((__m128i *)&steps[2]);
+    ddc6 = _mm_loadu_si128 ((__m128i *)&steps[4]);
+
+    sse2_gradient_walker_load (&sw, &walker);
+
+    for (i = 0; i < width; i += 4)
+    {
+	int n = MIN (width - i, 4);
+
+	if (!sse2_gradient_mask_is_zero (mask ? mask + i : NULL, n))
+	{
+	    __m128d t01, t23, valid01, valid23, in01, in23;
+	    __m128d lo = _mm_set1_pd (-2147483649.0);
+	    __m128d hi = _mm_set1_pd (2147483648.0);
+	    __m128i valid, in, pixels;
+
+	    t01 = sse2_radial_t (radial, repeat, b01, c01, &valid01);
+	    t23 = sse2_radial_t (radial, repeat, b23, c23, &valid23);
+
+	    in01 = _mm_and_pd (_mm_cmpgt_pd (t01, lo), _mm_cmplt_pd (t01, hi));
+	    in23 = _mm_and_pd (_mm_cmpgt_pd (t23, lo), _mm_cmplt_pd (t23, hi));
+
+	    valid = sse2_pack_pd_mask (valid01, valid23);
+	    in = sse2_pack_pd_mask (in01, in23);
+
+	    if (_mm_movemask_epi8 (valid) == 0)
+	    {
+		pixels = _mm_setzero_si128 ();
+	    }
+	    else if (_mm_movemask_epi8 (_mm_andnot_si128 (in, valid)) == 0)
+	    {
+		__m128i x = _mm_unpacklo_epi64 (_mm_cvttpd_epi32 (t01),
+						_mm_cvttpd_epi32 (t23));
+
+		/* Keep the walker where it is for the transparent pixels */
+		x = _mm_or_si128 (_mm_and_si128 (valid, x),
+				  _mm_andnot_si128 (valid, sw.left_x));
+
+		pixels = _mm_and_si128 (
+		    valid, sse2_gradient_walker_pixels (&walker, &sw, x));
+	    }
+	    else
+	    {
+		double ts[4];
+		uint32_t tmp[4];
+		int valid_bits = _mm_movemask_ps (_mm_castsi128_ps (valid));
+		int k;
+
+		_mm_storeu_pd (&ts[0], t01);
+		_mm_storeu_pd (&ts[2], t23);
+
+		for (k = 0; k < 4; ++k)
+		{
+		    if (valid_bits & (1 << k))
+			_pixman_gradient_walker_write_narrow (&walker, ts[k], &tmp[k]);
+		    else
+			tmp[k] = 0;
+		}
+
+		sse2_gradient_walker_load (&sw, &walker);
+
+		pixels = _mm_loadu_si128 ((__m128i *)tmp);
+	    }
+
+	    sse2_gradient_store (buffer + i, pixels, n);
+	}
+
+	b01 = _mm_add_epi64 (b01, db4);
+	b23 = _mm_add_epi64 (b23, db4);
+	c01 = _mm_add_epi64 (c01, _mm_add_epi64 (_mm_slli_epi64 (dc01, 2), ddc6));
+	c23 = _mm_add_epi64 (c23, _mm_add_epi64 (_mm_slli_epi64 (dc23, 2), ddc6));
+	dc01 = _mm_add_epi64 (dc01, ddc4);
+	dc23 = _mm_add_epi64 (dc23, ddc4);
+    }
+
+    iter->y++;
+
+    return iter->buffer;
+}
+
+/* atan2() of two pairs of coordinates. This is the atan() approximation
+ * from the Cephes library, with the argument reduced to [0, 1] first.
+ */
+static force_inline __m128d
+sse2_atan2_pd (__m128d y, __m128d x)
+{
+    const __m128d sign = _mm_set1_pd (-0.0);
+    const __m128d zero = _mm_setzero_pd ();
+    const __m128d one = _mm_set1_pd (1.0);
+    const __m128d pio4 = _mm_set1_pd (7.85398163397448309616E-1);
+    const __m128d pio2 = _mm_set1_pd (1.57079632679489661923E0);
+    const __m128d pi = _mm_set1_pd (3.14159265358979323846E0);
+    const __m128d morebits = _mm_set1_pd (6.123233995736765886130E-17);
+    __m128d ax = _mm_andnot_pd (sign, x);
+    __m128d ay = _mm_andnot_pd (sign, y);
+    __m128d swap = _mm_cmpgt_pd (ay, ax);
+    __m128d den = _mm_max_pd (ax, ay);
+    __m128d r, big, z, p, q, hi, lo, xneg;
+
+    /* r = min (|x|, |y|) / max (|x|, |y|), and 0 at the origin */
+    r = _mm_andnot_pd (_mm_cmpeq_pd (den, zero),
+		       _mm_div_pd (_mm_min_pd (ax, ay), den));
+
+    /* atan (r) = pi/4 + atan ((r - 1) / (r + 1)) */
+    big = _mm_cmpgt_pd (r, _mm_set1_pd (0.66));
+    r = _mm_or_pd (
+	_mm_andnot_pd (big, r),
+	_mm_and_pd (big, _mm_div_pd (_mm_sub_pd (r, one), _mm_add_pd (r, one))));
+
+    z = _mm_mul_pd (r, r);
+
+    p = _mm_set1_pd (-8.750608600031904122785E-1);
+    p = _mm_add_pd (_mm_mul_pd (p, z), _mm_set1_pd (-1.615753718733365076637E1));
+    p = _mm_add_pd (_mm_mul_pd (p, z), _mm_set1_pd (-7.500855792314704667340E1));
+    p = _mm_add_pd (_mm_mul_pd (p, z), _mm_set1_pd (-1.228866684490136173410E2));
+    p = _mm_add_pd (_mm_mul_pd (p, z), _mm_set1_pd (-6.485021904942025371773E1));
+
+    q = _mm_add_pd (z, _mm_set1_pd (2.485846490142306297962E1));
+    q = _mm_add_pd (_mm_mul_pd (q, z), _mm_set1_pd (1.650270098316988542046E2));
+    q = _mm_add_pd (_mm_mul_pd (q, z), _mm_set1_pd (4.328810604912902668951E2));
+    q = _mm_add_pd (_mm_mul_pd (q, z), _mm_set1_pd (4.853903996359136964868E2));
+    q = _mm_add_pd (_mm_mul_pd (q, z), _mm_set1_pd (1.945506571482613964425E2));
+
+    z = _mm_div_pd (_mm_mul_pd (z, p), q);
+    z = _mm_add_pd (_mm_mul_pd (r, z), r);
+
+    /* atan (|y| / |x|) = pi/2 - atan (|x| / |y|) when |y| > |x|. The
+     * constants are split into a high and a low part as in Cephes.
+     */
+    z = _mm_xor_pd (z, _mm_and_pd (swap, sign));
+    hi = _mm_add_pd (_mm_xor_pd (_mm_and_pd (big, pio4), _mm_and_pd (swap, sign)),
+		     _mm_and_pd (swap, pio2));
+    lo = _mm_add_pd (
+	_mm_xor_pd (_mm_and_pd (big, _mm_mul_pd (_mm_set1_pd (0.5), morebits)),
+		    _mm_and_pd (swap, sign)),
+	_mm_and_pd (swap, morebits));
+    z = _mm_add_pd (hi, _mm_add_pd (z, lo));
+
+    /* Quadrants, going by the sign bits so that atan2 (0, -0) = pi */
+    xneg = _mm_castsi128_pd (_mm_srai_epi32 (
+	_mm_shuffle_epi32 (_mm_castpd_si128 (x), _MM_SHUFFLE (3, 3, 1, 1)), 31));
+
+    z = _mm_xor_pd (z, _mm_and_pd (xneg, sign));
+    z = _mm_add_pd (_mm_and_pd (xneg, pi),
+		    _mm_add_pd (z, _mm_and_pd (xneg, _mm_add_pd (morebits, morebits))));
+
+    return _mm_xor_pd (z, _mm_and_pd (y, sign));
+}
+
+/* coordinates_to_parameter() for two pixels, converted to 16.16 */
+static force_inline __m128i
+sse2_conical_positions (const double *x, const double *y, __m128d angle)
+{
+    const __m128d two_pi = _mm_set1_pd (2 * M_PI);
+    __m128d t;
+
+    t = _mm_add_pd (sse2_atan2_pd (_mm_loadu_pd (y), _mm_loadu_pd (x)), angle);
+
+    t = _mm_add_pd (t, _mm_and_pd (_mm_cmplt_pd (t, _mm_setzero_pd ()), two_pi));
+    t = _mm_sub_pd (t, _mm_and_pd (_mm_cmpge_pd (t, two_pi), two_pi));
+
+    t = _mm_sub_pd (_mm_set1_pd (1.), _mm_mul_pd (t, _mm_set1_pd (1 / (2 * M_PI))));
+
+    return _mm_cvttpd_epi32 (_mm_mul_pd (t, _mm_set1_pd (65536.0)));
+}
+
+static uint32_t *
+sse2_fetch_conical_gradient (pixman_iter_t *iter, const uint32_t *mask)
+{
+    pixman_image_t *image = iter->image;
+    conical_gradient_t *conical = (conical_gradient_t *)image;
+    int width = iter->width;
+    uint32_t *buffer = iter->buffer;
+    pixman_gradient_walker_t walker;
+    sse2_gradient_walker_t sw;
+    __m128d angle = _mm_set1_pd (conical->angle);
+    double cx = 1.;
+    double cy = 0.;
+    double rx = iter->x + 0.5;
+    double ry = iter->y + 0.5;
+    int i, k;
+
+    _pixman_gradient_walker_init (&walker, &conical->common,
+				  image->common.repeat);
+
+    if (image->common.transform)
+    {
+	pixman_vector_t v;
+
+	/* reference point is the center of the pixel */
+	v.vector[0] = pixman_int_to_fixed (iter->x) + pixman_fixed_1 / 2;
+	v.vector[1] = pixman_int_to_fixed (iter->y) + pixman_fixed_1 / 2;
+	v.vector[2] = pixman_fixed_1;
+
+	if (!pixman_transform_point_3d (image->common.transform, &v))
+	    return iter->buffer;
+
+	cx = image->common.transform->matrix[0][0] / 65536.;
+	cy = image->common.transform->matrix[1][0] / 65536.;
+
+	rx = v.vector[0] / 65536.;
+	ry = v.vector[1] / 65536.;
+    }
+
+    rx -= conical->center.x / 65536.;
+    ry -= conical->center.y / 65536.;
+
+    sse2_gradient_walker_load (&sw, &walker);
+
+    for (i = 0; i < width; i += 4)
+    {
+	int n = MIN (width - i, 4);
+	double xs[4], ys[4];
+
+	/* Step the coordinates the same way as the C code */
+	for (k = 0; k < 4; ++k)
+	{
+	    xs[k] = rx;
+	    ys[k] = ry;
+
+	    rx += cx;
+	    ry += cy;
+	}
+
+	if (!sse2_gradient_mask_is_zero (mask ? mask + i : NULL, n))
+	{
+	    __m128i x = _mm_unpacklo_epi64 (
+		sse2_conical_positions (&xs[0], &ys[0], angle),
+		sse2_conical_positions (&xs[2], &ys[2], angle));
+
+	    sse2_gradient_store (
+		buffer + i, sse2_gradient_walker_pixels (&walker, &sw, x), n);
+	}
+    }
+
+    iter->y++;
+
+    return iter->buffer;
+}
+
+static void
+sse2_gradient_iter_init (pixman_iter_t *iter, const pixman_iter_info_t *iter_info)
+{
+    pixman_image_t *image = iter->image;
+
+    /* The C initializers take care of horizontal linear gradients, which
+     * are fetched only once, and of the cases handled here
+     */
+    switch (image->type)
+    {
+    case LINEAR:
+	_pixman_linear_gradient_iter_init (image, iter);
+	if (iter->get_scanline != _pixman_iter_get_scanline_noop)
+	    iter->get_scanline = sse2_fetch_linear_gradient;
+	break;
+
+    case RADIAL:
+	_pixman_radial_gradient_iter_init (image, iter);
+	if (image->radial.a != 0)
+	    iter->get_scanline = sse2_fetch_radial_gradient;
+	break;
+
+    case CONICAL:
+	_pixman_conical_gradient_iter_init (image, iter);
+	iter->get_scanline = sse2_fetch_conical_gradient;
+	break;
+
+    default:
+	break;
+    }
+}
+
 #define IMAGE_FLAGS							\
     (FAST_PATH_STANDARD_FLAGS | FAST_PATH_ID_TRANSFORM |		\
      FAST_PATH_BITS_IMAGE | FAST_PATH_SAMPLES_COVER_CLIP_NEAREST)
@@ -6463,6 +7507,46 @@ static const pixman_iter_info_t sse2_iters[] =
     { PIXMAN_a8, IMAGE_FLAGS, ITER_NARROW,
       _pixman_iter_init_bits_stride, sse2_fetch_a8, NULL
     },
+
+#define SSE2_AFFINE_FLAGS						\
+    (FAST_PATH_NO_ALPHA_MAP		|				\
+     FAST_PATH_NO_ACCESSORS		|				\
+     FAST_PATH_HAS_TRANSFORM		|				\
+     FAST_PATH_AFFINE_TRANSFORM)
+
+#define SSE2_AFFINE_ITERS(name, format, repeat)				\
+    { PIXMAN_ ## format,						\
+      SSE2_AFFINE_FLAGS | FAST_PATH_BILINEAR_FILTER |			\
+      FAST_PATH_ ## repeat ## _REPEAT,					\
+      ITER_NARROW | ITER_SRC,						\
+      NULL, sse2_fetch_bilinear_affine_ ## name, NULL			\
+    },									\
+    { PIXMAN_ ## format,						\
+      SSE2_AFFINE_FLAGS | FAST_PATH_SEPARABLE_CONVOLUTION_FILTER |	\
+      FAST_PATH_ ## repeat ## _REPEAT,					\
+      ITER_NARROW | ITER_SRC,						\
+      NULL, sse2_fetch_separable_convolution_affine_ ## name, NULL	\
+    },
+
+    SSE2_AFFINE_ITERS (pad_a8r8g8b8, a8r8g8b8, PAD)
+    SSE2_AFFINE_ITERS (none_a8r8g8b8, a8r8g8b8, NONE)
+    SSE2_AFFINE_ITERS (reflect_a8r8g8b8, a8r8g8b8, REFLECT)
+    SSE2_AFFINE_ITERS (normal_a8r8g8b8, a8r8g8b8, NORMAL)
+    SSE2_AFFINE_ITERS (pad_x8r8g8b8, x8r8g8b8, PAD)
+    SSE2_AFFINE_ITERS (none_x8r8g8b8, x8r8g8b8, NONE)
+    SSE2_AFFINE_ITERS (reflect_x8r8g8b8, x8r8g8b8, REFLECT)
+    SSE2_AFFINE_ITERS (normal_x8r8g8b8, x8r8g8b8, NORMAL)
+    SSE2_AFFINE_ITERS (pad_a8, a8, PAD)
+    SSE2_AFFINE_ITERS (none_a8, a8, NONE)
+    SSE2_AFFINE_ITERS (reflect_a8, a8, REFLECT)
+    SSE2_AFFINE_ITERS (normal_a8, a8, NORMAL)
+
+    { PIXMAN_unknown,
+      FAST_PATH_NO_ALPHA_MAP | FAST_PATH_AFFINE_TRANSFORM,
+      ITER_NARROW | ITER_SRC,
+      sse2_gradient_iter_init, NULL, NULL
+    },
+
     { PIXMAN_null },
 };
 
@@ -1170,6 +1170,56 @@ void          pixman_image_composite32        (pixman_op_t        op,
 					       int32_t            width,
 					       int32_t            height);
 
+/*
+ * Parallel compositing
+ *
+ * pixman_image_composite_parallel() composites like
+ * pixman_image_composite32(), but splits the destination into bands that
+ * are rendered by the threads of a pool; the result is the same. When pool
+ * is NULL a pool with one thread per CPU is used. Applications that have
+ * threads of their own can wrap them in a pool created with
+ * pixman_thread_pool_create_custom(); run_tasks must then call
+ * func (data, i) once for every i from 0 to n_tasks - 1, concurrently if
+ * it wants, and return when all calls have returned.
+ *
+ * Images with accessors, and sources that share memory with the
+ * destination, are composited by the calling thread alone.
+ */
+typedef struct pixman_thread_pool pixman_thread_pool_t;
+
+typedef void (* pixman_task_func_t)      (void               *data,
+					  int                 task);
+typedef void (* pixman_run_tasks_func_t) (void               *user_data,
+					  pixman_task_func_t  func,
+					  void               *data,
+					  int                 n_tasks);
+
+PIXMAN_API
+pixman_thread_pool_t *pixman_thread_pool_create        (int                      n_threads);
+
+PIXMAN_API
+pixman_thread_pool_t *pixman_thread_pool_create_custom (pixman_run_tasks_func_t  run_tasks,
+							void                    *user_data,
+							int                      n_threads);
+
+PIXMAN_API
+void                  pixman_thread_pool_destroy       (pixman_thread_pool_t    *pool);
+
+PIXMAN_API
+void          pixman_image_composite_parallel (pixman_thread_pool_t *pool,
+					       pixman_op_t        op,
+					       pixman_image_t    *src,
+					       pixman_image_t    *mask,
+					       pixman_image_t    *dest,
+					       int32_t            src_x,
+					       int32_t            src_y,
+					       int32_t            mask_x,
+					       int32_t            mask_y,
+					       int32_t            dest_x,
+					       int32_t            dest_y,
+					       int32_t            width,
+					       int32_t            height);
+
 /* Executive Summary: This function is a no-op that only exists
  * for historical reasons.
  *
@@ -1213,6 +1263,41 @@ void                  pixman_glyph_cache_freeze       (pixman_glyph_cache_t *cac
 PIXMAN_API
 void                  pixman_glyph_cache_thaw         (pixman_glyph_cache_t *cache);
 
+/*
+ * The glyph cache keeps the least recently looked up glyphs that fit in
+ * its memory budget, 16 MB unless set otherwise. Glyphs are only evicted
+ * when the cache is not frozen.
+ *
+ * PIXMAN_HAS_GLYPH_CACHE_STATS is defined when the memory budget and the
+ * statistics below are available.  Such a cache is also only read by
+ * pixman_composite_glyphs() and pixman_composite_glyphs_no_mask(), so
+ * several threads may composite glyphs from it at once, as long as no
+ * lookup, insertion or removal runs at the same time.
+ */
+#define PIXMAN_HAS_GLYPH_CACHE_STATS
+
+typedef struct
+{
+    uint64_t	hits;
+    uint64_t	misses;
+    uint64_t	insertions;
+    uint64_t	evictions;
+    uint32_t	n_glyphs;
+    uint64_t	memory;		/* bytes used by the cached glyphs */
+    uint64_t	memory_budget;
+} pixman_glyph_cache_stats_t;
+
+PIXMAN_API
+void                  pixman_glyph_cache_set_memory_budget (pixman_glyph_cache_t       *cache,
+							    uint64_t                    bytes);
+
+PIXMAN_API
+void                  pixman_glyph_cache_get_stats    (pixman_glyph_cache_t       *cache,
+						       pixman_glyph_cache_stats_t *stats);
+
+PIXMAN_API
+void                  pixman_glyph_cache_reset_stats  (pixman_glyph_cache_t *cache);
+
 PIXMAN_API
 const void *          pixman_glyph_cache_lookup       (pixman_glyph_cache_t *cache,
 						       void                 *font_key,
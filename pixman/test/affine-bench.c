@@ -28,6 +28,7 @@
 #include <string.h>
 #include <ctype.h>
 #include <stdint.h>
+#include <math.h>
 #include "utils.h"
 
 #ifdef HAVE_GETTIMEOFDAY
@@ -133,6 +134,8 @@ create_image (uint32_t                   width,
               uint32_t                   height,
               pixman_format_code_t       format,
               pixman_filter_t            filter,
+              const pixman_fixed_t      *filter_params,
+              int                        n_filter_params,
               uint32_t                 **bits,
               pixman_image_t           **image)
 {
@@ -142,7 +145,7 @@ create_image (uint32_t                   width,
     memset (*bits, 0xCC, stride * height);
     *image = pixman_image_create_bits (format, width, height, *bits, stride);
     pixman_image_set_repeat (*image, PIXMAN_REPEAT_NORMAL);
-    pixman_image_set_filter (*image, filter, NULL, 0);
+    pixman_image_set_filter (*image, filter, filter_params, n_filter_params);
 }
 
 /* This needs to match the shortest cacheline length we expect to encounter */
@@ -352,6 +355,8 @@ main (int argc, char *argv[])
     pixman_format_code_t dest_format = PIXMAN_a8r8g8b8;
     pixman_box32_t       dest_box    = { 0, 0, WIDTH, HEIGHT };
     box_48_16_t          transformed = { 0 };
+    pixman_fixed_t      *params      = NULL;
+    int                  n_params    = 0;
     int32_t xmin, ymin, xmax, ymax;
     uint32_t *src, *mask, *dest;
 
@@ -374,14 +379,22 @@ main (int argc, char *argv[])
         --argc;
     }
 
+    if (*argv && (*argv)[0] == '-' && (*argv)[1] == 'c')
+    {
+        filter = PIXMAN_FILTER_SEPARABLE_CONVOLUTION;
+        ++argv;
+        --argc;
+    }
+
     if (argc == 1 ||
         !parse_arguments (argc, argv, &binfo.transform, &binfo.op,
                           &src_format, &mask_format, &dest_format))
     {
-        printf ("Usage: affine-bench [-n] [-b] axx [axy] [ayx] [ayy] [combine type]\n");
+        printf ("Usage: affine-bench [-n] [-b] [-c] axx [axy] [ayx] [ayy] [combine type]\n");
         printf ("                    [src format] [mask format] [dest format]\n");
         printf ("  -n : nearest scaling (default)\n");
         printf ("  -b : bilinear scaling\n");
+        printf ("  -c : separable convolution, box sampling of a linear reconstruction\n");
         printf ("  axx : x_out:x_in factor\n");
         printf ("  axy : x_out:y_in factor (default 0)\n");
         printf ("  ayx : y_out:x_in factor (default 0)\n");
@@ -395,6 +408,20 @@ main (int argc, char *argv[])
         return EXIT_FAILURE;
     }
 
+    if (filter == PIXMAN_FILTER_SEPARABLE_CONVOLUTION)
+    {
+        pixman_transform_t *t = &binfo.transform;
+        double sx = hypot (pixman_fixed_to_double (t->matrix[0][0]),
+                           pixman_fixed_to_double (t->matrix[1][0]));
+        double sy = hypot (pixman_fixed_to_double (t->matrix[0][1]),
+                           pixman_fixed_to_double (t->matrix[1][1]));
+
+        params = pixman_filter_create_separable_convolution (
+            &n_params, pixman_double_to_fixed (sx), pixman_double_to_fixed (sy),
+            PIXMAN_KERNEL_LINEAR, PIXMAN_KERNEL_LINEAR,
+            PIXMAN_KERNEL_BOX, PIXMAN_KERNEL_BOX, 4, 4);
+    }
+
     /* Compute required extents for source and mask image so they qualify
      * for COVER fast paths and get the flags in pixman.c:analyze_extent().
      * These computations are for FAST_PATH_SAMPLES_COVER_CLIP_BILINEAR,
@@ -424,12 +451,12 @@ main (int argc, char *argv[])
      * to hit different cacheline misalignments.
      */
     create_image (xmax - xmin + 64, ymax - ymin + 1, src_format, filter,
-                  &src, &binfo.src_image);
+                  params, n_params, &src, &binfo.src_image);
 
     if (mask_format)
     {
         create_image (xmax - xmin + 64, ymax - ymin + 1, mask_format, filter,
-                      &mask, &binfo.mask_image);
+                      params, n_params, &mask, &binfo.mask_image);
 
         if ((PIXMAN_FORMAT_R(mask_format) ||
              PIXMAN_FORMAT_G(mask_format) ||
@@ -440,9 +467,11 @@ main (int argc, char *argv[])
     }
 
     create_image (WIDTH + 64, HEIGHT, dest_format, filter,
-                  &dest, &binfo.dest_image);
+                  params, n_params, &dest, &binfo.dest_image);
 
     run_benchmark (&binfo);
 
+    free (params);
+
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,206 @@
+/*
+ * Replays a CJK text workload through the glyph cache: a few thousand
+ * distinct characters with a Zipf-like frequency distribution, rendered
+ * at several font sizes, one line of text per freeze/thaw of the cache.
+ * This is the kind of load where the set of glyphs in use is larger
+ * than what a small cache holds.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "utils.h"
+
+#define N_CHARS		3500
+#define N_LINES		20000
+#define LINE_LENGTH	40
+#define DEST_WIDTH	1920
+#define DEST_HEIGHT	1080
+
+static const int font_sizes[] = { 12, 14, 16, 20, 24, 32 };
+
+typedef struct
+{
+    int			size;
+    pixman_image_t *	scratch;
+} font_t;
+
+static font_t fonts[ARRAY_LENGTH (font_sizes)];
+static double cumulative[N_CHARS];
+
+/* Character frequencies in CJK text fall off roughly as 1 / rank */
+static void
+init_frequencies (void)
+{
+    double total = 0;
+    int i;
+
+    for (i = 0; i < N_CHARS; ++i)
+    {
+	total += 1.0 / (i + 1);
+	cumulative[i] = total;
+    }
+
+    for (i = 0; i < N_CHARS; ++i)
+	cumulative[i] /= total;
+}
+
+static int
+random_char (void)
+{
+    double r = prng_rand () / 4294967296.0;
+    int lo = 0, hi = N_CHARS - 1;
+
+    while (lo < hi)
+    {
+	int mid = (lo + hi) / 2;
+
+	if (cumulative[mid] < r)
+	    lo = mid + 1;
+	else
+	    hi = mid;
+    }
+
+    return lo;
+}
+
+/* Stands in for the rasterizer: a glyph image that depends on the
+ * character.
+ */
+static pixman_image_t *
+render_glyph (font_t *font, int c)
+{
+    uint8_t *bits = (uint8_t *)pixman_image_get_data (font->scratch);
+    int stride = pixman_image_get_stride (font->scratch);
+    int y;
+
+    for (y = 0; y < font->size; ++y)
+	memset (bits + y * stride, (c * 31 + y * 7) & 0xff, font->size);
+
+    return font->scratch;
+}
+
+static void
+replay (pixman_glyph_cache_t *cache, pixman_image_t *source,
+	pixman_image_t *dest, double *t)
+{
+    pixman_glyph_t glyphs[LINE_LENGTH];
+    double t1;
+    int line, i;
+
+    prng_srand (4711);
+
+    t1 = gettime ();
+
+    for (line = 0; line < N_LINES; ++line)
+    {
+	font_t *font = &fonts[prng_rand_n (ARRAY_LENGTH (fonts))];
+	int y = prng_rand_n (DEST_HEIGHT);
+
+	pixman_glyph_cache_freeze (cache);
+
+	for (i = 0; i < LINE_LENGTH; ++i)
+	{
+	    uintptr_t c = random_char () + 1;
+	    const void *g;
+
+	    if (!(g = pixman_glyph_cache_lookup (cache, font, (void *)c)))
+	    {
+		g = pixman_glyph_cache_insert (cache, font, (void *)c,
+					       0, font->size,
+					       render_glyph (font, c));
+	    }
+
+	    glyphs[i].x = i * font->size;
+	    glyphs[i].y = y;
+	    glyphs[i].glyph = g;
+	}
+
+	pixman_composite_glyphs (PIXMAN_OP_OVER, source, dest, PIXMAN_a8,
+				 0, 0, 0, y - font->size,
+				 0, y - font->size,
+				 LINE_LENGTH * font->size, font->size,
+				 cache, LINE_LENGTH, glyphs);
+
+	pixman_glyph_cache_thaw (cache);
+    }
+
+    *t = gettime () - t1;
+}
+
+static void
+usage (void)
+{
+    printf ("Usage: glyph-bench [budget in KB ...]\n");
+    printf ("  Replays %d lines of %d CJK glyphs, in %d font sizes, through\n",
+	    N_LINES, LINE_LENGTH, (int)ARRAY_LENGTH (fonts));
+    printf ("  glyph caches with the given memory budgets\n");
+}
+
+int
+main (int argc, char **argv)
+{
+    static const int default_budgets[] = { 1024, 4096, 16384, 65536 };
+    pixman_image_t *source, *dest;
+    pixman_color_t black = { 0, 0, 0, 0xffff };
+    int n_budgets = ARRAY_LENGTH (default_budgets);
+    int i;
+
+    for (i = 1; i < argc; ++i)
+    {
+	if (atoi (argv[i]) <= 0)
+	{
+	    usage ();
+	    return 1;
+	}
+    }
+    if (argc > 1)
+	n_budgets = argc - 1;
+
+    init_frequencies ();
+
+    for (i = 0; i < ARRAY_LENGTH (fonts); ++i)
+    {
+	fonts[i].size = font_sizes[i];
+	fonts[i].scratch = pixman_image_create_bits (
+	    PIXMAN_a8, font_sizes[i], font_sizes[i], NULL, -1);
+    }
+
+    source = pixman_image_create_solid_fill (&black);
+    dest = pixman_image_create_bits (PIXMAN_a8r8g8b8,
+				     DEST_WIDTH, DEST_HEIGHT, NULL, -1);
+
+    printf ("# %-10s %10s %10s %8s %10s %8s %10s\n",
+	    "budget/KB", "time/ms", "ns/glyph", "hits", "evictions",
+	    "glyphs", "memory/KB");
+
+    for (i = 0; i < n_budgets; ++i)
+    {
+	int budget = argc > 1 ? atoi (argv[i + 1]) : default_budgets[i];
+	pixman_glyph_cache_t *cache = pixman_glyph_cache_create ();
+	pixman_glyph_cache_stats_t stats;
+	double t;
+
+	pixman_glyph_cache_set_memory_budget (cache, (uint64_t)budget * 1024);
+
+	/* Warm up, then measure a second replay of the same text */
+	replay (cache, source, dest, &t);
+	pixman_glyph_cache_reset_stats (cache);
+	replay (cache, source, dest, &t);
+
+	pixman_glyph_cache_get_stats (cache, &stats);
+
+	printf ("%12d %10.2f %10.1f %7.2f%% %10llu %8u %10llu\n",
+		budget, t * 1000, t * 1e9 / (N_LINES * LINE_LENGTH),
+		100.0 * stats.hits / (stats.hits + stats.misses),
+		(unsigned long long)stats.evictions, stats.n_glyphs,
+		(unsigned long long)(stats.memory / 1024));
+
+	pixman_glyph_cache_destroy (cache);
+    }
+
+    for (i = 0; i < ARRAY_LENGTH (fonts); ++i)
+	pixman_image_unref (fonts[i].scratch);
+    pixman_image_unref (source);
+    pixman_image_unref (dest);
+
+    return 0;
+}
@@ -323,9 +323,94 @@ test_glyphs (int testnum, int verbose)
     return crc32;
 }
 
+#define KEY(n) ((void *)(uintptr_t)((n) + 1))
+
+/* Check that the cache keeps the least recently looked up glyphs that
+ * fit in its budget, and that it counts what it does.
+ */
+static int
+test_cache (void)
+{
+    pixman_image_t *image = pixman_image_create_bits (PIXMAN_a8, 16, 16, NULL, -1);
+    pixman_glyph_cache_t *cache = pixman_glyph_cache_create ();
+    pixman_glyph_cache_stats_t stats;
+    uint64_t glyph_size;
+    int i, ok = 1;
+
+    pixman_glyph_cache_freeze (cache);
+    pixman_glyph_cache_insert (cache, KEY (0), NULL, 0, 0, image);
+    pixman_glyph_cache_thaw (cache);
+    pixman_glyph_cache_get_stats (cache, &stats);
+    glyph_size = stats.memory;
+
+    /* Many glyphs inserted at once stay until the cache is thawed, and
+     * can be found while the table grows.
+     */
+    pixman_glyph_cache_set_memory_budget (cache, 10 * glyph_size);
+    pixman_glyph_cache_freeze (cache);
+    for (i = 1; i < 5000; ++i)
+    {
+	if (pixman_glyph_cache_lookup (cache, KEY (i), NULL))
+	    ok = 0;
+	if (!pixman_glyph_cache_insert (cache, KEY (i), NULL, 0, 0, image))
+	    ok = 0;
+    }
+    for (i = 0; i < 5000; ++i)
+    {
+	if (!pixman_glyph_cache_lookup (cache, KEY (i), NULL))
+	    ok = 0;
+    }
+    pixman_glyph_cache_get_stats (cache, &stats);
+    if (stats.n_glyphs != 5000 || stats.memory != 5000 * glyph_size)
+	ok = 0;
+    pixman_glyph_cache_thaw (cache);
+
+    pixman_glyph_cache_get_stats (cache, &stats);
+    if (stats.n_glyphs != 10 || stats.evictions != 4990 ||
+	stats.insertions != 5000 || stats.hits != 5000 || stats.misses != 4999)
+    {
+	ok = 0;
+    }
+
+    /* The glyphs used last are kept */
+    for (i = 4990; i < 5000; ++i)
+    {
+	if (!pixman_glyph_cache_lookup (cache, KEY (i), NULL))
+	    ok = 0;
+    }
+    pixman_glyph_cache_lookup (cache, KEY (4990), NULL);
+
+    pixman_glyph_cache_freeze (cache);
+    pixman_glyph_cache_insert (cache, KEY (5000), NULL, 0, 0, image);
+    pixman_glyph_cache_thaw (cache);
+
+    if (!pixman_glyph_cache_lookup (cache, KEY (4990), NULL) ||
+	pixman_glyph_cache_lookup (cache, KEY (4991), NULL))
+    {
+	ok = 0;
+    }
+
+    pixman_glyph_cache_set_memory_budget (cache, 0);
+    pixman_glyph_cache_reset_stats (cache);
+    pixman_glyph_cache_get_stats (cache, &stats);
+    if (stats.n_glyphs != 0 || stats.memory != 0 || stats.evictions != 0)
+	ok = 0;
+
+    pixman_glyph_cache_destroy (cache);
+    pixman_image_unref (image);
+
+    if (!ok)
+	printf ("glyph cache test failed\n");
+
+    return !ok;
+}
+
 int
 main (int argc, const char *argv[])
 {
+    if (test_cache ())
+	return 1;
+
     return fuzzer_test_main ("glyph", 30000,	
 			     0xFA478A79,
 			     test_glyphs, argc, argv);
@@ -0,0 +1,297 @@
+/*
+ * Compares the gradient scanlines fetched by the best available
+ * implementation, which may use SIMD fetchers, with the ones fetched by
+ * the general implementation. The pixels must agree within the
+ * tolerance of the pixel checker. They usually agree exactly, but the
+ * SIMD conical fetchers use their own atan2(), so that isn't required.
+ */
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "utils.h"
+
+#define N_TESTS    20000
+#define MAX_WIDTH  300
+#define MAX_HEIGHT 4
+#define MAX_STOPS  6
+
+#define RANDOM_ELT(array)						\
+    ((array)[prng_rand_n (ARRAY_LENGTH ((array)))])
+
+static const pixman_repeat_t repeats[] =
+{
+    PIXMAN_REPEAT_NONE,
+    PIXMAN_REPEAT_PAD,
+    PIXMAN_REPEAT_REFLECT,
+    PIXMAN_REPEAT_NORMAL,
+};
+
+static pixman_fixed_t
+random_coordinate (int range)
+{
+    return prng_rand_n (2 * range << 16) - (range << 16);
+}
+
+static pixman_point_fixed_t
+random_point (void)
+{
+    pixman_point_fixed_t p;
+
+    p.x = random_coordinate (400);
+    p.y = random_coordinate (400);
+
+    return p;
+}
+
+static int
+random_stops (pixman_gradient_stop_t *stops)
+{
+    int n_stops = prng_rand_n (MAX_STOPS - 1) + 2;
+    int gap = pixman_fixed_1 / n_stops;
+    int i;
+
+    /* Hard stops make the color jump at a single position, where
+     * the slightest difference in the computed position shows up, so
+     * keep the stops apart.
+     */
+    for (i = 0; i < n_stops; ++i)
+    {
+	stops[i].x = i * gap + prng_rand_n (gap / 2);
+	stops[i].color.red = prng_rand_n (0x10000);
+	stops[i].color.green = prng_rand_n (0x10000);
+	stops[i].color.blue = prng_rand_n (0x10000);
+	stops[i].color.alpha = prng_rand_n (0x10000);
+    }
+
+    return n_stops;
+}
+
+static pixman_image_t *
+create_gradient (int *type)
+{
+    pixman_gradient_stop_t stops[MAX_STOPS];
+    int n_stops = random_stops (stops);
+    pixman_point_fixed_t p1, p2;
+
+    *type = prng_rand_n (3);
+
+    p1 = random_point ();
+    p2 = random_point ();
+
+    switch (*type)
+    {
+    case 0:
+	return pixman_image_create_linear_gradient (&p1, &p2, stops, n_stops);
+
+    case 1:
+	return pixman_image_create_radial_gradient (
+	    &p1, &p2, prng_rand_n (300 << 16), prng_rand_n (300 << 16),
+	    stops, n_stops);
+
+    default:
+	return pixman_image_create_conical_gradient (
+	    &p1, prng_rand_n (360 << 16), stops, n_stops);
+    }
+}
+
+static void
+set_random_transform (pixman_image_t *image)
+{
+    pixman_transform_t transform;
+    double a = prng_rand_n (360) * M_PI / 180;
+
+    pixman_transform_init_identity (&transform);
+
+    switch (prng_rand_n (5))
+    {
+    case 0:
+	return;
+
+    case 1:
+	pixman_transform_translate (&transform, NULL,
+				    random_coordinate (200),
+				    random_coordinate (200));
+	break;
+
+    case 2:
+	pixman_transform_scale (&transform, NULL,
+				prng_rand_n (4 << 16) + pixman_fixed_1 / 8,
+				prng_rand_n (4 << 16) + pixman_fixed_1 / 8);
+	break;
+
+    case 3:
+	pixman_transform_rotate (&transform, NULL,
+				 pixman_double_to_fixed (cos (a)),
+				 pixman_double_to_fixed (sin (a)));
+	pixman_transform_translate (&transform, NULL,
+				    random_coordinate (200),
+				    random_coordinate (200));
+	break;
+
+    case 4:
+	/* projective */
+	transform.matrix[2][0] = prng_rand_n (64);
+	transform.matrix[2][1] = prng_rand_n (64);
+	break;
+    }
+
+    pixman_image_set_transform (image, &transform);
+}
+
+/* Does what _pixman_implementation_iter_init() does, starting at @imp */
+static void
+fetch_scanlines (pixman_implementation_t *imp, pixman_image_t *image,
+		 int x, int y, int width, int height,
+		 const uint32_t *mask, uint32_t *result)
+{
+    iter_flags_t iter_flags = ITER_NARROW | ITER_SRC;
+    uint32_t *buffer = calloc (width, sizeof (uint32_t));
+    const pixman_iter_info_t *info = NULL;
+    pixman_iter_t iter;
+    int i;
+
+    for (; imp && !info; imp = imp->fallback)
+    {
+	if (!imp->iter_info)
+	    continue;
+
+	for (info = imp->iter_info; info->format != PIXMAN_null; ++info)
+	{
+	    if ((info->format == PIXMAN_any ||
+		 info->format == image->common.extended_format_code)	&&
+		(info->image_flags & image->common.flags) == info->image_flags &&
+		(info->iter_flags & iter_flags) == info->iter_flags)
+	    {
+		break;
+	    }
+	}
+
+	if (info->format == PIXMAN_null)
+	    info = NULL;
+    }
+
+    assert (info);
+
+    iter.image = image;
+    iter.buffer = buffer;
+    iter.x = x;
+    iter.y = y;
+    iter.width = width;
+    iter.height = height;
+    iter.iter_flags = iter_flags;
+    iter.image_flags = image->common.flags;
+    iter.fini = NULL;
+    iter.get_scanline = info->get_scanline;
+    iter.write_back = info->write_back;
+
+    if (info->initializer)
+	info->initializer (&iter, info);
+
+    for (i = 0; i < height; ++i)
+    {
+	memcpy (result + i * width, iter.get_scanline (&iter, mask),
+		width * sizeof (uint32_t));
+    }
+
+    if (iter.fini)
+	iter.fini (&iter);
+
+    free (buffer);
+}
+
+static pixman_bool_t
+do_check (int i)
+{
+    static const char *type_names[] = { "linear", "radial", "conical" };
+    pixman_implementation_t *imp, *general;
+    pixman_image_t *gradient, *dest;
+    uint32_t *mask, *expected, *result;
+    pixel_checker_t checker;
+    int type, x, y, width, height, j;
+    pixman_bool_t success = TRUE;
+
+    prng_srand (i);
+
+    gradient = create_gradient (&type);
+    pixman_image_set_repeat (gradient, RANDOM_ELT (repeats));
+    set_random_transform (gradient);
+
+    /* Far from the origin, the positions no longer fit in 32 bits */
+    x = prng_rand_n (4) ? prng_rand_n (800) - 200 : prng_rand_n (60000) - 30000;
+    y = prng_rand_n (800) - 200;
+    width = prng_rand_n (MAX_WIDTH) + 1;
+    height = prng_rand_n (MAX_HEIGHT) + 1;
+
+    mask = NULL;
+    if (prng_rand_n (4) == 0)
+    {
+	mask = malloc (width * sizeof (uint32_t));
+	for (j = 0; j < width; ++j)
+	    mask[j] = prng_rand_n (2) ? 0xff000000 : 0;
+    }
+
+    /* Compositing validates the image */
+    dest = pixman_image_create_bits (PIXMAN_a8r8g8b8, 1, 1, NULL, -1);
+    pixman_image_composite32 (PIXMAN_OP_SRC, gradient, NULL, dest,
+			      0, 0, 0, 0, 0, 0, 1, 1);
+
+    imp = _pixman_internal_only_get_implementation ();
+    for (general = imp; general->fallback; general = general->fallback)
+	;
+
+    expected = malloc (width * height * sizeof (uint32_t));
+    result = malloc (width * height * sizeof (uint32_t));
+
+    fetch_scanlines (general, gradient, x, y, width, height, mask, expected);
+    fetch_scanlines (imp, gradient, x, y, width, height, mask, result);
+
+    pixel_checker_init (&checker, PIXMAN_a8r8g8b8);
+
+    for (j = 0; j < width * height; ++j)
+    {
+	color_t color;
+
+	if (mask && !mask[j % width])
+	    continue;
+
+	pixel_checker_convert_pixel_to_color (&checker, expected[j], &color);
+
+	if (!pixel_checker_check (&checker, result[j], &color))
+	{
+	    printf ("Test %d failed: %s gradient, pixel %d, %d: "
+		    "got %08x, expected %08x\n",
+		    i, type_names[type], x + j % width, y + j / width,
+		    result[j], expected[j]);
+	    success = FALSE;
+	    break;
+	}
+    }
+
+    free (mask);
+    free (expected);
+    free (result);
+    pixman_image_unref (dest);
+    pixman_image_unref (gradient);
+
+    return success;
+}
+
+int
+main (int argc, const char *argv[])
+{
+    int result = 0;
+    int i;
+
+    if (argc == 2)
+	return !do_check (strtol (argv[1], NULL, 0));
+
+    for (i = 0; i < N_TESTS; ++i)
+    {
+	if (!do_check (i))
+	    result = 1;
+    }
+
+    return result;
+}
@@ -92,6 +92,19 @@ static pixman_bool_t use_scaling = FALSE;
 static pixman_filter_t filter = PIXMAN_FILTER_NEAREST;
 static pixman_bool_t use_csv_output = FALSE;
 
+/* L1, L2, M, HT, VT, R and RT results of the last test, in Mpx/s */
+#define N_RESULTS 7
+static double results[N_RESULTS];
+
+/* With -d, the same tests are first run by a copy of the benchmark with
+ * one implementation disabled, and the speedup over it is printed after
+ * each result.
+ */
+static const char *baseline_impl = NULL;
+static double (*baseline)[N_RESULTS] = NULL;
+static int n_baseline = 0;
+static int n_tests_run = 0;
+
 /* nearly 1x scale factor */
 static pixman_transform_t m =
 {
@@ -493,10 +506,11 @@ bench_composite (const char *testname,
     t2 = gettime ();
     pix_cnt = bench_L (op, src_img, mask_img, dst_img, n, func, l1test_width, 1);
     t3 = gettime ();
+    results[0] = Mpx_per_sec (pix_cnt, t1, t2, t3);
     if (use_csv_output)
-        printf ("%g,", Mpx_per_sec (pix_cnt, t1, t2, t3));
+        printf ("%g,", results[0]);
     else
-        printf ("  L1:%7.2f", Mpx_per_sec (pix_cnt, t1, t2, t3));
+        printf ("  L1:%7.2f", results[0]);
     fflush (stdout);
 
     memcpy (dst, src, BUFSIZE);
@@ -514,10 +528,11 @@ bench_composite (const char *testname,
     t2 = gettime ();
     pix_cnt = bench_L (op, src_img, mask_img, dst_img, n, func, l1test_width, nlines);
     t3 = gettime ();
+    results[1] = Mpx_per_sec (pix_cnt, t1, t2, t3);
     if (use_csv_output)
-        printf ("%g,", Mpx_per_sec (pix_cnt, t1, t2, t3));
+        printf ("%g,", results[1]);
     else
-        printf ("  L2:%7.2f", Mpx_per_sec (pix_cnt, t1, t2, t3));
+        printf ("  L2:%7.2f", results[1]);
     fflush (stdout);
 
     memcpy (dst, src, BUFSIZE);
@@ -531,10 +546,11 @@ bench_composite (const char *testname,
     t2 = gettime ();
     pix_cnt = bench_M (op, src_img, mask_img, dst_img, n, func);
     t3 = gettime ();
+    results[2] = Mpx_per_sec (pix_cnt, t1, t2, t3);
     if (use_csv_output)
-        printf ("%g,", Mpx_per_sec (pix_cnt, t1, t2, t3));
+        printf ("%g,", results[2]);
     else
-        printf ("  M:%6.2f (%6.2f%%)", Mpx_per_sec (pix_cnt, t1, t2, t3),
+        printf ("  M:%6.2f (%6.2f%%)", results[2],
                 (pix_cnt / ((t3 - t2) - (t2 - t1)) * bytes_per_pix) * (100.0 / bandwidth) );
     fflush (stdout);
 
@@ -549,10 +565,11 @@ bench_composite (const char *testname,
     t2 = gettime ();
     pix_cnt = bench_HT (op, src_img, mask_img, dst_img, n, func);
     t3 = gettime ();
+    results[3] = Mpx_per_sec (pix_cnt, t1, t2, t3);
     if (use_csv_output)
-        printf ("%g,", Mpx_per_sec (pix_cnt, t1, t2, t3));
+        printf ("%g,", results[3]);
     else
-        printf ("  HT:%6.2f", Mpx_per_sec (pix_cnt, t1, t2, t3));
+        printf ("  HT:%6.2f", results[3]);
     fflush (stdout);
 
     memcpy (dst, src, BUFSIZE);
@@ -566,10 +583,11 @@ bench_composite (const char *testname,
     t2 = gettime ();
     pix_cnt = bench_VT (op, src_img, mask_img, dst_img, n, func);
     t3 = gettime ();
+    results[4] = Mpx_per_sec (pix_cnt, t1, t2, t3);
     if (use_csv_output)
-        printf ("%g,", Mpx_per_sec (pix_cnt, t1, t2, t3));
+        printf ("%g,", results[4]);
     else
-        printf ("  VT:%6.2f", Mpx_per_sec (pix_cnt, t1, t2, t3));
+        printf ("  VT:%6.2f", results[4]);
     fflush (stdout);
 
     memcpy (dst, src, BUFSIZE);
@@ -583,10 +601,11 @@ bench_composite (const char *testname,
     t2 = gettime ();
     pix_cnt = bench_R (op, src_img, mask_img, dst_img, n, func, WIDTH, HEIGHT);
     t3 = gettime ();
+    results[5] = Mpx_per_sec (pix_cnt, t1, t2, t3);
     if (use_csv_output)
-        printf ("%g,", Mpx_per_sec (pix_cnt, t1, t2, t3));
+        printf ("%g,", results[5]);
     else
-        printf ("  R:%6.2f", Mpx_per_sec (pix_cnt, t1, t2, t3));
+        printf ("  R:%6.2f", results[5]);
     fflush (stdout);
 
     memcpy (dst, src, BUFSIZE);
@@ -600,10 +619,11 @@ bench_composite (const char *testname,
     t2 = gettime ();
     pix_cnt = bench_RT (op, src_img, mask_img, dst_img, n, func, WIDTH, HEIGHT);
     t3 = gettime ();
+    results[6] = Mpx_per_sec (pix_cnt, t1, t2, t3);
     if (use_csv_output)
-        printf ("%g\n", Mpx_per_sec (pix_cnt, t1, t2, t3));
+        printf ("%g\n", results[6]);
     else
-        printf ("  RT:%6.2f (%4.0fKops/s)\n", Mpx_per_sec (pix_cnt, t1, t2, t3), (double) n / ((t3 - t2) * 1000));
+        printf ("  RT:%6.2f (%4.0fKops/s)\n", results[6], (double) n / ((t3 - t2) * 1000));
 
     if (mask_img) {
 	pixman_image_unref (mask_img);
@@ -993,6 +1013,107 @@ print_test_details (const test_entry_t *test)
             format_name (test->dst_fmt));
 }
 
+static void
+set_pixman_disable (const char *value)
+{
+#ifdef _WIN32
+    _putenv_s ("PIXMAN_DISABLE", value ? value : "");
+#else
+    if (value)
+	setenv ("PIXMAN_DISABLE", value, 1);
+    else
+	unsetenv ("PIXMAN_DISABLE");
+#endif
+}
+
+/* Runs the same tests in a child process with baseline_impl added to
+ * PIXMAN_DISABLE, and keeps its results.  All of them are read before
+ * this process starts benchmarking, so the two never compete for the CPU.
+ */
+static void
+run_baseline (const char *progname, const char *pattern, double bandwidth_)
+{
+    const char *old_disable = getenv ("PIXMAN_DISABLE");
+    char *saved = old_disable ? strdup (old_disable) : NULL;
+    char disable[256], cmd[1024], line[1024];
+    double r[N_RESULTS];
+    int size = 0;
+    FILE *f;
+
+    snprintf (disable, sizeof disable, "%s%s%s", saved ? saved : "",
+              saved ? " " : "", baseline_impl);
+    snprintf (cmd, sizeof cmd, "\"%s\" -c%s -m %f %s", progname,
+              !use_scaling ? "" :
+              filter == PIXMAN_FILTER_BILINEAR ? " -b" : " -n",
+              bandwidth_ / 1e6, pattern);
+
+    set_pixman_disable (disable);
+#ifdef _WIN32
+    f = _popen (cmd, "r");
+#else
+    f = popen (cmd, "r");
+#endif
+    set_pixman_disable (saved);
+    free (saved);
+
+    if (!f)
+    {
+        printf ("Could not run '%s'\n", cmd);
+        return;
+    }
+
+    while (fgets (line, sizeof line, f))
+    {
+        /* Skip anything which is not a CSV line with a full set of results */
+        if (sscanf (line, "%lf,%lf,%lf,%lf,%lf,%lf,%lf",
+                    &r[0], &r[1], &r[2], &r[3], &r[4], &r[5], &r[6]) != N_RESULTS)
+            continue;
+
+        if (n_baseline == size)
+        {
+            size = size ? size * 2 : 64;
+            baseline = realloc (baseline, size * sizeof (*baseline));
+        }
+        memcpy (baseline[n_baseline++], r, sizeof r);
+    }
+
+#ifdef _WIN32
+    _pclose (f);
+#else
+    pclose (f);
+#endif
+
+    if (!n_baseline)
+        printf ("No results from '%s'\n", cmd);
+}
+
+static void
+print_speedup (const double *base)
+{
+    static const char *names[N_RESULTS] = { "L1", "L2", "M", "HT", "VT", "R", "RT" };
+    char label[64];
+    int i;
+
+    if (!use_csv_output)
+    {
+        snprintf (label, sizeof label, "speedup over -%s", baseline_impl);
+        printf ("%24s x", label);
+    }
+
+    for (i = 0; i < N_RESULTS; i++)
+    {
+        double speedup = base[i] > 0 ? results[i] / base[i] : 0;
+
+        if (use_csv_output)
+            printf ("%g%c", speedup, i == N_RESULTS - 1 ? '\n' : ',');
+        else
+            printf ("  %s:%6.2fx", names[i], speedup);
+    }
+
+    if (!use_csv_output)
+        printf ("\n");
+}
+
 static void
 run_one_test (const char *pattern, double bandwidth_, pixman_bool_t prdetails)
 {
@@ -1018,6 +1139,10 @@ run_one_test (const char *pattern, double bandwidth_, pixman_bool_t prdetails)
                      test.mask_flags,
                      test.dst_fmt,
                      bandwidth_ / 8);
+
+    if (n_tests_run < n_baseline)
+        print_speedup (baseline[n_tests_run]);
+    n_tests_run++;
 }
 
 static void
@@ -1084,11 +1209,13 @@ print_speed_scaling (double bw)
 static void
 usage (const char *progname)
 {
-    printf ("Usage: %s [-b] [-n] [-c] [-m M] pattern\n", progname);
+    printf ("Usage: %s [-b] [-n] [-c] [-m M] [-d IMPL] pattern\n", progname);
     printf ("  -n : benchmark nearest scaling\n");
     printf ("  -b : benchmark bilinear scaling\n");
     printf ("  -c : print output as CSV data\n");
     printf ("  -m M : set reference memcpy speed to M MB/s instead of measuring it\n");
+    printf ("  -d IMPL : also print the speedup over a run with PIXMAN_DISABLE=IMPL\n");
+    printf ("            (for example -d avx2 shows what the AVX2 code gains over SSE2)\n");
 }
 
 int
@@ -1117,6 +1244,9 @@ main (int argc, char *argv[])
 
 	    if (strcmp (argv[i], "-m") == 0 && i + 1 < argc)
 		bandwidth = atof (argv[++i]) * 1e6;
+
+	    if (strcmp (argv[i], "-d") == 0 && i + 1 < argc)
+		baseline_impl = argv[++i];
 	}
 	else
 	{
@@ -1151,11 +1281,15 @@ main (int argc, char *argv[])
     if (!use_csv_output)
         print_speed_scaling (bandwidth);
 
+    if (baseline_impl)
+        run_baseline (argv[0], pattern, bandwidth);
+
     if (strcmp (pattern, "all") == 0)
         run_default_tests (bandwidth);
     else
         run_one_test (pattern, bandwidth, !use_csv_output);
 
+    free (baseline);
     free (src);
     return 0;
 }
@@ -0,0 +1,185 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "utils.h"
+
+#define WIDTH 1920
+#define HEIGHT 1080
+#define TEST_REPEATS 5
+#define ROTATION 5
+
+typedef struct
+{
+    const char *	name;
+    pixman_op_t		op;
+    pixman_image_t *	src;
+    pixman_image_t *	mask;
+} bench_case_t;
+
+static pixman_image_t *
+make_bits (pixman_format_code_t format, int width, int height)
+{
+    int stride = (width * PIXMAN_FORMAT_BPP (format) / 8 + 15) & ~15;
+    uint32_t *data = aligned_malloc (16, stride * height);
+
+    prng_randmemset (data, stride * height, 0);
+
+    return pixman_image_create_bits (format, width, height, data, stride);
+}
+
+static pixman_image_t *
+make_rotated (void)
+{
+    pixman_image_t *image = make_bits (PIXMAN_a8r8g8b8, 800, 600);
+    pixman_transform_t transform;
+    double a = ROTATION * 3.14159265358979323846 / 180;
+
+    pixman_transform_init_rotate (&transform,
+				  pixman_double_to_fixed (cos (a)),
+				  pixman_double_to_fixed (sin (a)));
+    pixman_image_set_transform (image, &transform);
+    pixman_image_set_filter (image, PIXMAN_FILTER_BILINEAR, NULL, 0);
+    pixman_image_set_repeat (image, PIXMAN_REPEAT_REFLECT);
+
+    return image;
+}
+
+static pixman_image_t *
+make_radial (void)
+{
+    static const pixman_gradient_stop_t stops[] =
+    {
+	{ pixman_int_to_fixed (0), { 0xffff, 0x0000, 0x0000, 0xffff } },
+	{ pixman_double_to_fixed (0.5), { 0x0000, 0xffff, 0x0000, 0x8000 } },
+	{ pixman_int_to_fixed (1), { 0x0000, 0x0000, 0xffff, 0xffff } },
+    };
+    pixman_point_fixed_t c1 = { pixman_int_to_fixed (700), pixman_int_to_fixed (500) };
+    pixman_point_fixed_t c2 = { pixman_int_to_fixed (960), pixman_int_to_fixed (540) };
+    pixman_image_t *image;
+
+    image = pixman_image_create_radial_gradient (
+	&c1, &c2, pixman_int_to_fixed (50), pixman_int_to_fixed (900),
+	stops, ARRAY_LENGTH (stops));
+    pixman_image_set_repeat (image, PIXMAN_REPEAT_REFLECT);
+
+    return image;
+}
+
+static double
+bench (pixman_thread_pool_t *pool, bench_case_t *c, pixman_image_t *dest)
+{
+    double t1, t2, t = -1;
+    int i;
+
+    for (i = 0; i < TEST_REPEATS; i++)
+    {
+	t1 = gettime ();
+	if (pool)
+	{
+	    pixman_image_composite_parallel (pool, c->op, c->src, c->mask, dest,
+					     0, 0, 0, 0, 0, 0, WIDTH, HEIGHT);
+	}
+	else
+	{
+	    pixman_image_composite32 (c->op, c->src, c->mask, dest,
+				      0, 0, 0, 0, 0, 0, WIDTH, HEIGHT);
+	}
+	t2 = gettime ();
+
+	if (t < 0 || t2 - t1 < t)
+	    t = t2 - t1;
+    }
+
+    return WIDTH * HEIGHT / t / 1000000;
+}
+
+static void
+usage (void)
+{
+    printf ("Usage: parallel-bench [max threads]\n");
+    printf ("  Composites %dx%d pixels with pixman_image_composite_parallel()\n",
+	    WIDTH, HEIGHT);
+    printf ("  on 1, 2, 4, ... threads and prints Mpixels/s and the speedup\n");
+    printf ("  over pixman_image_composite32()\n");
+}
+
+int
+main (int argc, char **argv)
+{
+    pixman_image_t *dest;
+    bench_case_t cases[5];
+    int max_threads = 8;
+    int i, n;
+
+    if (argc > 2 || (argc == 2 && (max_threads = atoi (argv[1])) <= 0))
+    {
+	usage ();
+	return 1;
+    }
+
+    prng_srand (23874);
+
+    dest = make_bits (PIXMAN_a8r8g8b8, WIDTH, HEIGHT);
+
+    cases[0].name = "src_8888_8888";
+    cases[0].op = PIXMAN_OP_SRC;
+    cases[0].src = make_bits (PIXMAN_a8r8g8b8, WIDTH, HEIGHT);
+    cases[0].mask = NULL;
+
+    cases[1].name = "over_8888_8888";
+    cases[1].op = PIXMAN_OP_OVER;
+    cases[1].src = make_bits (PIXMAN_a8r8g8b8, WIDTH, HEIGHT);
+    cases[1].mask = NULL;
+
+    cases[2].name = "over_8888_8_8888";
+    cases[2].op = PIXMAN_OP_OVER;
+    cases[2].src = make_bits (PIXMAN_a8r8g8b8, WIDTH, HEIGHT);
+    cases[2].mask = make_bits (PIXMAN_a8, WIDTH, HEIGHT);
+
+    cases[3].name = "over_bilinear_rotated";
+    cases[3].op = PIXMAN_OP_OVER;
+    cases[3].src = make_rotated ();
+    cases[3].mask = NULL;
+
+    cases[4].name = "over_radial";
+    cases[4].op = PIXMAN_OP_OVER;
+    cases[4].src = make_radial ();
+    cases[4].mask = NULL;
+
+    printf ("# %-22s %10s", "operation", "serial");
+    for (n = 1; n <= max_threads; n *= 2)
+	printf ("  %6d thr", n);
+    printf ("\n");
+
+    for (i = 0; i < ARRAY_LENGTH (cases); i++)
+    {
+	double serial = bench (NULL, &cases[i], dest);
+
+	printf ("%-24s %10.2f", cases[i].name, serial);
+
+	for (n = 1; n <= max_threads; n *= 2)
+	{
+	    pixman_thread_pool_t *pool = pixman_thread_pool_create (n);
+	    double mpix = bench (pool, &cases[i], dest);
+
+	    printf ("  %5.2fx", mpix / serial);
+	    fflush (stdout);
+	    pixman_thread_pool_destroy (pool);
+	}
+	printf ("\n");
+
+	if (cases[i].src->type == BITS)
+	    free (pixman_image_get_data (cases[i].src));
+	pixman_image_unref (cases[i].src);
+	if (cases[i].mask)
+	{
+	    free (pixman_image_get_data (cases[i].mask));
+	    pixman_image_unref (cases[i].mask);
+	}
+    }
+
+    free (pixman_image_get_data (dest));
+    pixman_image_unref (dest);
+
+    return 0;
+}
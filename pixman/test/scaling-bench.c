@@ -1,38 +1,68 @@
 #include <stdlib.h>
+#include <string.h>
+#include <math.h>
 #include "utils.h"
 
 #define SOURCE_WIDTH 320
 #define SOURCE_HEIGHT 240
 #define TEST_REPEATS 3
+#define ROTATION 5
 
 static pixman_image_t *
-make_source (void)
+make_source (pixman_format_code_t format)
 {
-    size_t n_bytes = (SOURCE_WIDTH + 2) * (SOURCE_HEIGHT + 2) * 4;
+    int stride = ((SOURCE_WIDTH + 2) * PIXMAN_FORMAT_BPP (format) / 8 + 3) & ~3;
+    size_t n_bytes = stride * (SOURCE_HEIGHT + 2);
     uint32_t *data = malloc (n_bytes);
     pixman_image_t *source;
 
     prng_randmemset (data, n_bytes, 0);
     
     source = pixman_image_create_bits (
-	PIXMAN_a8r8g8b8, SOURCE_WIDTH + 2, SOURCE_HEIGHT + 2,
+	format, SOURCE_WIDTH + 2, SOURCE_HEIGHT + 2,
 	data,
-	(SOURCE_WIDTH + 2) * 4);
+	stride);
 
     pixman_image_set_filter (source, PIXMAN_FILTER_BILINEAR, NULL, 0);
 
     return source;
 }
 
+static void
+usage (void)
+{
+    printf ("Usage: scaling-bench [-r] [-c] [src format]\n");
+    printf ("  -r : also rotate the source by %d degrees\n", ROTATION);
+    printf ("  -c : separable convolution filter instead of bilinear\n");
+    printf ("  src format : a8r8g8b8 (default), x8r8g8b8, a8 etc\n");
+}
+
 int
-main ()
+main (int argc, char **argv)
 {
     double scale;
     pixman_image_t *src;
+    pixman_format_code_t format = PIXMAN_a8r8g8b8;
+    pixman_bool_t rotate = FALSE;
+    pixman_bool_t convolution = FALSE;
+    int i;
+
+    for (i = 1; i < argc; i++)
+    {
+	if (strcmp (argv[i], "-r") == 0)
+	    rotate = TRUE;
+	else if (strcmp (argv[i], "-c") == 0)
+	    convolution = TRUE;
+	else if ((format = format_from_string (argv[i])) == PIXMAN_null)
+	{
+	    usage ();
+	    return 1;
+	}
+    }
 
     prng_srand (23874);
     
-    src = make_source ();
+    src = make_source (format);
     printf ("# %-6s %-22s   %-14s %-12s\n",
 	    "ratio",
 	    "resolutions",
@@ -40,7 +70,6 @@ main ()
 	    "time per pixel / ns");
     for (scale = 0.1; scale < 10.005; scale += 0.01)
     {
-	int i;
 	int dest_width = SOURCE_WIDTH * scale + 0.5;
 	int dest_height = SOURCE_HEIGHT * scale + 0.5;
 	int dest_byte_stride = (dest_width * 4 + 15) & ~15;
@@ -52,7 +81,29 @@ main ()
 	memset (dest_buf, 0, dest_byte_stride * dest_height);
 
 	pixman_transform_init_scale (&transform, s, s);
+	if (rotate)
+	{
+	    double a = ROTATION * 3.14159265358979323846 / 180;
+
+	    pixman_transform_rotate (&transform, NULL,
+				     pixman_double_to_fixed (cos (a)),
+				     pixman_double_to_fixed (sin (a)));
+	}
 	pixman_image_set_transform (src, &transform);
+
+	if (convolution)
+	{
+	    pixman_fixed_t *params;
+	    int n_params;
+
+	    params = pixman_filter_create_separable_convolution (
+		&n_params, s, s,
+		PIXMAN_KERNEL_LINEAR, PIXMAN_KERNEL_LINEAR,
+		PIXMAN_KERNEL_BOX, PIXMAN_KERNEL_BOX, 4, 4);
+	    pixman_image_set_filter (src, PIXMAN_FILTER_SEPARABLE_CONVOLUTION,
+				     params, n_params);
+	    free (params);
+	}
 	
 	dest = pixman_image_create_bits (
 	    PIXMAN_a8r8g8b8, dest_width, dest_height, dest_buf, dest_byte_stride);
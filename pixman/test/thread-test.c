@@ -11,6 +11,8 @@ int main ()
 #else
 
 #include <stdlib.h>
+#include <string.h>
+#include <math.h>
 
 #ifdef HAVE_PTHREADS
 # include <pthread.h>
@@ -73,8 +75,11 @@ static const pixman_format_code_t formats[] =
 
 #define N_ROUNDS 8192
 
+#define RAND_ELT_R(prng, arr)						\
+    arr[prng_rand_r(prng) % ARRAY_LENGTH (arr)]
+
 #define RAND_ELT(arr)							\
-    arr[prng_rand_r(&info->prng_state) % ARRAY_LENGTH (arr)]
+    RAND_ELT_R (&info->prng_state, arr)
 
 #define DEST_WIDTH (7)
 
@@ -136,6 +141,311 @@ thread (LPVOID data)
 #endif
 }
 
+static uint32_t
+read_memory (const void *src, int size)
+{
+    switch (size)
+    {
+    case 1:
+	return *(uint8_t *)src;
+    case 2:
+	return *(uint16_t *)src;
+    default:
+	return *(uint32_t *)src;
+    }
+}
+
+static void
+write_memory (void *dst, uint32_t value, int size)
+{
+    switch (size)
+    {
+    case 1:
+	*(uint8_t *)dst = value;
+	break;
+    case 2:
+	*(uint16_t *)dst = value;
+	break;
+    default:
+	*(uint32_t *)dst = value;
+	break;
+    }
+}
+
+/* A pool that runs the tasks backwards on the calling thread */
+static void
+run_tasks_backwards (void *user_data, pixman_task_func_t func,
+		     void *data, int n_tasks)
+{
+    int *n_calls = user_data;
+
+    while (n_tasks--)
+	func (data, n_tasks);
+
+    (*n_calls)++;
+}
+
+#define PAR_WIDTH  400
+#define PAR_HEIGHT 300
+#define PAR_ROUNDS 64
+
+static const pixman_format_code_t par_formats[] =
+{
+    PIXMAN_a8r8g8b8,
+    PIXMAN_x8r8g8b8,
+    PIXMAN_r5g6b5,
+    PIXMAN_a8,
+    PIXMAN_a4r4g4b4,
+    PIXMAN_a2r10g10b10,
+};
+
+static const pixman_repeat_t repeats[] =
+{
+    PIXMAN_REPEAT_NONE,
+    PIXMAN_REPEAT_NORMAL,
+    PIXMAN_REPEAT_PAD,
+    PIXMAN_REPEAT_REFLECT,
+};
+
+static pixman_image_t *
+make_image (prng_t *prng, pixman_format_code_t format,
+	    int width, int height, pixman_bool_t accessors)
+{
+    int stride = ((width * PIXMAN_FORMAT_BPP (format) + 31) / 32) * 4;
+    uint32_t *bits = malloc (stride * height);
+    pixman_image_t *image;
+
+    prng_randmemset_r (prng, bits, stride * height, 0);
+    image = pixman_image_create_bits (format, width, height, bits, stride);
+
+    if (accessors)
+	pixman_image_set_accessors (image, read_memory, write_memory);
+
+    return image;
+}
+
+static void
+free_image (pixman_image_t *image)
+{
+    if (image)
+    {
+	free (pixman_image_get_data (image));
+	pixman_image_unref (image);
+    }
+}
+
+static pixman_image_t *
+copy_image (pixman_image_t *image)
+{
+    int size = pixman_image_get_stride (image) * pixman_image_get_height (image);
+    uint32_t *bits = malloc (size);
+
+    memcpy (bits, pixman_image_get_data (image), size);
+
+    return pixman_image_create_bits (pixman_image_get_format (image),
+				     pixman_image_get_width (image),
+				     pixman_image_get_height (image),
+				     bits, pixman_image_get_stride (image));
+}
+
+static pixman_bool_t
+images_equal (pixman_image_t *a, pixman_image_t *b)
+{
+    return memcmp (pixman_image_get_data (a), pixman_image_get_data (b),
+		   pixman_image_get_stride (a) * pixman_image_get_height (a)) == 0;
+}
+
+static void
+set_random_source_state (prng_t *prng, pixman_image_t *image)
+{
+    pixman_transform_t transform;
+    double angle;
+
+    pixman_image_set_repeat (image, RAND_ELT_R (prng, repeats));
+
+    if (prng_rand_r (prng) % 2)
+    {
+	angle = (prng_rand_r (prng) % 360) * 3.14159265 / 180;
+
+	pixman_transform_init_rotate (
+	    &transform,
+	    pixman_double_to_fixed (cos (angle)),
+	    pixman_double_to_fixed (sin (angle)));
+	pixman_transform_scale (&transform, NULL,
+				pixman_double_to_fixed (0.8), pixman_double_to_fixed (1.3));
+	pixman_image_set_transform (image, &transform);
+	pixman_image_set_filter (image, prng_rand_r (prng) % 2 ?
+				 PIXMAN_FILTER_BILINEAR : PIXMAN_FILTER_NEAREST,
+				 NULL, 0);
+    }
+}
+
+/*
+ * Composite with pixman_image_composite_parallel() and with
+ * pixman_image_composite32() and check that the results are identical.
+ */
+static int
+test_parallel (pixman_thread_pool_t *pool, uint32_t seed)
+{
+    prng_t prng;
+    int i;
+
+    prng_srand_r (&prng, seed);
+
+    for (i = 0; i < PAR_ROUNDS; ++i)
+    {
+	pixman_image_t *src, *mask = NULL, *dest, *dest_alpha = NULL;
+	pixman_image_t *ref, *ref_alpha = NULL;
+	pixman_op_t op = RAND_ELT_R (&prng, operators);
+	int flags = prng_rand_r (&prng);
+	int width = PAR_WIDTH - prng_rand_r (&prng) % 64;
+	int height = PAR_HEIGHT - prng_rand_r (&prng) % 64;
+	int dest_x = prng_rand_r (&prng) % 64 - 16;
+	int dest_y = prng_rand_r (&prng) % 64 - 16;
+	int ok;
+
+	src = make_image (&prng, RAND_ELT_R (&prng, par_formats),
+			  1 + prng_rand_r (&prng) % 200, 1 + prng_rand_r (&prng) % 200,
+			  flags & 1);
+	set_random_source_state (&prng, src);
+
+	if (flags & 2)
+	{
+	    mask = make_image (&prng, PIXMAN_a8, 1 + prng_rand_r (&prng) % 100,
+			       1 + prng_rand_r (&prng) % 100, FALSE);
+	    set_random_source_state (&prng, mask);
+	    pixman_image_set_component_alpha (mask, flags & 4);
+	}
+
+	dest = make_image (&prng, RAND_ELT_R (&prng, par_formats),
+			   PAR_WIDTH, PAR_HEIGHT, flags & 8);
+	ref = copy_image (dest);
+	if (flags & 8)
+	    pixman_image_set_accessors (ref, read_memory, write_memory);
+
+	if (flags & 16)
+	{
+	    dest_alpha = make_image (&prng, PIXMAN_a8, PAR_WIDTH, PAR_HEIGHT, FALSE);
+	    ref_alpha = copy_image (dest_alpha);
+	    pixman_image_set_alpha_map (dest, dest_alpha, 0, 0);
+	    pixman_image_set_alpha_map (ref, ref_alpha, 0, 0);
+	}
+
+	if (flags & 32)
+	{
+	    pixman_region32_t clip;
+
+	    pixman_region32_init_rect (&clip, 20, 30, 300, 100);
+	    pixman_region32_union_rect (&clip, &clip, 0, 180, 350, 120);
+	    pixman_image_set_clip_region32 (dest, &clip);
+	    pixman_image_set_clip_region32 (ref, &clip);
+	    pixman_region32_fini (&clip);
+	}
+
+	if (flags & 64)
+	{
+	    pixman_image_set_dither (dest, PIXMAN_DITHER_ORDERED_BAYER_8);
+	    pixman_image_set_dither (ref, PIXMAN_DITHER_ORDERED_BAYER_8);
+	}
+
+	pixman_image_composite32 (op, src, mask, ref, -3, 5, 7, -2,
+				  dest_x, dest_y, width, height);
+	pixman_image_composite_parallel (pool, op, src, mask, dest, -3, 5, 7, -2,
+					 dest_x, dest_y, width, height);
+
+	ok = images_equal (dest, ref) &&
+	    (!dest_alpha || images_equal (dest_alpha, ref_alpha));
+
+	free_image (src);
+	free_image (mask);
+	free_image (dest);
+	free_image (ref);
+	free_image (dest_alpha);
+	free_image (ref_alpha);
+
+	if (!ok)
+	{
+	    printf ("thread-test failed. Parallel composite differs in round %d "
+		    "(seed %u)\n", i, seed);
+	    return 1;
+	}
+    }
+
+    return 0;
+}
+
+/*
+ * Composite an image onto itself shifted by one row.  Every band reads
+ * rows that the band before it writes, so the operation must not be
+ * split.
+ */
+static int
+test_self_composite (pixman_thread_pool_t *pool)
+{
+    prng_t prng;
+    int shift;
+
+    prng_srand_r (&prng, 4);
+
+    for (shift = -1; shift <= 1; shift += 2)
+    {
+	pixman_image_t *image, *ref;
+	int ok;
+
+	image = make_image (&prng, PIXMAN_a8r8g8b8, 1024, 2048, FALSE);
+	ref = copy_image (image);
+
+	pixman_image_composite32 (PIXMAN_OP_SRC, ref, NULL, ref,
+				  0, 0, 0, 0, 0, shift, 1024, 2048);
+	pixman_image_composite_parallel (pool, PIXMAN_OP_SRC, image, NULL, image,
+					 0, 0, 0, 0, 0, shift, 1024, 2048);
+
+	ok = images_equal (image, ref);
+
+	free_image (image);
+	free_image (ref);
+
+	if (!ok)
+	{
+	    printf ("thread-test failed. Parallel composite of an image onto "
+		    "itself differs (shift %d)\n", shift);
+	    return 1;
+	}
+    }
+
+    return 0;
+}
+
+static int
+test_pools (void)
+{
+    pixman_thread_pool_t *pool;
+    int n_calls = 0;
+    int result = 0;
+
+    result |= test_parallel (NULL, 1);
+
+    pool = pixman_thread_pool_create (3);
+    result |= test_parallel (pool, 2);
+    pixman_thread_pool_destroy (pool);
+
+    pool = pixman_thread_pool_create (8);
+    result |= test_self_composite (pool);
+    pixman_thread_pool_destroy (pool);
+
+    pool = pixman_thread_pool_create_custom (run_tasks_backwards, &n_calls, 8);
+    result |= test_parallel (pool, 3);
+    pixman_thread_pool_destroy (pool);
+
+    if (n_calls == 0)
+    {
+	printf ("thread-test failed. The custom pool was never used\n");
+	result = 1;
+    }
+
+    return result;
+}
+
 static inline uint32_t
 byteswap32 (uint32_t x)
 {
@@ -224,7 +534,7 @@ main (void)
 	return 1;
     }
 
-    return 0;
+    return test_pools ();
 }
 
 #endif
@@ -62,6 +62,7 @@ in this Software without prior written authorization from The Open Group.
 #include <sys/mman.h>
 #include "protocol-versions.h"
 #include "busfault.h"
+#include "damage.h"
 
 /* Needed for Solaris cross-zone shared memory extension */
 #ifdef HAVE_SHMCTL64
@@ -101,8 +102,31 @@ typedef struct _ShmScrPrivateRec {
     CloseScreenProcPtr CloseScreen;
     ShmFuncsPtr shmFuncs;
     DestroyPixmapProcPtr destroyPixmap;
+    Bool directAccess;
 } ShmScrPrivateRec;
 
+/*
+ * Each client keeps the last few segments it detached mapped, so that
+ * clients attaching and detaching the same segment around every frame
+ * don't pay for shmat() or mmap() and the page faults that follow each
+ * time.  A cached mapping is only handed back to the client which
+ * detached it, and only after the access checks have been repeated.
+ *
+ * Keeping a SysV segment mapped keeps it alive after the client removes
+ * it, so removed segments are dropped from the caches whenever a client
+ * caches or attaches a segment, and every few seconds while any are
+ * cached.
+ */
+#define SHM_CACHE_SIZE	4
+#define SHM_CACHE_BYTES	(64 << 20)
+#define SHM_CACHE_CHECK_MS	2000
+
+typedef struct _ShmClientPrivate {
+    ShmDescPtr cache;           /* most recently detached first */
+    int ncached;
+    unsigned long cachedBytes;
+} ShmClientPrivateRec;
+
 static PixmapPtr fbShmCreatePixmap(XSHM_CREATE_PIXMAP_ARGS);
 static int ShmDetachSegment(void *value, XID shmseg);
 static void ShmResetProc(ExtensionEntry *extEntry);
@@ -116,6 +140,8 @@ int ShmCompletionCode;
 int BadShmSegCode;
 RESTYPE ShmSegType;
 static ShmDescPtr Shmsegs;
+static OsTimerPtr ShmCacheTimer;
+static Bool ShmCacheTimerActive;
 static Bool sharedPixmaps;
 static DevPrivateKeyRec shmScrPrivateKeyRec;
 
@@ -123,10 +149,14 @@ static DevPrivateKeyRec shmScrPrivateKeyRec;
 static DevPrivateKeyRec shmPixmapPrivateKeyRec;
 
 #define shmPixmapPrivateKey (&shmPixmapPrivateKeyRec)
+static DevPrivateKeyRec shmClientPrivateKeyRec;
+
+#define shmClientPrivateKey (&shmClientPrivateKeyRec)
 static ShmFuncs miFuncs = { NULL, NULL };
 static ShmFuncs fbFuncs = { fbShmCreatePixmap, NULL };
 
 #define ShmGetScreenPriv(s) ((ShmScrPrivateRec *)dixLookupPrivate(&(s)->devPrivates, shmScrPrivateKey))
+#define ShmGetClientPriv(c) ((ShmClientPrivateRec *)dixLookupPrivate(&(c)->devPrivates, shmClientPrivateKey))
 
 #define VERIFY_SHMSEG(shmseg,shmdesc,client) \
 { \
@@ -235,8 +265,13 @@ ShmResetProc(ExtensionEntry * extEntry)
 {
     int i;
 
-    for (i = 0; i < screenInfo.numScreens; i++)
+    for (i = 0; i < screenInfo.numScreens; i++) {
         ShmRegisterFuncs(screenInfo.screens[i], NULL);
+        ShmGetScreenPriv(screenInfo.screens[i])->directAccess = FALSE;
+    }
+    TimerFree(ShmCacheTimer);
+    ShmCacheTimer = NULL;
+    ShmCacheTimerActive = FALSE;
 }
 
 void
@@ -275,6 +310,19 @@ ShmRegisterFbFuncs(ScreenPtr pScreen)
     ShmRegisterFuncs(pScreen, &fbFuncs);
 }
 
+/*
+ * Called by DDXes which keep every pixmap in system memory at
+ * devPrivate.ptr, in the layout fb uses, to let ShmPutImage and
+ * ShmGetImage copy straight between segments and pixmaps.
+ */
+void
+ShmRegisterDirectAccess(ScreenPtr pScreen)
+{
+    if (!ShmRegisterPrivates())
+        return;
+    ShmInitScreenPriv(pScreen)->directAccess = TRUE;
+}
+
 static int
 ProcShmQueryVersion(ClientPtr client)
 {
@@ -383,6 +431,188 @@ shm_access(ClientPtr client, SHMPERM_TYPE * perm, int readonly)
     #endif
 }
 
+/*
+ * Unmap a segment for good.
+ */
+static void
+ShmUnmapSegment(ShmDescPtr shmdesc)
+{
+#ifndef _MSC_VER
+#if SHM_FD_PASSING
+    if (shmdesc->is_fd) {
+        if (shmdesc->busfault)
+            busfault_unregister(shmdesc->busfault);
+        munmap(shmdesc->addr, shmdesc->size);
+    } else
+#endif
+        shmdt(shmdesc->addr);
+#endif
+    free(shmdesc);
+}
+
+/*
+ * Whether a SysV segment has been removed, so that it goes away as soon as
+ * the last mapping does.
+ */
+static Bool
+ShmSegmentRemoved(ShmDescPtr shmdesc)
+{
+#if defined(SHM_DEST) && !defined(_MSC_VER)
+    SHMSTAT_TYPE buf;
+
+    if (SHMDESC_IS_FD(shmdesc))
+        return FALSE;
+    return SHMSTAT(shmdesc->shmid, &buf) ||
+        (SHMPERM_MODE((&SHM_PERM(buf))) & SHM_DEST);
+#else
+    return FALSE;
+#endif
+}
+
+/*
+ * Unmap the cached segments which have been removed since, and the least
+ * recently detached ones past the limits.  Returns whether any SysV
+ * segments are left in the cache.
+ */
+static Bool
+ShmTrimCache(ShmClientPrivateRec *priv)
+{
+    ShmDescPtr shmdesc, *prev;
+    unsigned long bytes = 0;
+    Bool sysv = FALSE;
+    int n = 0;
+
+    for (prev = &priv->cache; (shmdesc = *prev);) {
+        if (n == SHM_CACHE_SIZE ||
+            (n && bytes + shmdesc->size > SHM_CACHE_BYTES) ||
+            ShmSegmentRemoved(shmdesc)) {
+            *prev = shmdesc->next;
+            ShmUnmapSegment(shmdesc);
+            continue;
+        }
+        n++;
+        bytes += shmdesc->size;
+        sysv |= !SHMDESC_IS_FD(shmdesc);
+        prev = &shmdesc->next;
+    }
+    priv->ncached = n;
+    priv->cachedBytes = bytes;
+    return sysv;
+}
+
+static CARD32
+ShmCacheTimerExpired(OsTimerPtr timer, CARD32 now, void *arg)
+{
+    Bool sysv = FALSE;
+    int i;
+
+    for (i = 1; i < currentMaxClients; i++) {
+        if (clients[i] && ShmGetClientPriv(clients[i])->ncached)
+            sysv |= ShmTrimCache(ShmGetClientPriv(clients[i]));
+    }
+    ShmCacheTimerActive = sysv;
+    return sysv ? SHM_CACHE_CHECK_MS : 0;
+}
+
+/*
+ * Keep a segment no longer attached in its owner's cache, unmapping the
+ * least recently detached ones if the cache is full.  Returns FALSE if
+ * the segment should be unmapped right away instead.
+ */
+static Bool
+ShmCacheSegment(ShmDescPtr shmdesc)
+{
+    ShmClientPrivateRec *priv;
+
+    if (!shmdesc->owner || shmdesc->size > SHM_CACHE_BYTES)
+        return FALSE;
+#ifdef SHM_FD_PASSING
+    if (shmdesc->is_fd) {
+        /* Reattaching registers a handler for the new resource */
+        if (shmdesc->busfault)
+            busfault_unregister(shmdesc->busfault);
+        shmdesc->busfault = NULL;
+    }
+#endif
+    /* Removed by the client, don't keep it alive */
+    if (ShmSegmentRemoved(shmdesc))
+        return FALSE;
+
+    priv = ShmGetClientPriv(shmdesc->owner);
+    shmdesc->next = priv->cache;
+    priv->cache = shmdesc;
+
+    /* Clients usually remove a segment only after detaching it */
+    if (ShmTrimCache(priv) && !ShmCacheTimerActive) {
+        ShmCacheTimer = TimerSet(ShmCacheTimer, 0, SHM_CACHE_CHECK_MS,
+                                 ShmCacheTimerExpired, NULL);
+        ShmCacheTimerActive = ShmCacheTimer != NULL;
+    }
+    return TRUE;
+}
+
+static Bool
+ShmSameSegment(ShmDescPtr a, ShmDescPtr b)
+{
+    if (SHMDESC_IS_FD(a) != SHMDESC_IS_FD(b) || a->writable != b->writable)
+        return FALSE;
+#ifdef SHM_FD_PASSING
+    if (a->is_fd)
+        return a->dev == b->dev && a->ino == b->ino && a->size == b->size;
+#endif
+    return a->shmid == b->shmid;
+}
+
+/*
+ * Take the mapping of the segment described by key out of the client's
+ * cache, if it is there.
+ */
+static ShmDescPtr
+ShmUncacheSegment(ClientPtr client, ShmDescPtr key)
+{
+    ShmClientPrivateRec *priv = ShmGetClientPriv(client);
+    ShmDescPtr shmdesc, *prev;
+
+    if (!priv->ncached)
+        return NULL;
+
+    ShmTrimCache(priv);
+    for (prev = &priv->cache; (shmdesc = *prev); prev = &shmdesc->next) {
+        if (ShmSameSegment(shmdesc, key)) {
+            *prev = shmdesc->next;
+            priv->ncached--;
+            priv->cachedBytes -= shmdesc->size;
+            return shmdesc;
+        }
+    }
+    return NULL;
+}
+
+static void
+ShmClientCallback(CallbackListPtr *list, void *closure, void *data)
+{
+    NewClientInfoRec *clientinfo = (NewClientInfoRec *) data;
+    ClientPtr client = clientinfo->client;
+    ShmClientPrivateRec *priv = ShmGetClientPriv(client);
+    ShmDescPtr shmdesc;
+
+    if (client->clientState != ClientStateRetained &&
+        client->clientState != ClientStateGone)
+        return;
+
+    /* Segments it still has attached are unmapped once detached */
+    for (shmdesc = Shmsegs; shmdesc; shmdesc = shmdesc->next)
+        if (shmdesc->owner == client)
+            shmdesc->owner = NULL;
+
+    while ((shmdesc = priv->cache)) {
+        priv->cache = shmdesc->next;
+        ShmUnmapSegment(shmdesc);
+    }
+    priv->ncached = 0;
+    priv->cachedBytes = 0;
+}
+
 static int
 ProcShmAttach(ClientPtr client)
 {
@@ -407,33 +637,51 @@ ProcShmAttach(ClientPtr client)
         shmdesc->refcnt++;
     }
     else {
-        shmdesc = malloc(sizeof(ShmDescRec));
-        if (!shmdesc)
-            return BadAlloc;
+        ShmDescRec key = {
+            .shmid = stuff->shmid,
+            .writable = !stuff->readOnly
+        };
+
+        shmdesc = ShmUncacheSegment(client, &key);
+        if (shmdesc) {
+            /* Permissions may have changed since it was detached */
+            if (SHMSTAT(stuff->shmid, &buf) ||
+                shm_access(client, &(SHM_PERM(buf)), stuff->readOnly) == -1) {
+                ShmUnmapSegment(shmdesc);
+                return BadAccess;
+            }
+        }
+        else {
+            shmdesc = malloc(sizeof(ShmDescRec));
+            if (!shmdesc)
+                return BadAlloc;
 #ifdef SHM_FD_PASSING
-        shmdesc->is_fd = FALSE;
+            shmdesc->is_fd = FALSE;
 #endif
-        shmdesc->addr = shmat(stuff->shmid, 0,
-                              stuff->readOnly ? SHM_RDONLY : 0);
-        if ((shmdesc->addr == ((char *) -1)) || SHMSTAT(stuff->shmid, &buf)) {
-            free(shmdesc);
-            return BadAccess;
-        }
+            shmdesc->addr = shmat(stuff->shmid, 0,
+                                  stuff->readOnly ? SHM_RDONLY : 0);
+            if ((shmdesc->addr == ((char *) -1)) ||
+                SHMSTAT(stuff->shmid, &buf)) {
+                free(shmdesc);
+                return BadAccess;
+            }
 
-        /* The attach was performed with root privs. We must
-         * do manual checking of access rights for the credentials
-         * of the client */
+            /* The attach was performed with root privs. We must
+             * do manual checking of access rights for the credentials
+             * of the client */
 
-        if (shm_access(client, &(SHM_PERM(buf)), stuff->readOnly) == -1) {
-            shmdt(shmdesc->addr);
-            free(shmdesc);
-            return BadAccess;
-        }
+            if (shm_access(client, &(SHM_PERM(buf)), stuff->readOnly) == -1) {
+                shmdt(shmdesc->addr);
+                free(shmdesc);
+                return BadAccess;
+            }
 
-        shmdesc->shmid = stuff->shmid;
+            shmdesc->shmid = stuff->shmid;
+            shmdesc->writable = !stuff->readOnly;
+            shmdesc->size = SHM_SEGSZ(buf);
+        }
         shmdesc->refcnt = 1;
-        shmdesc->writable = !stuff->readOnly;
-        shmdesc->size = SHM_SEGSZ(buf);
+        shmdesc->owner = client;
         shmdesc->next = Shmsegs;
         Shmsegs = shmdesc;
     }
@@ -451,19 +699,10 @@ ShmDetachSegment(void *value, /* must conform to DeleteType */
 
     if (--shmdesc->refcnt)
         return TRUE;
-#ifndef _MSC_VER
-#if SHM_FD_PASSING
-    if (shmdesc->is_fd) {
-        if (shmdesc->busfault)
-            busfault_unregister(shmdesc->busfault);
-        munmap(shmdesc->addr, shmdesc->size);
-    } else
-#endif
-        shmdt(shmdesc->addr);
-#endif
     for (prev = &Shmsegs; *prev != shmdesc; prev = &(*prev)->next);
     *prev = shmdesc->next;
-    free(shmdesc);
+    if (!ShmCacheSegment(shmdesc))
+        ShmUnmapSegment(shmdesc);
     return Success;
 }
 
@@ -480,6 +719,101 @@ ProcShmDetach(ClientPtr client)
     return Success;
 }
 
+/*
+ * On screens which registered direct access, ZPixmap images in the
+ * format of a pixmap are copied straight between the segment and the
+ * pixmap bits, instead of going through PutImage or a scratch pixmap
+ * header and CopyArea with the GC and region work they involve.
+ */
+static PixmapPtr
+ShmDirectPixmap(DrawablePtr pDraw, unsigned int format)
+{
+    ShmScrPrivateRec *screen_priv = ShmGetScreenPriv(pDraw->pScreen);
+    PixmapPtr pPixmap = (PixmapPtr) pDraw;
+
+    if (format != ZPixmap || pDraw->type != DRAWABLE_PIXMAP ||
+        !screen_priv || !screen_priv->directAccess ||
+        !pPixmap->devPrivate.ptr || pDraw->bitsPerPixel < 8)
+        return NULL;
+    return pPixmap;
+}
+
+/* All planes of an n bit pixel */
+#define ShmAllPlanes(n)	((n) >= 32 ? (CARD32) ~0 : ((CARD32) 1 << (n)) - 1)
+
+static Bool
+ShmDirectPutImage(DrawablePtr dst, GCPtr pGC,
+                  int depth, unsigned int format,
+                  int w, int h, int sx, int sy, int sw, int sh, int dx, int dy,
+                  char *data)
+{
+    PixmapPtr pPixmap = ShmDirectPixmap(dst, format);
+    CARD32 planes = ShmAllPlanes(depth);
+    int bpp = dst->bitsPerPixel;
+    int srcStride = PixmapBytePad(w, depth);
+    char *src, *bits;
+    BoxRec box;
+    RegionRec region;
+    int x, y;
+
+    if (!pPixmap || pGC->alu != GXcopy || pGC->clientClip ||
+        (pGC->planemask & planes) != planes || (depth != bpp && bpp != 32))
+        return FALSE;
+
+    box.x1 = max(dx, 0);
+    box.y1 = max(dy, 0);
+    box.x2 = min(dx + sw, dst->width);
+    box.y2 = min(dy + sh, dst->height);
+    if (box.x1 >= box.x2 || box.y1 >= box.y2)
+        return TRUE;
+
+    src = data + (sy + box.y1 - dy) * srcStride +
+        (sx + box.x1 - dx) * (bpp >> 3);
+    bits = (char *) pPixmap->devPrivate.ptr + box.y1 * pPixmap->devKind +
+        box.x1 * (bpp >> 3);
+    for (y = box.y1; y < box.y2; y++) {
+        if (depth == bpp)
+            memcpy(bits, src, (box.x2 - box.x1) * (bpp >> 3));
+        else {
+            /* Bits above the depth are left alone, as fb does */
+            CARD32 *s = (CARD32 *) src, *d = (CARD32 *) bits;
+
+            for (x = 0; x < box.x2 - box.x1; x++)
+                d[x] = (s[x] & planes) | (d[x] & ~planes);
+        }
+        src += srcStride;
+        bits += pPixmap->devKind;
+    }
+
+    RegionInit(&region, &box, 1);
+    DamageDamageRegion(dst, &region);
+    RegionUninit(&region);
+    return TRUE;
+}
+
+static Bool
+ShmDirectGetImage(DrawablePtr pDraw, int x, int y, int w, int h,
+                  unsigned int format, unsigned long planeMask, char *data)
+{
+    PixmapPtr pPixmap = ShmDirectPixmap(pDraw, format);
+    int bpp = pDraw->bitsPerPixel;
+    int dstStride = PixmapBytePad(w, pDraw->depth);
+    char *bits;
+
+    /* fb masks the image unless the plane mask covers whole pixels */
+    if (!pPixmap || (planeMask & ShmAllPlanes(bpp)) != ShmAllPlanes(bpp))
+        return FALSE;
+
+    bits = (char *) pPixmap->devPrivate.ptr + y * pPixmap->devKind +
+        x * (bpp >> 3);
+    while (h--) {
+        memcpy(data, bits, w * (bpp >> 3));
+        data += dstStride;
+        bits += pPixmap->devKind;
+    }
+    return TRUE;
+}
+
 /*
  * If the given request doesn't exactly match PutImage's constraints,
  * wrap the image in a scratch pixmap header and let CopyArea sort it out.
@@ -594,13 +928,21 @@ ProcShmPutImage(ClientPtr client)
         return BadValue;
     }
 
-    if ((((stuff->format == ZPixmap) && (stuff->srcX == 0)) ||
-         ((stuff->format != ZPixmap) &&
-          (stuff->srcX < screenInfo.bitmapScanlinePad) &&
-          ((stuff->format == XYBitmap) ||
-           ((stuff->srcY == 0) &&
-            (stuff->srcHeight == stuff->totalHeight))))) &&
-        ((stuff->srcX + stuff->srcWidth) == stuff->totalWidth))
+    if (ShmDirectPutImage(pDraw, pGC, stuff->depth, stuff->format,
+                          stuff->totalWidth, stuff->totalHeight,
+                          stuff->srcX, stuff->srcY,
+                          stuff->srcWidth, stuff->srcHeight,
+                          stuff->dstX, stuff->dstY,
+                          shmdesc->addr + stuff->offset)) {
+        /* copied straight into the pixmap */
+    }
+    else if ((((stuff->format == ZPixmap) && (stuff->srcX == 0)) ||
+              ((stuff->format != ZPixmap) &&
+               (stuff->srcX < screenInfo.bitmapScanlinePad) &&
+               ((stuff->format == XYBitmap) ||
+                ((stuff->srcY == 0) &&
+                 (stuff->srcHeight == stuff->totalHeight))))) &&
+             ((stuff->srcX + stuff->srcWidth) == stuff->totalWidth))
         (*pGC->ops->PutImage) (pDraw, pGC, stuff->depth,
                                stuff->dstX, stuff->dstY,
                                stuff->totalWidth, stuff->srcHeight,
@@ -706,6 +1048,12 @@ ProcShmGetImage(ClientPtr client)
     if (length == 0) {
         /* nothing to do */
     }
+    else if (ShmDirectGetImage(pDraw, stuff->x, stuff->y,
+                               stuff->width, stuff->height,
+                               stuff->format, stuff->planeMask,
+                               shmdesc->addr + stuff->offset)) {
+        /* copied straight from the pixmap */
+    }
     else if (stuff->format == ZPixmap) {
         (*pDraw->pScreen->GetImage) (pDraw, stuff->x, stuff->y,
                                      stuff->width, stuff->height,
@@ -1156,6 +1504,7 @@ ShmBusfaultNotify(void *context)
            (unsigned int) shmdesc->resource);
     busfault_unregister(shmdesc->busfault);
     shmdesc->busfault = NULL;
+    shmdesc->owner = NULL;
     FreeResource (shmdesc->resource, RT_NONE);
 }
 
@@ -1164,6 +1513,7 @@ ProcShmAttachFd(ClientPtr client)
 {
     int fd;
     ShmDescPtr shmdesc;
+    ShmDescRec key;
     REQUEST(xShmAttachFdReq);
     struct stat statb;
 
@@ -1183,32 +1533,48 @@ ProcShmAttachFd(ClientPtr client)
         return BadMatch;
     }
 
-    shmdesc = malloc(sizeof(ShmDescRec));
-    if (!shmdesc) {
+    key = (ShmDescRec) {
+        .is_fd = TRUE,
+        .writable = !stuff->readOnly,
+        .size = statb.st_size,
+        .dev = statb.st_dev,
+        .ino = statb.st_ino
+    };
+    shmdesc = ShmUncacheSegment(client, &key);
+    if (shmdesc) {
         close(fd);
-        return BadAlloc;
     }
-    shmdesc->is_fd = TRUE;
-    shmdesc->addr = mmap(NULL, statb.st_size,
-                         stuff->readOnly ? PROT_READ : PROT_READ|PROT_WRITE,
-                         MAP_SHARED,
-                         fd, 0);
+    else {
+        shmdesc = malloc(sizeof(ShmDescRec));
+        if (!shmdesc) {
+            close(fd);
+            return BadAlloc;
+        }
+        shmdesc->is_fd = TRUE;
+        shmdesc->addr = mmap(NULL, statb.st_size,
+                             stuff->readOnly ? PROT_READ : PROT_READ|PROT_WRITE,
+                             MAP_SHARED,
+                             fd, 0);
 
-    close(fd);
-    if (shmdesc->addr == ((char *) -1)) {
-        free(shmdesc);
-        return BadAccess;
+        close(fd);
+        if (shmdesc->addr == ((char *) -1)) {
+            free(shmdesc);
+            return BadAccess;
+        }
+
+        shmdesc->writable = !stuff->readOnly;
+        shmdesc->size = statb.st_size;
+        shmdesc->dev = statb.st_dev;
+        shmdesc->ino = statb.st_ino;
     }
 
     shmdesc->refcnt = 1;
-    shmdesc->writable = !stuff->readOnly;
-    shmdesc->size = statb.st_size;
+    shmdesc->owner = client;
     shmdesc->resource = stuff->shmseg;
 
     shmdesc->busfault = busfault_register_mmap(shmdesc->addr, shmdesc->size, ShmBusfaultNotify, shmdesc);
     if (!shmdesc->busfault) {
-        munmap(shmdesc->addr, shmdesc->size);
-        free(shmdesc);
+        ShmUnmapSegment(shmdesc);
         return BadAlloc;
     }
 
@@ -1279,6 +1645,7 @@ ProcShmCreateSegment(ClientPtr client)
 {
     int fd;
     ShmDescPtr shmdesc;
+    struct stat statb;
     REQUEST(xShmCreateSegmentReq);
     xShmCreateSegmentReply rep = {
         .type = X_Reply,
@@ -1320,6 +1687,13 @@ ProcShmCreateSegment(ClientPtr client)
     shmdesc->refcnt = 1;
     shmdesc->writable = !stuff->readOnly;
     shmdesc->size = stuff->size;
+    shmdesc->owner = NULL;
+    if (fstat(fd, &statb) == 0) {
+        shmdesc->owner = client;
+        shmdesc->dev = statb.st_dev;
+        shmdesc->ino = statb.st_ino;
+    }
+    shmdesc->resource = stuff->shmseg;
 
     shmdesc->busfault = busfault_register_mmap(shmdesc->addr, shmdesc->size, ShmBusfaultNotify, shmdesc);
     if (!shmdesc->busfault) {
@@ -1559,6 +1933,11 @@ ShmExtensionInit(void)
 
     if (!ShmRegisterPrivates())
         return;
+    if (!dixRegisterPrivateKey(&shmClientPrivateKeyRec, PRIVATE_CLIENT,
+                               sizeof(ShmClientPrivateRec)))
+        return;
+    if (!AddCallback(&ClientStateCallback, ShmClientCallback, NULL))
+        return;
 
     sharedPixmaps = xFalse;
     {
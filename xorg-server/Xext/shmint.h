@@ -58,6 +58,7 @@ typedef struct _ShmFuncs {
 
 #if XTRANS_SEND_FDS
 #define SHM_FD_PASSING  1
+#include <sys/types.h>
 #endif
 
 typedef struct _ShmDesc {
@@ -67,10 +68,13 @@ typedef struct _ShmDesc {
     char *addr;
     Bool writable;
     unsigned long size;
+    struct _Client *owner;      /* keeps the mapping cached once detached */
 #ifdef SHM_FD_PASSING
     Bool is_fd;
     struct busfault *busfault;
     XID resource;
+    dev_t dev;                  /* identify the file for the mapping cache */
+    ino_t ino;
 #endif
 } ShmDescRec, *ShmDescPtr;
 
@@ -86,6 +90,9 @@ extern _X_EXPORT void
 extern _X_EXPORT void
  ShmRegisterFbFuncs(ScreenPtr pScreen);
 
+extern _X_EXPORT void
+ ShmRegisterDirectAccess(ScreenPtr pScreen);
+
 extern _X_EXPORT RESTYPE ShmSegType;
 extern _X_EXPORT int ShmCompletionCode;
 extern _X_EXPORT int BadShmSegCode;
@@ -70,6 +70,7 @@ PERFORMANCE OF THIS SOFTWARE.
 #include "syncsdk.h"
 #include "protocol-versions.h"
 #include "inputstr.h"
+#include "mi.h"
 
 #include <stdio.h>
 #if !defined(WIN32)
@@ -114,6 +115,10 @@ static void SyncInitServerTime(void);
 
 static void SyncInitIdleTime(void);
 
+static void SyncInitMotionCoalesced(void);
+
+static SyncCounter *MotionCoalescedCounter;
+
 static inline void*
 SysCounterGetPrivate(SyncCounter *counter)
 {
@@ -2477,6 +2482,7 @@ static void
 SyncResetProc(ExtensionEntry * extEntry)
 {
     RTCounter = 0;
+    MotionCoalescedCounter = NULL;
 }
 
 /*
@@ -2532,6 +2538,7 @@ SyncExtensionInit(void)
      */
     SyncInitServerTime();
     SyncInitIdleTime();
+    SyncInitMotionCoalesced();
 
 #ifdef DEBUG
     fprintf(stderr, "Sync Extension %d.%d\n",
@@ -2837,6 +2844,44 @@ SyncInitIdleTime(void)
     init_system_idle_counter("IDLETIME", XIAllDevices);
 }
 
+/*
+ * MOTION-COALESCED implementation
+ *
+ * Number of motion events merged away in the input event queue.  mieq
+ * reports every change once it has processed its events, so there is
+ * nothing to watch for the brackets.
+ */
+
+static void
+MotionCoalescedQueryValue(void *pCounter, int64_t *pValue_return)
+{
+    *pValue_return = mieqGetCoalescedMotionCount();
+}
+
+static void
+MotionCoalescedBracketValues(void *pCounter, int64_t *pbracket_less,
+                             int64_t *pbracket_greater)
+{
+}
+
+static void
+SyncInitMotionCoalesced(void)
+{
+    MotionCoalescedCounter =
+        SyncCreateSystemCounter("MOTION-COALESCED",
+                                mieqGetCoalescedMotionCount(), 1,
+                                XSyncCounterNeverDecreases,
+                                MotionCoalescedQueryValue,
+                                MotionCoalescedBracketValues);
+}
+
+void
+SyncChangeMotionCoalesced(int64_t count)
+{
+    if (MotionCoalescedCounter)
+        SyncChangeCounter(MotionCoalescedCounter, count);
+}
+
 SyncCounter*
 SyncInitDeviceIdleTime(DeviceIntPtr dev)
 {
@@ -135,6 +135,7 @@ extern void SyncDestroySystemCounter(void *pCounter);
 
 extern SyncCounter *SyncInitDeviceIdleTime(DeviceIntPtr dev);
 extern void SyncRemoveDeviceIdleTime(SyncCounter *counter);
+extern void SyncChangeMotionCoalesced(int64_t count);
 
 int
 SyncCreateFenceFromFD(ClientPtr client, DrawablePtr pDraw, XID id, int fd, BOOL initially_triggered);
@@ -195,6 +195,8 @@ compRedirectWindow(ClientPtr pClient, WindowPtr pWin, int update)
         cw->damageRegistered = FALSE;
         cw->damaged = FALSE;
         cw->pOldPixmap = NullPixmap;
+        cw->alloc.pPixmap = NullPixmap;
+        cw->oldAlloc.pPixmap = NullPixmap;
         dixSetPrivate(&pWin->devPrivates, CompWindowPrivateKey, cw);
     }
     ccw->next = cw->clients;
@@ -267,6 +269,7 @@ compFreeClientWindow(WindowPtr pWin, XID id)
     Bool anyMarked = FALSE;
     WindowPtr pLayerWin;
     PixmapPtr pPixmap = NULL;
+    CompPixmapAllocRec alloc = { NullPixmap };
 
     if (!cw)
         return;
@@ -291,6 +294,7 @@ compFreeClientWindow(WindowPtr pWin, XID id)
             DamageDestroy(cw->damage);
 
         RegionUninit(&cw->borderClip);
+        alloc = cw->alloc;
 
         dixSetPrivate(&pWin->devPrivates, CompWindowPrivateKey, NULL);
         free(cw);
@@ -310,7 +314,7 @@ compFreeClientWindow(WindowPtr pWin, XID id)
 
     if (pPixmap) {
         compRestoreWindow(pWin, pPixmap);
-        (*pScreen->DestroyPixmap) (pPixmap);
+        compReleasePixmap(pScreen, pPixmap, &alloc);
     }
 }
 
@@ -527,21 +531,197 @@ compUnredirectOneSubwindow(WindowPtr pParent, WindowPtr pWin)
     return Success;
 }
 
+/*
+ * Backing pixmaps are allocated with some slack, so that a window can
+ * grow a little without a new pixmap, and pixmaps no longer needed are
+ * kept in a per-screen pool for other windows of similar size.  Only
+ * pixmaps in system memory with the default ModifyPixmapHeader can be
+ * shrunk to the window size like this; other screens get pixmaps of the
+ * exact size, as before.
+ */
+
+#define COMP_POOL_ALIGN		64
+#define COMP_POOL_IDLE_MS	2000
+
+typedef struct _CompPoolEntry {
+    struct xorg_list entry;
+    CompPixmapAllocRec alloc;
+    CARD32 released;
+} CompPoolEntryRec, *CompPoolEntryPtr;
+
+static int
+compPoolRound(int n)
+{
+    return min((n + n / 8 + COMP_POOL_ALIGN - 1) & ~(COMP_POOL_ALIGN - 1),
+               MAXSHORT);
+}
+
+/*
+ * Whether a pixmap allocated at width x height may back a w x h window
+ * without wasting more than twice the memory a new one would take.
+ */
+static Bool
+compPoolFits(int width, int height, int w, int h)
+{
+    return w <= width && h <= height &&
+        (int64_t) width * height <=
+        2 * (int64_t) compPoolRound(w) * compPoolRound(h);
+}
+
+static size_t
+compPoolSize(CompPixmapAllocPtr alloc)
+{
+    return (size_t) alloc->pPixmap->devKind * alloc->height;
+}
+
+static void
+compPoolRemove(CompScreenPtr cs, CompPoolEntryPtr e)
+{
+    xorg_list_del(&e->entry);
+    cs->pixmapPoolBytes -= compPoolSize(&e->alloc);
+    cs->pixmapPoolStats.cached--;
+    free(e);
+}
+
+/*
+ * Free pooled pixmaps, oldest first, until the pool holds no more than
+ * budget bytes.
+ */
+void
+compTrimPixmapPool(ScreenPtr pScreen, size_t budget)
+{
+    CompScreenPtr cs = GetCompScreen(pScreen);
+
+    while (cs->pixmapPoolBytes > budget) {
+        CompPoolEntryPtr e = xorg_list_last_entry(&cs->pixmapPool,
+                                                  CompPoolEntryRec, entry);
+        PixmapPtr pPixmap = e->alloc.pPixmap;
+
+        compPoolRemove(cs, e);
+        (*pScreen->DestroyPixmap) (pPixmap);
+    }
+}
+
+static CARD32
+compPixmapPoolTimer(OsTimerPtr timer, CARD32 now, void *arg)
+{
+    ScreenPtr pScreen = arg;
+    CompScreenPtr cs = GetCompScreen(pScreen);
+
+    while (!xorg_list_is_empty(&cs->pixmapPool)) {
+        CompPoolEntryPtr e = xorg_list_last_entry(&cs->pixmapPool,
+                                                  CompPoolEntryRec, entry);
+        PixmapPtr pPixmap = e->alloc.pPixmap;
+
+        if ((int) (now - e->released) < COMP_POOL_IDLE_MS)
+            return COMP_POOL_IDLE_MS;
+        compPoolRemove(cs, e);
+        (*pScreen->DestroyPixmap) (pPixmap);
+    }
+    return 0;
+}
+
+/*
+ * Give up a backing pixmap.  If it is the one described by alloc and
+ * nobody else holds a reference, it goes to the pool instead of being
+ * destroyed.
+ */
+void
+compReleasePixmap(ScreenPtr pScreen, PixmapPtr pPixmap,
+                  CompPixmapAllocPtr alloc)
+{
+    CompScreenPtr cs = GetCompScreen(pScreen);
+    CompPoolEntryPtr e;
+
+    if (alloc->pPixmap == pPixmap && pPixmap->refcnt == 1 &&
+        compPoolSize(alloc) <= cs->pixmapPoolBudget &&
+        (e = malloc(sizeof(CompPoolEntryRec)))) {
+        e->alloc = *alloc;
+        e->released = GetTimeInMillis();
+        xorg_list_add(&e->entry, &cs->pixmapPool);
+        cs->pixmapPoolBytes += compPoolSize(alloc);
+        cs->pixmapPoolStats.cached++;
+        compTrimPixmapPool(pScreen, cs->pixmapPoolBudget);
+        cs->pixmapPoolTimer = TimerSet(cs->pixmapPoolTimer, 0,
+                                       COMP_POOL_IDLE_MS,
+                                       compPixmapPoolTimer, pScreen);
+    }
+    else
+        (*pScreen->DestroyPixmap) (pPixmap);
+
+    alloc->pPixmap = NullPixmap;
+}
+
+/*
+ * Find a w x h backing pixmap, from the pool if there is one that fits,
+ * otherwise allocate one with slack.  alloc describes the allocation, or
+ * has no pixmap when it was made at the exact size.
+ */
 static PixmapPtr
-compNewPixmap(WindowPtr pWin, int x, int y, int w, int h)
+compCreatePixmap(ScreenPtr pScreen, int w, int h, int depth,
+                 CompPixmapAllocPtr alloc)
 {
-    ScreenPtr pScreen = pWin->drawable.pScreen;
-    WindowPtr pParent = pWin->parent;
+    CompScreenPtr cs = GetCompScreen(pScreen);
+    CompPoolEntryPtr e, best = NULL;
     PixmapPtr pPixmap;
 
-    pPixmap = (*pScreen->CreatePixmap) (pScreen, w, h, pWin->drawable.depth,
-                                        CREATE_PIXMAP_USAGE_BACKING_PIXMAP);
+    alloc->pPixmap = NullPixmap;
 
-    if (!pPixmap)
-        return 0;
+    if (cs->pixmapPoolBudget && w && h) {
+        xorg_list_for_each_entry(e, &cs->pixmapPool, entry) {
+            if (e->alloc.pPixmap->drawable.depth == depth &&
+                compPoolFits(e->alloc.width, e->alloc.height, w, h) &&
+                (!best || compPoolSize(&e->alloc) < compPoolSize(&best->alloc)))
+                best = e;
+        }
+        if (best) {
+            *alloc = best->alloc;
+            compPoolRemove(cs, best);
+            cs->pixmapPoolStats.reused++;
+            (*pScreen->ModifyPixmapHeader) (alloc->pPixmap, w, h,
+                                            0, 0, 0, NULL);
+            return alloc->pPixmap;
+        }
 
-    pPixmap->screen_x = x;
-    pPixmap->screen_y = y;
+        alloc->width = compPoolRound(w);
+        alloc->height = compPoolRound(h);
+        pPixmap = (*pScreen->CreatePixmap) (pScreen, alloc->width,
+                                            alloc->height, depth,
+                                            CREATE_PIXMAP_USAGE_BACKING_PIXMAP);
+        if (pPixmap && pPixmap->devPrivate.ptr) {
+            cs->pixmapPoolStats.allocated++;
+            alloc->pPixmap = pPixmap;
+            (*pScreen->ModifyPixmapHeader) (pPixmap, w, h, 0, 0, 0, NULL);
+            return pPixmap;
+        }
+
+        /* Not in system memory, so it cannot be shrunk to the window */
+        if (pPixmap) {
+            (*pScreen->DestroyPixmap) (pPixmap);
+            compTrimPixmapPool(pScreen, 0);
+            cs->pixmapPoolBudget = 0;
+        }
+    }
+
+    pPixmap = (*pScreen->CreatePixmap) (pScreen, w, h, depth,
+                                        CREATE_PIXMAP_USAGE_BACKING_PIXMAP);
+    if (pPixmap)
+        cs->pixmapPoolStats.allocated++;
+    return pPixmap;
+}
+
+/*
+ * Fill part of a backing pixmap, in pixmap coordinates, with what the
+ * parent shows there
+ */
+static void
+compCopyFromParent(WindowPtr pWin, PixmapPtr pPixmap,
+                   int x, int y, int w, int h)
+{
+    ScreenPtr pScreen = pWin->drawable.pScreen;
+    WindowPtr pParent = pWin->parent;
+    int src_x = pPixmap->screen_x + x - pParent->drawable.x;
+    int src_y = pPixmap->screen_y + y - pParent->drawable.y;
 
     if (pParent->drawable.depth == pWin->drawable.depth) {
         GCPtr pGC = GetScratchGC(pWin->drawable.depth, pScreen);
@@ -554,9 +734,7 @@ compNewPixmap(WindowPtr pWin, int x, int y, int w, int h)
             ValidateGC(&pPixmap->drawable, pGC);
             (*pGC->ops->CopyArea) (&pParent->drawable,
                                    &pPixmap->drawable,
-                                   pGC,
-                                   x - pParent->drawable.x,
-                                   y - pParent->drawable.y, w, h, 0, 0);
+                                   pGC, src_x, src_y, w, h, x, y);
             FreeScratchGC(pGC);
         }
     }
@@ -584,14 +762,31 @@ compNewPixmap(WindowPtr pWin, int x, int y, int w, int h)
                              pSrcPicture,
                              NULL,
                              pDstPicture,
-                             x - pParent->drawable.x,
-                             y - pParent->drawable.y, 0, 0, 0, 0, w, h);
+                             src_x, src_y, 0, 0, x, y, w, h);
         }
         if (pSrcPicture)
             FreePicture(pSrcPicture, 0);
         if (pDstPicture)
             FreePicture(pDstPicture, 0);
     }
+}
+
+static PixmapPtr
+compNewPixmap(WindowPtr pWin, int x, int y, int w, int h,
+              CompPixmapAllocPtr alloc)
+{
+    ScreenPtr pScreen = pWin->drawable.pScreen;
+    PixmapPtr pPixmap;
+
+    pPixmap = compCreatePixmap(pScreen, w, h, pWin->drawable.depth, alloc);
+
+    if (!pPixmap)
+        return 0;
+
+    pPixmap->screen_x = x;
+    pPixmap->screen_y = y;
+
+    compCopyFromParent(pWin, pPixmap, 0, 0, w, h);
     return pPixmap;
 }
 
@@ -603,8 +798,8 @@ compAllocPixmap(WindowPtr pWin)
     int y = pWin->drawable.y - bw;
     int w = pWin->drawable.width + (bw << 1);
     int h = pWin->drawable.height + (bw << 1);
-    PixmapPtr pPixmap = compNewPixmap(pWin, x, y, w, h);
     CompWindowPtr cw = GetCompWindow(pWin);
+    PixmapPtr pPixmap = compNewPixmap(pWin, x, y, w, h, &cw->alloc);
 
     if (!pPixmap)
         return FALSE;
@@ -658,7 +853,9 @@ compSetParentPixmap(WindowPtr pWin)
 /*
  * Make sure the pixmap is the right size and offset.  Allocate a new
  * pixmap to change size, adjust origin to change offset, leaving the
- * old pixmap in cw->pOldPixmap so bits can be recovered
+ * old pixmap in cw->pOldPixmap so bits can be recovered.  A pixmap with
+ * enough slack is resized in place instead, as long as its origin stays
+ * put so the bits are already where they belong.
  */
 Bool
 compReallocPixmap(WindowPtr pWin, int draw_x, int draw_y,
@@ -679,11 +876,34 @@ compReallocPixmap(WindowPtr pWin, int draw_x, int draw_y,
     pix_y = draw_y - bw;
     pix_w = w + (bw << 1);
     pix_h = h + (bw << 1);
-    if (pix_w != pOld->drawable.width || pix_h != pOld->drawable.height) {
-        pNew = compNewPixmap(pWin, pix_x, pix_y, pix_w, pix_h);
+    if ((pix_w != pOld->drawable.width || pix_h != pOld->drawable.height) &&
+        cw->alloc.pPixmap == pOld && pOld->refcnt == 1 &&
+        pix_x == pOld->screen_x && pix_y == pOld->screen_y &&
+        compPoolFits(cw->alloc.width, cw->alloc.height, pix_w, pix_h)) {
+        int old_w = pOld->drawable.width;
+        int old_h = pOld->drawable.height;
+
+        pNew = pOld;
+        cw->pOldPixmap = 0;
+        (*pScreen->ModifyPixmapHeader) (pNew, pix_w, pix_h, 0, 0, 0, NULL);
+        if (pix_w > old_w)
+            compCopyFromParent(pWin, pNew, old_w, 0, pix_w - old_w,
+                               min(old_h, pix_h));
+        if (pix_h > old_h)
+            compCopyFromParent(pWin, pNew, 0, old_h, pix_w, pix_h - old_h);
+        compSetPixmap(pWin, pNew, bw);
+        GetCompScreen(pScreen)->pixmapPoolStats.resized++;
+    }
+    else if (pix_w != pOld->drawable.width ||
+             pix_h != pOld->drawable.height) {
+        CompPixmapAllocRec alloc;
+
+        pNew = compNewPixmap(pWin, pix_x, pix_y, pix_w, pix_h, &alloc);
         if (!pNew)
             return FALSE;
         cw->pOldPixmap = pOld;
+        cw->oldAlloc = cw->alloc;
+        cw->alloc = alloc;
         compSetPixmap(pWin, pNew, bw);
     }
     else {
@@ -58,6 +58,15 @@ compCloseScreen(ScreenPtr pScreen)
     CompScreenPtr cs = GetCompScreen(pScreen);
     Bool ret;
 
+    if (cs->pixmapPoolStats.allocated)
+        LogMessageVerb(X_INFO, 3, "composite: screen %d: %llu backing pixmaps "
+                       "allocated, %llu resized in place, %llu reused\n",
+                       pScreen->myNum,
+                       (unsigned long long) cs->pixmapPoolStats.allocated,
+                       (unsigned long long) cs->pixmapPoolStats.resized,
+                       (unsigned long long) cs->pixmapPoolStats.reused);
+    compTrimPixmapPool(pScreen, 0);
+    TimerFree(cs->pixmapPoolTimer);
     free(cs->alternateVisuals);
 
     pScreen->CloseScreen = cs->CloseScreen;
@@ -234,6 +243,19 @@ CompositeRegisterImplicitRedirectionException(ScreenPtr pScreen,
     return TRUE;
 }
 
+/*
+ * Limit the memory held by pixmaps pooled for reuse on this screen; 0
+ * disables the pool and allocates backing pixmaps at their exact size.
+ */
+void
+CompositeSetPixmapPoolBudget(ScreenPtr pScreen, size_t bytes)
+{
+    CompScreenPtr cs = GetCompScreen(pScreen);
+
+    cs->pixmapPoolBudget = bytes;
+    compTrimPixmapPool(pScreen, bytes);
+}
+
 typedef struct _alternateVisual {
     int depth;
     CARD32 format;
@@ -356,6 +378,15 @@ compScreenInit(ScreenPtr pScreen)
     cs->numImplicitRedirectExceptions = 0;
     cs->implicitRedirectExceptions = NULL;
 
+    xorg_list_init(&cs->pixmapPool);
+    cs->pixmapPoolBytes = 0;
+    cs->pixmapPoolTimer = NULL;
+    memset(&cs->pixmapPoolStats, 0, sizeof(cs->pixmapPoolStats));
+    if (pScreen->ModifyPixmapHeader == miModifyPixmapHeader)
+        cs->pixmapPoolBudget = COMP_PIXMAP_POOL_BUDGET;
+    else
+        cs->pixmapPoolBudget = 0;
+
     if (!compAddAlternateVisuals(pScreen, cs)) {
         free(cs);
         return FALSE;
@@ -66,6 +66,7 @@
 #include "picturestr.h"
 #include "extnsionst.h"
 #include "privates.h"
+#include "list.h"
 #include "mi.h"
 #include "damage.h"
 #include "damageextint.h"
@@ -86,6 +87,15 @@ typedef struct _CompClientWindow {
     int update;
 } CompClientWindowRec, *CompClientWindowPtr;
 
+/*
+ * Backing pixmap allocated larger than its window, so that it can grow
+ * without being reallocated
+ */
+typedef struct _CompPixmapAlloc {
+    PixmapPtr pPixmap;
+    int width, height;
+} CompPixmapAllocRec, *CompPixmapAllocPtr;
+
 typedef struct _CompWindow {
     RegionRec borderClip;
     DamagePtr damage;           /* for automatic update mode */
@@ -97,6 +107,8 @@ typedef struct _CompWindow {
     int oldy;
     PixmapPtr pOldPixmap;
     int borderClipX, borderClipY;
+    CompPixmapAllocRec alloc;
+    CompPixmapAllocRec oldAlloc;
 } CompWindowRec, *CompWindowPtr;
 
 #define COMP_ORIGIN_INVALID	    0x80000000
@@ -110,6 +122,15 @@ typedef struct _CompSubwindows {
 #define COMP_INCLUDE_RGB24_VISUAL 0
 #endif
 
+#define COMP_PIXMAP_POOL_BUDGET (64 << 20)
+
+typedef struct _CompPixmapPoolStats {
+    uint64_t allocated;         /* backing pixmaps created */
+    uint64_t resized;           /* resizes which kept the old pixmap */
+    uint64_t reused;            /* pixmaps taken from the pool */
+    unsigned long cached;       /* pixmaps in the pool */
+} CompPixmapPoolStatsRec, *CompPixmapPoolStatsPtr;
+
 typedef struct _CompOverlayClientRec *CompOverlayClientPtr;
 
 typedef struct _CompOverlayClientRec {
@@ -169,6 +190,16 @@ typedef struct _CompScreen {
     CompOverlayClientPtr pOverlayClients;
 
     SourceValidateProcPtr SourceValidate;
+
+    /*
+     * Backing pixmaps of unredirected, unmapped or resized windows,
+     * kept for reuse
+     */
+    struct xorg_list pixmapPool;
+    size_t pixmapPoolBytes;
+    size_t pixmapPoolBudget;    /* 0 when pixmaps cannot be pooled */
+    OsTimerPtr pixmapPoolTimer;
+    CompPixmapPoolStatsRec pixmapPoolStats;
 } CompScreenRec, *CompScreenPtr;
 
 extern DevPrivateKeyRec CompScreenPrivateKeyRec;
@@ -235,6 +266,13 @@ Bool
 compReallocPixmap(WindowPtr pWin, int x, int y,
                   unsigned int w, unsigned int h, int bw);
 
+void
+ compReleasePixmap(ScreenPtr pScreen, PixmapPtr pPixmap,
+                   CompPixmapAllocPtr alloc);
+
+void
+ compTrimPixmapPool(ScreenPtr pScreen, size_t budget);
+
 void compMarkAncestors(WindowPtr pWin);
 
 /*
@@ -39,6 +39,8 @@ extern _X_EXPORT Bool CompositeRegisterImplicitRedirectionException(ScreenPtr pS
                                                                     VisualID parentVisual,
                                                                     VisualID winVisual);
 
+extern _X_EXPORT void CompositeSetPixmapPoolBudget(ScreenPtr pScreen,
+                                                   size_t bytes);
 
 extern _X_EXPORT Bool compIsAlternateVisual(ScreenPtr pScreen, XID visual);
 extern _X_EXPORT RESTYPE CompositeClientWindowType;
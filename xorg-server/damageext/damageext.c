@@ -456,12 +456,44 @@ ProcDamageAdd(ClientPtr client)
     return Success;
 }
 
+/*
+ * Trade precision for speed: the damage reported to the client is kept to
+ * maxRects rectangles, merged into their bounding box when that adds no
+ * more than maxOverhead percent to its area.
+ */
+static int
+ProcDamageSetPolicy(ClientPtr client)
+{
+    REQUEST(xDamageSetPolicyReq);
+    DamageExtPtr pDamageExt;
+
+    REQUEST_SIZE_MATCH(xDamageSetPolicyReq);
+    VERIFY_DAMAGEEXT(pDamageExt, stuff->damage, client, DixSetAttrAccess);
+
+    DamageSetPolicy(pDamageExt->pDamage, stuff->maxRects, stuff->maxOverhead);
+    return Success;
+}
+
 /* Major version controls available requests */
 static const int version_requests[] = {
     X_DamageQueryVersion,       /* before client sends QueryVersion */
-    X_DamageAdd,                /* Version 1 */
+    X_DamageSetPolicy,          /* Version 1 */
 };
 
+/* Requests added in minor versions */
+static Bool
+DamageRequestSupported(DamageClientPtr pDamageClient, int req)
+{
+    if (pDamageClient->major_version >= ARRAY_SIZE(version_requests))
+        return FALSE;
+    if (req > version_requests[pDamageClient->major_version])
+        return FALSE;
+    if (req == X_DamageSetPolicy && pDamageClient->major_version == 1 &&
+        pDamageClient->minor_version < 2)
+        return FALSE;
+    return TRUE;
+}
+
 static int (*ProcDamageVector[XDamageNumberRequests]) (ClientPtr) = {
     /*************** Version 1 ******************/
     ProcDamageQueryVersion,
@@ -470,6 +502,8 @@ static int (*ProcDamageVector[XDamageNumberRequests]) (ClientPtr) = {
     ProcDamageSubtract,
     /*************** Version 1.1 ****************/
     ProcDamageAdd,
+    /*************** Version 1.2 ****************/
+    ProcDamageSetPolicy,
 };
 
 static int
@@ -478,9 +512,7 @@ ProcDamageDispatch(ClientPtr client)
     REQUEST(xDamageReq);
     DamageClientPtr pDamageClient = GetDamageClient(client);
 
-    if (pDamageClient->major_version >= ARRAY_SIZE(version_requests))
-        return BadRequest;
-    if (stuff->damageReqType > version_requests[pDamageClient->major_version])
+    if (!DamageRequestSupported(pDamageClient, stuff->damageReqType))
         return BadRequest;
     return (*ProcDamageVector[stuff->damageReqType]) (client);
 }
@@ -545,6 +577,19 @@ SProcDamageAdd(ClientPtr client)
     return (*ProcDamageVector[stuff->damageReqType]) (client);
 }
 
+static int _X_COLD
+SProcDamageSetPolicy(ClientPtr client)
+{
+    REQUEST(xDamageSetPolicyReq);
+
+    swaps(&stuff->length);
+    REQUEST_SIZE_MATCH(xDamageSetPolicyReq);
+    swapl(&stuff->damage);
+    swaps(&stuff->maxRects);
+    swaps(&stuff->maxOverhead);
+    return (*ProcDamageVector[stuff->damageReqType]) (client);
+}
+
 static int (*SProcDamageVector[XDamageNumberRequests]) (ClientPtr) = {
     /*************** Version 1 ******************/
     SProcDamageQueryVersion,
@@ -553,6 +598,8 @@ static int (*SProcDamageVector[XDamageNumberRequests]) (ClientPtr) = {
     SProcDamageSubtract,
     /*************** Version 1.1 ****************/
     SProcDamageAdd,
+    /*************** Version 1.2 ****************/
+    SProcDamageSetPolicy,
 };
 
 static int _X_COLD
@@ -561,9 +608,7 @@ SProcDamageDispatch(ClientPtr client)
     REQUEST(xDamageReq);
     DamageClientPtr pDamageClient = GetDamageClient(client);
 
-    if (pDamageClient->major_version >= ARRAY_SIZE(version_requests))
-        return BadRequest;
-    if (stuff->damageReqType > version_requests[pDamageClient->major_version])
+    if (!DamageRequestSupported(pDamageClient, stuff->damageReqType))
         return BadRequest;
     return (*SProcDamageVector[stuff->damageReqType]) (client);
 }
@@ -58,49 +58,88 @@ SOFTWARE.
 
 #define InitialTableSize 256
 
+/*
+ * Atoms are found by name through an open-addressed hash index and by
+ * value through nodeTable.  Each node keeps the hash and length of its
+ * name so probing only touches the string on a probable match.  Atoms are
+ * never freed individually, so the index needs no tombstones.
+ */
+
 typedef struct _Node {
-    struct _Node *left, *right;
     Atom a;
-    unsigned int fingerPrint;
+    unsigned int hash;
+    unsigned int len;
     const char *string;
 } NodeRec, *NodePtr;
 
 static Atom lastAtom = None;
-static NodePtr atomRoot = NULL;
 static unsigned long tableLength;
 static NodePtr *nodeTable;
+static Atom *hashTable;         /* None marks an empty slot */
+static unsigned int hashMask;
 
-Atom
-MakeAtom(const char *string, unsigned len, Bool makeit)
+static unsigned int
+AtomHash(const char *string, unsigned len)
 {
-    NodePtr *np;
+    unsigned int h = 2166136261U;       /* FNV-1a */
     unsigned i;
-    int comp;
-    unsigned int fp = 0;
 
-    np = &atomRoot;
-    for (i = 0; i < (len + 1) / 2; i++) {
-        fp = fp * 27 + string[i];
-        fp = fp * 27 + string[len - 1 - i];
+    for (i = 0; i < len; i++) {
+        h ^= (unsigned char) string[i];
+        h *= 16777619U;
     }
-    while (*np != NULL) {
-        if (fp < (*np)->fingerPrint)
-            np = &((*np)->left);
-        else if (fp > (*np)->fingerPrint)
-            np = &((*np)->right);
-        else {                  /* now start testing the strings */
-            comp = strncmp(string, (*np)->string, (int) len);
-            if ((comp < 0) || ((comp == 0) && (len < strlen((*np)->string))))
-                np = &((*np)->left);
-            else if (comp > 0)
-                np = &((*np)->right);
-            else
-                return (*np)->a;
-        }
+    return h;
+}
+
+static Bool
+GrowAtomHash(void)
+{
+    unsigned int size = (hashMask + 1) * 2;
+    Atom *table;
+    Atom a;
+
+    table = calloc(size, sizeof(Atom));
+    if (!table)
+        return FALSE;
+    for (a = None + 1; a <= lastAtom; a++) {
+        unsigned int i = nodeTable[a]->hash & (size - 1);
+
+        while (table[i] != None)
+            i = (i + 1) & (size - 1);
+        table[i] = a;
+    }
+    free(hashTable);
+    hashTable = table;
+    hashMask = size - 1;
+    return TRUE;
+}
+
+Atom
+MakeAtom(const char *string, unsigned len, Bool makeit)
+{
+    unsigned int hash = AtomHash(string, len);
+    unsigned int i;
+    Atom a;
+
+    for (i = hash & hashMask; (a = hashTable[i]) != None;
+         i = (i + 1) & hashMask) {
+        NodePtr node = nodeTable[a];
+
+        if (node->hash == hash && node->len == len &&
+            memcmp(node->string, string, len) == 0)
+            return a;
     }
     if (makeit) {
         NodePtr nd;
 
+        /* keep the index at most half full */
+        if ((lastAtom + 1) * 2 > hashMask) {
+            if (!GrowAtomHash())
+                return BAD_RESOURCE;
+            i = hash & hashMask;
+            while (hashTable[i] != None)
+                i = (i + 1) & hashMask;
+        }
         nd = malloc(sizeof(NodeRec));
         if (!nd)
             return BAD_RESOURCE;
@@ -129,11 +168,11 @@ MakeAtom(const char *string, unsigned len, Bool makeit)
             tableLength <<= 1;
             nodeTable = table;
         }
-        *np = nd;
-        nd->left = nd->right = NULL;
-        nd->fingerPrint = fp;
+        nd->hash = hash;
+        nd->len = len;
         nd->a = ++lastAtom;
         nodeTable[lastAtom] = nd;
+        hashTable[i] = nd->a;
         return nd->a;
     }
     else
@@ -164,32 +203,28 @@ AtomError(void)
     FatalError("initializing atoms");
 }
 
-static void
-FreeAtom(NodePtr patom)
-{
-    if (patom->left)
-        FreeAtom(patom->left);
-    if (patom->right)
-        FreeAtom(patom->right);
-    if (patom->a > XA_LAST_PREDEFINED) {
-        /*
-         * All strings above XA_LAST_PREDEFINED are strdup'ed, so it's safe to
-         * cast here
-         */
-        free((char *) patom->string);
-    }
-    free(patom);
-}
-
 void
 FreeAllAtoms(void)
 {
-    if (atomRoot == NULL)
+    Atom a;
+
+    if (nodeTable == NULL)
         return;
-    FreeAtom(atomRoot);
-    atomRoot = NULL;
+    for (a = None + 1; a <= lastAtom; a++) {
+        if (a > XA_LAST_PREDEFINED) {
+            /*
+             * All strings above XA_LAST_PREDEFINED are strdup'ed, so it's
+             * safe to cast here
+             */
+            free((char *) nodeTable[a]->string);
+        }
+        free(nodeTable[a]);
+    }
     free(nodeTable);
     nodeTable = NULL;
+    free(hashTable);
+    hashTable = NULL;
+    hashMask = 0;
     lastAtom = None;
 }
 
@@ -202,6 +237,10 @@ InitAtoms(void)
     if (!nodeTable)
         AtomError();
     nodeTable[None] = NULL;
+    hashMask = InitialTableSize * 2 - 1;
+    hashTable = calloc(hashMask + 1, sizeof(Atom));
+    if (!hashTable)
+        AtomError();
     MakePredeclaredAtoms();
     if (lastAtom != XA_LAST_PREDEFINED)
         AtomError();
@@ -254,6 +254,7 @@ long SmartScheduleMaxSlice = SMART_SCHEDULE_MAX_SLICE;
 long SmartScheduleTime;
 int SmartScheduleLatencyLimited = 0;
 static ClientPtr SmartLastClient;
+static long SmartScheduleStartTick;   /* start of the current slice */
 static int SmartLastIndex[SMART_MAX_PRIORITY - SMART_MIN_PRIORITY + 1];
 
 #ifdef SMART_DEBUG
@@ -524,13 +525,12 @@ void DispatchQueuedEvents(Bool wait)
 
         if (!dispatchException && clients_are_ready())
         {
-            long start_tick;
             ClientPtr client;
             client = SmartScheduleClient();
 
             isItTimeToYield = FALSE;
 
-            start_tick = SmartScheduleTime;
+            SmartScheduleStartTick = SmartScheduleTime;
             while (!isItTimeToYield)
             {
                 int result;
@@ -541,7 +541,8 @@ void DispatchQueuedEvents(Bool wait)
                     ProcessInputEvents();
 
                 FlushIfCriticalOutputPending();
-                if ((SmartScheduleTime - start_tick) >= SmartScheduleSlice)
+                if ((SmartScheduleTime - SmartScheduleStartTick) >=
+                    SmartScheduleSlice)
                 {
                     /* Penalize clients which consume ticks */
                     if (client->smart_priority > SMART_MIN_PRIORITY)
@@ -1190,8 +1191,8 @@ ProcQueryTree(ClientPtr client)
     return Success;
 }
 
-int
-ProcInternAtom(ClientPtr client)
+static int
+DoInternAtom(ClientPtr client)
 {
     Atom atom;
     char *tchar;
@@ -1219,6 +1220,63 @@ ProcInternAtom(ClientPtr client)
         return BadAlloc;
 }
 
+/*
+ * Toolkits intern their atoms in long pipelined bursts at startup.  Once
+ * one InternAtom has been answered, answer the InternAtom requests that
+ * are already buffered behind it right here instead of going back through
+ * the scheduler for each one.  The burst is bounded so other clients and
+ * input still get their turn.
+ */
+#define INTERN_ATOM_BURST 256
+
+int
+ProcInternAtom(ClientPtr client)
+{
+    int burst = INTERN_ATOM_BURST;
+    int rc;
+
+    while ((rc = DoInternAtom(client)) == Success && --burst > 0) {
+        const xReq *next;
+
+        /* byte-swapped clients and wrapped vectors take the normal path */
+        if (client->requestVector[X_InternAtom] != ProcInternAtom ||
+            client->noClientException != Success ||
+            isItTimeToYield || InputCheckPending())
+            break;
+
+        /* The burst counts against the client's time slice */
+        if (!SmartScheduleSignalEnable)
+            SmartScheduleTime = GetTimeInMillis();
+        if ((SmartScheduleTime - SmartScheduleStartTick) >= SmartScheduleSlice)
+            break;
+
+        next = PeekNextRequestFromClient(client);
+        if (!next || next->reqType != X_InternAtom)
+            break;
+        if (ReadRequestFromClient(client) <= 0)
+            break;
+
+        /* Dispatch reports the start of the first request and the end of
+         * the last one */
+#ifdef XSERVER_DTRACE
+        if (XSERVER_REQUEST_DONE_ENABLED())
+            XSERVER_REQUEST_DONE(LookupMajorName(X_InternAtom), X_InternAtom,
+                                 client->sequence, client->index, Success);
+#endif
+        client->sequence++;
+#ifdef XSERVER_DTRACE
+        if (XSERVER_REQUEST_START_ENABLED())
+            XSERVER_REQUEST_START(LookupMajorName(X_InternAtom), X_InternAtom,
+                                  ((xReq *) client->requestBuffer)->length,
+                                  client->index, client->requestBuffer);
+#endif
+        rc = XaceHookDispatch(client, X_InternAtom);
+        if (rc != Success)
+            break;
+    }
+    return rc;
+}
+
 int
 ProcGetAtomName(ClientPtr client)
 {
@@ -43,6 +43,10 @@ from The Open Group.
 #include "X11/extensions/render.h"
 #include "picturestr.h"
 #include "randrstr.h"
+
+#define PIXMAP_POOL_MIN_DATA    64
+#define PIXMAP_POOL_MAX_DATA    4096
+
 /*
  *  Scratch pixmap management and device independent pixmap allocation
  *  function.
@@ -110,15 +114,31 @@ PixmapPtr
 AllocatePixmap(ScreenPtr pScreen, int pixDataSize)
 {
     PixmapPtr pPixmap;
+    unsigned size;
 
     assert(pScreen->totalPixmapSize > 0);
 
     if (pScreen->totalPixmapSize > ((size_t) - 1) - pixDataSize)
         return NullPixmap;
 
-    pPixmap = calloc(1, pScreen->totalPixmapSize + pixDataSize);
+    /*
+     * Round small pixmaps up to a power of two, so that scratch pixmaps of
+     * all sizes share a few pools.
+     */
+    size = pixDataSize;
+    if (size && size <= PIXMAP_POOL_MAX_DATA) {
+        size = PIXMAP_POOL_MIN_DATA;
+        while (size < pixDataSize)
+            size <<= 1;
+    }
+    if (size > UINT_MAX - pScreen->totalPixmapSize)
+        return NullPixmap;
+
+    pPixmap = dixAllocatePooledObject(PRIVATE_PIXMAP,
+                                      pScreen->totalPixmapSize + size);
     if (!pPixmap)
         return NullPixmap;
+    memset(pPixmap, 0, pScreen->totalPixmapSize + pixDataSize);
 
     dixInitScreenPrivates(pScreen, pPixmap, pPixmap + 1, PRIVATE_PIXMAP);
     return pPixmap;
@@ -129,7 +149,7 @@ void
 FreePixmap(PixmapPtr pPixmap)
 {
     dixFiniPrivates(pPixmap, PRIVATE_PIXMAP);
-    free(pPixmap);
+    dixFreePooledObject(PRIVATE_PIXMAP, pPixmap);
 }
 
 void PixmapUnshareSecondaryPixmap(PixmapPtr secondary_pixmap)
@@ -480,6 +480,147 @@ _dixFiniPrivates(PrivatePtr privates, DevPrivateType type)
         global_keys[PRIVATE_XSELINUX].created--;
 }
 
+/*
+ * Object pools
+ *
+ * Windows, pixmaps, GCs and pictures come and go at a high rate (scratch
+ * GCs and pixmaps in particular), but in only a few sizes: the structure
+ * plus the private space registered for the type on their screen.  Freed
+ * objects of those types are kept on a free list per type and size, and
+ * handed out again instead of going back to malloc.
+ *
+ * Each pooled object is preceded by a header recording its size, so that
+ * it finds its list again when freed.  The lists are emptied when the
+ * privates are reset, as the sizes change between server generations;
+ * the counters of the generation are logged at verbosity 3 then.
+ */
+
+#define POOL_SIZE_CLASSES       8       /* per type */
+#define POOL_MAX_CACHED         64      /* free objects kept per size */
+#define POOL_MAX_SIZE           8192    /* larger objects are not kept */
+
+typedef union _PoolHeader {
+    struct {
+        union _PoolHeader *next;        /* while on a free list */
+        unsigned size;
+    } h;
+    char align[16];             /* keep malloc's alignment */
+} PoolHeaderRec, *PoolHeaderPtr;
+
+typedef struct _PoolSizeClass {
+    unsigned size;              /* 0 if unused */
+    int cached;
+    PoolHeaderPtr free;
+} PoolSizeClassRec, *PoolSizeClassPtr;
+
+typedef struct _ObjectPool {
+    PoolSizeClassRec classes[POOL_SIZE_CLASSES];
+    DevPrivatePoolStatsRec stats;
+} ObjectPoolRec;
+
+static ObjectPoolRec pools[PRIVATE_LAST];
+
+static PoolSizeClassPtr
+pool_size_class(DevPrivateType type, unsigned size, Bool create)
+{
+    PoolSizeClassPtr sc;
+    int i;
+
+    if (size > POOL_MAX_SIZE)
+        return NULL;
+    for (i = 0; i < POOL_SIZE_CLASSES; i++) {
+        sc = &pools[type].classes[i];
+        if (sc->size == size)
+            return sc;
+        if (!sc->size) {
+            if (!create)
+                return NULL;
+            sc->size = size;
+            return sc;
+        }
+    }
+    return NULL;
+}
+
+static void
+pool_reset(DevPrivateType type)
+{
+    int i;
+
+    if (pools[type].stats.allocations)
+        LogMessageVerb(X_INFO, 3, "%s pool: %llu allocations, %llu reused\n",
+                       key_names[type],
+                       (unsigned long long) pools[type].stats.allocations,
+                       (unsigned long long) pools[type].stats.reused);
+
+    for (i = 0; i < POOL_SIZE_CLASSES; i++) {
+        PoolSizeClassPtr sc = &pools[type].classes[i];
+
+        while (sc->free) {
+            PoolHeaderPtr header = sc->free;
+
+            sc->free = header->h.next;
+            free(header);
+        }
+    }
+    memset(&pools[type], '\0', sizeof(pools[type]));
+}
+
+void *
+dixAllocatePooledObject(DevPrivateType type, unsigned size)
+{
+    PoolSizeClassPtr sc;
+    PoolHeaderPtr header;
+
+    assert(screen_specific_private[type]);
+
+    sc = pool_size_class(type, size, TRUE);
+    if (sc && sc->free) {
+        header = sc->free;
+        sc->free = header->h.next;
+        sc->cached--;
+        pools[type].stats.cached--;
+        pools[type].stats.reused++;
+    }
+    else {
+        header = malloc(sizeof(PoolHeaderRec) + size);
+        if (!header)
+            return NULL;
+        header->h.size = size;
+    }
+    pools[type].stats.allocations++;
+    return header + 1;
+}
+
+void
+dixFreePooledObject(DevPrivateType type, void *object)
+{
+    PoolHeaderPtr header;
+    PoolSizeClassPtr sc;
+
+    if (!object)
+        return;
+    header = (PoolHeaderPtr) object - 1;
+    sc = pool_size_class(type, header->h.size, FALSE);
+    if (sc && sc->cached < POOL_MAX_CACHED) {
+        header->h.next = sc->free;
+        sc->free = header;
+        sc->cached++;
+        pools[type].stats.cached++;
+    }
+    else
+        free(header);
+}
+
+Bool
+dixGetPrivatePoolStats(DevPrivateType type, DevPrivatePoolStatsPtr stats)
+{
+    if (type >= PRIVATE_LAST || !screen_specific_private[type])
+        return FALSE;
+    *stats = pools[type].stats;
+    return TRUE;
+}
+
 /*
  * Allocate new object with privates.
  *
@@ -555,7 +696,10 @@ _dixFreeObjectWithPrivates(void *object, PrivatePtr privates,
                            DevPrivateType type)
 {
     _dixFiniPrivates(privates, type);
-    free(object);
+    if (screen_specific_private[type])
+        dixFreePooledObject(type, object);
+    else
+        free(object);
 }
 
 /*
@@ -730,7 +874,7 @@ _dixAllocateScreenObjectWithPrivates(ScreenPtr pScreen,
     /* round up so that pointer is aligned */
     baseSize = (baseSize + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
     totalSize = baseSize + privates_size;
-    object = malloc(totalSize);
+    object = dixAllocatePooledObject(type, totalSize);
     if (!object)
         return NULL;
 
@@ -803,6 +947,7 @@ dixResetPrivates(void)
         global_keys[t].offset = 0;
         global_keys[t].created = 0;
         global_keys[t].allocated = 0;
+        pool_reset(t);
     }
 }
 
@@ -65,8 +65,212 @@ SOFTWARE.
  *   Properties belong to windows.  The list of properties should not be
  *   traversed directly.  Instead, use the three functions listed above.
  *
+ *   Each window with properties also has an index from property name to
+ *   the first property of that name in its list.  Windows with few
+ *   properties keep the names in a small inline array; past
+ *   PROPERTY_INLINE_MAX names the index becomes an open-addressed hash
+ *   table.  The list stays the authoritative store and keeps its order,
+ *   so ListProperties and PropertyNotify delivery are unaffected.
+ *
  *****************************************************************/
 
+#define PROPERTY_INLINE_MAX 8
+
+typedef struct _PropertySlot {
+    Atom name;
+    PropertyPtr prop;           /* NULL if the slot is empty */
+} PropertySlotRec, *PropertySlotPtr;
+
+typedef struct _PropertyIndex {
+    unsigned int count;
+    unsigned int hashsize;      /* log(2) of the table size, 0 if inline */
+    Bool duplicates;            /* some name has several instances */
+    PropertySlotPtr slots;
+    PropertySlotRec inlineSlots[PROPERTY_INLINE_MAX];
+} PropertyIndexRec, *PropertyIndexPtr;
+
+static _X_INLINE unsigned int
+PropertyHash(Atom name, unsigned int hashsize)
+{
+    return (CARD32) ((CARD32) name * 0x9e3779b1U) >> (32 - hashsize);
+}
+
+static PropertySlotPtr
+PropertyIndexFind(PropertyIndexPtr index, Atom name)
+{
+    unsigned int i, mask;
+
+    if (!index->hashsize) {
+        for (i = 0; i < index->count; i++)
+            if (index->slots[i].name == name)
+                return &index->slots[i];
+        return NULL;
+    }
+
+    mask = (1U << index->hashsize) - 1;
+    for (i = PropertyHash(name, index->hashsize); index->slots[i].prop;
+         i = (i + 1) & mask)
+        if (index->slots[i].name == name)
+            return &index->slots[i];
+    return NULL;
+}
+
+static void
+PropertyIndexInsertHashed(PropertyIndexPtr index, Atom name, PropertyPtr prop)
+{
+    unsigned int mask = (1U << index->hashsize) - 1;
+    unsigned int i;
+
+    for (i = PropertyHash(name, index->hashsize); index->slots[i].prop;
+         i = (i + 1) & mask);
+    index->slots[i].name = name;
+    index->slots[i].prop = prop;
+}
+
+/* Rebuild the index as a hash table of 2^hashsize slots */
+static Bool
+PropertyIndexRehash(PropertyIndexPtr index, unsigned int hashsize)
+{
+    PropertySlotPtr old = index->slots;
+    unsigned int i, oldsize;
+
+    oldsize = index->hashsize ? 1U << index->hashsize : index->count;
+    index->slots = calloc(1U << hashsize, sizeof(PropertySlotRec));
+    if (!index->slots) {
+        index->slots = old;
+        return FALSE;
+    }
+    index->hashsize = hashsize;
+    for (i = 0; i < oldsize; i++)
+        if (old[i].prop)
+            PropertyIndexInsertHashed(index, old[i].name, old[i].prop);
+    if (old != index->inlineSlots)
+        free(old);
+    return TRUE;
+}
+
+/*
+ * Record pProp, which is about to be put at the head of the window's
+ * property list, as the first property of its name.
+ */
+static Bool
+PropertyIndexAdd(WindowPtr pWin, PropertyPtr pProp)
+{
+    PropertyIndexPtr index = pWin->optional->userPropIndex;
+    PropertySlotPtr slot;
+
+    if (!index) {
+        index = calloc(1, sizeof(PropertyIndexRec));
+        if (!index)
+            return FALSE;
+        index->slots = index->inlineSlots;
+        pWin->optional->userPropIndex = index;
+    }
+
+    slot = PropertyIndexFind(index, pProp->propertyName);
+    if (slot) {
+        slot->prop = pProp;
+        index->duplicates = TRUE;
+        return TRUE;
+    }
+
+    if (!index->hashsize) {
+        if (index->count < PROPERTY_INLINE_MAX) {
+            slot = &index->slots[index->count];
+            slot->name = pProp->propertyName;
+            slot->prop = pProp;
+            index->count++;
+            return TRUE;
+        }
+        if (!PropertyIndexRehash(index, 5))
+            return FALSE;
+    }
+    else if (2 * (index->count + 1) > 1U << index->hashsize &&
+             !PropertyIndexRehash(index, index->hashsize + 1))
+        return FALSE;
+
+    PropertyIndexInsertHashed(index, pProp->propertyName, pProp);
+    index->count++;
+    return TRUE;
+}
+
+static void
+PropertyIndexRemove(WindowPtr pWin, PropertyPtr pProp)
+{
+    PropertyIndexPtr index = pWin->optional->userPropIndex;
+    PropertySlotPtr slot = PropertyIndexFind(index, pProp->propertyName);
+    PropertyPtr other;
+    unsigned int i, j, k, mask;
+
+    if (slot->prop != pProp)
+        return;
+
+    if (index->duplicates) {
+        for (other = pProp->next; other; other = other->next)
+            if (other->propertyName == pProp->propertyName) {
+                slot->prop = other;
+                return;
+            }
+    }
+
+    index->count--;
+    if (!index->hashsize) {
+        *slot = index->slots[index->count];
+        return;
+    }
+
+    /* Shift back the entries that probed past the freed slot */
+    mask = (1U << index->hashsize) - 1;
+    i = j = slot - index->slots;
+    for (;;) {
+        j = (j + 1) & mask;
+        if (!index->slots[j].prop)
+            break;
+        k = PropertyHash(index->slots[j].name, index->hashsize);
+        if ((j > i) ? (k <= i || k > j) : (k <= i && k > j)) {
+            index->slots[i] = index->slots[j];
+            i = j;
+        }
+    }
+    index->slots[i].prop = NULL;
+}
+
+static void
+PropertyIndexFree(WindowPtr pWin)
+{
+    PropertyIndexPtr index = pWin->optional->userPropIndex;
+
+    if (!index)
+        return;
+    if (index->slots != index->inlineSlots)
+        free(index->slots);
+    free(index);
+    pWin->optional->userPropIndex = NULL;
+}
+
+/* Take pProp off the window's property list without freeing it */
+static void
+UnlinkProperty(WindowPtr pWin, PropertyPtr pProp)
+{
+    PropertyPtr prevProp;
+
+    PropertyIndexRemove(pWin, pProp);
+    if (pWin->optional->userProps == pProp) {
+        /* Takes care of head */
+        if (!(pWin->optional->userProps = pProp->next)) {
+            PropertyIndexFree(pWin);
+            CheckWindowOptionalNeed(pWin);
+        }
+    }
+    else {
+        /* Need to traverse to find the previous element */
+        prevProp = pWin->optional->userProps;
+        while (prevProp->next != pProp)
+            prevProp = prevProp->next;
+        prevProp->next = pProp->next;
+    }
+}
+
 #ifdef notdef
 static void
 PrintPropertys(WindowPtr pWin)
@@ -90,14 +294,17 @@ int
 dixLookupProperty(PropertyPtr *result, WindowPtr pWin, Atom propertyName,
                   ClientPtr client, Mask access_mode)
 {
-    PropertyPtr pProp;
+    PropertyPtr pProp = NULL;
+    PropertySlotPtr slot;
     int rc = BadMatch;
 
     client->errorValue = propertyName;
 
-    for (pProp = wUserProps(pWin); pProp; pProp = pProp->next)
-        if (pProp->propertyName == propertyName)
-            break;
+    if (pWin->optional && pWin->optional->userPropIndex) {
+        slot = PropertyIndexFind(pWin->optional->userPropIndex, propertyName);
+        if (slot)
+            pProp = slot->prop;
+    }
 
     if (pProp)
         rc = XaceHookPropertyAccess(client, pWin, &pProp, access_mode);
@@ -293,6 +500,11 @@ dixChangeWindowProperty(ClientPtr pClient, WindowPtr pWin, Atom property,
             pClient->errorValue = property;
             return rc;
         }
+        if (!PropertyIndexAdd(pWin, pProp)) {
+            free(data);
+            dixFreeObjectWithPrivates(pProp, PRIVATE_PROPERTY);
+            return BadAlloc;
+        }
         pProp->next = pWin->optional->userProps;
         pWin->optional->userProps = pProp;
     }
@@ -368,7 +580,7 @@ dixChangeWindowProperty(ClientPtr pClient, WindowPtr pWin, Atom property,
 int
 DeleteProperty(ClientPtr client, WindowPtr pWin, Atom propName)
 {
-    PropertyPtr pProp, prevProp;
+    PropertyPtr pProp;
     int rc;
 
     rc = dixLookupProperty(&pProp, pWin, propName, client, DixDestroyAccess);
@@ -376,18 +588,7 @@ DeleteProperty(ClientPtr client, WindowPtr pWin, Atom propName)
         return Success;         /* Succeed if property does not exist */
 
     if (rc == Success) {
-        if (pWin->optional->userProps == pProp) {
-            /* Takes care of head */
-            if (!(pWin->optional->userProps = pProp->next))
-                CheckWindowOptionalNeed(pWin);
-        }
-        else {
-            /* Need to traverse to find the previous element */
-            prevProp = pWin->optional->userProps;
-            while (prevProp->next != pProp)
-                prevProp = prevProp->next;
-            prevProp->next = pProp->next;
-        }
+        UnlinkProperty(pWin, pProp);
 
         deliverPropertyNotifyEvent(pWin, PropertyDelete, pProp);
         free(pProp->data);
@@ -410,8 +611,10 @@ DeleteAllWindowProperties(WindowPtr pWin)
         pProp = pNextProp;
     }
 
-    if (pWin->optional)
+    if (pWin->optional) {
         pWin->optional->userProps = NULL;
+        PropertyIndexFree(pWin);
+    }
 }
 
 static int
@@ -442,7 +645,7 @@ NullPropertyReply(ClientPtr client, ATOM propertyType, int format)
 int
 ProcGetProperty(ClientPtr client)
 {
-    PropertyPtr pProp, prevProp;
+    PropertyPtr pProp;
     unsigned long n, len, ind;
     int rc;
     WindowPtr pWin;
@@ -543,19 +746,7 @@ ProcGetProperty(ClientPtr client)
 
     if (stuff->delete && (reply.bytesAfter == 0)) {
         /* Delete the Property */
-        if (pWin->optional->userProps == pProp) {
-            /* Takes care of head */
-            if (!(pWin->optional->userProps = pProp->next))
-                CheckWindowOptionalNeed(pWin);
-        }
-        else {
-            /* Need to traverse to find the previous element */
-            prevProp = pWin->optional->userProps;
-            while (prevProp->next != pProp)
-                prevProp = prevProp->next;
-            prevProp->next = pProp->next;
-        }
-
+        UnlinkProperty(pWin, pProp);
         free(pProp->data);
         dixFreeObjectWithPrivates(pProp, PRIVATE_PROPERTY);
     }
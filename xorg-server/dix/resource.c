@@ -105,8 +105,8 @@ Equipment Corporation.
  *      A resource ID is a 32 bit quantity, the upper 2 bits of which are
  *	off-limits for client-visible resources.  The next 8 bits are
  *      used as client ID, and the low 22 bits come from the client.
- *	A resource ID is "hashed" by extracting and xoring subfields
- *      (varying with the size of the hash table).
+ *	Resources are kept in pages of consecutive IDs, which are found
+ *      by hashing the ID with its low bits cleared.
  *
  *      It is sometimes necessary for the server to create an ID that looks
  *      like it belongs to a client.  This ID, however,  must not be one
@@ -149,31 +149,65 @@ Equipment Corporation.
 #define TypeNameString(t) LookupResourceName(t)
 #endif
 
-static void RebuildTable(int    /*client */
-    );
-
 #define SERVER_MINID 32
 
-#define INITBUCKETS 64
-#define INITHASHSIZE 6
-#define MAXHASHSIZE 16
+#define PAGEBITS 6              /* log(2) of the ids covered by a page */
+#define PAGESIZE (1 << PAGEBITS)
+#define PAGEMASK (PAGESIZE - 1)
+#define INITHASHSIZE 2          /* log(2) of the initial directory size */
 
 typedef struct _Resource {
-    struct _Resource *next;
+    struct _Resource *next;     /* older resource with the same id */
     XID id;
     RESTYPE type;
     void *value;
+    uint64_t serial;            /* insertion order within the client */
 } ResourceRec, *ResourcePtr;
 
+/*
+ * Each client's resources are kept in pages covering PAGESIZE consecutive
+ * ids.  Clients allocate ids mostly sequentially, so resources created
+ * together share a page, and a lookup is a directory probe plus an array
+ * index.  Resources sharing an id are chained from their slot, newest
+ * first.
+ *
+ * The directory is an open-addressed table of { first id, page } pairs.
+ * It is only rebuilt when the number of pages doubles, which moves no
+ * resources.  A page is freed when its last resource goes, unless the
+ * client's resources are being iterated over at the time.
+ */
+typedef struct _ResourcePage {
+    struct xorg_list entry;     /* client page list, newest first */
+    XID base;                   /* id of slots[0] */
+    unsigned int count;         /* resources in the page */
+    ResourcePtr slots[PAGESIZE];
+} ResourcePageRec, *ResourcePagePtr;
+
+typedef struct _PageSlot {
+    XID base;
+    ResourcePagePtr page;       /* NULL if the slot is empty */
+} PageSlot;
+
 typedef struct _ClientResource {
-    ResourcePtr *resources;
-    int elements;
-    int buckets;
-    int hashsize;               /* log(2)(buckets) */
+    PageSlot *pages;
+    unsigned int hashsize;      /* log(2)(directory size) */
+    unsigned int npages;
+    struct xorg_list pagelist;
+    int iterating;              /* iterations in progress */
+    Bool sweep;                 /* pages were emptied during iteration */
+    uint64_t serial;
     XID fakeID;
     XID endFakeID;
 } ClientResourceRec;
 
+typedef struct _ResourceIter {
+    ClientResourceRec *rrec;
+    ResourcePagePtr page;
+    int slot;
+    uint64_t start;             /* resources added later are skipped */
+    uint64_t bound;             /* next resource in the slot is older */
+} ResourceIterRec;
+
 RESTYPE lastResourceType;
 static RESTYPE lastResourceClass;
 RESTYPE TypeMask;
@@ -637,7 +671,7 @@ ResourceClientBits(void)
 Bool
 InitClientResources(ClientPtr client)
 {
-    int i, j;
+    ClientResourceRec *rrec;
 
     if (client == serverClient) {
         lastResourceType = RT_LASTPREDEF;
@@ -649,24 +683,24 @@ InitClientResources(ClientPtr client)
             return FALSE;
         memcpy(resourceTypes, predefTypes, sizeof(predefTypes));
     }
-    clientTable[i = client->index].resources =
-        malloc(INITBUCKETS * sizeof(ResourcePtr));
-    if (!clientTable[i].resources)
+    rrec = &clientTable[client->index];
+    rrec->pages = calloc(1 << INITHASHSIZE, sizeof(PageSlot));
+    if (!rrec->pages)
         return FALSE;
-    clientTable[i].buckets = INITBUCKETS;
-    clientTable[i].elements = 0;
-    clientTable[i].hashsize = INITHASHSIZE;
+    rrec->hashsize = INITHASHSIZE;
+    rrec->npages = 0;
+    xorg_list_init(&rrec->pagelist);
+    rrec->iterating = 0;
+    rrec->sweep = FALSE;
+    rrec->serial = 0;
     /* Many IDs allocated from the server client are visible to clients,
      * so we don't use the SERVER_BIT for them, but we have to start
      * past the magic value constants used in the protocol.  For normal
      * clients, we can start from zero, with SERVER_BIT set.
      */
-    clientTable[i].fakeID = client->clientAsMask |
+    rrec->fakeID = client->clientAsMask |
         (client->index ? SERVER_BIT : SERVER_MINID);
-    clientTable[i].endFakeID = (clientTable[i].fakeID | RESOURCE_ID_MASK) + 1;
-    for (j = 0; j < INITBUCKETS; j++) {
-        clientTable[i].resources[j] = NULL;
-    }
+    rrec->endFakeID = (rrec->fakeID | RESOURCE_ID_MASK) + 1;
     return TRUE;
 }
 
@@ -683,18 +717,204 @@ HashResourceID(XID id, unsigned int numBits)
     return (id ^ (id >> numBits)) & ~((~0) << numBits);
 }
 
-static XID
-AvailableID(int client, XID id, XID maxid, XID goodid)
+static _X_INLINE unsigned int
+PageHash(XID base, unsigned int hashsize)
 {
+    return ((CARD32) (base >> PAGEBITS) * 0x9e3779b1U) >> (32 - hashsize);
+}
+
+static _X_INLINE ResourcePagePtr
+FindPage(ClientResourceRec *rrec, XID id)
+{
+    unsigned int mask = (1U << rrec->hashsize) - 1;
+    unsigned int i = PageHash(id & ~PAGEMASK, rrec->hashsize);
+    PageSlot *slot;
+
+    for (; (slot = &rrec->pages[i])->page; i = (i + 1) & mask) {
+        if (slot->base == (id & ~PAGEMASK))
+            return slot->page;
+    }
+    return NULL;
+}
+
+static void
+InsertPage(PageSlot *pages, unsigned int hashsize, ResourcePagePtr page)
+{
+    unsigned int mask = (1U << hashsize) - 1;
+    unsigned int i = PageHash(page->base, hashsize);
+
+    while (pages[i].page)
+        i = (i + 1) & mask;
+    pages[i].base = page->base;
+    pages[i].page = page;
+}
+
+/*
+ * Add an empty page for id, doubling the directory if it would become
+ * more than half full.
+ */
+static ResourcePagePtr
+AddPage(ClientResourceRec *rrec, XID id)
+{
+    unsigned int size = 1U << rrec->hashsize;
+    ResourcePagePtr page;
+    PageSlot *pages;
+    unsigned int i;
+
+    if (2 * (rrec->npages + 1) > size) {
+        pages = calloc(2 * size, sizeof(PageSlot));
+        if (!pages)
+            return NULL;
+        for (i = 0; i < size; i++) {
+            if (rrec->pages[i].page)
+                InsertPage(pages, rrec->hashsize + 1, rrec->pages[i].page);
+        }
+        free(rrec->pages);
+        rrec->pages = pages;
+        rrec->hashsize++;
+    }
+    page = calloc(1, sizeof(ResourcePageRec));
+    if (!page)
+        return NULL;
+    page->base = id & ~PAGEMASK;
+    InsertPage(rrec->pages, rrec->hashsize, page);
+    xorg_list_add(&page->entry, &rrec->pagelist);
+    rrec->npages++;
+    return page;
+}
+
+/*
+ * Free an empty page.  Later entries of its probe sequence are shifted
+ * back into the hole, so the directory needs no deleted markers.
+ */
+static void
+RemovePage(ClientResourceRec *rrec, ResourcePagePtr page)
+{
+    unsigned int mask = (1U << rrec->hashsize) - 1;
+    unsigned int i = PageHash(page->base, rrec->hashsize);
+    unsigned int j, home;
+
+    while (rrec->pages[i].page != page)
+        i = (i + 1) & mask;
+    for (j = (i + 1) & mask; rrec->pages[j].page; j = (j + 1) & mask) {
+        home = PageHash(rrec->pages[j].base, rrec->hashsize);
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            rrec->pages[i] = rrec->pages[j];
+            i = j;
+        }
+    }
+    rrec->pages[i].page = NULL;
+    xorg_list_del(&page->entry);
+    free(page);
+    rrec->npages--;
+}
+
+static _X_INLINE Bool
+ResourceMatches(ResourcePtr res, RESTYPE type, RESTYPE rclass)
+{
+    if (rclass == RC_ANY)
+        return TRUE;
+    if (rclass)
+        return (res->type & rclass) != 0;
+    return res->type == type;
+}
+
+/*
+ * Find the link to the most recently added resource with this id that has
+ * the given type, or belongs to rclass if that is non-zero.  Resources
+ * sharing an id must be found newest first, as some deletion functions
+ * depend on it.
+ */
+static ResourcePtr *
+LookupLink(ClientResourceRec *rrec, XID id, RESTYPE type, RESTYPE rclass,
+           ResourcePagePtr *pagep)
+{
+    ResourcePagePtr page = FindPage(rrec, id);
+    ResourcePtr *link;
+
+    if (!page)
+        return NULL;
+    for (link = &page->slots[id & PAGEMASK]; *link; link = &(*link)->next) {
+        if (ResourceMatches(*link, type, rclass)) {
+            if (pagep)
+                *pagep = page;
+            return link;
+        }
+    }
+    return NULL;
+}
+
+static ResourcePtr
+LookupResource(ClientResourceRec *rrec, XID id, RESTYPE type, RESTYPE rclass)
+{
+    ResourcePtr *link = LookupLink(rrec, id, type, rclass, NULL);
+
+    return link ? *link : NULL;
+}
+
+/*
+ * Iteration goes through the pages newest first and through each page
+ * from its last id down, which is close to newest first for sequentially
+ * allocated ids.  Pages stay allocated until the last iteration ends, and
+ * the position is kept as a slot rather than a resource, so callbacks may
+ * free any resource.
+ */
+static void
+StartIteration(ClientResourceRec *rrec, ResourceIterRec *iter)
+{
+    rrec->iterating++;
+    iter->rrec = rrec;
+    iter->page = xorg_list_first_entry(&rrec->pagelist, ResourcePageRec,
+                                       entry);
+    iter->slot = PAGEMASK;
+    iter->start = iter->bound = rrec->serial;
+}
+
+static ResourcePtr
+NextResource(ResourceIterRec *iter)
+{
+    ClientResourceRec *rrec = iter->rrec;
     ResourcePtr res;
 
+    while (&iter->page->entry != &rrec->pagelist) {
+        for (; iter->slot >= 0; iter->slot--, iter->bound = iter->start) {
+            for (res = iter->page->slots[iter->slot]; res; res = res->next) {
+                if (res->serial < iter->bound) {
+                    iter->bound = res->serial;
+                    return res;
+                }
+            }
+        }
+        iter->page = xorg_list_entry(iter->page->entry.next,
+                                     ResourcePageRec, entry);
+        iter->slot = PAGEMASK;
+        iter->bound = iter->start;
+    }
+    return NULL;
+}
+
+static void
+EndIteration(ResourceIterRec *iter)
+{
+    ClientResourceRec *rrec = iter->rrec;
+    ResourcePagePtr page, tmp;
+
+    if (--rrec->iterating || !rrec->sweep)
+        return;
+    rrec->sweep = FALSE;
+    xorg_list_for_each_entry_safe(page, tmp, &rrec->pagelist, entry) {
+        if (!page->count)
+            RemovePage(rrec, page);
+    }
+}
+
+static XID
+AvailableID(int client, XID id, XID maxid, XID goodid)
+{
     if ((goodid >= id) && (goodid <= maxid))
         return goodid;
     for (; id <= maxid; id++) {
-        res = clientTable[client].resources[HashResourceID(id, clientTable[client].hashsize)];
-        while (res && (res->id != id))
-            res = res->next;
-        if (!res)
+        if (!LookupResource(&clientTable[client], id, RT_NONE, RC_ANY))
             return id;
     }
     return 0;
@@ -703,10 +923,9 @@ AvailableID(int client, XID id, XID maxid, XID goodid)
 void
 GetXIDRange(int client, Bool server, XID *minp, XID *maxp)
 {
+    ResourceIterRec iter;
     XID id, maxid;
-    ResourcePtr *resp;
     ResourcePtr res;
-    int i;
     XID goodid;
 
     id = (Mask) client << CLIENTOFFSET;
@@ -714,19 +933,18 @@ GetXIDRange(int client, Bool server, XID *minp, XID *maxp)
         id |= client ? SERVER_BIT : SERVER_MINID;
     maxid = id | RESOURCE_ID_MASK;
     goodid = 0;
-    for (resp = clientTable[client].resources, i = clientTable[client].buckets;
-         --i >= 0;) {
-        for (res = *resp++; res; res = res->next) {
-            if ((res->id < id) || (res->id > maxid))
-                continue;
-            if (((res->id - id) >= (maxid - res->id)) ?
-                (goodid = AvailableID(client, id, res->id - 1, goodid)) :
-                !(goodid = AvailableID(client, res->id + 1, maxid, goodid)))
-                maxid = res->id - 1;
-            else
-                id = res->id + 1;
-        }
+    StartIteration(&clientTable[client], &iter);
+    while ((res = NextResource(&iter))) {
+        if ((res->id < id) || (res->id > maxid))
+            continue;
+        if (((res->id - id) >= (maxid - res->id)) ?
+            (goodid = AvailableID(client, id, res->id - 1, goodid)) :
+            !(goodid = AvailableID(client, res->id + 1, maxid, goodid)))
+            maxid = res->id - 1;
+        else
+            id = res->id + 1;
     }
+    EndIteration(&iter);
     if (id > maxid)
         id = maxid = 0;
     *minp = id;
@@ -803,82 +1021,53 @@ AddResource(XID id, RESTYPE type, void *value)
 {
     int client;
     ClientResourceRec *rrec;
-    ResourcePtr res, *head;
+    ResourcePagePtr page;
+    ResourcePtr res;
 
 #ifdef XSERVER_DTRACE
     XSERVER_RESOURCE_ALLOC(id, type, value, TypeNameString(type));
 #endif
     client = CLIENT_ID(id);
     rrec = &clientTable[client];
-    if (!rrec->buckets) {
+    if (!rrec->pages) {
         ErrorF("[dix] AddResource(%lx, %x, %lx), client=%d \n",
                (unsigned long) id, type, (unsigned long)(uintptr_t) value, client);
         FatalError("client not in use\n");
     }
-    if ((rrec->elements >= 4 * rrec->buckets) && (rrec->hashsize < MAXHASHSIZE))
-        RebuildTable(client);
-    head = &rrec->resources[HashResourceID(id, clientTable[client].hashsize)];
     res = malloc(sizeof(ResourceRec));
-    if (!res) {
+    page = res ? FindPage(rrec, id) : NULL;
+    if (res && !page)
+        page = AddPage(rrec, id);
+    if (!page) {
+        free(res);
         (*resourceTypes[type & TypeMask].deleteFunc) (value, id);
         return FALSE;
     }
-    res->next = *head;
     res->id = id;
     res->type = type;
     res->value = value;
-    *head = res;
-    rrec->elements++;
+    res->serial = rrec->serial++;
+    res->next = page->slots[id & PAGEMASK];
+    page->slots[id & PAGEMASK] = res;
+    page->count++;
     CallResourceStateCallback(ResourceStateAdding, res);
     return TRUE;
 }
 
 static void
-RebuildTable(int client)
+doFreeResource(ClientResourceRec *rrec, ResourcePagePtr page,
+               ResourcePtr *link, Bool skip)
 {
-    int j;
-    ResourcePtr res, next;
-    ResourcePtr **tails, *resources;
-    ResourcePtr **tptr, *rptr;
-
-    /*
-     * For now, preserve insertion order, since some ddx layers depend
-     * on resources being free in the opposite order they are added.
-     */
-
-    j = 2 * clientTable[client].buckets;
-    tails =  xallocarray(j, sizeof(ResourcePtr *));
-    if (!tails)
-        return;
-    resources =  xallocarray(j, sizeof(ResourcePtr));
-    if (!resources) {
-        free(tails);
-        return;
-    }
-    for (rptr = resources, tptr = tails; --j >= 0; rptr++, tptr++) {
-        *rptr = NULL;
-        *tptr = rptr;
-    }
-    clientTable[client].hashsize++;
-    for (j = clientTable[client].buckets,
-         rptr = clientTable[client].resources; --j >= 0; rptr++) {
-        for (res = *rptr; res; res = next) {
-            next = res->next;
-            res->next = NULL;
-            tptr = &tails[HashResourceID(res->id, clientTable[client].hashsize)];
-            **tptr = res;
-            *tptr = &res->next;
-        }
+    ResourcePtr res = *link;
+
+    *link = res->next;
+    if (!--page->count) {
+        if (rrec->iterating)
+            rrec->sweep = TRUE;
+        else
+            RemovePage(rrec, page);
     }
-    free(tails);
-    clientTable[client].buckets *= 2;
-    free(clientTable[client].resources);
-    clientTable[client].resources = resources;
-}
 
-static void
-doFreeResource(ResourcePtr res, Bool skip)
-{
     CallResourceStateCallback(ResourceStateFreeing, res);
 
     if (!skip)
@@ -887,38 +1076,43 @@ doFreeResource(ResourcePtr res, Bool skip)
     free(res);
 }
 
+/* Free a resource found by iteration */
+static void
+doFreeIterResource(ClientResourceRec *rrec, ResourcePtr res)
+{
+    ResourcePagePtr page = FindPage(rrec, res->id);
+    ResourcePtr *link = &page->slots[res->id & PAGEMASK];
+
+    while (*link != res)
+        link = &(*link)->next;
+#ifdef XSERVER_DTRACE
+    XSERVER_RESOURCE_FREE(res->id, res->type,
+                          res->value, TypeNameString(res->type));
+#endif
+    doFreeResource(rrec, page, link, FALSE);
+}
+
 void
 FreeResource(XID id, RESTYPE skipDeleteFuncType)
 {
     int cid;
-    ResourcePtr res;
-    ResourcePtr *prev, *head;
-    int *eltptr;
-    int elements;
+    ClientResourceRec *rrec;
+    ResourcePagePtr page;
+    ResourcePtr *link;
 
-    if (((cid = CLIENT_ID(id)) < LimitClients) && clientTable[cid].buckets) {
-        head = &clientTable[cid].resources[HashResourceID(id, clientTable[cid].hashsize)];
-        eltptr = &clientTable[cid].elements;
+    if (((cid = CLIENT_ID(id)) < LimitClients) && clientTable[cid].pages) {
+        rrec = &clientTable[cid];
 
-        prev = head;
-        while ((res = *prev)) {
-            if (res->id == id) {
-                RESTYPE rtype = res->type;
+        /* The deletion function may free other resources with this id */
+        while ((link = LookupLink(rrec, id, RT_NONE, RC_ANY, &page))) {
+            RESTYPE rtype = (*link)->type;
 
 #ifdef XSERVER_DTRACE
-                XSERVER_RESOURCE_FREE(res->id, res->type,
-                                      res->value, TypeNameString(res->type));
+            XSERVER_RESOURCE_FREE((*link)->id, (*link)->type,
+                                  (*link)->value,
+                                  TypeNameString((*link)->type));
 #endif
-                *prev = res->next;
-                elements = --*eltptr;
-
-                doFreeResource(res, rtype == skipDeleteFuncType);
-
-                if (*eltptr != elements)
-                    prev = head;        /* prev may no longer be valid */
-            }
-            else
-                prev = &res->next;
+            doFreeResource(rrec, page, link, rtype == skipDeleteFuncType);
         }
     }
 }
@@ -927,28 +1121,18 @@ void
 FreeResourceByType(XID id, RESTYPE type, Bool skipFree)
 {
     int cid;
-    ResourcePtr res;
-    ResourcePtr *prev, *head;
+    ResourcePagePtr page;
+    ResourcePtr *link;
 
-    if (((cid = CLIENT_ID(id)) < LimitClients) && clientTable[cid].buckets) {
-        head = &clientTable[cid].resources[HashResourceID(id, clientTable[cid].hashsize)];
-
-        prev = head;
-        while ((res = *prev)) {
-            if (res->id == id && res->type == type) {
+    if (((cid = CLIENT_ID(id)) < LimitClients) && clientTable[cid].pages) {
+        link = LookupLink(&clientTable[cid], id, type, 0, &page);
+        if (link) {
 #ifdef XSERVER_DTRACE
-                XSERVER_RESOURCE_FREE(res->id, res->type,
-                                      res->value, TypeNameString(res->type));
+            XSERVER_RESOURCE_FREE((*link)->id, (*link)->type,
+                                  (*link)->value,
+                                  TypeNameString((*link)->type));
 #endif
-                *prev = res->next;
-                clientTable[cid].elements--;
-
-                doFreeResource(res, skipFree);
-
-                break;
-            }
-            else
-                prev = &res->next;
+            doFreeResource(&clientTable[cid], page, link, skipFree);
         }
     }
 }
@@ -965,49 +1149,36 @@ ChangeResourceValue(XID id, RESTYPE rtype, void *value)
     int cid;
     ResourcePtr res;
 
-    if (((cid = CLIENT_ID(id)) < LimitClients) && clientTable[cid].buckets) {
-        res = clientTable[cid].resources[HashResourceID(id, clientTable[cid].hashsize)];
-
-        for (; res; res = res->next)
-            if ((res->id == id) && (res->type == rtype)) {
-                res->value = value;
-                return TRUE;
-            }
+    if (((cid = CLIENT_ID(id)) < LimitClients) && clientTable[cid].pages) {
+        res = LookupResource(&clientTable[cid], id, rtype, 0);
+        if (res) {
+            res->value = value;
+            return TRUE;
+        }
     }
     return FALSE;
 }
 
-/* Note: if func adds or deletes resources, then func can get called
- * more than once for some resources.  If func adds new resources,
- * func might or might not get called for them.  func cannot both
- * add and delete an equal number of resources!
+/* func may add or delete resources; resources it deletes before they are
+ * reached are not visited, and resources it adds are not visited either.
  */
 
 void
 FindClientResourcesByType(ClientPtr client,
                           RESTYPE type, FindResType func, void *cdata)
 {
-    ResourcePtr *resources;
-    ResourcePtr this, next;
-    int i, elements;
-    int *eltptr;
+    ResourceIterRec iter;
+    ResourcePtr this;
 
     if (!client)
         client = serverClient;
 
-    resources = clientTable[client->index].resources;
-    eltptr = &clientTable[client->index].elements;
-    for (i = 0; i < clientTable[client->index].buckets; i++) {
-        for (this = resources[i]; this; this = next) {
-            next = this->next;
-            if (!type || this->type == type) {
-                elements = *eltptr;
-                (*func) (this->value, this->id, cdata);
-                if (*eltptr != elements)
-                    next = resources[i];        /* start over */
-            }
-        }
+    StartIteration(&clientTable[client->index], &iter);
+    while ((this = NextResource(&iter))) {
+        if (!type || this->type == type)
+            (*func) (this->value, this->id, cdata);
     }
+    EndIteration(&iter);
 }
 
 void FindSubResources(void *resource,
@@ -1022,25 +1193,16 @@ void FindSubResources(void *resource,
 void
 FindAllClientResources(ClientPtr client, FindAllRes func, void *cdata)
 {
-    ResourcePtr *resources;
-    ResourcePtr this, next;
-    int i, elements;
-    int *eltptr;
+    ResourceIterRec iter;
+    ResourcePtr this;
 
     if (!client)
         client = serverClient;
 
-    resources = clientTable[client->index].resources;
-    eltptr = &clientTable[client->index].elements;
-    for (i = 0; i < clientTable[client->index].buckets; i++) {
-        for (this = resources[i]; this; this = next) {
-            next = this->next;
-            elements = *eltptr;
-            (*func) (this->value, this->id, this->type, cdata);
-            if (*eltptr != elements)
-                next = resources[i];    /* start over */
-        }
-    }
+    StartIteration(&clientTable[client->index], &iter);
+    while ((this = NextResource(&iter)))
+        (*func) (this->value, this->id, this->type, cdata);
+    EndIteration(&iter);
 }
 
 void *
@@ -1048,74 +1210,54 @@ LookupClientResourceComplex(ClientPtr client,
                             RESTYPE type,
                             FindComplexResType func, void *cdata)
 {
-    ResourcePtr *resources;
-    ResourcePtr this, next;
-    void *value;
-    int i;
+    ResourceIterRec iter;
+    ResourcePtr this;
+    void *value = NULL;
 
     if (!client)
         client = serverClient;
 
-    resources = clientTable[client->index].resources;
-    for (i = 0; i < clientTable[client->index].buckets; i++) {
-        for (this = resources[i]; this; this = next) {
-            next = this->next;
-            if (!type || this->type == type) {
-                /* workaround func freeing the type as DRI1 does */
-                value = this->value;
-                if ((*func) (value, this->id, cdata))
-                    return value;
-            }
+    StartIteration(&clientTable[client->index], &iter);
+    while ((this = NextResource(&iter))) {
+        if (!type || this->type == type) {
+            /* workaround func freeing the type as DRI1 does */
+            value = this->value;
+            if ((*func) (value, this->id, cdata))
+                break;
+            value = NULL;
         }
     }
-    return NULL;
+    EndIteration(&iter);
+    return value;
 }
 
 void
 FreeClientNeverRetainResources(ClientPtr client)
 {
-    ResourcePtr *resources;
+    ClientResourceRec *rrec;
+    ResourceIterRec iter;
     ResourcePtr this;
-    ResourcePtr *prev;
-    int j, elements;
-    int *eltptr;
 
     if (!client)
         return;
 
-    resources = clientTable[client->index].resources;
-    eltptr = &clientTable[client->index].elements;
-    for (j = 0; j < clientTable[client->index].buckets; j++) {
-        prev = &resources[j];
-        while ((this = *prev)) {
-            RESTYPE rtype = this->type;
-
-            if (rtype & RC_NEVERRETAIN) {
-#ifdef XSERVER_DTRACE
-                XSERVER_RESOURCE_FREE(this->id, this->type,
-                                      this->value, TypeNameString(this->type));
-#endif
-                *prev = this->next;
-                clientTable[client->index].elements--;
-                elements = *eltptr;
-
-                doFreeResource(this, FALSE);
-
-                if (*eltptr != elements)
-                    prev = &resources[j];       /* prev may no longer be valid */
-            }
-            else
-                prev = &this->next;
-        }
+    rrec = &clientTable[client->index];
+    StartIteration(rrec, &iter);
+    while ((this = NextResource(&iter))) {
+        if (this->type & RC_NEVERRETAIN)
+            doFreeIterResource(rrec, this);
     }
+    EndIteration(&iter);
 }
 
 void
 FreeClientResources(ClientPtr client)
 {
-    ResourcePtr *resources;
+    ClientResourceRec *rrec;
+    ResourceIterRec iter;
+    ResourcePagePtr page, tmp;
     ResourcePtr this;
-    int j;
+    Bool freed;
 
     /* This routine shouldn't be called with a null client, but just in
        case ... */
@@ -1125,35 +1267,28 @@ FreeClientResources(ClientPtr client)
 
     HandleSaveSet(client);
 
-    resources = clientTable[client->index].resources;
-    for (j = 0; j < clientTable[client->index].buckets; j++) {
-        /* It may seem silly to update the head of this resource list as
-           we delete the members, since the entire list will be deleted any way,
-           but there are some resource deletion functions "FreeClientPixels" for
-           one which do a LookupID on another resource id (a Colormap id in this
-           case), so the resource list must be kept valid up to the point that
-           it is deleted, so every time we delete a resource, we must update the
-           head, just like in FreeResource. I hope that this doesn't slow down
-           mass deletion appreciably. PRH */
-
-        ResourcePtr *head;
+    rrec = &clientTable[client->index];
 
-        head = &resources[j];
-
-        for (this = *head; this; this = *head) {
-#ifdef XSERVER_DTRACE
-            XSERVER_RESOURCE_FREE(this->id, this->type,
-                                  this->value, TypeNameString(this->type));
-#endif
-            *head = this->next;
-            clientTable[client->index].elements--;
+    /* Resources sharing an id are freed newest first.  Some resource
+       deletion functions, "FreeClientPixels" for one, do a LookupID on
+       another resource id (a Colormap id in this case), so the table must
+       be kept valid until every resource has been deleted.  Deletion
+       functions may add resources too, hence the repeated passes. */
 
-            doFreeResource(this, FALSE);
+    do {
+        freed = FALSE;
+        StartIteration(rrec, &iter);
+        while ((this = NextResource(&iter))) {
+            doFreeIterResource(rrec, this);
+            freed = TRUE;
         }
-    }
-    free(clientTable[client->index].resources);
-    clientTable[client->index].resources = NULL;
-    clientTable[client->index].buckets = 0;
+        EndIteration(&iter);
+    } while (freed);
+
+    xorg_list_for_each_entry_safe(page, tmp, &rrec->pagelist, entry)
+        free(page);
+    free(rrec->pages);
+    rrec->pages = NULL;
 }
 
 void
@@ -1162,7 +1297,7 @@ FreeAllResources(void)
     int i;
 
     for (i = currentMaxClients; --i >= 0;) {
-        if (clientTable[i].buckets)
+        if (clientTable[i].pages)
             FreeClientResources(clients[i]);
     }
 }
@@ -1203,13 +1338,8 @@ dixLookupResourceByType(void **result, XID id, RESTYPE rtype,
     if ((rtype & TypeMask) > lastResourceType)
         return BadImplementation;
 
-    if ((cid < LimitClients) && clientTable[cid].buckets) {
-        res = clientTable[cid].resources[HashResourceID(id, clientTable[cid].hashsize)];
-
-        for (; res; res = res->next)
-            if (res->id == id && res->type == rtype)
-                break;
-    }
+    if ((cid < LimitClients) && clientTable[cid].pages)
+        res = LookupResource(&clientTable[cid], id, rtype, 0);
     if (client) {
         client->errorValue = id;
     }
@@ -1238,13 +1368,8 @@ dixLookupResourceByClass(void **result, XID id, RESTYPE rclass,
 
     *result = NULL;
 
-    if ((cid < LimitClients) && clientTable[cid].buckets) {
-        res = clientTable[cid].resources[HashResourceID(id, clientTable[cid].hashsize)];
-
-        for (; res; res = res->next)
-            if (res->id == id && (res->type & rclass))
-                break;
-    }
+    if ((cid < LimitClients) && clientTable[cid].pages)
+        res = LookupResource(&clientTable[cid], id, RT_NONE, rclass);
     if (client) {
         client->errorValue = id;
     }
@@ -596,6 +596,8 @@ CreateRootWindow(ScreenPtr pScreen)
     pWin->optional->otherClients = NULL;
     pWin->optional->passiveGrabs = NULL;
     pWin->optional->userProps = NULL;
+    pWin->optional->userPropIndex = NULL;
+    pWin->optional->childIndex = NULL;
     pWin->optional->backingBitPlanes = ~0L;
     pWin->optional->backingPixel = 0;
     pWin->optional->boundingShape = NULL;
@@ -747,6 +749,263 @@ RealChildHead(WindowPtr pWin)
         return NullWindow;
 }
 
+/*
+ * Child index
+ *
+ * Pointer hit-testing walks a parent's children from the top of the stack
+ * until one contains the point.  Under root that is every toplevel and
+ * override-redirect window, so parents where such a walk has passed many
+ * mapped children get a grid over the border extents of their mapped
+ * children.  Each cell lists, in stacking order, the children overlapping
+ * it; callers still apply the exact hit test to each candidate, so the
+ * index only has to err on the side of listing too many windows.
+ *
+ * Extents are kept relative to the parent so moving the parent does not
+ * touch the index.  Anything that maps, restacks, moves, resizes or
+ * destroys a child marks its parent's index stale.  Rebuilding costs
+ * about as much as a few dozen walks, so lookups keep walking until the
+ * children have stayed put for a while; dragging a window around does not
+ * rebuild the index on every motion.
+ */
+
+#define CHILD_INDEX_MIN_CHILDREN	16
+#define CHILD_INDEX_MAX_CELLS	64      /* per side */
+#define CHILD_INDEX_MAX_ENTRIES	8       /* per indexed child */
+#define CHILD_INDEX_REBUILD_DELAY	64      /* lookups */
+
+typedef struct _ChildIndex {
+    Bool valid;
+    int stale;                  /* lookups walked since invalidation */
+    int x1, y1;                 /* grid origin, relative to parent */
+    int shiftX, shiftY;         /* log2 of the cell size */
+    int cols, rows;
+    int *cellStart;             /* cols * rows + 1 offsets into children */
+    int cellStartSize;
+    WindowPtr *children;
+    int childrenSize;
+    struct _ChildIndexBox {
+        int x1, y1, x2, y2;     /* border extents, relative to parent */
+        int c1, r1, c2, r2;     /* grid cells covered, inclusive */
+        WindowPtr pWin;
+    } *boxes;                   /* mapped children, top to bottom */
+    int boxesSize;
+} ChildIndexRec, *ChildIndexPtr;
+
+static void
+InvalidateChildIndex(WindowPtr pParent)
+{
+    ChildIndexPtr idx;
+
+    if (pParent && pParent->optional &&
+        (idx = pParent->optional->childIndex)) {
+        idx->valid = FALSE;
+        idx->stale = 0;
+    }
+}
+
+static void
+FreeChildIndex(WindowPtr pWin)
+{
+    ChildIndexPtr idx = pWin->optional->childIndex;
+
+    if (!idx)
+        return;
+    free(idx->cellStart);
+    free(idx->children);
+    free(idx->boxes);
+    free(idx);
+    pWin->optional->childIndex = NULL;
+}
+
+static Bool
+GrowChildIndexArray(void **array, int *size, int needed, size_t elem)
+{
+    void *grown;
+
+    if (*size >= needed)
+        return TRUE;
+    grown = reallocarray(*array, needed, elem);
+    if (!grown)
+        return FALSE;
+    *array = grown;
+    *size = needed;
+    return TRUE;
+}
+
+static Bool
+RebuildChildIndex(WindowPtr pParent, ChildIndexPtr idx)
+{
+    struct _ChildIndexBox *b;
+    WindowPtr pChild;
+    int mapped = 0, entries, side, sx, sy, cols, rows, cells, i, c, r;
+    int x1 = 0, y1 = 0, x2 = 0, y2 = 0;
+
+    for (pChild = pParent->firstChild; pChild; pChild = pChild->nextSib)
+        if (pChild->mapped)
+            mapped++;
+    if (mapped < CHILD_INDEX_MIN_CHILDREN / 2)
+        return FALSE;
+    if (!GrowChildIndexArray((void **) &idx->boxes, &idx->boxesSize,
+                             mapped, sizeof(*idx->boxes)))
+        return FALSE;
+
+    b = idx->boxes;
+    for (pChild = pParent->firstChild; pChild; pChild = pChild->nextSib) {
+        int bw = wBorderWidth(pChild);
+
+        if (!pChild->mapped)
+            continue;
+        b->pWin = pChild;
+        b->x1 = pChild->drawable.x - pParent->drawable.x - bw;
+        b->y1 = pChild->drawable.y - pParent->drawable.y - bw;
+        b->x2 = b->x1 + (int) pChild->drawable.width + 2 * bw;
+        b->y2 = b->y1 + (int) pChild->drawable.height + 2 * bw;
+        if (b == idx->boxes) {
+            x1 = b->x1;
+            y1 = b->y1;
+            x2 = b->x2;
+            y2 = b->y2;
+        }
+        else {
+            x1 = min(x1, b->x1);
+            y1 = min(y1, b->y1);
+            x2 = max(x2, b->x2);
+            y2 = max(y2, b->y2);
+        }
+        b++;
+    }
+
+    /*
+     * Start at roughly one child per cell and coarsen the grid while large
+     * windows would be listed in too many cells.  Cells are power of two
+     * sized to keep divisions out of the loops.
+     */
+    for (side = 1; side * side < mapped && side < CHILD_INDEX_MAX_CELLS;)
+        side *= 2;
+    sx = sy = 0;
+    while ((x2 - x1 - 1) >> sx >= side)
+        sx++;
+    while ((y2 - y1 - 1) >> sy >= side)
+        sy++;
+    for (;;) {
+        entries = 0;
+        for (b = idx->boxes; b < idx->boxes + mapped; b++)
+            entries += (((b->x2 - 1 - x1) >> sx) -
+                        ((b->x1 - x1) >> sx) + 1) *
+                (((b->y2 - 1 - y1) >> sy) - ((b->y1 - y1) >> sy) + 1);
+        if (side == 1 || entries <= mapped * CHILD_INDEX_MAX_ENTRIES)
+            break;
+        side /= 2;
+        sx++;
+        sy++;
+    }
+
+    cols = ((x2 - x1 - 1) >> sx) + 1;
+    rows = ((y2 - y1 - 1) >> sy) + 1;
+    cells = cols * rows;
+    if (!GrowChildIndexArray((void **) &idx->cellStart,
+                             &idx->cellStartSize, cells + 1, sizeof(int)) ||
+        !GrowChildIndexArray((void **) &idx->children,
+                             &idx->childrenSize, entries,
+                             sizeof(WindowPtr)))
+        return FALSE;
+    idx->x1 = x1;
+    idx->y1 = y1;
+    idx->shiftX = sx;
+    idx->shiftY = sy;
+    idx->cols = cols;
+    idx->rows = rows;
+
+    /* count each cell's children, turn the counts into end offsets and
+     * then fill backwards from the bottom of the stack */
+    memset(idx->cellStart, 0, (cells + 1) * sizeof(int));
+    for (b = idx->boxes; b < idx->boxes + mapped; b++) {
+        b->c1 = (b->x1 - x1) >> sx;
+        b->r1 = (b->y1 - y1) >> sy;
+        b->c2 = (b->x2 - 1 - x1) >> sx;
+        b->r2 = (b->y2 - 1 - y1) >> sy;
+        for (r = b->r1; r <= b->r2; r++)
+            for (c = b->c1; c <= b->c2; c++)
+                idx->cellStart[r * cols + c + 1]++;
+    }
+    for (i = 0; i < cells; i++)
+        idx->cellStart[i + 1] += idx->cellStart[i];
+    while (b-- > idx->boxes) {
+        for (r = b->r1; r <= b->r2; r++)
+            for (c = b->c1; c <= b->c2; c++)
+                idx->children[--idx->cellStart[r * cols + c + 1]] =
+                    b->pWin;
+    }
+    /* the backwards fill left cell i + 1 starting where cell i ends */
+    for (i = 0; i < cells; i++)
+        idx->cellStart[i] = idx->cellStart[i + 1];
+    idx->cellStart[cells] = entries;
+
+    idx->valid = TRUE;
+    return TRUE;
+}
+
+/**
+ * Start keeping a child index for pParent.  Called by hit-testing code
+ * once a walk of pParent's children has passed many mapped windows; the
+ * index is built by a later ChildWindowsAt() call.
+ */
+void
+IndexChildWindows(WindowPtr pParent)
+{
+    ChildIndexPtr idx;
+
+    if (pParent->optional && pParent->optional->childIndex)
+        return;
+    if (!MakeWindowOptional(pParent))
+        return;
+    idx = calloc(1, sizeof(ChildIndexRec));
+    if (!idx)
+        return;
+    pParent->optional->childIndex = idx;
+}
+
+/**
+ * Find the children of pParent whose border extents may contain x/y.
+ *
+ * @param x,y  in root
+ * @param children  set to the candidates, topmost first.  Candidates may
+ * be unmapped, shaped or not actually contain x/y; callers apply their own
+ * hit test.  Valid until the window tree changes.
+ *
+ * @returns the number of candidates, or -1 if pParent has no usable index
+ * and the caller has to walk pParent's children itself.
+ */
+int
+ChildWindowsAt(WindowPtr pParent, int x, int y, WindowPtr **children)
+{
+    ChildIndexPtr idx;
+    int c, r, cell;
+
+    if (!pParent->optional || !(idx = pParent->optional->childIndex))
+        return -1;
+    if (!idx->valid) {
+        if (++idx->stale < CHILD_INDEX_REBUILD_DELAY)
+            return -1;
+        if (!RebuildChildIndex(pParent, idx)) {
+            FreeChildIndex(pParent);
+            return -1;
+        }
+    }
+
+    x -= pParent->drawable.x + idx->x1;
+    y -= pParent->drawable.y + idx->y1;
+    if (x < 0 || y < 0)
+        return 0;
+    c = x >> idx->shiftX;
+    r = y >> idx->shiftY;
+    if (c >= idx->cols || r >= idx->rows)
+        return 0;
+    cell = r * idx->cols + c;
+    *children = idx->children + idx->cellStart[cell];
+    return idx->cellStart[cell + 1] - idx->cellStart[cell];
+}
+
 /*****
  * CreateWindow
  *    Makes a window in response to client request
@@ -986,6 +1245,7 @@ DisposeWindowOptional(WindowPtr pWin)
         pWin->optional->deviceCursors = NULL;
     }
 
+    FreeChildIndex(pWin);
     free(pWin->optional);
     pWin->optional = NULL;
 }
@@ -1089,6 +1349,7 @@ DeleteWindow(void *value, XID wid)
 
     FreeWindowResources(pWin);
     if (pParent) {
+        InvalidateChildIndex(pParent);
         if (pParent->firstChild == pWin)
             pParent->firstChild = pWin->nextSib;
         if (pParent->lastChild == pWin)
@@ -1638,6 +1899,9 @@ MoveWindowInStack(WindowPtr pWin, WindowPtr pNextSib)
     WindowPtr pParent = pWin->parent;
     WindowPtr pFirstChange = pWin;      /* highest window where list changes */
 
+    /* mi calls this for moves and resizes too, after updating the origin */
+    InvalidateChildIndex(pParent);
+
     if (pWin->nextSib != pNextSib) {
         WindowPtr pOldNextSib = pWin->nextSib;
 
@@ -1716,6 +1980,7 @@ MoveWindowInStack(WindowPtr pWin, WindowPtr pNextSib)
 void
 SetWinSize(WindowPtr pWin)
 {
+    pWin->sizeChanged = TRUE;
 #ifdef COMPOSITE
     if (pWin->redirectDraw != RedirectDrawNone) {
         BoxRec box;
@@ -1752,6 +2017,7 @@ SetBorderSize(WindowPtr pWin)
 {
     int bw;
 
+    pWin->sizeChanged = TRUE;
     if (HasBorder(pWin)) {
         bw = wBorderWidth(pWin);
 #ifdef COMPOSITE
@@ -1854,6 +2120,9 @@ ResizeChildrenWinSize(WindowPtr pWin, int dx, int dy, int dw, int dh)
 
     pScreen = pWin->drawable.pScreen;
 
+    if (resized)
+        InvalidateChildIndex(pWin);
+
     for (pSib = pWin->firstChild; pSib; pSib = pSib->nextSib) {
         if (resized && (pSib->winGravity > NorthWestGravity)) {
             int cwsx, cwsy;
@@ -2415,6 +2684,7 @@ ConfigureWindow(WindowPtr pWin, Mask mask, XID *vlist, ClientPtr client)
         (*pWin->drawable.pScreen->ResizeWindow) (pWin, x, y, w, h, pSib);
     else if (mask & CWStackMode)
         ReflectStackChange(pWin, pSib, VTOther);
+    InvalidateChildIndex(pParent);
 
     if (action != RESTACK_WIN)
         CheckCursorConfinement(pWin);
@@ -2540,6 +2810,8 @@ ReparentWindow(WindowPtr pWin, WindowPtr pParent,
     /* take out of sibling chain */
 
     pPriorParent = pPrev = pWin->parent;
+    InvalidateChildIndex(pPriorParent);
+    InvalidateChildIndex(pParent);
     if (pPrev->firstChild == pWin)
         pPrev->firstChild = pWin->nextSib;
     if (pPrev->lastChild == pWin)
@@ -2678,6 +2950,7 @@ MapWindow(WindowPtr pWin, ClientPtr client)
                 return Success;
 
         pWin->mapped = TRUE;
+        InvalidateChildIndex(pParent);
         if (SubStrSend(pWin, pParent))
             DeliverMapNotify(pWin);
 
@@ -2746,6 +3019,7 @@ MapSubwindows(WindowPtr pParent, ClientPtr client)
                     continue;
 
             pWin->mapped = TRUE;
+            InvalidateChildIndex(pParent);
             if (parentNotify || StrSend(pWin))
                 DeliverMapNotify(pWin);
 
@@ -2862,6 +3136,7 @@ UnmapWindow(WindowPtr pWin, Bool fromConfigure)
         (*pScreen->MarkWindow) (pLayerWin->parent);
     }
     pWin->mapped = FALSE;
+    InvalidateChildIndex(pParent);
     if (wasRealized)
         UnrealizeTree(pWin, fromConfigure);
     if (wasViewable && !fromConfigure) {
@@ -2911,6 +3186,7 @@ UnmapSubwindows(WindowPtr pWin)
                 anyMarked = TRUE;
             }
             pChild->mapped = FALSE;
+            InvalidateChildIndex(pWin);
             if (pChild->realized)
                 UnrealizeTree(pChild, FALSE);
         }
@@ -3406,6 +3682,8 @@ MakeWindowOptional(WindowPtr pWin)
     optional->otherClients = NULL;
     optional->passiveGrabs = NULL;
     optional->userProps = NULL;
+    optional->userPropIndex = NULL;
+    optional->childIndex = NULL;
     optional->backingBitPlanes = ~0L;
     optional->backingPixel = 0;
     optional->boundingShape = NULL;
@@ -952,6 +952,17 @@ extern _X_EXPORT void
 extern _X_EXPORT Bool
  fbPictureInit(ScreenPtr pScreen, PictFormatPtr formats, int nformats);
 
+/*
+ * Only the bundled pixman bounds the glyph cache by memory and reports
+ * its statistics.  It is also the only one whose pixman_composite_glyphs
+ * leaves the cache alone; others move each glyph to the front of the
+ * cache's list, so glyph bands can only run on several threads here.
+ */
+#ifdef PIXMAN_HAS_GLYPH_CACHE_STATS
+#define FB_GLYPH_CACHE_STATS
+#define FB_GLYPH_BANDS
+#endif
+
 extern _X_EXPORT void
 fbDestroyGlyphCache(void);
 
@@ -35,6 +35,27 @@
 #include "mipict.h"
 #include "fbpict.h"
 
+typedef struct {
+    pixman_op_t op;
+    pixman_image_t *src, *mask, *dest;
+    int xSrc, ySrc;
+    int xMask, yMask;
+    int xDst, yDst;
+    int width;
+} FbCompositeBandRec;
+
+static void
+fbCompositeBand(void *closure, int y1, int y2)
+{
+    FbCompositeBandRec *c = closure;
+    int dy = y1 - c->yDst;
+
+    pixman_image_composite(c->op, c->src, c->mask, c->dest,
+                           c->xSrc, c->ySrc + dy,
+                           c->xMask, c->yMask + dy,
+                           c->xDst, y1, c->width, y2 - y1);
+}
+
 void
 fbComposite(CARD8 op,
             PicturePtr pSrc,
@@ -59,10 +80,26 @@ fbComposite(CARD8 op,
     dest = image_from_pict(pDst, TRUE, &dst_xoff, &dst_yoff);
 
     if (src && dest && !(pMask && !mask)) {
-        pixman_image_composite(op, src, mask, dest,
-                               xSrc + src_xoff, ySrc + src_yoff,
-                               xMask + msk_xoff, yMask + msk_yoff,
-                               xDst + dst_xoff, yDst + dst_yoff, width, height);
+        FbCompositeBandRec c = {
+            .op = op, .src = src, .mask = mask, .dest = dest,
+            .xSrc = xSrc + src_xoff, .ySrc = ySrc + src_yoff,
+            .xMask = xMask + msk_xoff, .yMask = yMask + msk_yoff,
+            .xDst = xDst + dst_xoff, .yDst = yDst + dst_yoff,
+            .width = width,
+        };
+        int nbands = 1;
+
+        if (!fbBandReadsDestination(pSrc, pDst) &&
+            !fbBandReadsDestination(pMask, pDst))
+            nbands = fbBandCount(width, height);
+
+        /* An empty composite validates the images before the bands
+         * start sharing them.
+         */
+        if (nbands > 1)
+            pixman_image_composite(op, src, mask, dest, 0, 0, 0, 0, 0, 0, 0, 0);
+
+        fbRunBands(nbands, fbCompositeBand, &c, c.yDst, c.yDst + height);
     }
 
     free_pixman_pict(pSrc, src);
@@ -70,6 +107,11 @@ fbComposite(CARD8 op,
     free_pixman_pict(pDst, dest);
 }
 
+/*
+ * One cache is shared by all screens and glyph sets; it is keyed by
+ * GlyphPtr, which glyph sets already share for identical glyphs.  Its
+ * size is bounded by -renderglyphcache.
+ */
 static pixman_glyph_cache_t *glyphCache;
 
 void
@@ -82,6 +124,30 @@ fbDestroyGlyphCache(void)
     }
 }
 
+#ifdef FB_GLYPH_CACHE_STATS
+/*
+ * Fill in the statistics of the glyph cache; returns FALSE when no glyphs
+ * have been rendered yet.
+ */
+static Bool
+fbGetGlyphCacheStats(ScreenPtr pScreen, GlyphCacheStatsPtr stats)
+{
+    pixman_glyph_cache_stats_t s;
+
+    if (!glyphCache)
+	return FALSE;
+
+    pixman_glyph_cache_get_stats (glyphCache, &s);
+    stats->hits = s.hits;
+    stats->misses = s.misses;
+    stats->insertions = s.insertions;
+    stats->evictions = s.evictions;
+    stats->glyphs = s.n_glyphs;
+    stats->memory = s.memory;
+    return TRUE;
+}
+#endif
+
 static void
 fbUnrealizeGlyph(ScreenPtr pScreen,
 		 GlyphPtr pGlyph)
@@ -90,6 +156,32 @@ fbUnrealizeGlyph(ScreenPtr pScreen,
 	pixman_glyph_cache_remove (glyphCache, pGlyph, NULL);
 }
 
+typedef struct {
+    pixman_op_t op;
+    pixman_image_t *src, *dest;
+    pixman_format_code_t format;
+    int xSrc, ySrc;
+    int xMask, yMask;
+    int xDst, yDst;
+    int width;
+    int n_glyphs;
+    const pixman_glyph_t *glyphs;
+} FbGlyphBandRec;
+
+static void
+fbGlyphBand(void *closure, int y1, int y2)
+{
+    FbGlyphBandRec *g = closure;
+    int dy = y1 - g->yMask;
+
+    pixman_composite_glyphs(g->op, g->src, g->dest, g->format,
+                            g->xSrc, g->ySrc + dy,
+                            g->xMask, y1,
+                            g->xDst, g->yDst + dy,
+                            g->width, y2 - y1,
+                            glyphCache, g->n_glyphs, g->glyphs);
+}
+
 void
 fbGlyphs(CARD8 op,
 	 PicturePtr pSrc,
@@ -118,8 +210,14 @@ fbGlyphs(CARD8 op,
     for (i = 0; i < nlist; ++i)
 	n_glyphs += list[i].len;
 
-    if (!glyphCache)
-	glyphCache = pixman_glyph_cache_create();
+    if (!glyphCache) {
+	if (!(glyphCache = pixman_glyph_cache_create()))
+	    return;
+#ifdef FB_GLYPH_CACHE_STATS
+	pixman_glyph_cache_set_memory_budget (glyphCache,
+					      (uint64_t) PictureGlyphCacheSize * 1024);
+#endif
+    }
 
     pixman_glyph_cache_freeze (glyphCache);
 
@@ -183,20 +281,38 @@ fbGlyphs(CARD8 op,
 	goto out_free_src;
 
     if (maskFormat) {
-	pixman_format_code_t format;
+	FbGlyphBandRec g;
 	pixman_box32_t extents;
-
-	format = maskFormat->format | (maskFormat->depth << 24);
+	int nbands;
 
 	pixman_glyph_get_extents(glyphCache, n_glyphs, pglyphs, &extents);
 
-	pixman_composite_glyphs(op, srcImage, dstImage, format,
-				xSrc + srcXoff + extents.x1 - xDst, ySrc + srcYoff + extents.y1 - yDst,
-				extents.x1, extents.y1,
-				extents.x1 + dstXoff, extents.y1 + dstYoff,
-				extents.x2 - extents.x1,
-				extents.y2 - extents.y1,
-				glyphCache, n_glyphs, pglyphs);
+	g.op = op;
+	g.src = srcImage;
+	g.dest = dstImage;
+	g.format = maskFormat->format | (maskFormat->depth << 24);
+	g.xSrc = xSrc + srcXoff + extents.x1 - xDst;
+	g.ySrc = ySrc + srcYoff + extents.y1 - yDst;
+	g.xMask = extents.x1;
+	g.yMask = extents.y1;
+	g.xDst = extents.x1 + dstXoff;
+	g.yDst = extents.y1 + dstYoff;
+	g.width = extents.x2 - extents.x1;
+	g.n_glyphs = n_glyphs;
+	g.glyphs = pglyphs;
+
+	/* Each band builds its own mask for its rows of the extents */
+	nbands = 1;
+#ifdef FB_GLYPH_BANDS
+	if (!fbBandReadsDestination(pSrc, pDst))
+	    nbands = fbBandCount(extents.x2 - extents.x1,
+				 extents.y2 - extents.y1);
+#endif
+	if (nbands > 1)
+	    pixman_image_composite(op, srcImage, NULL, dstImage,
+				   0, 0, 0, 0, 0, 0, 0, 0);
+
+	fbRunBands(nbands, fbGlyphBand, &g, extents.y1, extents.y2);
     }
     else {
 	pixman_composite_glyphs_no_mask(op, srcImage, dstImage,
@@ -496,6 +612,9 @@ fbPictureInit(ScreenPtr pScreen, PictFormatPtr formats, int nformats)
     ps->Composite = fbComposite;
     ps->Glyphs = fbGlyphs;
     ps->UnrealizeGlyph = fbUnrealizeGlyph;
+#ifdef FB_GLYPH_CACHE_STATS
+    ps->GetGlyphCacheStats = fbGetGlyphCacheStats;
+#endif
     ps->CompositeRects = miCompositeRects;
     ps->RasterizeTrapezoid = fbRasterizeTrapezoid;
     ps->Trapezoids = fbTrapezoids;
@@ -76,4 +76,17 @@ fbGlyphs(CARD8 op,
 	 GlyphListPtr list,
 	 GlyphPtr *glyphs);
 
+/* fbthread.c */
+
+typedef void (*FbBandProc) (void *closure, int y1, int y2);
+
+extern _X_EXPORT int
+fbBandCount(int width, int height);
+
+extern _X_EXPORT Bool
+fbBandReadsDestination(PicturePtr pPict, PicturePtr pDst);
+
+extern _X_EXPORT void
+fbRunBands(int nbands, FbBandProc proc, void *closure, int y1, int y2);
+
 #endif                          /* _FBPICT_H_ */
@@ -0,0 +1,272 @@
+/*
+ * Copyright © 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include "fb.h"
+
+#include "picturestr.h"
+#include "fbpict.h"
+
+/*
+ * Large Render operations are split into horizontal bands of the
+ * destination which are rendered concurrently by a small pool of worker
+ * threads.  The thread running the request renders bands as well and
+ * waits for all of them to finish before returning, so as far as the
+ * rest of the server is concerned the operation completes synchronously
+ * and protocol ordering is unaffected.
+ *
+ * Bands write disjoint rows of the destination and share the source
+ * images read-only; callers make sure the images are validated before
+ * the bands start, after which pixman does not modify them.
+ */
+
+#define FB_BAND_MAX_THREADS	8
+#define FB_BAND_MIN_ROWS	16
+#define FB_BANDS_PER_THREAD	2
+
+typedef struct {
+    FbBandProc proc;
+    void *closure;
+    int y1, y2;
+    int rows;                   /* rows per band */
+    int next;                   /* next band to hand out */
+    int nbands;
+    int pending;                /* bands not yet rendered */
+} FbBandJobRec, *FbBandJobPtr;
+
+static pthread_mutex_t fbBandMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t fbBandWork = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t fbBandDone = PTHREAD_COND_INITIALIZER;
+static FbBandJobPtr fbBandJob;
+static int fbBandWorkers = -1;  /* not started yet */
+
+/*
+ * Render the next band of the current job, if there is one left.
+ * Called and returns with fbBandMutex held.
+ */
+static Bool
+fbBandStep(FbBandJobPtr job)
+{
+    int y1, y2;
+
+    if (job->next == job->nbands)
+        return FALSE;
+
+    y1 = job->y1 + job->next++ * job->rows;
+    y2 = min(y1 + job->rows, job->y2);
+
+    pthread_mutex_unlock(&fbBandMutex);
+    (*job->proc) (job->closure, y1, y2);
+    pthread_mutex_lock(&fbBandMutex);
+
+    if (--job->pending == 0)
+        pthread_cond_signal(&fbBandDone);
+    return TRUE;
+}
+
+static void *
+fbBandThread(void *arg)
+{
+#ifdef SIG_BLOCK
+    sigset_t set;
+
+    /* Signals are for the main thread */
+    sigfillset(&set);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+#endif
+
+#if defined(HAVE_PTHREAD_SETNAME_NP_WITH_TID)
+    pthread_setname_np(pthread_self(), "RenderBands");
+#elif defined(HAVE_PTHREAD_SETNAME_NP_WITHOUT_TID)
+    pthread_setname_np("RenderBands");
+#endif
+
+    pthread_mutex_lock(&fbBandMutex);
+    for (;;) {
+        if (!fbBandJob || !fbBandStep(fbBandJob))
+            pthread_cond_wait(&fbBandWork, &fbBandMutex);
+    }
+
+    return NULL;
+}
+
+static int
+fbBandCPUs(void)
+{
+#if defined(_SC_NPROCESSORS_ONLN)
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return n > 0 ? n : 1;
+#elif defined(__PTW32_VERSION) || defined(PTW32_VERSION)
+    return pthread_num_processors_np();
+#else
+    return 1;
+#endif
+}
+
+/*
+ * Start the workers the first time an operation is large enough to be
+ * banded.  They are never stopped; between operations they sleep on
+ * fbBandWork.
+ */
+static int
+fbBandStartWorkers(void)
+{
+    int threads = PictureRenderThreads;
+    pthread_t thread;
+
+    if (threads < 0)
+        threads = fbBandCPUs();
+    threads = min(threads, FB_BAND_MAX_THREADS);
+
+    for (fbBandWorkers = 0; fbBandWorkers < threads - 1; fbBandWorkers++) {
+        if (pthread_create(&thread, NULL, fbBandThread, NULL) != 0) {
+            LogMessageVerb(X_WARNING, 1,
+                           "fb: only %d render band threads started\n",
+                           fbBandWorkers + 1);
+            break;
+        }
+        pthread_detach(thread);
+    }
+
+    return fbBandWorkers;
+}
+
+/*
+ * Return the number of bands an operation writing a width x height area
+ * of the destination should be split into; 1 means it is not worth
+ * splitting.
+ */
+int
+fbBandCount(int width, int height)
+{
+    int workers = fbBandWorkers;
+    int nbands;
+
+#ifdef FB_ACCESS_WRAPPER
+    /* The wfb access functions are not known to be thread safe */
+    return 1;
+#endif
+
+    if (PictureRenderThreads == 1 || height < 2 * FB_BAND_MIN_ROWS ||
+        (long) width * height < PictureBandPixels)
+        return 1;
+
+    if (workers < 0)
+        workers = fbBandStartWorkers();
+
+    nbands = min((workers + 1) * FB_BANDS_PER_THREAD,
+                 height / FB_BAND_MIN_ROWS);
+    return workers ? nbands : 1;
+}
+
+static PixmapPtr
+fbBandDrawablePixmap(DrawablePtr pDrawable)
+{
+    if (pDrawable->type == DRAWABLE_PIXMAP)
+        return (PixmapPtr) pDrawable;
+    return fbGetWindowPixmap(pDrawable);
+}
+
+static Bool
+fbBandStorageOverlaps(PicturePtr pRead, PicturePtr pWrite)
+{
+    PixmapPtr a, b;
+    char *a1, *b1;
+    long alen, blen;
+
+    if (!pRead || !pRead->pDrawable || !pWrite || !pWrite->pDrawable)
+        return FALSE;
+
+    a = fbBandDrawablePixmap(pRead->pDrawable);
+    b = fbBandDrawablePixmap(pWrite->pDrawable);
+    if (a == b)
+        return TRUE;
+
+    a1 = a->devPrivate.ptr;
+    b1 = b->devPrivate.ptr;
+    alen = (long) abs(a->devKind) * a->drawable.height;
+    blen = (long) abs(b->devKind) * b->drawable.height;
+    return a1 && b1 && a1 < b1 + blen && b1 < a1 + alen;
+}
+
+/*
+ * Bands write disjoint rows of the destination but may read any rows of
+ * the pictures they composite, so an operation reading pixels that back
+ * the destination or its alpha map has to run as a single band.  Returns
+ * whether pPict or its alpha map shares storage with either of them.
+ */
+Bool
+fbBandReadsDestination(PicturePtr pPict, PicturePtr pDst)
+{
+    if (!pPict)
+        return FALSE;
+
+    return fbBandStorageOverlaps(pPict, pDst) ||
+        fbBandStorageOverlaps(pPict, pDst->alphaMap) ||
+        fbBandStorageOverlaps(pPict->alphaMap, pDst) ||
+        fbBandStorageOverlaps(pPict->alphaMap, pDst->alphaMap);
+}
+
+/*
+ * Call proc for every band of the rows y1 to y2, in parallel when nbands
+ * is larger than one.  Returns once all bands are finished.
+ */
+void
+fbRunBands(int nbands, FbBandProc proc, void *closure, int y1, int y2)
+{
+    FbBandJobRec job;
+
+    if (nbands <= 1) {
+        (*proc) (closure, y1, y2);
+        return;
+    }
+
+    job.proc = proc;
+    job.closure = closure;
+    job.y1 = y1;
+    job.y2 = y2;
+    job.rows = (y2 - y1 + nbands - 1) / nbands;
+    job.next = 0;
+    job.nbands = (y2 - y1 + job.rows - 1) / job.rows;
+    job.pending = job.nbands;
+
+    pthread_mutex_lock(&fbBandMutex);
+    fbBandJob = &job;
+    pthread_cond_broadcast(&fbBandWork);
+
+    while (fbBandStep(&job))
+        ;
+    while (job.pending)
+        pthread_cond_wait(&fbBandDone, &fbBandMutex);
+
+    fbBandJob = NULL;
+    pthread_mutex_unlock(&fbBandMutex);
+}
@@ -154,6 +154,140 @@ fbShapes(CompositeShapesFunc composite,
     free_pixman_pict(pDst, dst);
 }
 
+/*
+ * Operators for which rendering a trapezoid only touches the pixels it
+ * covers; the others composite the whole destination.
+ */
+#define FB_TRAP_BOUNDED_OPS ((1 << PictOpDst) | (1 << PictOpOver) |     \
+                             (1 << PictOpOverReverse) |                 \
+                             (1 << PictOpOutReverse) |                  \
+                             (1 << PictOpAtop) | (1 << PictOpXor) |     \
+                             (1 << PictOpAdd))
+
+#define N_STACK_TRAPS 64
+
+typedef struct {
+    pixman_op_t op;
+    pixman_image_t *src, *dst;
+    pixman_format_code_t mask_format;
+    int x_src, y_src;
+    int x_dst, y_dst;
+    int ntrap;
+    const pixman_trapezoid_t *traps;
+} FbTrapBandRec;
+
+/*
+ * Render the trapezoids cut to the rows y1 to y2.  Edges are sampled at
+ * fixed positions within each row, so cutting at a row boundary leaves
+ * the coverage of every pixel unchanged.
+ *
+ * pixman clips the mask horizontally to the edge end points of all the
+ * trapezoids, so trapezoids outside the band are kept as slivers too thin
+ * to cover a sample; that way each band gets the same horizontal clip as
+ * the whole operation would.
+ */
+static void
+fbTrapezoidBand(void *closure, int y1, int y2)
+{
+    FbTrapBandRec *t = closure;
+    pixman_trapezoid_t stack_traps[N_STACK_TRAPS];
+    pixman_trapezoid_t *traps = stack_traps;
+    pixman_fixed_t top = pixman_int_to_fixed(y1);
+    pixman_fixed_t bottom = pixman_int_to_fixed(y2);
+    Bool visible = FALSE;
+    int i, n = 0;
+
+    if (t->ntrap > N_STACK_TRAPS &&
+        !(traps = xallocarray(t->ntrap, sizeof(pixman_trapezoid_t))))
+        return;
+
+    for (i = 0; i < t->ntrap; i++) {
+        pixman_trapezoid_t *trap = &traps[n];
+
+        if (!pixman_trapezoid_valid(&t->traps[i]))
+            continue;
+
+        *trap = t->traps[i];
+        trap->top = max(trap->top, top);
+        trap->bottom = min(trap->bottom, bottom);
+        if (trap->bottom > trap->top)
+            visible = TRUE;
+        else {
+            trap->top = top;
+            trap->bottom = top + 1;
+        }
+        n++;
+    }
+
+    if (visible)
+        pixman_composite_trapezoids(t->op, t->src, t->dst, t->mask_format,
+                                    t->x_src, t->y_src, t->x_dst, t->y_dst,
+                                    n, traps);
+
+    if (traps != stack_traps)
+        free(traps);
+}
+
+static void
+fbCompositeTrapezoids(pixman_op_t op,
+                      pixman_image_t * src,
+                      pixman_image_t * dst,
+                      pixman_format_code_t mask_format,
+                      int x_src, int y_src,
+                      int x_dst, int y_dst,
+                      int ntrap, const uint8_t * shapes)
+{
+    FbTrapBandRec t;
+    pixman_fixed_t left = INT32_MAX, right = INT32_MIN;
+    pixman_fixed_t top = INT32_MAX, bottom = INT32_MIN;
+    int i, y1 = 0, y2 = 0, nbands = 1;
+
+    t.traps = (const pixman_trapezoid_t *) shapes;
+
+    if ((unsigned) op < 32 && (FB_TRAP_BOUNDED_OPS & (1 << op))) {
+        for (i = 0; i < ntrap; i++) {
+            const pixman_trapezoid_t *trap = &t.traps[i];
+
+            if (!pixman_trapezoid_valid(trap))
+                continue;
+
+            top = min(top, trap->top);
+            bottom = max(bottom, trap->bottom);
+            left = min(left, min(trap->left.p1.x, trap->left.p2.x));
+            right = max(right, max(trap->right.p1.x, trap->right.p2.x));
+        }
+
+        if (top < bottom && left < right) {
+            y1 = pixman_fixed_to_int(top);
+            y2 = pixman_fixed_to_int(pixman_fixed_ceil(bottom));
+            nbands = fbBandCount(pixman_fixed_to_int(right) -
+                                 pixman_fixed_to_int(left) + 1, y2 - y1);
+        }
+    }
+
+    if (nbands == 1) {
+        pixman_composite_trapezoids(op, src, dst, mask_format,
+                                    x_src, y_src, x_dst, y_dst,
+                                    ntrap, t.traps);
+        return;
+    }
+
+    t.op = op;
+    t.src = src;
+    t.dst = dst;
+    t.mask_format = mask_format;
+    t.x_src = x_src;
+    t.y_src = y_src;
+    t.x_dst = x_dst;
+    t.y_dst = y_dst;
+    t.ntrap = ntrap;
+
+    /* Validate the images before the bands start sharing them */
+    pixman_image_composite(op, src, NULL, dst, 0, 0, 0, 0, 0, 0, 0, 0);
+
+    fbRunBands(nbands, fbTrapezoidBand, &t, y1, y2);
+}
+
 void
 fbTrapezoids(CARD8 op,
              PicturePtr pSrc,
@@ -161,10 +295,16 @@ fbTrapezoids(CARD8 op,
              PictFormatPtr maskFormat,
              INT16 xSrc, INT16 ySrc, int ntrap, xTrapezoid * traps)
 {
+    CompositeShapesFunc composite = fbCompositeTrapezoids;
+
     xSrc -= (traps[0].left.p1.x >> 16);
     ySrc -= (traps[0].left.p1.y >> 16);
 
-    fbShapes((CompositeShapesFunc) pixman_composite_trapezoids,
+    /* Bands must not read what other bands write */
+    if (fbBandReadsDestination(pSrc, pDst))
+        composite = (CompositeShapesFunc) pixman_composite_trapezoids;
+
+    fbShapes(composite,
              op, pSrc, pDst, maskFormat,
              xSrc, ySrc, ntrap, sizeof(xTrapezoid), (const uint8_t *) traps);
 }
@@ -67,6 +67,12 @@ from The Open Group.
 #include "miline.h"
 #include "glx_extinit.h"
 #include "randrstr.h"
+#ifdef MITSHM
+#include "shmint.h"
+#endif
+#ifdef PRESENT
+#include "present.h"
+#endif
 
 #define VFB_DEFAULT_WIDTH      1280
 #define VFB_DEFAULT_HEIGHT     1024
@@ -770,6 +776,28 @@ vfbRRScreenSetSize(ScreenPtr  pScreen,
     return TRUE;
 }
 
+#ifdef PRESENT
+/*
+ * Pace Present clients at the refresh rate of the mode, so that setting a
+ * mode added with xrandr --newmode selects the emulated vblank rate.
+ * Modes without timings, like the initial one, leave it alone.
+ */
+static void
+vfbRRSetPresentRefresh(ScreenPtr pScreen, RRModePtr mode)
+{
+    uint64_t dots;
+
+    if (!mode || !mode->mode.dotClock)
+        return;
+
+    dots = (uint64_t) mode->mode.hTotal * mode->mode.vTotal;
+    if (dots)
+        present_fake_set_refresh(pScreen,
+                                 ((uint64_t) mode->mode.dotClock * 1000 +
+                                  dots / 2) / dots);
+}
+#endif
+
 static Bool
 vfbRRCrtcSet(ScreenPtr pScreen,
              RRCrtcPtr crtc,
@@ -780,6 +808,9 @@ vfbRRCrtcSet(ScreenPtr pScreen,
              int       numOutput,
              RROutputPtr *outputs)
 {
+#ifdef PRESENT
+  vfbRRSetPresentRefresh(pScreen, mode);
+#endif
   return RRCrtcNotify(crtc, mode, x, y, rotation, NULL, numOutput, outputs);
 }
 
@@ -928,6 +959,11 @@ vfbScreenInit(ScreenPtr pScreen, int argc, char **argv)
     if (!ret)
         return FALSE;
 
+#ifdef MITSHM
+    /* All pixmaps, including the screen's, are plain memory */
+    ShmRegisterDirectAccess(pScreen);
+#endif
+
     if (!vfbRandRInit(pScreen))
        return FALSE;
 
@@ -1158,7 +1158,7 @@ winDestroyPixmapMultiwindow(PixmapPtr pPixmap)
     pPixmapPriv->pbmih = NULL;
 
     /* Free the pixmap memory */
-    free(pPixmap);
+    FreePixmap(pPixmap);
     pPixmap = NULL;
 
     return TRUE;
@@ -630,6 +630,9 @@ typedef struct _DeviceIntRec {
     int xtest_master_id;
 
     struct _SyncCounter *idle_counter;
+
+    /* merge queued motion events, see XI_PROP_COALESCE_MOTION */
+    Bool coalesce_motion;
 } DeviceIntRec;
 
 typedef struct {
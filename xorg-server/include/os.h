@@ -106,6 +106,8 @@ extern _X_EXPORT Bool WaitForSomething(Bool clients_are_ready);
 
 extern _X_EXPORT int ReadRequestFromClient(ClientPtr /*client */ );
 
+extern _X_EXPORT const void *PeekNextRequestFromClient(ClientPtr client);
+
 extern _X_EXPORT int ReadFdFromClient(ClientPtr client);
 
 extern _X_EXPORT int WriteFdToClient(ClientPtr client, int fd, Bool do_close);
@@ -518,6 +520,9 @@ AddAuthorization(unsigned int /*name_length */ ,
                  unsigned int /*data_length */ ,
                  char * /*data */ );
 
+extern _X_EXPORT void
+GenerateRandomData(int /*len */ , char * /*buf */ );
+
 #ifdef XCSECURITY
 extern _X_EXPORT XID
 GenerateAuthorization(unsigned int /* name_length */ ,
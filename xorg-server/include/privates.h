@@ -325,6 +325,29 @@ _dixFreeObjectWithPrivates(void *object, PrivatePtr privates,
 
 #define dixFreeObjectWithPrivates(o,t) _dixFreeObjectWithPrivates(o, (o)->devPrivates, t)
 
+/*
+ * Pooled storage for the screen-specific types (windows, pixmaps, GCs and
+ * pictures), used by the functions above and by AllocatePixmap.
+ */
+extern _X_EXPORT void *
+ dixAllocatePooledObject(DevPrivateType type, unsigned size);
+
+extern _X_EXPORT void
+ dixFreePooledObject(DevPrivateType type, void *object);
+
+typedef struct _DevPrivatePoolStats {
+    uint64_t allocations;       /* objects allocated this generation */
+    uint64_t reused;            /* ... of which came from a free list */
+    int cached;                 /* free objects currently kept */
+} DevPrivatePoolStatsRec, *DevPrivatePoolStatsPtr;
+
+/*
+ * Return the pool counters for the specified type, or FALSE if objects of
+ * that type are not pooled
+ */
+extern _X_EXPORT Bool
+ dixGetPrivatePoolStats(DevPrivateType type, DevPrivatePoolStatsPtr stats);
+
 /*
  * Return size of privates for the specified type
  */
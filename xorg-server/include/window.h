@@ -193,6 +193,13 @@ extern _X_EXPORT Bool PointInWindowIsVisible(WindowPtr /*pWin */ ,
                                              int /*x */ ,
                                              int /*y */ );
 
+extern _X_EXPORT void IndexChildWindows(WindowPtr /*pParent */ );
+
+extern _X_EXPORT int ChildWindowsAt(WindowPtr /*pParent */ ,
+                                    int /*x */ ,
+                                    int /*y */ ,
+                                    WindowPtr ** /*children */ );
+
 extern _X_EXPORT RegionPtr NotClippedByChildren(WindowPtr /*pWin */ );
 
 extern _X_EXPORT void SendVisibilityNotify(WindowPtr /*pWin */ );
@@ -197,6 +197,8 @@ typedef struct _XkbSrvInfo {
     XkbSrvCheckRepeatPtr checkRepeat;
 
     char overlay_perkey_state[256/8]; /* bitfield */
+
+    struct _XkbCachedReply *replies;    /* serialized Get* replies */
 } XkbSrvInfoRec, *XkbSrvInfoPtr;
 
 #define	XkbSLI_IsDefault	(1L<<0)
@@ -307,6 +309,8 @@ extern _X_EXPORT int XkbEventBase;
 extern _X_EXPORT int XkbKeyboardErrorCode;
 extern _X_EXPORT const char *XkbBaseDirectory;
 extern _X_EXPORT const char *XkbBinDirectory;
+extern _X_EXPORT const char *XkbKeymapCacheDirectory;
+extern _X_EXPORT Bool XkbWantKeymapCache;
 
 extern _X_EXPORT CARD32 xkbDebugFlags;
 
@@ -804,6 +808,11 @@ extern _X_EXPORT void XkbFreeSrvLedInfo(XkbSrvLedInfoPtr        /* sli */
 extern _X_EXPORT void XkbFreeInfo(XkbSrvInfoPtr /* xkbi */
     );
 
+extern _X_EXPORT void XkbInvalidateReplies(void);
+
+extern _X_EXPORT void XkbFreeCachedReplies(XkbSrvInfoPtr /* xkbi */
+    );
+
 extern _X_EXPORT Status XkbChangeTypesOfKey(XkbDescPtr /* xkb */ ,
                                             int /* key */ ,
                                             int /* nGroups */ ,
@@ -52,6 +52,10 @@
 /* STRING. Device node path of device */
 #define XI_PROP_DEVICE_NODE "Device Node"
 
+/* BOOL. If set, motion events from this device still waiting in the event
+ * queue are merged into newer ones. Raw events are never merged. */
+#define XI_PROP_COALESCE_MOTION "Coalesce Motion"
+
 /* Pointer acceleration properties */
 /* INTEGER of any format */
 #define ACCEL_PROP_PROFILE_NUMBER "Device Accel Profile"
@@ -215,6 +215,14 @@ extern _X_EXPORT void mieqAddCallbackOnDrained(CallbackProcPtr callback,
 extern _X_EXPORT void mieqRemoveCallbackOnDrained(CallbackProcPtr callback,
                                                   void *param);
 
+/* Bucket i counts events delivered 2^i to 2^(i+1) microseconds after they
+ * were enqueued; the first and last buckets are open-ended. */
+#define MIEQ_LATENCY_BUCKETS 20
+
+extern _X_EXPORT void mieqGetLatencyHistogram(CARD32 *buckets);
+
+extern _X_EXPORT CARD64 mieqGetCoalescedMotionCount(void);
+
 extern DeviceIntPtr CopyGetMasterEvent(DeviceIntPtr /* sdev */ ,
                                        InternalEvent * /* original */ ,
                                        InternalEvent *  /* copy */
@@ -420,6 +428,8 @@ extern _X_EXPORT int miValidateTree(WindowPtr /*pParent */ ,
                                     VTKind      /*kind */
     );
 
+extern _X_EXPORT Bool miValidateIncremental;
+
 extern _X_EXPORT void miWideLine(DrawablePtr /*pDrawable */ ,
                                  GCPtr /*pGC */ ,
                                  int /*mode */ ,
@@ -53,12 +53,16 @@ in this Software without prior written authorization from The Open Group.
 #include   "extinit.h"
 #include   "exglobals.h"
 #include   "eventstr.h"
+#include   "syncsrv.h"
 
 #ifdef DPMSExtension
 #include "dpmsproc.h"
 #include <X11/extensions/dpmsconst.h>
 #endif
 
+/* How far back a motion event may be merged across raw events */
+#define COALESCE_LOOKBEHIND                  8
+
 /* Maximum size should be initial size multiplied by a power of 2 */
 #define QUEUE_INITIAL_SIZE                 1024
 #define QUEUE_RESERVED_SIZE                 64
@@ -73,20 +77,68 @@ typedef struct _Event {
     InternalEvent *events;
     ScreenPtr pScreen;
     DeviceIntPtr pDev;          /* device this event _originated_ from */
+    HWEventQueueType serial;    /* position in enqueue order */
+    CARD64 stamp;               /* enqueue time, in microseconds */
+    Bool coalesced;             /* merged into a later event, skip it */
 } EventRec, *EventPtr;
 
+#if INPUTTHREAD
+/*
+ * Events generated on the input thread bypass miEventQueue and go through
+ * a single-producer, single-consumer byte ring instead.  The main thread
+ * drains it without taking input_lock per event, and since the ring never
+ * grows nothing is reallocated under the lock.  Records are variable
+ * sized since most events are much smaller than an InternalEvent.
+ */
+#define RING_SIZE (1 << 21)    /* bytes, power of two */
+
+typedef struct _RingRecord {
+    CARD32 size;                /* bytes to the next record, 0 to wrap */
+    HWEventQueueType serial;
+    DeviceIntPtr pDev;
+    ScreenPtr pScreen;
+    CARD64 stamp;
+    /* followed by the event */
+} RingRecord;
+
+#define RING_RECORD_SIZE(len) \
+    ((sizeof(RingRecord) + (len) + 7) & ~(size_t) 7)
+
+typedef struct _EventRing {
+    char *buffer;
+    size_t head;                /* advanced by the main thread only */
+    size_t tail;                /* advanced by the input thread only */
+} EventRing;
+#endif
+
+/*
+ * Every enqueued event gets the next serial, whichever queue it goes to,
+ * and the consumer delivers them strictly in serial order.  serial and
+ * processed double as the SetInputCheck pair.
+ */
 typedef struct _EventQueue {
-    HWEventQueueType head, tail;        /* long for SetInputCheck */
+    HWEventQueueType head, tail;        /* of the events array */
+    HWEventQueueType serial;    /* serial of the next enqueued event */
+    HWEventQueueType processed; /* serial of the next event to deliver */
     CARD32 lastEventTime;       /* to avoid time running backwards */
     int lastMotion;             /* device ID if last event motion? */
     EventRec *events;           /* our queue as an array */
     size_t nevents;             /* the number of buckets in our queue */
     size_t dropped;             /* counter for number of consecutive dropped events */
     mieqHandler handlers[128];  /* custom event handler */
+    CARD32 latency[MIEQ_LATENCY_BUCKETS];
+    CARD64 coalesced;           /* motion events merged away */
+    CARD64 coalescedReported;   /* last value given to the sync counter */
+#if INPUTTHREAD
+    EventRing ring;
+#endif
 } EventQueueRec, *EventQueuePtr;
 
 static EventQueueRec miEventQueue;
 
+/* serials wrap around; avoid signed overflow doing so */
+#define NEXT_SERIAL(s) ((HWEventQueueType) ((unsigned int) (s) + 1))
+
 static CallbackListPtr miCallbacksWhenDrained = NULL;
 
 static size_t
@@ -170,9 +222,14 @@ mieqInit(void)
     input_lock();
     if (!mieqGrowQueue(&miEventQueue, QUEUE_INITIAL_SIZE))
         FatalError("Could not allocate event queue.\n");
+#if INPUTTHREAD
+    miEventQueue.ring.buffer = malloc(RING_SIZE);
+    if (!miEventQueue.ring.buffer)
+        FatalError("Could not allocate event queue.\n");
+#endif
     input_unlock();
 
-    SetInputCheck(&miEventQueue.head, &miEventQueue.tail);
+    SetInputCheck(&miEventQueue.processed, &miEventQueue.serial);
     return TRUE;
 }
 
@@ -181,6 +238,13 @@ mieqFini(void)
 {
     int i;
 
+    LogMessageVerb(X_INFO, 3, "[mi] Event delivery latency (us):");
+    for (i = 0; i < MIEQ_LATENCY_BUCKETS; i++)
+        if (miEventQueue.latency[i])
+            LogMessageVerb(X_NONE, 3, " <%d: %u", 2 << i,
+                           (unsigned) miEventQueue.latency[i]);
+    LogMessageVerb(X_NONE, 3, "\n");
+
     for (i = 0; i < miEventQueue.nevents; i++) {
         if (miEventQueue.events[i].events != NULL) {
             FreeEventList(miEventQueue.events[i].events, 1);
@@ -188,8 +252,163 @@ mieqFini(void)
         }
     }
     free(miEventQueue.events);
+#if INPUTTHREAD
+    free(miEventQueue.ring.buffer);
+#endif
 }
 
+/*
+ * Opt-in motion coalescing (XI_PROP_COALESCE_MOTION): a queued motion event
+ * is dropped in favour of a newer one from the same device when the only
+ * events between them are that device's raw events, so raw events stay
+ * exact and motion never moves across any other event.
+ */
+static Bool
+mieqCanCoalesce(const InternalEvent *older, const InternalEvent *newer)
+{
+    return older->any.type == ET_Motion && newer->any.type == ET_Motion &&
+        older->device_event.deviceid == newer->device_event.deviceid &&
+        older->device_event.flags == newer->device_event.flags &&
+        older->device_event.root == newer->device_event.root;
+}
+
+/* Keep axes that only changed in the older event */
+static void
+mieqCoalesceMotion(const DeviceEvent *older, DeviceEvent *newer)
+{
+    int i;
+
+    for (i = 0; i < MAX_VALUATORS; i++) {
+        if (!BitIsOn(older->valuators.mask, i) ||
+            BitIsOn(newer->valuators.mask, i))
+            continue;
+        SetBit(newer->valuators.mask, i);
+        if (BitIsOn(older->valuators.mode, i))
+            SetBit(newer->valuators.mode, i);
+        else
+            ClearBit(newer->valuators.mode, i);
+        newer->valuators.data[i] = older->valuators.data[i];
+    }
+}
+
+/* Main thread queue only; e has been copied to the tail slot, which is
+ * about to be published with the next serial */
+static void
+mieqCoalesceQueued(DeviceIntPtr pDev, InternalEvent *e)
+{
+    size_t n_enqueued = mieqNumEnqueued(&miEventQueue);
+    HWEventQueueType serial = miEventQueue.serial;
+    size_t i;
+
+    for (i = 1; i <= n_enqueued && i <= COALESCE_LOOKBEHIND; i++) {
+        EventRec *prev = &miEventQueue.events[(miEventQueue.tail +
+                                               miEventQueue.nevents - i) %
+                                              miEventQueue.nevents];
+
+        serial = (HWEventQueueType) ((unsigned int) serial - 1);
+        if (prev->serial != serial)
+            return;             /* an input thread event is in between */
+        if (prev->coalesced ||
+            (prev->pDev == pDev && prev->events->any.type == ET_RawMotion))
+            continue;
+        if (prev->pDev == pDev && prev->pScreen == EnqueueScreen(pDev) &&
+            mieqCanCoalesce(prev->events, e)) {
+            mieqCoalesceMotion(&prev->events->device_event, &e->device_event);
+            prev->coalesced = TRUE;
+            miEventQueue.coalesced++;
+        }
+        return;
+    }
+}
+
+static void
+mieqReportDropped(void)
+{
+    /* Toss events which come in late.  Usually this means your server's
+     * stuck in an infinite loop in the main thread.
+     */
+    miEventQueue.dropped++;
+    if (miEventQueue.dropped == 1) {
+        ErrorFSigSafe("[mi] EQ overflowing.  Additional events will be "
+                      "discarded until existing events are processed.\n");
+        xorg_backtrace();
+        ErrorFSigSafe("[mi] These backtraces from mieqEnqueue may point to "
+                      "a culprit higher up the stack.\n");
+        ErrorFSigSafe("[mi] mieq is *NOT* the cause.  It is a victim.\n");
+    }
+    else if (miEventQueue.dropped % QUEUE_DROP_BACKTRACE_FREQUENCY == 0 &&
+             miEventQueue.dropped / QUEUE_DROP_BACKTRACE_FREQUENCY <=
+             QUEUE_DROP_BACKTRACE_MAX) {
+        ErrorFSigSafe("[mi] EQ overflow continuing.  %zu events have been "
+                      "dropped.\n", miEventQueue.dropped);
+        if (miEventQueue.dropped / QUEUE_DROP_BACKTRACE_FREQUENCY ==
+            QUEUE_DROP_BACKTRACE_MAX) {
+            ErrorFSigSafe("[mi] No further overflow reports will be "
+                          "reported until the clog is cleared.\n");
+        }
+        xorg_backtrace();
+    }
+}
+
+#if INPUTTHREAD
+static inline RingRecord *
+RingRecordAt(EventRing *ring, size_t offset)
+{
+    return (RingRecord *) (ring->buffer + (offset & (RING_SIZE - 1)));
+}
+
+/* Input thread only, with input_lock held */
+static Bool
+mieqRingEnqueue(DeviceIntPtr pDev, InternalEvent *e, CARD64 stamp)
+{
+    EventRing *ring = &miEventQueue.ring;
+    size_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    size_t tail = ring->tail;
+    size_t size = RING_RECORD_SIZE(e->any.length);
+    size_t room = RING_SIZE - (tail & (RING_SIZE - 1));
+    RingRecord *rec;
+
+    /* records never straddle the end; skip the remainder instead */
+    if (RING_SIZE - (tail - head) < (size > room ? room + size : size))
+        return FALSE;
+    if (size > room) {
+        RingRecordAt(ring, tail)->size = 0;
+        tail += room;
+    }
+
+    rec = RingRecordAt(ring, tail);
+    rec->size = size;
+    rec->serial = miEventQueue.serial;
+    rec->pDev = pDev;
+    rec->pScreen = pDev ? EnqueueScreen(pDev) : NULL;
+    rec->stamp = stamp;
+    memcpy(rec + 1, e, e->any.length);
+
+    __atomic_store_n(&ring->tail, tail + size, __ATOMIC_RELEASE);
+    return TRUE;
+}
+
+/* Return the first published record at or after offset, skipping a wrap
+ * marker, or NULL if the input thread hasn't published one yet. */
+static RingRecord *
+mieqRingPeek(EventRing *ring, size_t *offset)
+{
+    size_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    RingRecord *rec;
+
+    if (*offset == tail)
+        return NULL;
+    rec = RingRecordAt(ring, *offset);
+    if (rec->size == 0) {
+        *offset += RING_SIZE - (*offset & (RING_SIZE - 1));
+        if (*offset == tail)
+            return NULL;
+        rec = RingRecordAt(ring, *offset);
+    }
+    return rec;
+}
+#endif
+
 /*
  * Must be reentrant with ProcessInputEvents.  Assumption: mieqEnqueue
  * will never be interrupted. Must be called with input_lock held
@@ -204,9 +423,32 @@ mieqEnqueue(DeviceIntPtr pDev, InternalEvent *e)
     int evlen;
     Time time;
     size_t n_enqueued;
+    HWEventQueueType serial = miEventQueue.serial;
+    CARD64 stamp = GetTimeInMicros();
+    Bool replaced = FALSE;
+    DeviceEvent older;
 
     verify_internal_event(e);
 
+#if INPUTTHREAD
+    if (in_input_thread()) {
+        /* Consecutive motion is merged by the consumer instead, as it may
+         * already be reading the previous record. */
+        if (!mieqRingEnqueue(pDev, e, stamp)) {
+            mieqReportDropped();
+            return;
+        }
+        time = e->any.time;
+        if (time < miEventQueue.lastEventTime &&
+            miEventQueue.lastEventTime - time < 10000)
+            e->any.time = miEventQueue.lastEventTime;
+        miEventQueue.lastEventTime = time;
+        miEventQueue.lastMotion = 0;
+        miEventQueue.serial = NEXT_SERIAL(miEventQueue.serial);
+        return;
+    }
+#endif
+
     n_enqueued = mieqNumEnqueued(&miEventQueue);
 
     /* avoid merging events from different devices */
@@ -216,33 +458,16 @@ mieqEnqueue(DeviceIntPtr pDev, InternalEvent *e)
     if (isMotion && isMotion == miEventQueue.lastMotion &&
         oldtail != miEventQueue.head) {
         oldtail = (oldtail - 1) % miEventQueue.nevents;
+        serial = miEventQueue.events[oldtail].serial;
+        if (pDev->coalesce_motion) {
+            older = miEventQueue.events[oldtail].events->device_event;
+            miEventQueue.coalesced++;
+        }
+        replaced = TRUE;
     }
     else if (n_enqueued + 1 == miEventQueue.nevents) {
         if (!mieqGrowQueue(&miEventQueue, miEventQueue.nevents << 1)) {
-            /* Toss events which come in late.  Usually this means your server's
-             * stuck in an infinite loop in the main thread.
-             */
-            miEventQueue.dropped++;
-            if (miEventQueue.dropped == 1) {
-                ErrorFSigSafe("[mi] EQ overflowing.  Additional events will be "
-                              "discarded until existing events are processed.\n");
-                xorg_backtrace();
-                ErrorFSigSafe("[mi] These backtraces from mieqEnqueue may point to "
-                              "a culprit higher up the stack.\n");
-                ErrorFSigSafe("[mi] mieq is *NOT* the cause.  It is a victim.\n");
-            }
-            else if (miEventQueue.dropped % QUEUE_DROP_BACKTRACE_FREQUENCY == 0 &&
-                     miEventQueue.dropped / QUEUE_DROP_BACKTRACE_FREQUENCY <=
-                     QUEUE_DROP_BACKTRACE_MAX) {
-                ErrorFSigSafe("[mi] EQ overflow continuing.  %zu events have been "
-                              "dropped.\n", miEventQueue.dropped);
-                if (miEventQueue.dropped / QUEUE_DROP_BACKTRACE_FREQUENCY ==
-                    QUEUE_DROP_BACKTRACE_MAX) {
-                    ErrorFSigSafe("[mi] No further overflow reports will be "
-                                  "reported until the clog is cleared.\n");
-                }
-                xorg_backtrace();
-            }
+            mieqReportDropped();
             return;
         }
         oldtail = miEventQueue.tail;
@@ -252,6 +477,13 @@ mieqEnqueue(DeviceIntPtr pDev, InternalEvent *e)
     evt = miEventQueue.events[oldtail].events;
     memcpy(evt, e, evlen);
 
+    if (isMotion && pDev->coalesce_motion) {
+        if (replaced)
+            mieqCoalesceMotion(&older, &evt->device_event);
+        else
+            mieqCoalesceQueued(pDev, evt);
+    }
+
     time = e->any.time;
     /* Make sure that event times don't go backwards - this
      * is "unnecessary", but very useful. */
@@ -262,9 +494,13 @@ mieqEnqueue(DeviceIntPtr pDev, InternalEvent *e)
     miEventQueue.lastEventTime = evt->any.time;
     miEventQueue.events[oldtail].pScreen = pDev ? EnqueueScreen(pDev) : NULL;
     miEventQueue.events[oldtail].pDev = pDev;
+    miEventQueue.events[oldtail].serial = serial;
+    miEventQueue.events[oldtail].stamp = stamp;
+    miEventQueue.events[oldtail].coalesced = FALSE;
 
     miEventQueue.lastMotion = isMotion;
     miEventQueue.tail = (oldtail + 1) % miEventQueue.nevents;
+    miEventQueue.serial = NEXT_SERIAL(serial);
 }
 
 /**
@@ -509,14 +745,149 @@ mieqProcessDeviceEvent(DeviceIntPtr dev, InternalEvent *event, ScreenPtr screen)
     }
 }
 
+#if INPUTTHREAD
+/*
+ * Check whether the motion record at offset can be merged into a later
+ * one, and do so.  Consecutive motion from a device is always merged, as
+ * on the main thread queue; with coalescing enabled the later event may
+ * also follow raw events.  Published records are never touched again by
+ * the input thread, so the later record can be updated in place.
+ */
+static Bool
+mieqRingCoalesce(EventRing *ring, size_t offset)
+{
+    RingRecord *rec = RingRecordAt(ring, offset);
+    InternalEvent *ev = (InternalEvent *) (rec + 1);
+    HWEventQueueType serial = rec->serial;
+    Bool coalesce = rec->pDev && rec->pDev->coalesce_motion;
+    int i;
+
+    for (i = 0; i < COALESCE_LOOKBEHIND; i++) {
+        RingRecord *succ;
+        InternalEvent *later;
+
+        offset += RingRecordAt(ring, offset)->size;
+        succ = mieqRingPeek(ring, &offset);
+        serial = NEXT_SERIAL(serial);
+        if (!succ || succ->serial != serial || succ->pDev != rec->pDev)
+            return FALSE;
+
+        later = (InternalEvent *) (succ + 1);
+        if (coalesce && later->any.type == ET_RawMotion)
+            continue;
+        if (later->any.type != ET_Motion)
+            return FALSE;
+        if (coalesce) {
+            if (succ->pScreen != rec->pScreen || !mieqCanCoalesce(ev, later))
+                return FALSE;
+            mieqCoalesceMotion(&ev->device_event, &later->device_event);
+            miEventQueue.coalesced++;
+        }
+        return TRUE;
+    }
+    return FALSE;
+}
+#endif
+
+/*
+ * Fetch the event with the next serial from whichever queue holds it.
+ * Only the ring is shared with the input thread, so this runs without
+ * input_lock.
+ */
+static Bool
+mieqDequeue(InternalEvent *event, DeviceIntPtr *dev, ScreenPtr *screen,
+            CARD64 *stamp)
+{
+    HWEventQueueType next = miEventQueue.processed;
+
+    while (miEventQueue.head != miEventQueue.tail) {
+        EventRec *e = &miEventQueue.events[miEventQueue.head];
+
+        if (e->serial != next)
+            break;
+        if (e->coalesced) {
+            miEventQueue.head = (miEventQueue.head + 1) % miEventQueue.nevents;
+            next = miEventQueue.processed = NEXT_SERIAL(next);
+        }
+        else {
+            *event = *e->events;
+            *dev = e->pDev;
+            *screen = e->pScreen;
+            *stamp = e->stamp;
+            miEventQueue.head = (miEventQueue.head + 1) % miEventQueue.nevents;
+            miEventQueue.processed = NEXT_SERIAL(next);
+            return TRUE;
+        }
+    }
+#if INPUTTHREAD
+    {
+        EventRing *ring = &miEventQueue.ring;
+        size_t offset = ring->head;
+        RingRecord *rec;
+
+        while ((rec = mieqRingPeek(ring, &offset)) && rec->serial == next) {
+            InternalEvent *ev = (InternalEvent *) (rec + 1);
+
+            if (ev->any.type == ET_Motion && mieqRingCoalesce(ring, offset)) {
+                offset += rec->size;
+                next = NEXT_SERIAL(next);
+                continue;
+            }
+
+            memcpy(event, ev, ev->any.length);
+            *dev = rec->pDev;
+            *screen = rec->pScreen;
+            *stamp = rec->stamp;
+            __atomic_store_n(&ring->head, offset + rec->size, __ATOMIC_RELEASE);
+            miEventQueue.processed = NEXT_SERIAL(next);
+            return TRUE;
+        }
+    }
+#endif
+    return FALSE;
+}
+
+static void
+mieqRecordLatency(CARD64 stamp)
+{
+    CARD64 latency = GetTimeInMicros() - stamp;
+    int bucket = 0;
+
+    while (latency >= 2 && bucket < MIEQ_LATENCY_BUCKETS - 1) {
+        latency >>= 1;
+        bucket++;
+    }
+    miEventQueue.latency[bucket]++;
+}
+
+/**
+ * Copy the event latency histogram into buckets, which must have room
+ * for MIEQ_LATENCY_BUCKETS counters.
+ */
+void
+mieqGetLatencyHistogram(CARD32 *buckets)
+{
+    memcpy(buckets, miEventQueue.latency, sizeof(miEventQueue.latency));
+}
+
+/**
+ * Number of motion events merged into later ones by devices with motion
+ * coalescing enabled, since mieqInit().
+ */
+CARD64
+mieqGetCoalescedMotionCount(void)
+{
+    return miEventQueue.coalesced;
+}
+
 /* Call this from ProcessInputEvents(). */
 void
 mieqProcessInputEvents(void)
 {
-    EventRec *e = NULL;
     ScreenPtr screen;
     InternalEvent event;
     DeviceIntPtr dev = NULL, master = NULL;
+    CARD64 stamp, coalesced;
     static Bool inProcessInputEvents = FALSE;
 
     input_lock();
@@ -537,38 +908,36 @@ mieqProcessInputEvents(void)
         miEventQueue.dropped = 0;
     }
 
-    while (miEventQueue.head != miEventQueue.tail) {
-        e = &miEventQueue.events[miEventQueue.head];
-
-        event = *e->events;
-        dev = e->pDev;
-        screen = e->pScreen;
-
-        miEventQueue.head = (miEventQueue.head + 1) % miEventQueue.nevents;
-
+    /* Events are enqueued with input_lock held, so once the queues are
+     * found empty under the lock they stay empty for the drain callbacks. */
+    while (miEventQueue.processed != miEventQueue.serial) {
         input_unlock();
 
-        master = (dev) ? GetMaster(dev, MASTER_ATTACHED) : NULL;
+        while (mieqDequeue(&event, &dev, &screen, &stamp)) {
+            master = (dev) ? GetMaster(dev, MASTER_ATTACHED) : NULL;
 
-        if (screenIsSaved == SCREEN_SAVER_ON)
-            dixSaveScreens(serverClient, SCREEN_SAVER_OFF, ScreenSaverReset);
+            if (screenIsSaved == SCREEN_SAVER_ON)
+                dixSaveScreens(serverClient, SCREEN_SAVER_OFF, ScreenSaverReset);
 #ifdef DPMSExtension
-        else if (DPMSPowerLevel != DPMSModeOn)
-            SetScreenSaverTimer();
+            else if (DPMSPowerLevel != DPMSModeOn)
+                SetScreenSaverTimer();
 
-        if (DPMSPowerLevel != DPMSModeOn)
-            DPMSSet(serverClient, DPMSModeOn);
+            if (DPMSPowerLevel != DPMSModeOn)
+                DPMSSet(serverClient, DPMSModeOn);
 #endif
 
-        mieqProcessDeviceEvent(dev, &event, screen);
+            mieqProcessDeviceEvent(dev, &event, screen);
 
-        /* Update the sprite now. Next event may be from different device. */
-        if (master &&
-            (event.any.type == ET_Motion ||
-             ((event.any.type == ET_TouchBegin ||
-               event.any.type == ET_TouchUpdate) &&
-              event.device_event.flags & TOUCH_POINTER_EMULATED)))
-            miPointerUpdateSprite(dev);
+            /* Update the sprite now. Next event may be from different device. */
+            if (master &&
+                (event.any.type == ET_Motion ||
+                 ((event.any.type == ET_TouchBegin ||
+                   event.any.type == ET_TouchUpdate) &&
+                  event.device_event.flags & TOUCH_POINTER_EMULATED)))
+                miPointerUpdateSprite(dev);
+
+            mieqRecordLatency(stamp);
+        }
 
         input_lock();
     }
@@ -577,7 +946,13 @@ mieqProcessInputEvents(void)
 
     CallCallbacks(&miCallbacksWhenDrained, NULL);
 
+    coalesced = miEventQueue.coalesced;
     input_unlock();
+
+    if (coalesced != miEventQueue.coalescedReported) {
+        miEventQueue.coalescedReported = coalesced;
+        SyncChangeMotionCoalesced(coalesced);
+    }
 }
 
 void mieqAddCallbackOnDrained(CallbackProcPtr callback, void *param)
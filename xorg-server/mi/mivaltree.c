@@ -177,6 +177,114 @@ miShapedWindowIn(RegionPtr universe, RegionPtr bounding,
 				    HasBorder(w) && \
 				    (w)->backgroundState == ParentRelative)
 
+/*
+ * When set, a marked window whose borderClip comes out unchanged and whose
+ * own size did not change since its clips were last computed keeps its
+ * clips and those of its inferiors instead of having them recomputed.
+ * Children of a viewable window are validated as soon as they change, so
+ * nothing else below such a window can be out of date.  Only the unit
+ * tests turn this off, to compare against full recomputation.
+ */
+Bool miValidateIncremental = TRUE;
+
+/*
+ * Scratch regions, taken and released in stack order by miValidateTree and
+ * each level of miComputeClips.  They are emptied but keep their rectangle
+ * storage between validations, unless it has grown unreasonably large.
+ */
+#define CLIP_SCRATCH_KEEP_RECTS 1024
+
+typedef struct _miClipScratch {
+    RegionRec universe;         /* child universe for the next level */
+    RegionRec childUnion;
+    RegionRec exposed;          /* miValidateTree only */
+} miClipScratchRec, *miClipScratchPtr;
+
+static miClipScratchPtr *clipScratch;
+static int clipScratchSize, clipScratchTop;
+
+static void
+miClearScratchRegion(RegionPtr pReg)
+{
+    if (pReg->data && pReg->data->size &&
+        pReg->data->size <= CLIP_SCRATCH_KEEP_RECTS) {
+        pReg->data->numRects = 0;
+        pReg->extents.x2 = pReg->extents.x1;
+        pReg->extents.y2 = pReg->extents.y1;
+    }
+    else
+        RegionEmpty(pReg);
+}
+
+static miClipScratchPtr
+miGetClipScratch(void)
+{
+    miClipScratchPtr scratch;
+
+    if (clipScratchTop == clipScratchSize) {
+        clipScratch = xnfreallocarray(clipScratch, clipScratchSize + 8,
+                                      sizeof(miClipScratchPtr));
+        memset(clipScratch + clipScratchSize, 0,
+               8 * sizeof(miClipScratchPtr));
+        clipScratchSize += 8;
+    }
+    scratch = clipScratch[clipScratchTop];
+    if (!scratch) {
+        scratch = xnfalloc(sizeof(miClipScratchRec));
+        RegionNull(&scratch->universe);
+        RegionNull(&scratch->childUnion);
+        RegionNull(&scratch->exposed);
+        clipScratch[clipScratchTop] = scratch;
+    }
+    clipScratchTop++;
+    return scratch;
+}
+
+static void
+miPutClipScratch(miClipScratchPtr scratch)
+{
+    miClearScratchRegion(&scratch->universe);
+    miClearScratchRegion(&scratch->childUnion);
+    miClearScratchRegion(&scratch->exposed);
+    clipScratchTop--;
+}
+
+static void miComputeClips(WindowPtr pParent, ScreenPtr pScreen,
+                           RegionPtr universe, VTKind kind, RegionPtr exposed);
+
+/*
+ * Finish a window whose clips did not change. Its marked children keep
+ * their borderClip as well, so they are validated against that instead of
+ * a universe carved out of the parent's, and get the same visibility,
+ * exposures and ClipNotify calls as in a full pass.
+ */
+static void
+miKeepClips(WindowPtr pParent, ScreenPtr pScreen, VTKind kind,
+            RegionPtr exposed)
+{
+    miClipScratchPtr scratch;
+    WindowPtr pChild;
+
+    RegionNull(&pParent->valdata->after.borderExposed);
+    RegionNull(&pParent->valdata->after.exposed);
+
+    if (pParent->firstChild && pParent->mapped) {
+        scratch = miGetClipScratch();
+        for (pChild = pParent->firstChild; pChild; pChild = pChild->nextSib) {
+            if (pChild->viewable && pChild->valdata) {
+                RegionCopy(&scratch->universe, &pChild->borderClip);
+                miComputeClips(pChild, pScreen, &scratch->universe, kind,
+                               exposed);
+            }
+        }
+        miPutClipScratch(scratch);
+    }
+
+    pParent->drawable.serialNumber = NEXT_SERIAL_NUMBER;
+    if (pScreen->ClipNotify)
+        (*pScreen->ClipNotify) (pParent, 0, 0);
+}
+
 /*
  *-----------------------------------------------------------------------
  * miComputeClips --
@@ -199,11 +307,10 @@ miComputeClips(WindowPtr pParent,
                RegionPtr universe, VTKind kind, RegionPtr exposed)
 {                               /* for intermediate calculations */
     int dx, dy;
-    RegionRec childUniverse;
+    miClipScratchPtr scratch;
     WindowPtr pChild;
     int oldVis, newVis;
     BoxRec borderSize;
-    RegionRec childUnion;
     Bool overlap;
     RegionPtr borderVisible;
 
@@ -305,6 +412,7 @@ miComputeClips(WindowPtr pParent,
                             (*pScreen->ClipNotify) (pChild, dx, dy);
 
                     }
+                    pChild->sizeChanged = FALSE;
                     if (pChild->valdata) {
                         RegionNull(&pChild->valdata->after.borderExposed);
                         if (HasParentRelativeBorder(pChild)) {
@@ -349,6 +457,20 @@ miComputeClips(WindowPtr pParent,
         break;
     }
 
+    if (miValidateIncremental && kind != VTBroken && !dx && !dy &&
+        oldVis == newVis && oldVis != VisibilityNotViewable &&
+        !pParent->sizeChanged &&
+#ifdef COMPOSITE
+        pParent->redirectDraw == RedirectDrawNone &&
+#endif
+        !pParent->valdata->before.borderVisible &&
+        !pParent->valdata->before.resized &&
+        RegionEqual(universe, &pParent->borderClip)) {
+        miKeepClips(pParent, pScreen, kind, exposed);
+        return;
+    }
+    pParent->sizeChanged = FALSE;
+
     borderVisible = pParent->valdata->before.borderVisible;
     RegionNull(&pParent->valdata->after.borderExposed);
     RegionNull(&pParent->valdata->after.exposed);
@@ -396,23 +518,22 @@ miComputeClips(WindowPtr pParent,
         RegionCopy(&pParent->borderClip, universe);
 
     if ((pChild = pParent->firstChild) && pParent->mapped) {
-        RegionNull(&childUniverse);
-        RegionNull(&childUnion);
+        scratch = miGetClipScratch();
         if ((pChild->drawable.y < pParent->lastChild->drawable.y) ||
             ((pChild->drawable.y == pParent->lastChild->drawable.y) &&
              (pChild->drawable.x < pParent->lastChild->drawable.x))) {
             for (; pChild; pChild = pChild->nextSib) {
                 if (pChild->viewable && !TreatAsTransparent(pChild))
-                    RegionAppend(&childUnion, &pChild->borderSize);
+                    RegionAppend(&scratch->childUnion, &pChild->borderSize);
             }
         }
         else {
             for (pChild = pParent->lastChild; pChild; pChild = pChild->prevSib) {
                 if (pChild->viewable && !TreatAsTransparent(pChild))
-                    RegionAppend(&childUnion, &pChild->borderSize);
+                    RegionAppend(&scratch->childUnion, &pChild->borderSize);
             }
         }
-        RegionValidate(&childUnion, &overlap);
+        RegionValidate(&scratch->childUnion, &overlap);
 
         for (pChild = pParent->firstChild; pChild; pChild = pChild->nextSib) {
             if (pChild->viewable) {
@@ -426,9 +547,9 @@ miComputeClips(WindowPtr pParent,
                      * Figure out the new universe from the child's
                      * perspective and recurse.
                      */
-                    RegionIntersect(&childUniverse,
+                    RegionIntersect(&scratch->universe,
                                     universe, &pChild->borderSize);
-                    miComputeClips(pChild, pScreen, &childUniverse, kind,
+                    miComputeClips(pChild, pScreen, &scratch->universe, kind,
                                    exposed);
                 }
                 /*
@@ -441,9 +562,8 @@ miComputeClips(WindowPtr pParent,
             }
         }
         if (!overlap)
-            RegionSubtract(universe, universe, &childUnion);
-        RegionUninit(&childUnion);
-        RegionUninit(&childUniverse);
+            RegionSubtract(universe, universe, &scratch->childUnion);
+        miPutClipScratch(scratch);
     }                           /* if any children */
 
     /*
@@ -559,11 +679,11 @@ miValidateTree(WindowPtr pParent,       /* Parent to validate */
                                  * the marked children. pParent's clipList
                                  * merged with the borderClips of all
                                  * the marked children. */
-    RegionRec childClip;        /* The new borderClip for the current
-                                 * child */
-    RegionRec childUnion;       /* the space covered by borderSize for
-                                 * all marked children */
-    RegionRec exposed;          /* For intermediate calculations */
+    miClipScratchPtr scratch;   /* universe: the new borderClip for the
+                                 * current child; childUnion: the space
+                                 * covered by borderSize for all marked
+                                 * children; exposed: for intermediate
+                                 * calculations */
     ScreenPtr pScreen;
     WindowPtr pWin;
     Bool overlap;
@@ -574,8 +694,7 @@ miValidateTree(WindowPtr pParent,       /* Parent to validate */
     if (pChild == NullWindow)
         pChild = pParent->firstChild;
 
-    RegionNull(&childClip);
-    RegionNull(&exposed);
+    scratch = miGetClipScratch();
 
     /*
      * compute the area of the parent window occupied
@@ -653,35 +772,34 @@ miValidateTree(WindowPtr pParent,       /* Parent to validate */
              * lower than the cost of multiple Subtracts in the
              * loop below.
              */
-            RegionNull(&childUnion);
             if (forward) {
                 for (pWin = pChild; pWin; pWin = pWin->nextSib)
                     if (pWin->valdata && pWin->viewable &&
                         !TreatAsTransparent(pWin))
-                        RegionAppend(&childUnion, &pWin->borderSize);
+                        RegionAppend(&scratch->childUnion, &pWin->borderSize);
             }
             else {
                 pWin = pParent->lastChild;
                 while (1) {
                     if (pWin->valdata && pWin->viewable &&
                         !TreatAsTransparent(pWin))
-                        RegionAppend(&childUnion, &pWin->borderSize);
+                        RegionAppend(&scratch->childUnion, &pWin->borderSize);
                     if (pWin == pChild)
                         break;
                     pWin = pWin->prevSib;
                 }
             }
-            RegionValidate(&childUnion, &overlap);
-            if (overlap)
-                RegionUninit(&childUnion);
+            RegionValidate(&scratch->childUnion, &overlap);
         }
     }
 
     for (pWin = pChild; pWin != NullWindow; pWin = pWin->nextSib) {
         if (pWin->viewable) {
             if (pWin->valdata) {
-                RegionIntersect(&childClip, &totalClip, &pWin->borderSize);
-                miComputeClips(pWin, pScreen, &childClip, kind, &exposed);
+                RegionIntersect(&scratch->universe, &totalClip,
+                                &pWin->borderSize);
+                miComputeClips(pWin, pScreen, &scratch->universe, kind,
+                               &scratch->exposed);
                 if (overlap && !TreatAsTransparent(pWin)) {
                     RegionSubtract(&totalClip, &totalClip, &pWin->borderSize);
                 }
@@ -701,11 +819,9 @@ miValidateTree(WindowPtr pParent,       /* Parent to validate */
         }
     }
 
-    RegionUninit(&childClip);
-    if (!overlap) {
-        RegionSubtract(&totalClip, &totalClip, &childUnion);
-        RegionUninit(&childUnion);
-    }
+    if (!overlap)
+        RegionSubtract(&totalClip, &totalClip, &scratch->childUnion);
+    miPutClipScratch(scratch);
 
     if (pParent->valdata && pParent->valdata!=UnmapValData)
     {
@@ -737,7 +853,6 @@ miValidateTree(WindowPtr pParent,       /* Parent to validate */
     }
 
     RegionUninit(&totalClip);
-    RegionUninit(&exposed);
     if (pScreen->ClipNotify)
         (*pScreen->ClipNotify) (pParent, 0, 0);
     return 1;
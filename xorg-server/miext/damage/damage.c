@@ -121,6 +121,91 @@ getDrawableDamageRef(DrawablePtr pDrawable)
     DamagePtr	*pPrev = (DamagePtr *) \
 	dixLookupPrivateAddr(&(pWindow)->devPrivates, damageWinPrivateKey)
 
+/*
+ * Reduce a region to at most policy->maxRects rectangles.  If its
+ * bounding box covers no more than policy->maxOverhead percent more area
+ * than the region itself, the region becomes that box.  Otherwise runs of
+ * consecutive bands are merged into their bounding boxes.  Either way the
+ * result contains the original region, damage may grow but never shrink.
+ */
+static void
+damageSimplifyRegion(RegionPtr pRegion, const DamagePolicyRec *policy)
+{
+    int nbox = RegionNumRects(pRegion);
+    BoxPtr pbox = RegionRects(pRegion);
+    BoxRec extents = *RegionExtents(pRegion);
+    BoxPtr boxes;
+    int64_t area = 0, bounds;
+    int i, n, per, count;
+
+    if (policy->maxRects <= 0 || nbox <= policy->maxRects)
+        return;
+
+    for (i = 0; i < nbox; i++)
+        area += (int64_t) (pbox[i].x2 - pbox[i].x1) *
+            (pbox[i].y2 - pbox[i].y1);
+    bounds = (int64_t) (extents.x2 - extents.x1) * (extents.y2 - extents.y1);
+
+    if (policy->maxRects == 1 ||
+        (bounds - area) * 100 <= area * policy->maxOverhead ||
+        !(boxes = xallocarray(policy->maxRects, sizeof(BoxRec)))) {
+        RegionReset(pRegion, &extents);
+        return;
+    }
+
+    /*
+     * Every group but the last gets at least per rectangles, so there
+     * are no more than maxRects groups.  Groups end on band boundaries,
+     * which keeps their boxes from overlapping.
+     */
+    per = (nbox + policy->maxRects - 2) / (policy->maxRects - 1);
+    n = 0;
+    count = 0;
+    for (i = 0; i < nbox; i++) {
+        if (count >= per && pbox[i].y1 != pbox[i - 1].y1)
+            count = 0;
+        if (count++ == 0) {
+            boxes[n++] = pbox[i];
+        }
+        else {
+            BoxPtr group = &boxes[n - 1];
+
+            group->x1 = min(group->x1, pbox[i].x1);
+            group->x2 = max(group->x2, pbox[i].x2);
+            group->y2 = pbox[i].y2;
+        }
+    }
+
+    RegionUninit(pRegion);
+    if (!RegionInitBoxes(pRegion, boxes, n))
+        RegionReset(pRegion, &extents);
+    free(boxes);
+}
+
+/*
+ * Bring the accumulated damage back within the object's rectangle limit.
+ * Raw and delta reports hand out other regions, which are simplified on
+ * their own; their accumulated damage stays exact, as deltas are computed
+ * against it and an over-approximation would hide later changes.
+ */
+static void
+damageLimitAccumulated(DamagePtr pDamage)
+{
+    if (pDamage->damageLevel != DamageReportRawRegion &&
+        pDamage->damageLevel != DamageReportDeltaRegion)
+        damageSimplifyRegion(&pDamage->damage, &pDamage->policy);
+}
+
+/*
+ * Add a region to the accumulated damage.
+ */
+static void
+damageAccumulate(DamagePtr pDamage, RegionPtr pRegion)
+{
+    RegionUnion(&pDamage->damage, &pDamage->damage, pRegion);
+    damageLimitAccumulated(pDamage);
+}
+
 #if DAMAGE_DEBUG_ENABLE
 static void
 _damageRegionAppend(DrawablePtr pDrawable, RegionPtr pRegion, Bool clip,
@@ -265,7 +350,7 @@ damageRegionAppend(DrawablePtr pDrawable, RegionPtr pRegion, Bool clip,
             if (pDamage->damageReport)
                 DamageReportDamage(pDamage, pDamageRegion);
             else
-                RegionUnion(&pDamage->damage, &pDamage->damage, pDamageRegion);
+                damageAccumulate(pDamage, pDamageRegion);
         }
 
         /*
@@ -293,8 +378,7 @@ damageRegionProcessPending(DrawablePtr pDrawable)
             if (pDamage->damageReport)
                 DamageReportDamage(pDamage, &pDamage->pendingDamage);
             else
-                RegionUnion(&pDamage->damage, &pDamage->damage,
-                            &pDamage->pendingDamage);
+                damageAccumulate(pDamage, &pDamage->pendingDamage);
         }
 
         if (pDamage->reportAfter)
@@ -1987,21 +2071,32 @@ DamageReportDamage(DamagePtr pDamage, RegionPtr pDamageRegion)
 
     switch (pDamage->damageLevel) {
     case DamageReportRawRegion:
-        RegionUnion(&pDamage->damage, &pDamage->damage, pDamageRegion);
-        (*pDamage->damageReport) (pDamage, pDamageRegion, pDamage->closure);
+        damageAccumulate(pDamage, pDamageRegion);
+        if (pDamage->policy.maxRects > 0 &&
+            RegionNumRects(pDamageRegion) > pDamage->policy.maxRects) {
+            RegionNull(&tmpRegion);
+            RegionCopy(&tmpRegion, pDamageRegion);
+            damageSimplifyRegion(&tmpRegion, &pDamage->policy);
+            (*pDamage->damageReport) (pDamage, &tmpRegion, pDamage->closure);
+            RegionUninit(&tmpRegion);
+        }
+        else
+            (*pDamage->damageReport) (pDamage, pDamageRegion,
+                                      pDamage->closure);
         break;
     case DamageReportDeltaRegion:
         RegionNull(&tmpRegion);
         RegionSubtract(&tmpRegion, pDamageRegion, &pDamage->damage);
         if (RegionNotEmpty(&tmpRegion)) {
-            RegionUnion(&pDamage->damage, &pDamage->damage, pDamageRegion);
+            damageAccumulate(pDamage, pDamageRegion);
+            damageSimplifyRegion(&tmpRegion, &pDamage->policy);
             (*pDamage->damageReport) (pDamage, &tmpRegion, pDamage->closure);
         }
         RegionUninit(&tmpRegion);
         break;
     case DamageReportBoundingBox:
         tmpBox = *RegionExtents(&pDamage->damage);
-        RegionUnion(&pDamage->damage, &pDamage->damage, pDamageRegion);
+        damageAccumulate(pDamage, pDamageRegion);
         if (!BOX_SAME(&tmpBox, RegionExtents(&pDamage->damage))) {
             (*pDamage->damageReport) (pDamage, &pDamage->damage,
                                       pDamage->closure);
@@ -2009,14 +2104,29 @@ DamageReportDamage(DamagePtr pDamage, RegionPtr pDamageRegion)
         break;
     case DamageReportNonEmpty:
         was_empty = !RegionNotEmpty(&pDamage->damage);
-        RegionUnion(&pDamage->damage, &pDamage->damage, pDamageRegion);
+        damageAccumulate(pDamage, pDamageRegion);
         if (was_empty && RegionNotEmpty(&pDamage->damage)) {
             (*pDamage->damageReport) (pDamage, &pDamage->damage,
                                       pDamage->closure);
         }
         break;
     case DamageReportNone:
-        RegionUnion(&pDamage->damage, &pDamage->damage, pDamageRegion);
+        damageAccumulate(pDamage, pDamageRegion);
         break;
     }
 }
+
+/*
+ * Limit the reported damage to maxRects rectangles, merging them into
+ * their bounding box when that grows the area by at most maxOverhead
+ * percent.  A maxRects of 0 keeps the damage exact, which is what every
+ * Damage starts with; only callers that can live with damage covering
+ * more than what was drawn should set a limit.
+ */
+void
+DamageSetPolicy(DamagePtr pDamage, int maxRects, int maxOverhead)
+{
+    pDamage->policy.maxRects = maxRects;
+    pDamage->policy.maxOverhead = maxOverhead;
+    damageLimitAccumulated(pDamage);
+}
@@ -37,6 +37,11 @@ typedef enum _damageReportLevel {
     DamageReportNone
 } DamageReportLevel;
 
+typedef struct _damagePolicy {
+    int maxRects;               /* 0 for no limit */
+    int maxOverhead;            /* percent of extra area merging may add */
+} DamagePolicyRec;
+
 typedef void (*DamageReportFunc) (DamagePtr pDamage, RegionPtr pRegion,
                                   void *closure);
 typedef void (*DamageDestroyFunc) (DamagePtr pDamage, void *closure);
@@ -110,6 +115,9 @@ extern _X_EXPORT void
 extern _X_EXPORT void
  DamageSetReportAfterOp(DamagePtr pDamage, Bool reportAfter);
 
+extern _X_EXPORT void
+ DamageSetPolicy(DamagePtr pDamage, int maxRects, int maxOverhead);
+
 extern _X_EXPORT DamageScreenFuncsPtr DamageGetScreenFuncs(ScreenPtr);
 
 #endif                          /* _DAMAGE_H_ */
@@ -38,6 +38,7 @@ typedef struct _damage {
     RegionRec damage;
 
     DamageReportLevel damageLevel;
+    DamagePolicyRec policy;
     Bool isInternal;
     void *closure;
     Bool isWindow;
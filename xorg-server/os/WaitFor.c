@@ -94,26 +94,112 @@ SOFTWARE.
 #include <X11/extensions/dpmsconst.h>
 #endif
 
+/*
+ * Pending timers live in a binary min-heap ordered by expiry, so arming,
+ * cancelling and firing a timer are O(log n) however many are armed.
+ * Each slot carries a copy of its timer's sort key so sifting stays within
+ * the heap array.  Timers expiring in the same millisecond fire in the
+ * order they were set.  The heap has room for every allocated timer, so
+ * re-arming one never needs to allocate.
+ */
+
 struct _OsTimerRec {
-    struct xorg_list list;
+    int index;                  /* slot in timer_heap, or -1 if not pending */
     CARD32 expires;
     CARD32 delta;
     OsTimerCallback callback;
     void *arg;
 };
 
+typedef struct {
+    CARD32 expires;
+    CARD32 serial;
+    OsTimerPtr timer;
+} TimerSlot;
+
 static void DoTimer(OsTimerPtr timer, CARD32 now);
 static void DoTimers(CARD32 now);
 static void CheckAllTimers(void);
-static volatile struct xorg_list timers;
+static TimerSlot *timer_heap;
+static int timer_count;         /* pending timers */
+static int timer_size;          /* allocated timers */
+static CARD32 timer_serial;
+
+static inline Bool
+timer_before(const TimerSlot *a, const TimerSlot *b)
+{
+    if (a->expires != b->expires)
+        return (int) (a->expires - b->expires) < 0;
+    return (int) (a->serial - b->serial) < 0;
+}
+
+static inline void
+timer_heap_place(const TimerSlot *slot, int i)
+{
+    timer_heap[i] = *slot;
+    slot->timer->index = i;
+}
+
+static void
+timer_heap_up(TimerSlot slot, int i)
+{
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+
+        if (!timer_before(&slot, &timer_heap[parent]))
+            break;
+        timer_heap_place(&timer_heap[parent], i);
+        i = parent;
+    }
+    timer_heap_place(&slot, i);
+}
+
+static void
+timer_heap_down(TimerSlot slot, int i)
+{
+    for (;;) {
+        int child = 2 * i + 1;
+
+        if (child >= timer_count)
+            break;
+        if (child + 1 < timer_count &&
+            timer_before(&timer_heap[child + 1], &timer_heap[child]))
+            child++;
+        if (!timer_before(&timer_heap[child], &slot))
+            break;
+        timer_heap_place(&timer_heap[child], i);
+        i = child;
+    }
+    timer_heap_place(&slot, i);
+}
+
+static void
+timer_heap_insert(OsTimerPtr timer)
+{
+    TimerSlot slot = { timer->expires, timer_serial++, timer };
+
+    timer_heap_up(slot, timer_count++);
+}
+
+static void
+timer_heap_remove(OsTimerPtr timer)
+{
+    int i = timer->index;
+    TimerSlot last = timer_heap[--timer_count];
+
+    timer->index = -1;
+    if (last.timer == timer)
+        return;
+    if (i > 0 && timer_before(&last, &timer_heap[(i - 1) / 2]))
+        timer_heap_up(last, i);
+    else
+        timer_heap_down(last, i);
+}
 
 static inline OsTimerPtr
 first_timer(void)
 {
-    /* inline xorg_list_is_empty which can't handle volatile */
-    if (timers.next == &timers)
-        return NULL;
-    return xorg_list_first_entry(&timers, struct _OsTimerRec, list);
+    return timer_count ? timer_heap[0].timer : NULL;
 }
 
 /*
@@ -124,16 +210,24 @@ static int
 check_timers(void)
 {
     OsTimerPtr timer;
+    CARD32 now, delta;
+    int timeout;
 
-    if ((timer = first_timer()) != NULL) {
-        CARD32 now = GetTimeInMillis();
-        int timeout = timer->expires - now;
+    input_lock();
+    timer = first_timer();
+    if (timer) {
+        now = GetTimeInMillis();
+        timeout = timer->expires - now;
+        delta = timer->delta;
+    }
+    input_unlock();
 
+    if (timer != NULL) {
         if (timeout <= 0) {
             DoTimers(now);
         } else {
             /* Make sure the timeout is sane */
-            if (timeout < timer->delta + 250)
+            if (timeout < delta + 250)
                 return timeout;
 
             /* time has rewound.  reset the timers. */
@@ -328,22 +422,24 @@ AdjustWaitForDelay(void *waitTime, int newdelay)
 }
 
 static inline Bool timer_pending(OsTimerPtr timer) {
-    return !xorg_list_is_empty(&timer->list);
+    return timer->index >= 0;
 }
 
 /* If time has rewound, re-run every affected timer.
- * Timers might drop out of the list, so we have to restart every time. */
+ * Timers might move around the heap, so we have to restart every time. */
 static void
 CheckAllTimers(void)
 {
-    OsTimerPtr timer;
     CARD32 now;
+    int i;
 
     input_lock();
  start:
     now = GetTimeInMillis();
 
-    xorg_list_for_each_entry(timer, &timers, list) {
+    for (i = 0; i < timer_count; i++) {
+        OsTimerPtr timer = timer_heap[i].timer;
+
         if (timer->expires - now > timer->delta + 250) {
             DoTimer(timer, now);
             goto start;
@@ -357,7 +453,7 @@ DoTimer(OsTimerPtr timer, CARD32 now)
 {
     CARD32 newTime;
 
-    xorg_list_del(&timer->list);
+    timer_heap_remove(timer);
     newTime = (*timer->callback) (timer, now, timer->arg);
     if (newTime)
         TimerSet(timer, 0, newTime, timer->callback, timer->arg);
@@ -381,19 +477,33 @@ OsTimerPtr
 TimerSet(OsTimerPtr timer, int flags, CARD32 millis,
          OsTimerCallback func, void *arg)
 {
-    OsTimerPtr existing;
     CARD32 now = GetTimeInMillis();
 
     if (!timer) {
         timer = calloc(1, sizeof(struct _OsTimerRec));
         if (!timer)
             return NULL;
-        xorg_list_init(&timer->list);
+        timer->index = -1;
+        input_lock();
+        if (timer_size % 64 == 0) {
+            TimerSlot *heap;
+
+            heap = reallocarray(timer_heap, timer_size + 64,
+                                sizeof(TimerSlot));
+            if (!heap) {
+                input_unlock();
+                free(timer);
+                return NULL;
+            }
+            timer_heap = heap;
+        }
+        timer_size++;
+        input_unlock();
     }
     else {
         input_lock();
         if (timer_pending(timer)) {
-            xorg_list_del(&timer->list);
+            timer_heap_remove(timer);
             if (flags & TimerForceOld)
                 (void) (*timer->callback) (timer, now, timer->arg);
         }
@@ -413,12 +523,7 @@ TimerSet(OsTimerPtr timer, int flags, CARD32 millis,
     timer->arg = arg;
     input_lock();
 
-    /* Sort into list */
-    xorg_list_for_each_entry(existing, &timers, list)
-        if ((int) (existing->expires - millis) > 0)
-            break;
-    /* This even works at the end of the list -- existing->list will be timers */
-    xorg_list_append(&timer->list, &existing->list);
+    timer_heap_insert(timer);
 
     /* Check to see if the timer is ready to run now */
     if ((int) (millis - now) <= 0)
@@ -447,7 +552,8 @@ TimerCancel(OsTimerPtr timer)
     if (!timer)
         return;
     input_lock();
-    xorg_list_del(&timer->list);
+    if (timer_pending(timer))
+        timer_heap_remove(timer);
     input_unlock();
 }
 
@@ -457,6 +563,9 @@ TimerFree(OsTimerPtr timer)
     if (!timer)
         return;
     TimerCancel(timer);
+    input_lock();
+    timer_size--;
+    input_unlock();
     free(timer);
 }
 
@@ -469,18 +578,14 @@ TimerCheck(void)
 void
 TimerInit(void)
 {
-    static Bool been_here;
-    OsTimerPtr timer, tmp;
-
-    if (!been_here) {
-        been_here = TRUE;
-        xorg_list_init((struct xorg_list*) &timers);
-    }
+    input_lock();
+    while (timer_count) {
+        OsTimerPtr timer = timer_heap[--timer_count].timer;
 
-    xorg_list_for_each_entry_safe(timer, tmp, &timers, list) {
-        xorg_list_del(&timer->list);
+        timer_size--;
         free(timer);
     }
+    input_unlock();
 }
 
 #ifdef DPMSExtension
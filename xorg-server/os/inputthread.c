@@ -72,6 +72,7 @@ typedef struct {
     struct ospoll *fds;
     int readPipe;
     int writePipe;
+    int wakeupPending;          /* set while a byte sits in the pipe */
     Bool changed;
     Bool running;
 } InputThreadInfo;
@@ -155,6 +156,23 @@ InputThreadFillPipe(int writeHead)
  * @see WaitForSomething()
  * @see InputThreadFillPipe()
  */
+static int
+InputThreadReadPipe(int readHead);
+
+/**
+ * Wake up the main thread to process input, unless a wake-up is already
+ * pending.  Events are published to mieq without the pipe, so while the
+ * main thread is busy this costs a single atomic exchange instead of a
+ * write() for every batch of input.
+ */
+static void
+InputThreadWakeup(void)
+{
+    if (!__atomic_exchange_n(&inputThreadInfo->wakeupPending, TRUE,
+                             __ATOMIC_ACQ_REL))
+        InputThreadFillPipe(inputThreadInfo->writePipe);
+}
+
 static int
 InputThreadReadPipe(int readHead)
 {
@@ -377,7 +395,7 @@ InputThreadDoWork(void *arg)
 
         /* Kick main thread to process the generated input events and drain
          * events from hotplug pipe */
-        InputThreadFillPipe(inputThreadInfo->writePipe);
+        InputThreadWakeup();
     }
 
     ospoll_remove(inputThreadInfo->fds, hotplugPipeRead);
@@ -388,6 +406,8 @@ InputThreadDoWork(void *arg)
 static void
 InputThreadNotifyPipe(int fd, int mask, void *data)
 {
+    /* Clear before draining, so a wake-up racing with us is not lost */
+    __atomic_store_n(&inputThreadInfo->wakeupPending, FALSE, __ATOMIC_SEQ_CST);
     InputThreadReadPipe(fd);
 }
 
@@ -415,6 +435,7 @@ InputThreadPreInit(void)
         FatalError("input-thread: could not allocate memory");
 
     inputThreadInfo->changed = FALSE;
+    inputThreadInfo->wakeupPending = FALSE;
 
     inputThreadInfo->thread.p = 0;
     xorg_list_init(&inputThreadInfo->devs);
@@ -96,15 +96,17 @@ typedef struct _connectionOutput {
     unsigned char *buf;
     int size;
     int count;
+    int peak;                   /* largest count since allocation */
 } ConnectionOutput;
 
 static ConnectionInputPtr AllocateInputBuffer(void);
-static ConnectionOutputPtr AllocateOutputBuffer(void);
+static ConnectionOutputPtr AllocateOutputBuffer(long size);
+static ConnectionOutputPtr GrowOutputBuffer(ConnectionOutputPtr oco, long size);
+static void FreeOutputBuffer(ConnectionOutputPtr oco);
 
 static Bool CriticalOutputPending;
 static int timesThisConnection = 0;
 static ConnectionInputPtr FreeInputs = (ConnectionInputPtr) NULL;
-static ConnectionOutputPtr FreeOutputs = (ConnectionOutputPtr) NULL;
 static OsCommPtr AvailableInput = (OsCommPtr) NULL;
 
 #define get_req_len(req,cli) ((cli)->swapped ? \
@@ -119,6 +121,29 @@ static OsCommPtr AvailableInput = (OsCommPtr) NULL;
 #define BUFSIZE 16384
 #define BUFWATERMARK 32768
 
+/*
+ * Output buffers come in power-of-two sizes from BUFSIZE to 1M, and
+ * drained buffers are kept on a free list per size.  Clients get a buffer
+ * sized after how much output they recently left queued or had to flush
+ * because it did not fit: one that fell behind on large replies or keeps
+ * overflowing its buffer with events does not have to grow it step by step
+ * again, while clients that keep up stay at BUFSIZE.  Larger buffers are
+ * allocated to size and freed once drained.
+ *
+ * Writes of at least OUTPUT_DIRECT_SIZE bytes are not copied into the
+ * buffer first, but go to the socket together with it in a single writev;
+ * only what the socket does not take is queued.
+ */
+#define OUTPUT_MIN_SHIFT 14        /* BUFSIZE */
+#define OUTPUT_CLASSES 7
+#define OUTPUT_POOL_BYTES (256 * 1024)  /* kept per size, at least one */
+#define OUTPUT_LARGE_ROUND (64 * 1024)
+#define OUTPUT_MAX_HINT (1 << (OUTPUT_MIN_SHIFT + OUTPUT_CLASSES - 1))
+#define OUTPUT_DIRECT_SIZE BUFSIZE
+
+static ConnectionOutputPtr FreeOutputs[OUTPUT_CLASSES];
+static int FreeOutputCount[OUTPUT_CLASSES];
+
 /*
  *   A lot of the code in this file manipulates a ConnectionInputPtr:
  *
@@ -464,6 +489,36 @@ ReadRequestFromClient(ClientPtr client)
     return needed;
 }
 
+/*****************************************************************
+ * PeekNextRequestFromClient
+ *    Return the request following the current one if it is already
+ *    completely in the input buffer, without consuming it.  Returns
+ *    NULL if more data would have to be read, or if the next request
+ *    is a big request or is being ignored; the regular dispatch path
+ *    deals with those.
+ *
+ **********************/
+
+const void *
+PeekNextRequestFromClient(ClientPtr client)
+{
+    OsCommPtr oc = (OsCommPtr) client->osPrivate;
+    ConnectionInputPtr oci = oc->input;
+    const xReq *request;
+    unsigned int gotnow, needed;
+
+    if (!oci || oci->ignoreBytes > 0)
+        return NULL;
+    gotnow = oci->bufcnt + oci->buffer - oci->bufptr - oci->lenLastReq;
+    if (gotnow < sizeof(xReq))
+        return NULL;
+    request = (const xReq *) (oci->bufptr + oci->lenLastReq);
+    needed = get_req_len(request, client) << 2;
+    if (needed == 0 || gotnow < needed)
+        return NULL;
+    return request;
+}
+
 int
 ReadFdFromClient(ClientPtr client)
 {
@@ -737,10 +792,8 @@ WriteToClient(ClientPtr who, int count, const void *__buf)
 #endif
 
     if (!oco) {
-        if ((oco = FreeOutputs)) {
-            FreeOutputs = oco->next;
-        }
-        else if (!(oco = AllocateOutputBuffer())) {
+        if (!(oco = AllocateOutputBuffer(min(oc->output_hint,
+                                             OUTPUT_MAX_HINT)))) {
             AbortClient(who);
             MarkClientException(who);
             return -1;
@@ -790,7 +843,8 @@ WriteToClient(ClientPtr who, int count, const void *__buf)
         }
     }
 #endif
-    if (oco->count == 0 || oco->count + count + padBytes > oco->size) {
+    if (oco->count == 0 || count >= OUTPUT_DIRECT_SIZE ||
+        oco->count + count + padBytes > oco->size) {
         output_pending_clear(who);
         if (!any_output_pending()) {
             CriticalOutputPending = FALSE;
@@ -808,6 +862,8 @@ WriteToClient(ClientPtr who, int count, const void *__buf)
         memset(oco->buf + oco->count, '\0', padBytes);
         oco->count += padBytes;
     }
+    if (oco->count > oco->peak)
+        oco->peak = oco->count;
     return count;
 }
 
@@ -916,19 +972,21 @@ FlushClient(ClientPtr who, OsCommPtr oc, const void *__extraBuf, int extraCount)
             }
 
             if (notWritten > oco->size) {
-                unsigned char *obuf = NULL;
-
-                if (notWritten + BUFSIZE <= INT_MAX) {
-                    obuf = realloc(oco->buf, notWritten + BUFSIZE);
-                }
-                if (!obuf) {
+                ConnectionOutputPtr bigger = NULL;
+                long size = notWritten;
+
+                /* grow geometrically, as the backlog is copied over */
+                if (size < oco->size + oco->size / 2 && oco->size < INT_MAX / 2)
+                    size = oco->size + oco->size / 2;
+                if (size <= INT_MAX)
+                    bigger = GrowOutputBuffer(oco, size);
+                if (!bigger) {
                     AbortClient(who);
                     MarkClientException(who);
                     oco->count = 0;
                     return -1;
                 }
-                oco->size = notWritten + BUFSIZE;
-                oco->buf = obuf;
+                oc->output = oco = bigger;
             }
 
             /* If the amount written extended into the padBuffer, then the
@@ -938,6 +996,8 @@ FlushClient(ClientPtr who, OsCommPtr oc, const void *__extraBuf, int extraCount)
                         extraBuf + written, len);
 
             oco->count = notWritten;    /* this will include the pad */
+            if (oco->count > oco->peak)
+                oco->peak = oco->count;
             ospoll_listen(server_poll, oc->fd, X_NOTIFY_WRITE);
 
             /* return only the amount explicitly requested */
@@ -956,18 +1016,17 @@ FlushClient(ClientPtr who, OsCommPtr oc, const void *__extraBuf, int extraCount)
         }
     }
 
-    /* everything was flushed out */
+    /* everything was flushed out; if the buffer overflowed, count what it
+     * should have held */
+    if (oco->count && extraCount < OUTPUT_DIRECT_SIZE &&
+        written > oco->peak)
+        oco->peak = written;
     oco->count = 0;
     output_pending_clear(who);
 
-    if (oco->size > BUFWATERMARK) {
-        free(oco->buf);
-        free(oco);
-    }
-    else {
-        oco->next = FreeOutputs;
-        FreeOutputs = oco;
-    }
+    /* size the next buffer after the last few */
+    oc->output_hint += (oco->peak - oc->output_hint) / 4;
+    FreeOutputBuffer(oco);
     oc->output = (ConnectionOutputPtr) NULL;
     return extraCount;          /* return only the amount explicitly requested */
 }
@@ -993,24 +1052,105 @@ AllocateInputBuffer(void)
     return oci;
 }
 
+static int
+OutputBufferClass(long size)
+{
+    int class = 0;
+
+    while (class < OUTPUT_CLASSES && (1L << (OUTPUT_MIN_SHIFT + class)) < size)
+        class++;
+    return class;
+}
+
+static long
+OutputBufferLargeSize(long size)
+{
+    size = (size + OUTPUT_LARGE_ROUND - 1) & ~(long) (OUTPUT_LARGE_ROUND - 1);
+    return size > INT_MAX ? -1 : size;
+}
+
 static ConnectionOutputPtr
-AllocateOutputBuffer(void)
+AllocateOutputBuffer(long size)
 {
     ConnectionOutputPtr oco;
+    int class = OutputBufferClass(size);
+
+    if (class < OUTPUT_CLASSES) {
+        if ((oco = FreeOutputs[class])) {
+            FreeOutputs[class] = oco->next;
+            FreeOutputCount[class]--;
+            oco->count = 0;
+            oco->peak = 0;
+            return oco;
+        }
+        size = 1L << (OUTPUT_MIN_SHIFT + class);
+    }
+    else if ((size = OutputBufferLargeSize(size)) < 0)
+        return NULL;
 
     oco = malloc(sizeof(ConnectionOutput));
     if (!oco)
         return NULL;
-    oco->buf = calloc(1, BUFSIZE);
+    oco->buf = malloc(size);
     if (!oco->buf) {
         free(oco);
         return NULL;
     }
-    oco->size = BUFSIZE;
+    oco->size = size;
     oco->count = 0;
+    oco->peak = 0;
     return oco;
 }
 
+/*
+ * Return a buffer of at least size bytes holding the contents of oco,
+ * which is released, or NULL, leaving oco alone.
+ */
+static ConnectionOutputPtr
+GrowOutputBuffer(ConnectionOutputPtr oco, long size)
+{
+    ConnectionOutputPtr bigger;
+
+    /* buffers past the pooled sizes may be resized in place */
+    if (OutputBufferClass(oco->size) == OUTPUT_CLASSES) {
+        unsigned char *buf;
+
+        if ((size = OutputBufferLargeSize(size)) < 0 ||
+            !(buf = realloc(oco->buf, size)))
+            return NULL;
+        oco->buf = buf;
+        oco->size = size;
+        return oco;
+    }
+
+    if (!(bigger = AllocateOutputBuffer(size)))
+        return NULL;
+    memcpy(bigger->buf, oco->buf, oco->count);
+    bigger->count = oco->count;
+    bigger->peak = oco->peak;
+    FreeOutputBuffer(oco);
+    return bigger;
+}
+
+static void
+FreeOutputBuffer(ConnectionOutputPtr oco)
+{
+    int class = OutputBufferClass(oco->size);
+
+    if (class < OUTPUT_CLASSES &&
+        oco->size == 1L << (OUTPUT_MIN_SHIFT + class) &&
+        (!FreeOutputCount[class] ||
+         (FreeOutputCount[class] + 1) * oco->size <= OUTPUT_POOL_BYTES)) {
+        oco->next = FreeOutputs[class];
+        FreeOutputs[class] = oco;
+        FreeOutputCount[class]++;
+    }
+    else {
+        free(oco->buf);
+        free(oco);
+    }
+}
+
 void
 FreeOsBuffers(OsCommPtr oc)
 {
@@ -1033,17 +1173,8 @@ FreeOsBuffers(OsCommPtr oc)
             oci->ignoreBytes = 0;
         }
     }
-    if ((oco = oc->output)) {
-        if (FreeOutputs) {
-            free(oco->buf);
-            free(oco);
-        }
-        else {
-            FreeOutputs = oco;
-            oco->next = (ConnectionOutputPtr) NULL;
-            oco->count = 0;
-        }
-    }
+    if ((oco = oc->output))
+        FreeOutputBuffer(oco);
 }
 
 void
@@ -1051,15 +1182,19 @@ ResetOsBuffers(void)
 {
     ConnectionInputPtr oci;
     ConnectionOutputPtr oco;
+    int class;
 
     while ((oci = FreeInputs)) {
         FreeInputs = oci->next;
         free(oci->buffer);
         free(oci);
     }
-    while ((oco = FreeOutputs)) {
-        FreeOutputs = oco->next;
-        free(oco->buf);
-        free(oco);
+    for (class = 0; class < OUTPUT_CLASSES; class++) {
+        while ((oco = FreeOutputs[class])) {
+            FreeOutputs[class] = oco->next;
+            free(oco->buf);
+            free(oco);
+        }
+        FreeOutputCount[class] = 0;
     }
 }
@@ -119,6 +119,7 @@ typedef struct _osComm {
     CARD32 conn_time;           /* timestamp if not established, else 0  */
     struct _XtransConnInfo *trans_conn; /* transport connection object */
     int flags;
+    int output_hint;            /* output buffer size to start with */
 } OsCommRec, *OsCommPtr;
 
 #define OS_COMM_GRAB_IMPERVIOUS 1
@@ -151,9 +152,6 @@ extern WorkQueuePtr workQueue;
 /* in access.c */
 extern Bool ComputeLocalClient(ClientPtr client);
 
-/* in auth.c */
-extern void GenerateRandomData(int len, char *buf);
-
 /* in mitauth.c */
 extern XID MitCheckCookie(AuthCheckArgs);
 extern XID MitGenerateCookie(AuthGenCArgs);
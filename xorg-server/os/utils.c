@@ -477,7 +477,15 @@ GetTimeInMillis(void)
 CARD64
 GetTimeInMicros(void)
 {
-    return (CARD64) GetTickCount() * 1000;
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER count;
+
+    if (!freq.QuadPart && !QueryPerformanceFrequency(&freq))
+        freq.QuadPart = -1;
+    if (freq.QuadPart < 0 || !QueryPerformanceCounter(&count))
+        return (CARD64) GetTickCount() * 1000;
+    return (CARD64) (count.QuadPart / freq.QuadPart) * 1000000 +
+        (CARD64) (count.QuadPart % freq.QuadPart) * 1000000 / freq.QuadPart;
 }
 #else
 CARD32
@@ -562,7 +570,7 @@ UseMsg(void)
     ErrorF
         ("-deferglyphs [none|all|16] defer loading of [no|all|16-bit] glyphs\n");
     ErrorF("-f #                   bell base (0-100)\n");
-    ErrorF("-fakescreenfps #       fake screen default fps (1-600)\n");
+    ErrorF("-fakescreenfps #       fake screen default fps (1-600 or unthrottled)\n");
     ErrorF("-fp string             default font path\n");
     ErrorF("-help                  prints message with these options\n");
     ErrorF("+iglx                  Allow creating indirect GLX contexts (default)\n");
@@ -591,6 +599,9 @@ UseMsg(void)
     ErrorF("-r                     turns off auto-repeat\n");
     ErrorF("r                      turns on auto-repeat \n");
     ErrorF("-render [default|mono|gray|color] set render color alloc policy\n");
+    ErrorF("-renderbandsize #      min pixels for threaded render operations\n");
+    ErrorF("-renderthreads #       threads used for large render operations\n");
+    ErrorF("-renderglyphcache #    KB of rendered glyphs kept by fb\n");
     ErrorF("-retro                 start with classic stipple\n");
     ErrorF("-seat string           seat to run on\n");
     ErrorF("-t #                   default pointer threshold (pixels/t)\n");
@@ -818,9 +829,13 @@ ProcessCommandLine(int argc, char *argv[])
         }
         else if (strcmp(argv[i], "-fakescreenfps") == 0) {
             if (++i < argc) {
-                FakeScreenFps = (uint32_t) atoi(argv[i]);
-                if (FakeScreenFps < 1 || FakeScreenFps > 600)
-                    FatalError("fakescreenfps must be an integer in [1;600] range\n");
+                if (strcmp(argv[i], "unthrottled") == 0)
+                    FakeScreenUnthrottled = TRUE;
+                else {
+                    FakeScreenFps = (uint32_t) atoi(argv[i]);
+                    if (FakeScreenFps < 1 || FakeScreenFps > 600)
+                        FatalError("fakescreenfps must be an integer in [1;600] range or unthrottled\n");
+                }
             }
             else
                 UseMsg();
@@ -1057,6 +1072,24 @@ ProcessCommandLine(int argc, char *argv[])
             else
                 UseMsg();
         }
+        else if (strcmp(argv[i], "-renderthreads") == 0) {
+            if (++i < argc && atoi(argv[i]) > 0)
+                PictureRenderThreads = atoi(argv[i]);
+            else
+                UseMsg();
+        }
+        else if (strcmp(argv[i], "-renderbandsize") == 0) {
+            if (++i < argc && atoi(argv[i]) > 0)
+                PictureBandPixels = atoi(argv[i]);
+            else
+                UseMsg();
+        }
+        else if (strcmp(argv[i], "-renderglyphcache") == 0) {
+            if (++i < argc && atoi(argv[i]) > 0)
+                PictureGlyphCacheSize = atoi(argv[i]);
+            else
+                UseMsg();
+        }
         else if (strcmp(argv[i], "+extension") == 0) {
             if (++i < argc) {
                 if (!EnableDisableExtension(argv[i], TRUE))
@@ -154,6 +154,41 @@ present_can_window_flip(WindowPtr window)
     return screen_priv->can_window_flip(window);
 }
 
+Bool
+present_get_frame_stats(WindowPtr window, present_frame_stats_ptr stats)
+{
+    present_window_priv_ptr     window_priv = present_window_priv(window);
+
+    if (!window_priv)
+        return FALSE;
+
+    *stats = window_priv->frame_stats;
+    return TRUE;
+}
+
+void
+present_reset_frame_stats(WindowPtr window)
+{
+    present_window_priv_ptr     window_priv = present_window_priv(window);
+    present_frame_stats_ptr     stats;
+
+    if (!window_priv)
+        return;
+
+    stats = &window_priv->frame_stats;
+    if (stats->frames || stats->skipped)
+        LogMessageVerb(X_INFO, 3, "present: window 0x%08x: %" PRIu64
+                       " frames, %" PRIu64 " skipped, %" PRIu64 " missed, "
+                       "interval min %" PRIu64 " mean %" PRIu64 " max %" PRIu64
+                       " us\n", (unsigned int) window->drawable.id,
+                       stats->frames, stats->skipped, stats->missed,
+                       stats->min_interval,
+                       stats->frames > 1 ?
+                       stats->total_interval / (stats->frames - 1) : 0,
+                       stats->max_interval);
+    memset(stats, 0, sizeof(*stats));
+}
+
 uint64_t
 present_get_target_msc(uint64_t target_msc_arg,
                        uint64_t crtc_msc,
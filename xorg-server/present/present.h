@@ -162,6 +162,39 @@ present_register_complete_notify(present_complete_notify_proc proc);
 extern _X_EXPORT Bool
 present_can_window_flip(WindowPtr window);
 
+/*
+ * Statistics of the PresentPixmap requests completed for a window since a
+ * client last selected CompleteNotify events on it.  They are written to
+ * the log at verbosity 3 when they are reset and when the window is
+ * destroyed.
+ */
+typedef struct present_frame_stats {
+    uint64_t                            frames;         /* shown */
+    uint64_t                            skipped;
+    uint64_t                            missed;         /* shown after their target MSC */
+    uint64_t                            last_ust;
+    uint64_t                            last_msc;
+    /* microseconds between consecutive frames shown */
+    uint64_t                            min_interval;
+    uint64_t                            max_interval;
+    uint64_t                            total_interval;
+} present_frame_stats_rec, *present_frame_stats_ptr;
+
+extern _X_EXPORT Bool
+present_get_frame_stats(WindowPtr window, present_frame_stats_ptr stats);
+
+extern _X_EXPORT void
+present_reset_frame_stats(WindowPtr window);
+
+/*
+ * Set the refresh rate, in millihertz, of the vblanks emulated for
+ * windows without a CRTC on 'screen'.  0 completes every request
+ * immediately.
+ */
+extern _X_EXPORT void
+present_fake_set_refresh(ScreenPtr screen, uint32_t refresh);
+
 extern _X_EXPORT uint32_t FakeScreenFps;
+extern _X_EXPORT Bool FakeScreenUnthrottled;
 
 #endif /* _PRESENT_H_ */
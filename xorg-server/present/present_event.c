@@ -224,6 +224,8 @@ present_select_input(ClientPtr client, XID eid, WindowPtr window, CARD32 mask)
         if (event->window != window || event->client != client)
             return BadMatch;
 
+        if (mask & ~event->mask & PresentCompleteNotifyMask)
+            present_reset_frame_stats(window);
         if (mask)
             event->mask = mask;
         else
@@ -254,6 +256,10 @@ present_select_input(ClientPtr client, XID eid, WindowPtr window, CARD32 mask)
     event->next = window_priv->events;
     window_priv->events = event;
 
+    /* Frame statistics cover the frames since the last selection */
+    if (mask & PresentCompleteNotifyMask)
+        present_reset_frame_stats(window);
+
     if (!AddResource(event->id, present_event_type, (void *) event))
         return BadAlloc;
 
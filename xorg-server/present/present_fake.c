@@ -27,32 +27,147 @@
 #include "present_priv.h"
 #include "list.h"
 
+#ifdef HAVE_TIMERFD_CREATE
+#include <errno.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#endif
+
+/*
+ * Vblanks are emulated for screens and windows without a CRTC.  The
+ * refresh rate is kept in millihertz, and vblank n of a screen happens
+ * at fake_ust plus (n - fake_msc) refresh periods, computed in
+ * microseconds; events report that time rather than the time they were
+ * delivered, so clients see exact, drift free timestamps.
+ *
+ * Pending vblanks of all screens are kept in one list sorted by time.
+ * Where timerfd is available it wakes the server when the first one is
+ * due, with microsecond resolution, otherwise a millisecond OsTimer is
+ * rounded up so that it never fires early.
+ *
+ * A refresh rate of 0 is unthrottled: waiting for any future vblank
+ * completes immediately, and the MSC jumps to the one waited for.
+ */
+
 static struct xorg_list fake_vblank_queue;
+static OsTimerPtr fake_vblank_timer;
+#ifdef HAVE_TIMERFD_CREATE
+static int fake_vblank_fd = -1;
+#endif
 
 typedef struct present_fake_vblank {
     struct xorg_list            list;
     uint64_t                    event_id;
-    OsTimerPtr                  timer;
+    uint64_t                    ust;
+    uint64_t                    msc;
     ScreenPtr                   screen;
 } present_fake_vblank_rec, *present_fake_vblank_ptr;
 
+/*
+ * Time of a vblank at or after the screen's reference vblank.  Rounded
+ * up, so that converting the result back yields msc again.  Whole
+ * multiples of the refresh rate are split off to keep the arithmetic
+ * within 64 bits for any uptime.
+ */
+static uint64_t
+present_fake_msc_to_ust(present_screen_priv_ptr screen_priv, uint64_t msc)
+{
+    uint64_t    refresh = screen_priv->fake_refresh;
+    uint64_t    frames = msc - screen_priv->fake_msc;
+
+    return screen_priv->fake_ust + frames / refresh * 1000000000 +
+        (frames % refresh * 1000000000 + refresh - 1) / refresh;
+}
+
+/* Number of the last vblank at or before ust */
+static uint64_t
+present_fake_ust_to_msc(present_screen_priv_ptr screen_priv, uint64_t ust)
+{
+    uint64_t    refresh = screen_priv->fake_refresh;
+    uint64_t    elapsed = ust - screen_priv->fake_ust;
+
+    return screen_priv->fake_msc +
+        (elapsed / 1000000 * refresh +
+         elapsed % 1000000 * refresh / 1000000) / 1000;
+}
+
+static CARD32
+present_fake_do_timer(OsTimerPtr timer, CARD32 time, void *arg);
+
 int
 present_fake_get_ust_msc(ScreenPtr screen, uint64_t *ust, uint64_t *msc)
 {
     present_screen_priv_ptr screen_priv = present_screen_priv(screen);
+    uint64_t                now = GetTimeInMicros();
+
+    if (!screen_priv->fake_refresh) {
+        *ust = now;
+        *msc = screen_priv->fake_msc;
+        return Success;
+    }
 
-    *ust = GetTimeInMicros();
-    *msc = (*ust + screen_priv->fake_interval / 2) / screen_priv->fake_interval;
+    /* The last vblank, like hardware reports */
+    *msc = present_fake_ust_to_msc(screen_priv, now);
+    *ust = present_fake_msc_to_ust(screen_priv, *msc);
     return Success;
 }
 
 static void
-present_fake_notify(ScreenPtr screen, uint64_t event_id)
+present_fake_arm(void)
 {
-    uint64_t                    ust, msc;
+    present_fake_vblank_ptr     first;
+    uint64_t                    now;
+    int64_t                     delay;
 
-    present_fake_get_ust_msc(screen, &ust, &msc);
-    present_event_notify(event_id, ust, msc);
+    if (xorg_list_is_empty(&fake_vblank_queue)) {
+        if (fake_vblank_timer)
+            TimerCancel(fake_vblank_timer);
+        return;
+    }
+
+    first = xorg_list_first_entry(&fake_vblank_queue,
+                                  present_fake_vblank_rec, list);
+    now = GetTimeInMicros();
+    delay = first->ust > now ? first->ust - now : 1;
+
+#ifdef HAVE_TIMERFD_CREATE
+    if (fake_vblank_fd >= 0) {
+        struct itimerspec spec = {
+            .it_value.tv_sec = delay / 1000000,
+            .it_value.tv_nsec = delay % 1000000 * 1000,
+        };
+
+        if (timerfd_settime(fake_vblank_fd, 0, &spec, NULL) == 0)
+            return;
+    }
+#endif
+
+    fake_vblank_timer = TimerSet(fake_vblank_timer, 0, (delay + 999) / 1000,
+                                 present_fake_do_timer, NULL);
+}
+
+/* Deliver every vblank which is due, and wait for the next one */
+static void
+present_fake_dispatch(void)
+{
+    uint64_t                    now = GetTimeInMicros();
+
+    while (!xorg_list_is_empty(&fake_vblank_queue)) {
+        present_fake_vblank_ptr fake_vblank =
+            xorg_list_first_entry(&fake_vblank_queue,
+                                  present_fake_vblank_rec, list);
+        uint64_t                event_id = fake_vblank->event_id;
+        uint64_t                ust = fake_vblank->ust;
+        uint64_t                msc = fake_vblank->msc;
+
+        if (ust > now)
+            break;
+
+        xorg_list_del(&fake_vblank->list);
+        free(fake_vblank);
+        present_event_notify(event_id, ust, msc);
+    }
+    present_fake_arm();
 }
 
 static CARD32
@@ -60,15 +175,36 @@ present_fake_do_timer(OsTimerPtr timer,
                       CARD32 time,
                       void *arg)
 {
-    present_fake_vblank_ptr     fake_vblank = arg;
-
-    present_fake_notify(fake_vblank->screen, fake_vblank->event_id);
-    xorg_list_del(&fake_vblank->list);
-    TimerFree(fake_vblank->timer);
-    free(fake_vblank);
+    present_fake_dispatch();
     return 0;
 }
 
+#ifdef HAVE_TIMERFD_CREATE
+static void
+present_fake_timerfd_notify(int fd, int ready, void *data)
+{
+    uint64_t                    expirations;
+
+    if (read(fd, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN)
+        return;
+    present_fake_dispatch();
+}
+#endif
+
+static void
+present_fake_insert(present_fake_vblank_ptr fake_vblank)
+{
+    present_fake_vblank_ptr     pos;
+
+    xorg_list_for_each_entry(pos, &fake_vblank_queue, list) {
+        if (pos->ust > fake_vblank->ust) {
+            xorg_list_append(&fake_vblank->list, &pos->list);
+            return;
+        }
+    }
+    xorg_list_append(&fake_vblank->list, &fake_vblank_queue);
+}
+
 void
 present_fake_abort_vblank(ScreenPtr screen, uint64_t event_id, uint64_t msc)
 {
@@ -76,7 +212,6 @@ present_fake_abort_vblank(ScreenPtr screen, uint64_t event_id, uint64_t msc)
 
     xorg_list_for_each_entry_safe(fake_vblank, tmp, &fake_vblank_queue, list) {
         if (fake_vblank->event_id == event_id) {
-            TimerFree(fake_vblank->timer); /* TimerFree will call TimerCancel() */
             xorg_list_del(&fake_vblank->list);
             free (fake_vblank);
             break;
@@ -90,13 +225,20 @@ present_fake_queue_vblank(ScreenPtr     screen,
                           uint64_t      msc)
 {
     present_screen_priv_ptr     screen_priv = present_screen_priv(screen);
-    uint64_t                    ust = msc * screen_priv->fake_interval;
-    uint64_t                    now = GetTimeInMicros();
-    INT32                       delay = ((int64_t) (ust - now)) / 1000;
     present_fake_vblank_ptr     fake_vblank;
+    uint64_t                    ust, now_msc;
+
+    present_fake_get_ust_msc(screen, &ust, &now_msc);
+
+    if (!screen_priv->fake_refresh) {
+        if (msc > screen_priv->fake_msc)
+            screen_priv->fake_msc = msc;
+        present_event_notify(event_id, ust, screen_priv->fake_msc);
+        return Success;
+    }
 
-    if (delay <= 0) {
-        present_fake_notify(screen, event_id);
+    if (msc <= now_msc) {
+        present_event_notify(event_id, ust, now_msc);
         return Success;
     }
 
@@ -106,18 +248,69 @@ present_fake_queue_vblank(ScreenPtr     screen,
 
     fake_vblank->screen = screen;
     fake_vblank->event_id = event_id;
-    fake_vblank->timer = TimerSet(NULL, 0, delay, present_fake_do_timer, fake_vblank);
-    if (!fake_vblank->timer) {
-        free(fake_vblank);
-        return BadAlloc;
-    }
+    fake_vblank->msc = msc;
+    fake_vblank->ust = present_fake_msc_to_ust(screen_priv, msc);
 
-    xorg_list_add(&fake_vblank->list, &fake_vblank_queue);
+    present_fake_insert(fake_vblank);
+    present_fake_arm();
 
     return Success;
 }
 
+/*
+ * Change the emulated refresh rate of a screen, in millihertz, or make it
+ * unthrottled with 0.  The MSC carries on from the current value, and
+ * vblanks already waited for are rescheduled at the new rate.
+ */
+void
+present_fake_set_refresh(ScreenPtr screen, uint32_t refresh)
+{
+    present_screen_priv_ptr     screen_priv;
+    present_fake_vblank_ptr     fake_vblank, tmp;
+    struct xorg_list            requeue;
+    uint64_t                    ust, msc;
+
+    if (!dixPrivateKeyRegistered(&present_screen_private_key))
+        return;
+
+    screen_priv = present_screen_priv(screen);
+    if (!screen_priv || screen_priv->fake_refresh == refresh)
+        return;
+
+    present_fake_get_ust_msc(screen, &ust, &msc);
+    screen_priv->fake_refresh = refresh;
+    screen_priv->fake_ust = ust;
+    screen_priv->fake_msc = msc;
+
+    xorg_list_init(&requeue);
+    xorg_list_for_each_entry_safe(fake_vblank, tmp, &fake_vblank_queue, list) {
+        if (fake_vblank->screen == screen) {
+            xorg_list_del(&fake_vblank->list);
+            xorg_list_append(&fake_vblank->list, &requeue);
+        }
+    }
+
+    xorg_list_for_each_entry_safe(fake_vblank, tmp, &requeue, list) {
+        xorg_list_del(&fake_vblank->list);
+        if (refresh) {
+            fake_vblank->ust = present_fake_msc_to_ust(screen_priv,
+                                                       fake_vblank->msc);
+            present_fake_insert(fake_vblank);
+        }
+        else {
+            uint64_t    event_id = fake_vblank->event_id;
+
+            if (fake_vblank->msc > screen_priv->fake_msc)
+                screen_priv->fake_msc = fake_vblank->msc;
+            free(fake_vblank);
+            present_event_notify(event_id, ust, screen_priv->fake_msc);
+        }
+    }
+    present_fake_arm();
+}
+
 uint32_t FakeScreenFps = 0;
+Bool FakeScreenUnthrottled = FALSE;
 
 void
 present_fake_screen_init(ScreenPtr screen)
@@ -125,7 +318,9 @@ present_fake_screen_init(ScreenPtr screen)
     uint32_t                fake_fps;
     present_screen_priv_ptr screen_priv = present_screen_priv(screen);
 
-    if (FakeScreenFps)
+    if (FakeScreenUnthrottled)
+        fake_fps = 0;
+    else if (FakeScreenFps)
         fake_fps = FakeScreenFps;
     else {
         /* For screens with hardware vblank support, the fake code
@@ -139,11 +334,25 @@ present_fake_screen_init(ScreenPtr screen)
         else
             fake_fps = 60;
     }
-    screen_priv->fake_interval = 1000000 / fake_fps;
+    screen_priv->fake_refresh = fake_fps * 1000;
+    screen_priv->fake_ust = 0;
+    screen_priv->fake_msc = 0;
 }
 
 void
 present_fake_queue_init(void)
 {
     xorg_list_init(&fake_vblank_queue);
+
+#ifdef HAVE_TIMERFD_CREATE
+    if (fake_vblank_fd < 0)
+        fake_vblank_fd = timerfd_create(CLOCK_MONOTONIC,
+                                        TFD_NONBLOCK | TFD_CLOEXEC);
+    if (fake_vblank_fd >= 0 &&
+        !SetNotifyFd(fake_vblank_fd, present_fake_timerfd_notify,
+                     X_NOTIFY_READ, NULL)) {
+        close(fake_vblank_fd);
+        fake_vblank_fd = -1;
+    }
+#endif
 }
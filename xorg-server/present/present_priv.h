@@ -150,7 +150,10 @@ struct present_screen_priv {
     present_vblank_ptr          flip_pending;
     uint64_t                    unflip_event_id;
 
-    uint32_t                    fake_interval;
+    /* Emulated vblanks, see present_fake.c */
+    uint32_t                    fake_refresh;   /* mHz, 0 when unthrottled */
+    uint64_t                    fake_ust;       /* time of vblank fake_msc */
+    uint64_t                    fake_msc;
 
     /* Currently active flipped pixmap and fence */
     RRCrtcPtr                   flip_crtc;
@@ -217,6 +220,7 @@ struct present_window_priv {
     uint64_t               msc;         /* Last reported MSC from the current crtc */
     struct xorg_list       vblank;
     struct xorg_list       notifies;
+    present_frame_stats_rec frame_stats;
 };
 
 #define PresentCrtcNeverSet     ((RRCrtcPtr) 1)
@@ -98,6 +98,7 @@ present_destroy_window(WindowPtr window)
     present_window_priv_ptr window_priv = present_window_priv(window);
 
     if (window_priv) {
+        present_reset_frame_stats(window);
         present_clear_window_notifies(window);
         present_free_events(window);
         present_free_window_vblank(window);
@@ -26,11 +26,44 @@
 
 #include "present_priv.h"
 
+static void
+present_vblank_frame_stats(present_vblank_ptr vblank, CARD8 mode, uint64_t ust, uint64_t crtc_msc)
+{
+    present_window_priv_ptr window_priv = present_window_priv(vblank->window);
+    present_frame_stats_ptr stats;
+
+    if (!window_priv)
+        return;
+
+    stats = &window_priv->frame_stats;
+    if (mode == PresentCompleteModeSkip) {
+        stats->skipped++;
+        return;
+    }
+
+    if (crtc_msc > vblank->target_msc)
+        stats->missed++;
+    if (stats->frames && ust >= stats->last_ust) {
+        uint64_t interval = ust - stats->last_ust;
+
+        if (stats->frames == 1 || interval < stats->min_interval)
+            stats->min_interval = interval;
+        if (interval > stats->max_interval)
+            stats->max_interval = interval;
+        stats->total_interval += interval;
+    }
+    stats->frames++;
+    stats->last_ust = ust;
+    stats->last_msc = crtc_msc - vblank->msc_offset;
+}
+
 void
 present_vblank_notify(present_vblank_ptr vblank, CARD8 kind, CARD8 mode, uint64_t ust, uint64_t crtc_msc)
 {
     int n;
 
+    if (vblank->window && kind == PresentCompleteKindPixmap)
+        present_vblank_frame_stats(vblank, mode, ust, crtc_msc);
     if (vblank->window)
         present_send_complete_notify(vblank->window, kind, mode, vblank->serial, ust, crtc_msc - vblank->msc_offset);
     for (n = 0; n < vblank->num_notifies; n++) {
@@ -49,6 +49,14 @@ and Jim Haggerty of Metheus.
 #include <stdio.h>
 #include <assert.h>
 
+#ifdef XTRANS_SEND_FDS
+#define RECORD_RING
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "busfault.h"
+#endif
+
 #ifdef PANORAMIX
 #include "globals.h"
 #include "panoramiX.h"
@@ -65,6 +73,10 @@ static RESTYPE RTContext;       /* internal resource type for Record contexts */
  */
 #define REPLY_BUF_SIZE 1024
 
+/* Limits on the data size of a shared memory ring */
+#define RING_MIN_SIZE (4 << 10)
+#define RING_MAX_SIZE (1 << 30)
+
 /* Record Context structure */
 
 typedef struct {
@@ -78,6 +90,14 @@ typedef struct {
     int numBufBytes;            /* number of bytes in replyBuffer */
     char replyBuffer[REPLY_BUF_SIZE];   /* buffered recorded protocol */
     int inFlush;                /*  are we inside RecordFlushReplyBuffer */
+#ifdef RECORD_RING
+    xRecordRingHeader *pRing;   /* shared ring enabled with EnableContextFd */
+    struct busfault *busfault;
+    CARD32 ringSize;            /* bytes of ring data */
+    CARD32 ringHead;            /* bytes written, including unpublished */
+    CARD32 ringReply;           /* where the reply being built starts */
+    Bool ringDropping;          /* dropping the rest of an element */
+#endif
 } RecordContextRec, *RecordContextPtr;
 
 /*  RecordMinorOpRec - to hold minor opcode selections for extension requests
@@ -213,6 +233,113 @@ RecordFindContextOnAllContexts(RecordContextPtr pContext)
 
 /***************************************************************************/
 
+#ifdef RECORD_RING
+
+/* Shared memory rings
+ *
+ * A context enabled with EnableContextFd builds its replies directly in
+ * the ring instead of in replyBuffer.  Only the 32 byte reply header is
+ * kept in replyBuffer, since its length grows as elements are added; it is
+ * copied to the space reserved for it when the reply is flushed, and the
+ * new head is then published to the client.  Each protocol element
+ * reserves all the space it needs when it starts and is dropped, whole,
+ * if the client has not consumed enough of the ring.
+ */
+
+/* Copy len bytes into the ring at position pos, wrapping around its end */
+static void
+RecordRingCopy(RecordContextPtr pContext, CARD32 pos, const void *data,
+               int len)
+{
+    char *base = (char *) pContext->pRing + sz_xRecordRingHeader;
+    CARD32 offset = pos & (pContext->ringSize - 1);
+    int first = min(len, pContext->ringSize - offset);
+
+    memcpy(base + offset, data, first);
+    if (len > first)
+        memcpy(base, (const char *) data + first, len - first);
+}
+
+static void
+RecordRingWrite(RecordContextPtr pContext, const void *data, int len)
+{
+    if (len) {
+        RecordRingCopy(pContext, pContext->ringHead, data, len);
+        pContext->ringHead += len;
+    }
+}
+
+/* Returns TRUE if there is room for len more bytes in the ring, else
+ * counts an element of len bytes as dropped.
+ */
+static Bool
+RecordRingReserve(RecordContextPtr pContext, int len)
+{
+    xRecordRingHeader *pRing = pContext->pRing;
+    CARD32 tail = __atomic_load_n(&pRing->tail, __ATOMIC_ACQUIRE);
+    CARD32 used = pContext->ringHead - tail;
+
+    /* a tail ahead of the head is a client bug; treat the ring as full */
+    if (used <= pContext->ringSize && pContext->ringSize - used >= len)
+        return TRUE;
+
+    pRing->dropped++;
+    pRing->droppedBytes += len;
+    return FALSE;
+}
+
+/* Send an empty reply over the connection to tell the recording client
+ * about the ring.
+ */
+static void
+RecordRingNotify(RecordContextPtr pContext, int category)
+{
+    ClientPtr client = pContext->pRecordingClient;
+    xRecordEnableContextReply rep = {
+        .type = X_Reply,
+        .category = category,
+        .sequenceNumber = client->sequence,
+        .length = 0,
+        .elementHeader = pContext->elemHeaders,
+        .serverTime = GetTimeInMillis()
+    };
+
+    if (client->swapped) {
+        swaps(&rep.sequenceNumber);
+        swapl(&rep.serverTime);
+    }
+    WriteToClient(client, sizeof(rep), &rep);
+}
+
+static void
+RecordRingFlush(RecordContextPtr pContext)
+{
+    xRecordRingHeader *pRing = pContext->pRing;
+
+    if (!pContext->numBufBytes)
+        return;
+
+    RecordRingCopy(pContext, pContext->ringReply, pContext->replyBuffer,
+                   SIZEOF(xRecordEnableContextReply));
+    pContext->numBufBytes = 0;
+
+    __atomic_store_n(&pRing->head, pContext->ringHead, __ATOMIC_SEQ_CST);
+    if (__atomic_exchange_n(&pRing->waiting, 0, __ATOMIC_SEQ_CST))
+        RecordRingNotify(pContext, XRecordRingData);
+}
+
+static void
+RecordRingUnmap(RecordContextPtr pContext)
+{
+    if (pContext->busfault)
+        busfault_unregister(pContext->busfault);
+    munmap(pContext->pRing, sz_xRecordRingHeader + pContext->ringSize);
+    pContext->pRing = NULL;
+    pContext->busfault = NULL;
+}
+
+#endif                          /* RECORD_RING */
+
 /* RecordFlushReplyBuffer
  *
  * Arguments:
@@ -237,6 +364,17 @@ RecordFlushReplyBuffer(RecordContextPtr pContext,
         pContext->inFlush)
         return;
     ++pContext->inFlush;
+#ifdef RECORD_RING
+    if (pContext->pRing) {
+        /* elements never bypass the buffer of a ring, see
+         * RecordAProtocolElement
+         */
+        assert(!len1 && !len2);
+        RecordRingFlush(pContext);
+        --pContext->inFlush;
+        return;
+    }
+#endif
     if (pContext->numBufBytes)
         WriteToClient(pContext->pRecordingClient, pContext->numBufBytes,
                       pContext->replyBuffer);
@@ -274,7 +412,9 @@ RecordFlushReplyBuffer(RecordContextPtr pContext,
  *	is continuation data (futurelen == -1), element headers won't
  *	be added.  If the protocol element and headers won't fit in
  *	the context's buffer, it is sent directly to the recording
- *	client (after any buffered data).
+ *	client (after any buffered data).  For a context reporting into a
+ *	shared ring, the element is written into the ring, or dropped if
+ *	it does not fit.
  */
 static void
 RecordAProtocolElement(RecordContextPtr pContext, ClientPtr pClient,
@@ -287,6 +427,12 @@ RecordAProtocolElement(RecordContextPtr pContext, ClientPtr pClient,
     CARD32 serverTime = 0;
     Bool gotServerTime = FALSE;
     int replylen;
+    static char padBuffer[3];   /* as in FlushClient */
+
+#ifdef RECORD_RING
+    if (futurelen < 0 && pContext->pRing && pContext->ringDropping)
+        return;
+#endif
 
     if (futurelen >= 0) {       /* start of new protocol element */
         xRecordEnableContextReply *pRep = (xRecordEnableContextReply *)
@@ -299,9 +445,44 @@ RecordAProtocolElement(RecordContextPtr pContext, ClientPtr pClient,
             pContext->bufCategory = category;
         }
 
-        if (!pContext->numBufBytes) {
+        /* generate element headers if needed */
+
+        if (((pContext->elemHeaders & XRecordFromClientTime)
+             && category == XRecordFromClient)
+            || ((pContext->elemHeaders & XRecordFromServerTime)
+                && category == XRecordFromServer)) {
             serverTime = GetTimeInMillis();
             gotServerTime = TRUE;
+            elemHeaderData[numElemHeaders] = serverTime;
+            if (recordingClientSwapped)
+                swapl(&elemHeaderData[numElemHeaders]);
+            numElemHeaders++;
+        }
+
+        if ((pContext->elemHeaders & XRecordFromClientSequence)
+            && (category == XRecordFromClient || category == XRecordClientDied)) {
+            elemHeaderData[numElemHeaders] = pClient->sequence;
+            if (recordingClientSwapped)
+                swapl(&elemHeaderData[numElemHeaders]);
+            numElemHeaders++;
+        }
+
+#ifdef RECORD_RING
+        if (pContext->pRing) {
+            int len = numElemHeaders * 4 + datalen +
+                pad_to_int32(futurelen);
+
+            if (!pContext->numBufBytes)
+                len += SIZEOF(xRecordEnableContextReply);
+            pContext->ringDropping = !RecordRingReserve(pContext, len);
+            if (pContext->ringDropping)
+                return;
+        }
+#endif
+
+        if (!pContext->numBufBytes) {
+            if (!gotServerTime)
+                serverTime = GetTimeInMillis();
             pRep->type = X_Reply;
             pRep->category = category;
             pRep->sequenceNumber = pContext->pRecordingClient->sequence;
@@ -330,29 +511,13 @@ RecordAProtocolElement(RecordContextPtr pContext, ClientPtr pClient,
                 swapl(&pRep->recordedSequenceNumber);
             }
             pContext->numBufBytes = SIZEOF(xRecordEnableContextReply);
-        }
-
-        /* generate element headers if needed */
-
-        if (((pContext->elemHeaders & XRecordFromClientTime)
-             && category == XRecordFromClient)
-            || ((pContext->elemHeaders & XRecordFromServerTime)
-                && category == XRecordFromServer)) {
-            if (gotServerTime)
-                elemHeaderData[numElemHeaders] = serverTime;
-            else
-                elemHeaderData[numElemHeaders] = GetTimeInMillis();
-            if (recordingClientSwapped)
-                swapl(&elemHeaderData[numElemHeaders]);
-            numElemHeaders++;
-        }
-
-        if ((pContext->elemHeaders & XRecordFromClientSequence)
-            && (category == XRecordFromClient || category == XRecordClientDied)) {
-            elemHeaderData[numElemHeaders] = pClient->sequence;
-            if (recordingClientSwapped)
-                swapl(&elemHeaderData[numElemHeaders]);
-            numElemHeaders++;
+#ifdef RECORD_RING
+            if (pContext->pRing) {
+                /* the header is copied in when the reply is flushed */
+                pContext->ringReply = pContext->ringHead;
+                pContext->ringHead += SIZEOF(xRecordEnableContextReply);
+            }
+#endif
         }
 
         /* adjust reply length */
@@ -369,17 +534,28 @@ RecordAProtocolElement(RecordContextPtr pContext, ClientPtr pClient,
 
     numElemHeaders *= 4;
 
-    /* if space available >= space needed, buffer the data */
+#ifdef RECORD_RING
+    if (pContext->pRing) {
+        RecordRingWrite(pContext, elemHeaderData, numElemHeaders);
+        RecordRingWrite(pContext, data, datalen - padlen);
+        RecordRingWrite(pContext, padBuffer, padlen);
+        return;
+    }
+#endif
+
+    /* if space available >= space needed, buffer the data.  Continuation
+     * data finding the buffer empty means the start of the element was
+     * written directly, so the rest must be too.
+     */
 
-    if (REPLY_BUF_SIZE - pContext->numBufBytes >= datalen + numElemHeaders) {
+    if (REPLY_BUF_SIZE - pContext->numBufBytes >= datalen + numElemHeaders &&
+        (futurelen >= 0 || pContext->numBufBytes)) {
         if (numElemHeaders) {
             memcpy(pContext->replyBuffer + pContext->numBufBytes,
                    elemHeaderData, numElemHeaders);
             pContext->numBufBytes += numElemHeaders;
         }
         if (datalen) {
-            static char padBuffer[3];   /* as in FlushClient */
-
             memcpy(pContext->replyBuffer + pContext->numBufBytes,
                    data, datalen - padlen);
             pContext->numBufBytes += datalen - padlen;
@@ -1866,6 +2042,11 @@ ProcRecordCreateContext(ClientPtr client)
     pContext->pBufClient = NULL;
     pContext->continuedReply = 0;
     pContext->inFlush = 0;
+#ifdef RECORD_RING
+    pContext->pRing = NULL;
+    pContext->busfault = NULL;
+    pContext->ringDropping = FALSE;
+#endif
 
     err = RecordRegisterClients(pContext, client,
                                 (xRecordRegisterClientsReq *) stuff);
@@ -2275,19 +2456,11 @@ ProcRecordGetContext(ClientPtr client)
 }                               /* ProcRecordGetContext */
 
 static int
-ProcRecordEnableContext(ClientPtr client)
+RecordEnableContext(ClientPtr client, RecordContextPtr pContext)
 {
-    RecordContextPtr pContext;
-
-    REQUEST(xRecordEnableContextReq);
     int i;
     RecordClientsAndProtocolPtr pRCAP;
 
-    REQUEST_SIZE_MATCH(xRecordGetContextReq);
-    VERIFY_CONTEXT(pContext, stuff->context, client);
-    if (pContext->pRecordingClient)
-        return BadMatch;        /* already enabled */
-
     /* install record hooks for each RCAP */
 
     for (pRCAP = pContext->pListOfRCAP; pRCAP; pRCAP = pRCAP->pNextRCAP) {
@@ -2332,8 +2505,107 @@ ProcRecordEnableContext(ClientPtr client)
     RecordAProtocolElement(pContext, NULL, XRecordStartOfData, NULL, 0, 0, 0);
     RecordFlushReplyBuffer(pContext, NULL, 0, NULL, 0);
     return Success;
+}                               /* RecordEnableContext */
+
+static int
+ProcRecordEnableContext(ClientPtr client)
+{
+    RecordContextPtr pContext;
+
+    REQUEST(xRecordEnableContextReq);
+
+    REQUEST_SIZE_MATCH(xRecordGetContextReq);
+    VERIFY_CONTEXT(pContext, stuff->context, client);
+    if (pContext->pRecordingClient)
+        return BadMatch;        /* already enabled */
+
+    return RecordEnableContext(client, pContext);
 }                               /* ProcRecordEnableContext */
 
+#ifdef RECORD_RING
+
+static void RecordDisableContext(RecordContextPtr pContext);
+
+static void
+RecordRingBusfaultNotify(void *context)
+{
+    RecordContextPtr pContext = context;
+
+    ErrorF("record ring of context 0x%x truncated by client\n",
+           (unsigned int) pContext->id);
+    busfault_unregister(pContext->busfault);
+    pContext->busfault = NULL;
+    RecordDisableContext(pContext);
+}
+
+/* ProcRecordEnableContextFd
+ *
+ * Like EnableContext, except that the recorded protocol is written into
+ * the ring passed by the client rather than sent as replies.  The
+ * connection only carries an XRecordRingData reply when the client has
+ * asked to be woken up, and a final XRecordEndOfData reply.
+ */
+static int
+ProcRecordEnableContextFd(ClientPtr client)
+{
+    RecordContextPtr pContext;
+    xRecordRingHeader *pRing;
+    struct stat statb;
+    size_t size;
+    int fd, err;
+
+    REQUEST(xRecordEnableContextFdReq);
+
+    SetReqFds(client, 1);
+    REQUEST_SIZE_MATCH(xRecordEnableContextFdReq);
+    VERIFY_CONTEXT(pContext, stuff->context, client);
+    if (pContext->pRecordingClient)
+        return BadMatch;        /* already enabled */
+    if (stuff->size < RING_MIN_SIZE || stuff->size > RING_MAX_SIZE ||
+        (stuff->size & (stuff->size - 1))) {
+        client->errorValue = stuff->size;
+        return BadValue;
+    }
+
+    fd = ReadFdFromClient(client);
+    if (fd < 0)
+        return BadMatch;
+
+    size = sz_xRecordRingHeader + stuff->size;
+    if (fstat(fd, &statb) < 0 || statb.st_size < size) {
+        close(fd);
+        return BadMatch;
+    }
+    pRing = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (pRing == MAP_FAILED)
+        return BadAccess;
+
+    pContext->pRing = pRing;
+    pContext->ringSize = stuff->size;
+    pContext->busfault = busfault_register_mmap(pRing, size,
+                                                RecordRingBusfaultNotify,
+                                                pContext);
+    if (!pContext->busfault) {
+        RecordRingUnmap(pContext);
+        return BadAlloc;
+    }
+
+    pRing->size = stuff->size;
+    pRing->head = 0;
+    pRing->dropped = 0;
+    pRing->droppedBytes = 0;
+    pContext->ringHead = 0;
+    pContext->ringDropping = FALSE;
+
+    err = RecordEnableContext(client, pContext);
+    if (err != Success)
+        RecordRingUnmap(pContext);
+    return err;
+}                               /* ProcRecordEnableContextFd */
+
+#endif                          /* RECORD_RING */
+
 /* RecordDisableContext
  *
  * Arguments:
@@ -2361,7 +2633,15 @@ RecordDisableContext(RecordContextPtr pContext)
     if (!pContext->pRecordingClient->clientGone) {
         RecordAProtocolElement(pContext, NULL, XRecordEndOfData, NULL, 0, 0, 0);
         RecordFlushReplyBuffer(pContext, NULL, 0, NULL, 0);
+#ifdef RECORD_RING
+        if (pContext->pRing)
+            RecordRingNotify(pContext, XRecordEndOfData);
+#endif
     }
+#ifdef RECORD_RING
+    if (pContext->pRing)
+        RecordRingUnmap(pContext);
+#endif
     /* Re-enable request processing on this connection. */
     AttendClient(pContext->pRecordingClient);
 
@@ -2481,6 +2761,10 @@ ProcRecordDispatch(ClientPtr client)
         return ProcRecordDisableContext(client);
     case X_RecordFreeContext:
         return ProcRecordFreeContext(client);
+#ifdef RECORD_RING
+    case X_RecordEnableContextFd:
+        return ProcRecordEnableContextFd(client);
+#endif
     default:
         return BadRequest;
     }
@@ -2605,6 +2889,20 @@ SProcRecordFreeContext(ClientPtr client)
     return ProcRecordFreeContext(client);
 }                               /* SProcRecordFreeContext */
 
+#ifdef RECORD_RING
+static int _X_COLD
+SProcRecordEnableContextFd(ClientPtr client)
+{
+    REQUEST(xRecordEnableContextFdReq);
+
+    swaps(&stuff->length);
+    REQUEST_SIZE_MATCH(xRecordEnableContextFdReq);
+    swapl(&stuff->context);
+    swapl(&stuff->size);
+    return ProcRecordEnableContextFd(client);
+}                               /* SProcRecordEnableContextFd */
+#endif
+
 static int _X_COLD
 SProcRecordDispatch(ClientPtr client)
 {
@@ -2627,6 +2925,10 @@ SProcRecordDispatch(ClientPtr client)
         return SProcRecordDisableContext(client);
     case X_RecordFreeContext:
         return SProcRecordFreeContext(client);
+#ifdef RECORD_RING
+    case X_RecordEnableContextFd:
+        return SProcRecordEnableContextFd(client);
+#endif
     default:
         return BadRequest;
     }
@@ -41,7 +41,11 @@ from The Open Group.
     opcode).  In such cases, a list-of-intervals representation would be
     preferable to reduce memory consumption.  Both representations will be
     implemented, and RecordCreateSet will decide heuristically which one
-    to use based on the set members.
+    to use based on the set members.  Sets whose members are all below
+    256, which covers every set of major opcodes, events and errors,
+    always use a bit vector: at most 32 bytes, and RecordIsMemberOfSet
+    tests those inline.  That is the path every recorded request takes
+    when a client asks for all core requests.
 
 */
 
@@ -78,11 +82,10 @@ NoopDestroySet(RecordSetPtr pSet)
 
 typedef struct {
     RecordSetRec baseSet;
-    int maxMember;
     /* followed by the bit vector itself */
 } BitVectorSet, *BitVectorSetPtr;
 
-#define BITS_PER_LONG (sizeof(unsigned long) * 8)
+#define BITS_PER_LONG RECORD_SET_BITS_PER_LONG
 
 static void
 BitVectorDestroySet(RecordSetPtr pSet)
@@ -96,7 +99,7 @@ BitVectorIsMemberOfSet(RecordSetPtr pSet, int pm)
     BitVectorSetPtr pbvs = (BitVectorSetPtr) pSet;
     unsigned long *pbitvec;
 
-    if ((int) pm > pbvs->maxMember)
+    if ((int) pm > pbvs->baseSet.maxMember)
         return FALSE;
     pbitvec = (unsigned long *) (&pbvs[1]);
     return (pbitvec[pm / BITS_PER_LONG] &
@@ -120,7 +123,7 @@ BitVectorFindBit(RecordSetPtr pSet, int iterbit, Bool bitval)
     pbitvec += startlong;
     startbit = startlong * BITS_PER_LONG;
     skipval = bitval ? 0L : ~0L;
-    maxMember = pbvs->maxMember;
+    maxMember = pbvs->baseSet.maxMember;
 
     if (startbit > maxMember)
         return -1;
@@ -161,7 +164,7 @@ BitVectorIterateSet(RecordSetPtr pSet, RecordSetIteratePtr pIter,
     pInterval->first = b;
 
     b = BitVectorFindBit(pSet, b, FALSE);
-    pInterval->last = (b < 0) ? ((BitVectorSetPtr) pSet)->maxMember : b - 1;
+    pInterval->last = (b < 0) ? pSet->maxMember : b - 1;
     return (RecordSetIteratePtr) (uintptr_t) (pInterval->last + 1);
 }
 
@@ -206,11 +209,12 @@ BitVectorCreateSet(RecordSetInterval * pIntervals, int nIntervals,
         pbvs->baseSet.ops = &BitVectorSetOperations;
     }
 
-    pbvs->maxMember = maxMemberInInterval(pIntervals, nIntervals);
+    pbvs->baseSet.maxMember = maxMemberInInterval(pIntervals, nIntervals);
 
     /* fill in the set */
 
     pbitvec = (unsigned long *) (&pbvs[1]);
+    pbvs->baseSet.bits = pbitvec;
     for (i = 0; i < nIntervals; i++) {
         for (j = pIntervals[i].first; j <= (int) pIntervals[i].last; j++) {
             pbitvec[j / BITS_PER_LONG] |=
@@ -354,6 +358,7 @@ IntervalListCreateSet(RecordSetInterval * pIntervals, int nIntervals,
     }
     memcpy(&prls[1], stackIntervals, nIntervals * sizeof(RecordSetInterval));
     prls->nIntervals = nIntervals;
+    prls->baseSet.bits = NULL;
  bailout:
     free(stackIntervals);
     return (RecordSetPtr) prls;
@@ -378,8 +383,7 @@ _RecordSetMemoryRequirements(RecordSetInterval * pIntervals, int nIntervals,
                                             &bma);
     rlsize = IntervalListMemoryRequirements(pIntervals, nIntervals, maxMember,
                                             &rla);
-    if (((nIntervals > 1) && (maxMember <= 255))
-        || (bmsize < rlsize)) {
+    if ((maxMember <= 255) || (bmsize < rlsize)) {
         *alignment = bma;
         *ppCreateSet = BitVectorCreateSet;
         return bmsize;
@@ -74,11 +74,17 @@ typedef struct {
 
 /* "base class" for sets.
    set users should never declare a variable of this type.
+   Sets stored as bit vectors also fill in bits and maxMember, so that
+   RecordIsMemberOfSet can test them without calling through ops.
  */
 typedef struct _RecordSetRec {
     RecordSetOperations *ops;
+    unsigned long *bits;        /* bit vector, or NULL */
+    int maxMember;              /* largest member of a bit vector set */
 } RecordSetRec;
 
+#define RECORD_SET_BITS_PER_LONG (sizeof(unsigned long) * 8)
+
 RecordSetPtr RecordCreateSet(RecordSetInterval * intervals,
                              int nintervals, void *pMem, int memsize);
 /*
@@ -105,9 +111,15 @@ int RecordSetMemoryRequirements(RecordSetInterval * /*pIntervals */ ,
     used after it is destroyed.
 */
 
-#define RecordIsMemberOfSet(_pSet, _m) \
-  /* unsigned long */ (*_pSet->ops->IsMemberOfSet)(/* RecordSetPtr */ _pSet, \
-						   /* int */ _m)
+static inline unsigned long
+RecordIsMemberOfSet(RecordSetPtr pSet, int m)
+{
+    if (pSet->bits)
+        return m <= pSet->maxMember &&
+            (pSet->bits[m / RECORD_SET_BITS_PER_LONG] >>
+             (m % RECORD_SET_BITS_PER_LONG) & 1);
+    return (*pSet->ops->IsMemberOfSet) (pSet, m);
+}
 /*
     RecordIsMemberOfSet returns a non-zero value if _m is a member of
     _pSet, else it returns zero.
@@ -26,8 +26,6 @@
 #include <dix-config.h>
 #endif
 
-#include "xsha1.h"
-
 #include "misc.h"
 #include "scrnintstr.h"
 #include "os.h"
@@ -82,6 +80,15 @@ static GlyphHashSetRec glyphHashSets[] = {
 
 static GlyphHashRec globalGlyphs[GlyphFormatNum];
 
+/*
+ * After a resize, entries are moved from the old table to the new one a
+ * few slots at a time on each lookup, so that growing a large table does
+ * not stall the server.
+ */
+#define GLYPH_HASH_MOVE_SLOTS	64
+
+static void MoveGlyphHash(GlyphHashPtr hash, CARD32 slots);
+
 void
 GlyphUninit(ScreenPtr pScreen)
 {
@@ -93,6 +100,7 @@ GlyphUninit(ScreenPtr pScreen)
         if (!globalGlyphs[fdepth].hashSet)
             continue;
 
+        MoveGlyphHash(&globalGlyphs[fdepth], ~0);
         for (i = 0; i < globalGlyphs[fdepth].hashSet->size; i++) {
             glyph = globalGlyphs[fdepth].table[i].glyph;
             if (glyph && glyph != DeletedGlyph) {
@@ -118,15 +126,14 @@ FindGlyphHashSet(CARD32 filled)
 }
 
 static GlyphRefPtr
-FindGlyphRef(GlyphHashPtr hash,
-             CARD32 signature, Bool match, unsigned char sha1[20])
+FindGlyphRefIn(GlyphRefPtr table, GlyphHashSetPtr hashSet,
+               CARD32 signature, Bool match, unsigned char sha1[20])
 {
     CARD32 elt, step, s;
     GlyphPtr glyph;
-    GlyphRefPtr table, gr, del;
-    CARD32 tableSize = hash->hashSet->size;
+    GlyphRefPtr gr, del;
+    CARD32 tableSize = hashSet->size;
 
-    table = hash->table;
     elt = signature % tableSize;
     step = 0;
     del = 0;
@@ -150,7 +157,7 @@ FindGlyphRef(GlyphHashPtr hash,
             break;
         }
         if (!step) {
-            step = signature % hash->hashSet->rehash;
+            step = signature % hashSet->rehash;
             if (!step)
                 step = 1;
         }
@@ -161,28 +168,236 @@ FindGlyphRef(GlyphHashPtr hash,
     return gr;
 }
 
+/*
+ * Move the entries in the next slots of the old table of a hash being
+ * resized to the new table, and free the old table once it is empty.
+ */
+static void
+MoveGlyphHash(GlyphHashPtr hash, CARD32 slots)
+{
+    GlyphRefPtr old, gr;
+
+    while (hash->oldTable) {
+        if (hash->oldNext == hash->oldHashSet->size) {
+            free(hash->oldTable);
+            hash->oldTable = 0;
+            hash->oldHashSet = 0;
+            break;
+        }
+        if (!slots--)
+            break;
+
+        old = &hash->oldTable[hash->oldNext++];
+        if (old->glyph && old->glyph != DeletedGlyph) {
+            /* Signature and sha1 together are unique in every table */
+            gr = FindGlyphRefIn(hash->table, hash->hashSet,
+                                old->signature, TRUE, old->glyph->sha1);
+            *gr = *old;
+            old->glyph = DeletedGlyph;
+            old->signature = 0;
+        }
+    }
+}
+
+/*
+ * Look up signature in a hash, which may be in the middle of a resize.
+ * Entries still in the old table are moved over when found, so the
+ * returned slot is always in the new table.
+ */
+static GlyphRefPtr
+FindGlyphRef(GlyphHashPtr hash,
+             CARD32 signature, Bool match, unsigned char sha1[20])
+{
+    GlyphRefPtr gr, old;
+
+    if (hash->oldTable)
+        MoveGlyphHash(hash, GLYPH_HASH_MOVE_SLOTS);
+
+    gr = FindGlyphRefIn(hash->table, hash->hashSet, signature, match, sha1);
+    if (!hash->oldTable || (gr->glyph && gr->glyph != DeletedGlyph))
+        return gr;
+
+    old = FindGlyphRefIn(hash->oldTable, hash->oldHashSet,
+                         signature, match, sha1);
+    if (old->glyph && old->glyph != DeletedGlyph) {
+        *gr = *old;
+        old->glyph = DeletedGlyph;
+        old->signature = 0;
+    }
+    return gr;
+}
+
+static inline uint64_t
+GlyphHashRotate(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+#define GlyphHashRound(v0, v1, v2, v3) do {                             \
+        v0 += v1; v1 = GlyphHashRotate(v1, 13); v1 ^= v0;               \
+        v0 = GlyphHashRotate(v0, 32);                                   \
+        v2 += v3; v3 = GlyphHashRotate(v3, 16); v3 ^= v2;               \
+        v0 += v3; v3 = GlyphHashRotate(v3, 21); v3 ^= v0;               \
+        v2 += v1; v1 = GlyphHashRotate(v1, 17); v1 ^= v2;               \
+        v2 = GlyphHashRotate(v2, 32);                                   \
+    } while (0)
+
+#define GlyphHashWord(v0, v1, v2, v3, m) do {                           \
+        v3 ^= m;                                                        \
+        GlyphHashRound(v0, v1, v2, v3);                                 \
+        GlyphHashRound(v0, v1, v2, v3);                                 \
+        v0 ^= m;                                                        \
+    } while (0)
+
+/* chosen at random when the first glyph is hashed */
+static uint64_t glyphHashKey[2];
+static Bool glyphHashKeyed;
+
+/*
+ * The glyph hash only has to tell glyphs apart within this server, so
+ * rather than a cryptographic digest it is 128-bit SipHash-2-4 of the
+ * metrics and bits, under a random key so that clients can't pick
+ * images which hash alike.  Matching hashes are confirmed by comparing
+ * the images, and the last four bytes of sha1 are left for numbering
+ * different glyphs which hash alike.
+ */
 int
 HashGlyph(xGlyphInfo * gi,
           CARD8 *bits, unsigned long size, unsigned char sha1[20])
 {
-    void *ctx = x_sha1_init();
-    int success;
-
-    if (!ctx)
-        return BadAlloc;
-
-    success = x_sha1_update(ctx, gi, sizeof(xGlyphInfo));
-    if (!success)
-        return BadAlloc;
-    success = x_sha1_update(ctx, bits, size);
-    if (!success)
-        return BadAlloc;
-    success = x_sha1_final(ctx, sha1);
-    if (!success)
-        return BadAlloc;
+    uint64_t v0, v1, v2, v3, m, h;
+    unsigned long n;
+
+    if (!glyphHashKeyed) {
+        GenerateRandomData(sizeof(glyphHashKey), (char *) glyphHashKey);
+        glyphHashKeyed = TRUE;
+    }
+
+    v0 = glyphHashKey[0] ^ 0x736f6d6570736575ULL;
+    v1 = glyphHashKey[1] ^ 0x646f72616e646f6dULL ^ 0xee;
+    v2 = glyphHashKey[0] ^ 0x6c7967656e657261ULL;
+    v3 = glyphHashKey[1] ^ 0x7465646279746573ULL;
+
+    m = ((uint64_t) gi->width | (uint64_t) gi->height << 16 |
+         (uint64_t) (CARD16) gi->x << 32 | (uint64_t) (CARD16) gi->y << 48);
+    GlyphHashWord(v0, v1, v2, v3, m);
+    m = ((uint64_t) (CARD16) gi->xOff | (uint64_t) (CARD16) gi->yOff << 16 |
+         (uint64_t) size << 32);
+    GlyphHashWord(v0, v1, v2, v3, m);
+
+    for (n = size; n >= 8; n -= 8, bits += 8) {
+        memcpy(&m, bits, 8);
+        GlyphHashWord(v0, v1, v2, v3, m);
+    }
+
+    m = (uint64_t) (size + 16) << 56;
+    while (n--)
+        m |= (uint64_t) bits[n] << (n * 8);
+    GlyphHashWord(v0, v1, v2, v3, m);
+
+    v2 ^= 0xee;
+    for (n = 0; n < 4; n++)
+        GlyphHashRound(v0, v1, v2, v3);
+    h = v0 ^ v1 ^ v2 ^ v3;
+    memcpy(sha1, &h, 8);
+
+    v1 ^= 0xdd;
+    for (n = 0; n < 4; n++)
+        GlyphHashRound(v0, v1, v2, v3);
+    h = v0 ^ v1 ^ v2 ^ v3;
+    memcpy(sha1 + 8, &h, 8);
+
+    memset(sha1 + 16, 0, 4);
     return Success;
 }
 
+/*
+ * Read a glyph's image back from its picture on the first screen, in the
+ * layout AddGlyphs takes it; glyphs keep no other copy of their bits.
+ */
+static CARD8 *
+GlyphReadImage(GlyphPtr glyph, unsigned long size)
+{
+    ScreenPtr pScreen = screenInfo.screens[0];
+    PicturePtr pPicture = GetGlyphPicture(glyph, pScreen);
+    CARD8 *image;
+
+    if (!pPicture || !(image = malloc(size)))
+        return NULL;
+    (*pScreen->GetImage) (pPicture->pDrawable, 0, 0,
+                          glyph->info.width, glyph->info.height,
+                          ZPixmap, ~0, (char *) image);
+    return image;
+}
+
+/*
+ * Compare a glyph's image with bits in the AddGlyphs layout.  The padding
+ * at the end of each row is left out, as clients need not clear it and
+ * pictures need not keep it.
+ */
+static Bool
+GlyphImageEqual(GlyphPtr glyph,
+                xGlyphInfo * gi, CARD8 *bits, unsigned long size)
+{
+    CARD8 *image, *a, *b;
+    unsigned long stride, bytes, rowBits;
+    CARD8 mask = 0;
+    Bool equal = TRUE;
+    int y;
+
+    if (memcmp(&glyph->info, gi, sizeof(xGlyphInfo)) != 0)
+        return FALSE;
+    if (!size)
+        return TRUE;
+    if (!bits || !(image = GlyphReadImage(glyph, size)))
+        return FALSE;
+
+    stride = size / gi->height;
+    rowBits = (unsigned long) gi->width *
+        GetGlyphPicture(glyph, screenInfo.screens[0])->pDrawable->bitsPerPixel;
+    bytes = rowBits / 8;
+    if (rowBits % 8) {
+#if BITMAP_BIT_ORDER == MSBFirst
+        mask = 0xff << (8 - rowBits % 8);
+#else
+        mask = 0xff >> (8 - rowBits % 8);
+#endif
+    }
+
+    for (y = 0, a = image, b = bits; y < gi->height && equal;
+         y++, a += stride, b += stride)
+        equal = (memcmp(a, b, bytes) == 0 && !((a[bytes] ^ b[bytes]) & mask));
+
+    free(image);
+    return equal;
+}
+
+/*
+ * Find the global table slot of the glyph with the given image, or the
+ * slot for it if there is none.  sha1 comes from HashGlyph; glyphs with
+ * the same hash but different images are numbered in its last bytes,
+ * which are updated to the number found.
+ */
+static GlyphRefPtr
+FindGlyphImageRef(int format, unsigned char sha1[20],
+                  xGlyphInfo * gi, CARD8 *bits, unsigned long size)
+{
+    GlyphRefPtr gr;
+    CARD32 signature = *(CARD32 *) sha1;
+    CARD32 n;
+
+    for (;;) {
+        gr = FindGlyphRef(&globalGlyphs[format], signature, TRUE, sha1);
+        if (!gr->glyph || gr->glyph == DeletedGlyph ||
+            GlyphImageEqual(gr->glyph, gi, bits, size))
+            return gr;
+
+        memcpy(&n, sha1 + 16, 4);
+        n++;
+        memcpy(sha1 + 16, &n, 4);
+    }
+}
+
 GlyphPtr
 FindGlyphByHash(unsigned char sha1[20], int format)
 {
@@ -200,6 +415,23 @@ FindGlyphByHash(unsigned char sha1[20], int format)
         return NULL;
 }
 
+GlyphPtr
+FindGlyphByImage(unsigned char sha1[20], int format,
+                 xGlyphInfo * gi, CARD8 *bits, unsigned long size)
+{
+    GlyphRefPtr gr;
+
+    if (!globalGlyphs[format].hashSet)
+        return NULL;
+
+    gr = FindGlyphImageRef(format, sha1, gi, bits, size);
+
+    if (gr->glyph && gr->glyph != DeletedGlyph)
+        return gr->glyph;
+    else
+        return NULL;
+}
+
 #ifdef CHECK_DUPLICATES
 void
 DuplicateRef(GlyphPtr glyph, char *where)
@@ -251,9 +483,10 @@ FreeGlyph(GlyphPtr glyph, int format)
     CheckDuplicates(&globalGlyphs[format], "FreeGlyph");
     if (--glyph->refcnt == 0) {
         GlyphRefPtr gr;
+        CARD32 signature;
+#ifdef CHECK_DUPLICATES
         int i;
         int first;
-        CARD32 signature;
 
         first = -1;
         for (i = 0; i < globalGlyphs[format].hashSet->size; i++)
@@ -262,11 +495,14 @@ FreeGlyph(GlyphPtr glyph, int format)
                     DuplicateRef(glyph, "FreeGlyph check");
                 first = i;
             }
+#endif
 
         signature = *(CARD32 *) glyph->sha1;
         gr = FindGlyphRef(&globalGlyphs[format], signature, TRUE, glyph->sha1);
+#ifdef CHECK_DUPLICATES
         if (gr - globalGlyphs[format].table != first)
             DuplicateRef(glyph, "Found wrong one");
+#endif
         if (gr->glyph && gr->glyph != DeletedGlyph) {
             gr->glyph = DeletedGlyph;
             gr->signature = 0;
@@ -289,6 +525,17 @@ AddGlyph(GlyphSetPtr glyphSet, GlyphPtr glyph, Glyph id)
     signature = *(CARD32 *) glyph->sha1;
     gr = FindGlyphRef(&globalGlyphs[glyphSet->fdepth], signature,
                       TRUE, glyph->sha1);
+    if (gr->glyph && gr->glyph != DeletedGlyph && gr->glyph != glyph) {
+        /* Another glyph of the same request hashed alike */
+        unsigned long size = glyph->info.height *
+            PixmapBytePad(glyph->info.width, glyphSet->format->depth);
+        CARD8 *bits = size ? GlyphReadImage(glyph, size) : NULL;
+
+        gr = FindGlyphImageRef(glyphSet->fdepth, glyph->sha1, &glyph->info,
+                               bits, size);
+        signature = *(CARD32 *) glyph->sha1;
+        free(bits);
+    }
     if (gr->glyph && gr->glyph != DeletedGlyph && gr->glyph != glyph) {
         FreeGlyphPicture(glyph);
         dixFreeObjectWithPrivates(glyph, PRIVATE_GLYPH);
@@ -391,6 +638,9 @@ AllocateGlyphHash(GlyphHashPtr hash, GlyphHashSetPtr hashSet)
         return FALSE;
     hash->hashSet = hashSet;
     hash->tableEntries = 0;
+    hash->oldTable = 0;
+    hash->oldHashSet = 0;
+    hash->oldNext = 0;
     return TRUE;
 }
 
@@ -399,39 +649,30 @@ ResizeGlyphHash(GlyphHashPtr hash, CARD32 change, Bool global)
 {
     CARD32 tableEntries;
     GlyphHashSetPtr hashSet;
-    GlyphHashRec newHash;
-    GlyphRefPtr gr;
-    GlyphPtr glyph;
-    int i;
-    int oldSize;
-    CARD32 s;
+    GlyphRefPtr table;
 
     tableEntries = hash->tableEntries + change;
     hashSet = FindGlyphHashSet(tableEntries);
     if (hashSet == hash->hashSet)
         return TRUE;
+    if (!hashSet)
+        return FALSE;
     if (global)
         CheckDuplicates(hash, "ResizeGlyphHash top");
-    if (!AllocateGlyphHash(&newHash, hashSet))
+    table = calloc(hashSet->size, sizeof(GlyphRefRec));
+    if (!table)
         return FALSE;
-    if (hash->table) {
-        oldSize = hash->hashSet->size;
-        for (i = 0; i < oldSize; i++) {
-            glyph = hash->table[i].glyph;
-            if (glyph && glyph != DeletedGlyph) {
-                s = hash->table[i].signature;
-                gr = FindGlyphRef(&newHash, s, global, glyph->sha1);
 
-                gr->signature = s;
-                gr->glyph = glyph;
-                ++newHash.tableEntries;
-            }
-        }
-        free(hash->table);
-    }
-    *hash = newHash;
-    if (global)
-        CheckDuplicates(hash, "ResizeGlyphHash bottom");
+    /*
+     * The entries are moved over by later lookups, see MoveGlyphHash;
+     * a previous resize still in progress is finished first.
+     */
+    MoveGlyphHash(hash, ~0);
+    hash->oldTable = hash->table;
+    hash->oldHashSet = hash->hashSet;
+    hash->oldNext = 0;
+    hash->table = table;
+    hash->hashSet = hashSet;
     return TRUE;
 }
 
@@ -472,10 +713,13 @@ FreeGlyphSet(void *value, XID gid)
     GlyphSetPtr glyphSet = (GlyphSetPtr) value;
 
     if (--glyphSet->refcnt == 0) {
-        CARD32 i, tableSize = glyphSet->hash.hashSet->size;
-        GlyphRefPtr table = glyphSet->hash.table;
+        CARD32 i, tableSize;
+        GlyphRefPtr table;
         GlyphPtr glyph;
 
+        MoveGlyphHash(&glyphSet->hash, ~0);
+        tableSize = glyphSet->hash.hashSet->size;
+        table = glyphSet->hash.table;
         for (i = 0; i < tableSize; i++) {
             glyph = table[i].glyph;
             if (glyph && glyph != DeletedGlyph)
@@ -483,8 +727,11 @@ FreeGlyphSet(void *value, XID gid)
         }
         if (!globalGlyphs[glyphSet->fdepth].tableEntries) {
             free(globalGlyphs[glyphSet->fdepth].table);
+            free(globalGlyphs[glyphSet->fdepth].oldTable);
             globalGlyphs[glyphSet->fdepth].table = 0;
             globalGlyphs[glyphSet->fdepth].hashSet = 0;
+            globalGlyphs[glyphSet->fdepth].oldTable = 0;
+            globalGlyphs[glyphSet->fdepth].oldHashSet = 0;
         }
         else
             ResizeGlyphHash(&globalGlyphs[glyphSet->fdepth], 0, TRUE);
@@ -42,7 +42,7 @@
 typedef struct _Glyph {
     CARD32 refcnt;
     PrivateRec *devPrivates;
-    unsigned char sha1[20];
+    unsigned char sha1[20];     /* unique identity, see HashGlyph */
     CARD32 size;                /* info + bitmap */
     xGlyphInfo info;
     /* per-screen pixmaps follow */
@@ -67,6 +67,9 @@ typedef struct _GlyphHash {
     GlyphRefPtr table;
     GlyphHashSetPtr hashSet;
     CARD32 tableEntries;
+    GlyphRefPtr oldTable;       /* being moved to table after a resize */
+    GlyphHashSetPtr oldHashSet;
+    CARD32 oldNext;             /* first old slot not yet moved */
 } GlyphHashRec, *GlyphHashPtr;
 
 typedef struct _GlyphSet {
@@ -95,6 +98,10 @@ extern void
 
 extern GlyphPtr FindGlyphByHash(unsigned char sha1[20], int format);
 
+extern GlyphPtr
+FindGlyphByImage(unsigned char sha1[20], int format,
+                 xGlyphInfo * gi, CARD8 *bits, unsigned long size);
+
 extern int
 HashGlyph(xGlyphInfo * gi,
           CARD8 *bits, unsigned long size, unsigned char sha1[20]);
@@ -52,6 +52,9 @@ RESTYPE PictureType;
 RESTYPE PictFormatType;
 RESTYPE GlyphSetType;
 int PictureCmapPolicy = PictureCmapPolicyDefault;
+int PictureRenderThreads = -1;
+int PictureBandPixels = 256 * 1024;
+int PictureGlyphCacheSize = 16 * 1024;
 
 PictFormatPtr
 PictureWindowFormat(WindowPtr pWindow)
@@ -86,9 +89,20 @@ static Bool
 PictureCloseScreen(ScreenPtr pScreen)
 {
     PictureScreenPtr ps = GetPictureScreen(pScreen);
+    GlyphCacheStatsRec stats;
     Bool ret;
     int n;
 
+    if (ps->GetGlyphCacheStats && (*ps->GetGlyphCacheStats) (pScreen, &stats))
+        LogMessageVerb(X_INFO, 3, "render: glyph cache: %llu hits, "
+                       "%llu misses, %llu insertions, %llu evictions, "
+                       "%llu glyphs in %llu KB\n",
+                       (unsigned long long) stats.hits,
+                       (unsigned long long) stats.misses,
+                       (unsigned long long) stats.insertions,
+                       (unsigned long long) stats.evictions,
+                       (unsigned long long) stats.glyphs,
+                       (unsigned long long) stats.memory / 1024);
     pScreen->CloseScreen = ps->CloseScreen;
     ret = (*pScreen->CloseScreen) (pScreen);
     PictureResetFilters(pScreen);
@@ -687,6 +701,8 @@ PictureInit(ScreenPtr pScreen, PictFormatPtr formats, int nformats)
 
     ps->subpixel = SubPixelUnknown;
 
+    ps->GetGlyphCacheStats = NULL;
+
     ps->CloseScreen = pScreen->CloseScreen;
     ps->DestroyWindow = pScreen->DestroyWindow;
     ps->StoreColors = pScreen->StoreColors;
@@ -868,7 +884,7 @@ CreateSolidPicture(Picture pid, xRenderColor * color, int *error)
     pPicture->pSourcePict = (SourcePictPtr) malloc(sizeof(SourcePict));
     if (!pPicture->pSourcePict) {
         *error = BadAlloc;
-        free(pPicture);
+        dixFreeObjectWithPrivates(pPicture, PRIVATE_PICTURE);
         return 0;
     }
     pPicture->pSourcePict->type = SourcePictTypeSolidFill;
@@ -899,7 +915,7 @@ CreateLinearGradientPicture(Picture pid, xPointFixed * p1, xPointFixed * p2,
     pPicture->pSourcePict = (SourcePictPtr) malloc(sizeof(SourcePict));
     if (!pPicture->pSourcePict) {
         *error = BadAlloc;
-        free(pPicture);
+        dixFreeObjectWithPrivates(pPicture, PRIVATE_PICTURE);
         return 0;
     }
 
@@ -909,7 +925,7 @@ CreateLinearGradientPicture(Picture pid, xPointFixed * p1, xPointFixed * p2,
 
     initGradient(pPicture->pSourcePict, nStops, stops, colors, error);
     if (*error) {
-        free(pPicture);
+        dixFreeObjectWithPrivates(pPicture, PRIVATE_PICTURE);
         return 0;
     }
     return pPicture;
@@ -939,7 +955,7 @@ CreateRadialGradientPicture(Picture pid, xPointFixed * inner,
     pPicture->pSourcePict = (SourcePictPtr) malloc(sizeof(SourcePict));
     if (!pPicture->pSourcePict) {
         *error = BadAlloc;
-        free(pPicture);
+        dixFreeObjectWithPrivates(pPicture, PRIVATE_PICTURE);
         return 0;
     }
     radial = &pPicture->pSourcePict->radial;
@@ -954,7 +970,7 @@ CreateRadialGradientPicture(Picture pid, xPointFixed * inner,
 
     initGradient(pPicture->pSourcePict, nStops, stops, colors, error);
     if (*error) {
-        free(pPicture);
+        dixFreeObjectWithPrivates(pPicture, PRIVATE_PICTURE);
         return 0;
     }
     return pPicture;
@@ -982,7 +998,7 @@ CreateConicalGradientPicture(Picture pid, xPointFixed * center, xFixed angle,
     pPicture->pSourcePict = (SourcePictPtr) malloc(sizeof(SourcePict));
     if (!pPicture->pSourcePict) {
         *error = BadAlloc;
-        free(pPicture);
+        dixFreeObjectWithPrivates(pPicture, PRIVATE_PICTURE);
         return 0;
     }
 
@@ -992,7 +1008,7 @@ CreateConicalGradientPicture(Picture pid, xPointFixed * center, xFixed angle,
 
     initGradient(pPicture->pSourcePict, nStops, stops, colors, error);
     if (*error) {
-        free(pPicture);
+        dixFreeObjectWithPrivates(pPicture, PRIVATE_PICTURE);
         return 0;
     }
     return pPicture;
@@ -171,6 +171,17 @@ typedef enum _PictFormatShort {
 
 extern int PictureCmapPolicy;
 
+/*
+ * Threads used to render large operations in horizontal bands; -1 picks
+ * one per CPU, 1 disables banding.  Only operations covering at least
+ * PictureBandPixels pixels are split.
+ */
+extern int PictureRenderThreads;
+extern int PictureBandPixels;
+
+/* Kilobytes of glyphs fb keeps ready for pixman */
+extern int PictureGlyphCacheSize;
+
 extern int PictureParseCmapPolicy(const char *name);
 
 extern int RenderErrBase;
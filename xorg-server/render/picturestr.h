@@ -280,6 +280,22 @@ typedef Bool (*RealizeGlyphProcPtr) (ScreenPtr pScreen, GlyphPtr glyph);
 
 typedef void (*UnrealizeGlyphProcPtr) (ScreenPtr pScreen, GlyphPtr glyph);
 
+/*
+ * Statistics of the cache a backend keeps of glyphs in the form it draws
+ * them from.  Screens sharing one cache report the same one.
+ */
+typedef struct _GlyphCacheStats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t insertions;
+    uint64_t evictions;
+    uint64_t glyphs;
+    uint64_t memory;            /* bytes */
+} GlyphCacheStatsRec, *GlyphCacheStatsPtr;
+
+typedef Bool (*GetGlyphCacheStatsProcPtr) (ScreenPtr pScreen,
+                                           GlyphCacheStatsPtr stats);
+
 typedef struct _PictureScreen {
     PictFormatPtr formats;
     PictFormatPtr fallback;
@@ -342,6 +358,8 @@ typedef struct _PictureScreen {
 #define PICTURE_SCREEN_VERSION 2
     TriStripProcPtr TriStrip;
     TriFanProcPtr TriFan;
+
+    GetGlyphCacheStatsProcPtr GetGlyphCacheStats;
 } PictureScreenRec, *PictureScreenPtr;
 
 extern _X_EXPORT DevPrivateKeyRec PictureScreenPrivateKeyRec;
@@ -0,0 +1,288 @@
+/**
+ * Copyright © 2026 agent <agent@local>
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice (including the next
+ *  paragraph) shall be included in all copies or substantial portions of the
+ *  Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+/*
+ * Tests the InternAtom burst path of ProcInternAtom.
+ *
+ * Test approach:
+ * Wrap ReadRequestFromClient and PeekNextRequestFromClient to feed
+ * requests from a buffer, and WriteToClient to collect the replies.
+ * Every InternAtom must get one reply with its own sequence number, and
+ * the burst must stop at other requests, errors, the burst limit, the
+ * end of the client's time slice and pending yields.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <X11/X.h>
+#include <X11/Xproto.h>
+#include <X11/Xatom.h>
+#include "misc.h"
+#include "dixstruct.h"
+#include "opaque.h"
+#include "../dix/dispatch.h"
+#include "protocol-common.h"
+
+#define INPUT_SIZE 16384         /* in 4-byte units */
+#define MAX_REPLIES 512
+
+const void *__wrap_PeekNextRequestFromClient(ClientPtr client);
+int __wrap_ReadRequestFromClient(ClientPtr client);
+
+static CARD32 input[INPUT_SIZE];
+static int input_len, input_pos;
+
+static Atom replies[MAX_REPLIES];
+static CARD16 reply_sequence[MAX_REPLIES];
+static int nreplies;
+
+static ClientRec atom_client;
+static HWEventQueueType input_check[2];
+
+const void *
+__wrap_PeekNextRequestFromClient(ClientPtr client)
+{
+    return input_pos < input_len ? &input[input_pos] : NULL;
+}
+
+int
+__wrap_ReadRequestFromClient(ClientPtr client)
+{
+    xReq *req;
+
+    if (input_pos >= input_len)
+        return 0;
+    req = (xReq *) &input[input_pos];
+    client->requestBuffer = req;
+    client->req_len = req->length;
+    input_pos += req->length;
+    return req->length << 2;
+}
+
+static void
+reply_InternAtom(ClientPtr client, int len, char *data, void *closure)
+{
+    xInternAtomReply *rep = (xInternAtomReply *) data;
+
+    assert(len == sizeof(xInternAtomReply));
+    assert(rep->type == X_Reply);
+    assert(nreplies < MAX_REPLIES);
+    replies[nreplies] = rep->atom;
+    reply_sequence[nreplies] = rep->sequenceNumber;
+    nreplies++;
+}
+
+static void
+queue_intern_atom(const char *name, int onlyIfExists)
+{
+    xInternAtomReq *req = (xInternAtomReq *) &input[input_len];
+    int nbytes = strlen(name);
+
+    req->reqType = X_InternAtom;
+    req->onlyIfExists = onlyIfExists;
+    req->nbytes = nbytes;
+    req->length = bytes_to_int32(sizeof(xInternAtomReq) + nbytes);
+    memcpy(&req[1], name, nbytes);
+    input_len += req->length;
+    assert(input_len <= INPUT_SIZE);
+}
+
+static void
+queue_get_atom_name(Atom atom)
+{
+    xResourceReq *req = (xResourceReq *) &input[input_len];
+
+    req->reqType = X_GetAtomName;
+    req->length = bytes_to_int32(sizeof(xResourceReq));
+    req->id = atom;
+    input_len += req->length;
+}
+
+static void
+reset_client(void)
+{
+    input_len = input_pos = 0;
+    nreplies = 0;
+    atom_client.sequence = 0;
+}
+
+/* Read the first request and dispatch it like Dispatch would */
+static int
+dispatch_intern_atom(void)
+{
+    assert(__wrap_ReadRequestFromClient(&atom_client) > 0);
+    atom_client.sequence++;
+    atom_client.majorOp = X_InternAtom;
+    return ProcInternAtom(&atom_client);
+}
+
+static const char *
+atom_test_name(int i)
+{
+    static char name[32];
+
+    snprintf(name, sizeof(name), "ATOM_BURST_TEST_%d", i);
+    return name;
+}
+
+static void
+check_replies(int first, int count)
+{
+    const char *name;
+    int i;
+
+    assert(nreplies == count);
+    for (i = 0; i < count; i++) {
+        name = atom_test_name(first + i);
+        assert(replies[i] == MakeAtom(name, strlen(name), FALSE));
+        assert(replies[i] != None);
+        assert(reply_sequence[i] == i + 1);
+    }
+}
+
+static void
+test_burst_stops_at_other_requests(void)
+{
+    int i;
+
+    reset_client();
+    for (i = 0; i < 5; i++)
+        queue_intern_atom(atom_test_name(i), xFalse);
+    queue_get_atom_name(XA_PRIMARY);
+    queue_intern_atom(atom_test_name(5), xFalse);
+
+    assert(dispatch_intern_atom() == Success);
+    check_replies(0, 5);
+    assert(atom_client.sequence == 5);
+
+    /* The GetAtomName is left for Dispatch */
+    assert(((xReq *) __wrap_PeekNextRequestFromClient(&atom_client))->reqType ==
+           X_GetAtomName);
+
+    /* onlyIfExists requests are answered in the burst too */
+    reset_client();
+    queue_intern_atom(atom_test_name(3), xTrue);
+    queue_intern_atom("ATOM_BURST_TEST_NONEXISTENT", xTrue);
+    assert(dispatch_intern_atom() == Success);
+    assert(nreplies == 2);
+    assert(replies[0] == MakeAtom(atom_test_name(3),
+                                  strlen(atom_test_name(3)), FALSE));
+    assert(replies[1] == None);
+}
+
+static void
+test_burst_stops_at_errors(void)
+{
+    reset_client();
+    queue_intern_atom(atom_test_name(10), xFalse);
+    queue_intern_atom(atom_test_name(11), 2);
+    queue_intern_atom(atom_test_name(12), xFalse);
+
+    assert(dispatch_intern_atom() == BadValue);
+    assert(atom_client.errorValue == 2);
+    check_replies(10, 1);
+
+    /* The failing request was consumed and gets the error's sequence */
+    assert(atom_client.sequence == 2);
+    assert(input_pos < input_len);
+}
+
+static void
+test_burst_limit(void)
+{
+    int i;
+
+    reset_client();
+    for (i = 0; i < 300; i++)
+        queue_intern_atom(atom_test_name(100 + i), xFalse);
+
+    assert(dispatch_intern_atom() == Success);
+    assert(nreplies > 1 && nreplies < 300);
+
+    /* Dispatch picks up the rest, in order */
+    while (input_pos < input_len)
+        assert(dispatch_intern_atom() == Success);
+    assert(nreplies == 300);
+    for (i = 0; i < 300; i++)
+        assert(reply_sequence[i] == i + 1);
+}
+
+static void
+test_burst_yields(void)
+{
+    long time = SmartScheduleTime;
+    int i;
+
+    /* The client's time slice is used up */
+    reset_client();
+    for (i = 0; i < 3; i++)
+        queue_intern_atom(atom_test_name(i), xFalse);
+    SmartScheduleTime += SmartScheduleSlice;
+    assert(dispatch_intern_atom() == Success);
+    assert(nreplies == 1);
+    SmartScheduleTime = time;
+
+    /* Another client is waiting */
+    reset_client();
+    for (i = 0; i < 3; i++)
+        queue_intern_atom(atom_test_name(i), xFalse);
+    isItTimeToYield = TRUE;
+    assert(dispatch_intern_atom() == Success);
+    assert(nreplies == 1);
+    isItTimeToYield = FALSE;
+
+    /* Byte-swapped clients take the normal path */
+    reset_client();
+    for (i = 0; i < 3; i++)
+        queue_intern_atom(atom_test_name(i), xFalse);
+    atom_client.requestVector = SwappedProcVector;
+    assert(dispatch_intern_atom() == Success);
+    assert(nreplies == 1);
+    atom_client.requestVector = ProcVector;
+}
+
+int
+atom_test(void)
+{
+    InitAtoms();
+    SetInputCheck(&input_check[0], &input_check[1]);
+
+    atom_client = init_client(0, NULL);
+    atom_client.requestVector = ProcVector;
+    reply_handler = reply_InternAtom;
+
+    test_burst_stops_at_other_requests();
+    test_burst_stops_at_errors();
+    test_burst_limit();
+    test_burst_yields();
+
+    return 0;
+}
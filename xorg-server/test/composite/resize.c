@@ -0,0 +1,180 @@
+/*
+ * Copyright © 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/** @file
+ *
+ * Resizes a redirected window like an interactive resize does, and checks
+ * that the contents survive and that pixmaps named with NameWindowPixmap
+ * keep the size they had, whether or not the server reuses the backing
+ * pixmap.  Also prints how long the resizes took.
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <xcb/composite.h>
+
+#define WIDTH 600
+#define HEIGHT 400
+#define STEPS 500
+#define COLOR 0x123456
+
+static double
+now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void
+resize(xcb_connection_t *c, xcb_window_t window, int width, int height)
+{
+    uint32_t values[] = { width, height };
+
+    xcb_configure_window(c, window,
+                         XCB_CONFIG_WINDOW_WIDTH | XCB_CONFIG_WINDOW_HEIGHT,
+                         values);
+}
+
+static void
+check_size(xcb_connection_t *c, xcb_drawable_t drawable,
+           int width, int height)
+{
+    xcb_get_geometry_reply_t *geom =
+        xcb_get_geometry_reply(c, xcb_get_geometry(c, drawable), NULL);
+
+    assert(geom);
+    assert(geom->width == width && geom->height == height);
+    free(geom);
+}
+
+/** Every pixel of the area must still have the color painted at start */
+static void
+check_contents(xcb_connection_t *c, xcb_drawable_t drawable,
+               int width, int height)
+{
+    xcb_get_image_reply_t *image =
+        xcb_get_image_reply(c, xcb_get_image(c, XCB_IMAGE_FORMAT_Z_PIXMAP,
+                                             drawable, 0, 0, width, height,
+                                             0xffffff),
+                            NULL);
+    uint32_t *pixels;
+    int i;
+
+    assert(image);
+    assert(xcb_get_image_data_length(image) == width * height * 4);
+    pixels = (uint32_t *) xcb_get_image_data(image);
+    for (i = 0; i < width * height; i++)
+        assert((pixels[i] & 0xffffff) == COLOR);
+    free(image);
+}
+
+int
+main(int argc, char **argv)
+{
+    xcb_connection_t *c = xcb_connect(NULL, NULL);
+    xcb_screen_t *screen;
+    xcb_composite_query_version_reply_t *version;
+    xcb_window_t window;
+    xcb_gcontext_t gc;
+    xcb_pixmap_t named, renamed;
+    uint32_t values[2];
+    xcb_rectangle_t all = { 0, 0, WIDTH, HEIGHT };
+    double start;
+    int i;
+
+    assert(!xcb_connection_has_error(c));
+    screen = xcb_setup_roots_iterator(xcb_get_setup(c)).data;
+    if (screen->root_depth != 24) {
+        fprintf(stderr, "Needs a depth 24 screen, skipping\n");
+        return 77;
+    }
+
+    version = xcb_composite_query_version_reply(c,
+                                                xcb_composite_query_version(c, 0, 4),
+                                                NULL);
+    assert(version && version->minor_version >= 2);
+    free(version);
+
+    window = xcb_generate_id(c);
+    values[0] = XCB_GRAVITY_NORTH_WEST;
+    values[1] = 0;
+    xcb_create_window(c, XCB_COPY_FROM_PARENT, window, screen->root,
+                      0, 0, WIDTH, HEIGHT, 0,
+                      XCB_WINDOW_CLASS_INPUT_OUTPUT, XCB_COPY_FROM_PARENT,
+                      XCB_CW_BIT_GRAVITY | XCB_CW_OVERRIDE_REDIRECT, values);
+    xcb_composite_redirect_window(c, window, XCB_COMPOSITE_REDIRECT_MANUAL);
+    xcb_map_window(c, window);
+
+    gc = xcb_generate_id(c);
+    values[0] = COLOR;
+    xcb_create_gc(c, gc, window, XCB_GC_FOREGROUND, values);
+    xcb_poly_fill_rectangle(c, window, gc, 1, &all);
+
+    /* Small steps, as while dragging a corner */
+    start = now();
+    for (i = 1; i <= STEPS; i++)
+        resize(c, window, WIDTH + i, HEIGHT + i / 2);
+    for (i = STEPS; i >= 0; i--)
+        resize(c, window, WIDTH + i, HEIGHT + i / 2);
+    check_size(c, window, WIDTH, HEIGHT);
+    printf("%d resizes: %.3f ms each\n", 2 * STEPS + 1,
+           (now() - start) * 1000 / (2 * STEPS + 1));
+    check_contents(c, window, WIDTH, HEIGHT);
+
+    /* A named pixmap keeps its size and contents across a resize */
+    named = xcb_generate_id(c);
+    xcb_composite_name_window_pixmap(c, window, named);
+    resize(c, window, WIDTH + 8, HEIGHT + 8);
+    check_size(c, named, WIDTH, HEIGHT);
+    check_contents(c, named, WIDTH, HEIGHT);
+
+    renamed = xcb_generate_id(c);
+    xcb_composite_name_window_pixmap(c, window, renamed);
+    check_size(c, renamed, WIDTH + 8, HEIGHT + 8);
+    check_contents(c, renamed, WIDTH, HEIGHT);
+
+    /* Shrinking does not disturb either */
+    xcb_free_pixmap(c, named);
+    resize(c, window, WIDTH / 2, HEIGHT / 2);
+    check_size(c, renamed, WIDTH + 8, HEIGHT + 8);
+    check_contents(c, window, WIDTH / 2, HEIGHT / 2);
+    xcb_free_pixmap(c, renamed);
+
+    /* Unredirecting and redirecting again gets a fresh pixmap */
+    xcb_composite_unredirect_window(c, window, XCB_COMPOSITE_REDIRECT_MANUAL);
+    xcb_composite_redirect_window(c, window, XCB_COMPOSITE_REDIRECT_MANUAL);
+    named = xcb_generate_id(c);
+    xcb_composite_name_window_pixmap(c, window, named);
+    check_size(c, named, WIDTH / 2, HEIGHT / 2);
+
+    assert(!xcb_connection_has_error(c));
+    xcb_disconnect(c);
+    return 0;
+}
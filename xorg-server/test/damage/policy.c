@@ -0,0 +1,251 @@
+/*
+ * Copyright © 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/** @file
+ *
+ * Checks the DAMAGE 1.2 SetPolicy request: scattered drawing produces a
+ * region of many rectangles, which a damage object with a rectangle limit
+ * must report as at most that many rectangles still covering everything
+ * that was drawn.
+ *
+ * A DeltaRectangles damage object with a limit must still report drawing
+ * inside an area it merged into an earlier report, but that was not drawn
+ * then.
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/uio.h>
+#include <xcb/xcbext.h>
+#include <xcb/damage.h>
+#include <xcb/xfixes.h>
+
+#define SIZE 256
+#define NRECTS 200
+#define MAX_RECTS 16
+
+/* Sent by hand, the installed xcb may predate DAMAGE 1.2 */
+static void
+damage_set_policy(xcb_connection_t *c, xcb_damage_damage_t damage,
+                  uint16_t max_rects, uint16_t max_overhead)
+{
+    static const xcb_protocol_request_t request = {
+        .count = 2,
+        .ext = &xcb_damage_id,
+        .opcode = 5,
+        .isvoid = 1,
+    };
+    struct {
+        uint8_t major_opcode;
+        uint8_t minor_opcode;
+        uint16_t length;
+        uint32_t damage;
+        uint16_t max_rects;
+        uint16_t max_overhead;
+    } out = {
+        .damage = damage,
+        .max_rects = max_rects,
+        .max_overhead = max_overhead,
+    };
+    struct iovec parts[4] = {
+        [2] = { .iov_base = &out, .iov_len = sizeof(out) },
+        [3] = { .iov_base = NULL, .iov_len = 0 },
+    };
+    xcb_void_cookie_t cookie;
+
+    cookie.sequence = xcb_send_request(c, XCB_REQUEST_CHECKED, parts + 2,
+                                       &request);
+    assert(!xcb_request_check(c, cookie));
+}
+
+static bool
+covered(xcb_rectangle_t *rects, int n, int x, int y)
+{
+    for (int i = 0; i < n; i++) {
+        if (x >= rects[i].x && x < rects[i].x + rects[i].width &&
+            y >= rects[i].y && y < rects[i].y + rects[i].height)
+            return true;
+    }
+    return false;
+}
+
+/**
+ * Draws scattered rectangles to a pixmap watched by a damage object with
+ * the given limit, and returns the number of rectangles in its region.
+ */
+static int
+damaged_rects(xcb_connection_t *c, xcb_screen_t *screen, int max_rects)
+{
+    xcb_pixmap_t pixmap = xcb_generate_id(c);
+    xcb_gcontext_t gc = xcb_generate_id(c);
+    xcb_damage_damage_t damage = xcb_generate_id(c);
+    xcb_xfixes_region_t region = xcb_generate_id(c);
+    xcb_rectangle_t drawn[NRECTS];
+    xcb_xfixes_fetch_region_reply_t *reply;
+    xcb_rectangle_t *rects;
+    int n;
+
+    xcb_create_pixmap(c, screen->root_depth, pixmap, screen->root,
+                      SIZE, SIZE);
+    xcb_create_gc(c, gc, pixmap, 0, NULL);
+    xcb_damage_create(c, damage, pixmap,
+                      XCB_DAMAGE_REPORT_LEVEL_NON_EMPTY);
+    if (max_rects)
+        damage_set_policy(c, damage, max_rects, 0);
+
+    for (int i = 0; i < NRECTS; i++) {
+        drawn[i].x = rand() % (SIZE - 3);
+        drawn[i].y = rand() % (SIZE - 3);
+        drawn[i].width = 1 + rand() % 3;
+        drawn[i].height = 1 + rand() % 3;
+    }
+    xcb_poly_fill_rectangle(c, pixmap, gc, NRECTS, drawn);
+
+    xcb_xfixes_create_region(c, region, 0, NULL);
+    xcb_damage_subtract(c, damage, XCB_NONE, region);
+    reply = xcb_xfixes_fetch_region_reply(c,
+                                          xcb_xfixes_fetch_region(c, region),
+                                          NULL);
+    assert(reply);
+    rects = xcb_xfixes_fetch_region_rectangles(reply);
+    n = xcb_xfixes_fetch_region_rectangles_length(reply);
+
+    /* Damage may grow, but must never lose anything */
+    for (int i = 0; i < NRECTS; i++) {
+        for (int y = drawn[i].y; y < drawn[i].y + drawn[i].height; y++)
+            for (int x = drawn[i].x; x < drawn[i].x + drawn[i].width; x++)
+                assert(covered(rects, n, x, y));
+    }
+
+    free(reply);
+    xcb_xfixes_destroy_region(c, region);
+    xcb_damage_destroy(c, damage);
+    xcb_free_gc(c, gc);
+    xcb_free_pixmap(c, pixmap);
+
+    return n;
+}
+
+/** Returns whether a DamageNotify arrived covering x, y */
+static bool
+notified(xcb_connection_t *c, uint8_t first_event, int x, int y)
+{
+    xcb_generic_event_t *event;
+    bool found = false;
+
+    free(xcb_get_input_focus_reply(c, xcb_get_input_focus(c), NULL));
+    while ((event = xcb_poll_for_event(c))) {
+        xcb_damage_notify_event_t *notify =
+            (xcb_damage_notify_event_t *) event;
+
+        if ((event->response_type & 0x7f) == first_event + XCB_DAMAGE_NOTIFY &&
+            covered(&notify->area, 1, x, y))
+            found = true;
+        free(event);
+    }
+    return found;
+}
+
+/**
+ * Draws two opposite corners of a pixmap watched by a DeltaRectangles
+ * damage object limited to one rectangle, then the middle.
+ */
+static void
+check_delta(xcb_connection_t *c, xcb_screen_t *screen, uint8_t first_event)
+{
+    xcb_pixmap_t pixmap = xcb_generate_id(c);
+    xcb_gcontext_t gc = xcb_generate_id(c);
+    xcb_damage_damage_t damage = xcb_generate_id(c);
+    xcb_rectangle_t corners[2] = {
+        { 0, 0, 1, 1 },
+        { SIZE - 1, SIZE - 1, 1, 1 },
+    };
+    xcb_rectangle_t middle = { SIZE / 2, SIZE / 2, 1, 1 };
+
+    xcb_create_pixmap(c, screen->root_depth, pixmap, screen->root,
+                      SIZE, SIZE);
+    xcb_create_gc(c, gc, pixmap, 0, NULL);
+    xcb_damage_create(c, damage, pixmap,
+                      XCB_DAMAGE_REPORT_LEVEL_DELTA_RECTANGLES);
+    damage_set_policy(c, damage, 1, 0);
+
+    /* The corners are reported as one box, which covers the middle */
+    xcb_poly_fill_rectangle(c, pixmap, gc, 2, corners);
+    assert(notified(c, first_event, SIZE / 2, SIZE / 2));
+
+    /* The middle wasn't drawn yet, so drawing it is news */
+    xcb_poly_fill_rectangle(c, pixmap, gc, 1, &middle);
+    assert(notified(c, first_event, SIZE / 2, SIZE / 2));
+
+    xcb_damage_destroy(c, damage);
+    xcb_free_gc(c, gc);
+    xcb_free_pixmap(c, pixmap);
+}
+
+int
+main(int argc, char **argv)
+{
+    xcb_connection_t *c = xcb_connect(NULL, NULL);
+    xcb_screen_t *screen;
+    xcb_damage_query_version_reply_t *damage_version;
+    xcb_xfixes_query_version_reply_t *xfixes_version;
+    int exact, limited;
+
+    assert(!xcb_connection_has_error(c));
+    screen = xcb_setup_roots_iterator(xcb_get_setup(c)).data;
+
+    damage_version =
+        xcb_damage_query_version_reply(c, xcb_damage_query_version(c, 1, 2),
+                                       NULL);
+    assert(damage_version);
+    if (damage_version->minor_version < 2) {
+        fprintf(stderr, "DAMAGE 1.2 not supported, skipping\n");
+        return 77;
+    }
+    free(damage_version);
+
+    xfixes_version =
+        xcb_xfixes_query_version_reply(c, xcb_xfixes_query_version(c, 2, 0),
+                                       NULL);
+    assert(xfixes_version);
+    free(xfixes_version);
+
+    srand(1);
+    exact = damaged_rects(c, screen, 0);
+    limited = damaged_rects(c, screen, MAX_RECTS);
+
+    /* Without a policy, clients keep getting exact damage */
+    assert(exact > MAX_RECTS);
+    assert(limited > 0 && limited <= MAX_RECTS);
+
+    check_delta(c, screen,
+                xcb_get_extension_data(c, &xcb_damage_id)->first_event);
+
+    xcb_disconnect(c);
+    return 0;
+}
@@ -1766,6 +1766,7 @@ dix_double_fp_conversion(void)
  * order that they went in.
  */
 static uint32_t mieq_test_event_last_processed;
+static uint32_t mieq_test_event_count;
 
 static void
 mieq_test_event_handler(int screenNum, InternalEvent *ie, DeviceIntPtr dev)
@@ -1775,6 +1776,7 @@ mieq_test_event_handler(int screenNum, InternalEvent *ie, DeviceIntPtr dev)
     assert(e->type == ET_RawMotion);
     assert(e->flags > mieq_test_event_last_processed);
     mieq_test_event_last_processed = e->flags;
+    mieq_test_event_count++;
 }
 
 static void
@@ -1813,8 +1815,12 @@ static void
 mieq_test(void)
 {
     uint32_t next = 1;
+    CARD32 latency[MIEQ_LATENCY_BUCKETS];
+    uint32_t delivered = 0;
+    int i;
 
     mieq_test_event_last_processed = 0;
+    mieq_test_event_count = 0;
     mieqInit();
     mieqSetHandler(ET_RawMotion, mieq_test_event_handler);
 
@@ -1842,6 +1848,120 @@ mieq_test(void)
     mieq_test_generate_events(10000);
     mieqProcessInputEvents();
 
+    /* Every delivered event, and only those, is in the latency histogram */
+    mieqGetLatencyHistogram(latency);
+    for (i = 0; i < MIEQ_LATENCY_BUCKETS; i++)
+        delivered += latency[i];
+    assert(delivered == mieq_test_event_count);
+
+    mieqFini();
+}
+
+/* The coalescing test checks that queued motion is merged across the
+ * device's raw events but never across other events, and that axes only
+ * present in the merged event survive.
+ */
+static int mieq_coalesce_types[16];
+static int mieq_coalesce_count;
+static InternalEvent mieq_coalesce_motion;
+
+static void
+mieq_coalesce_handler(int screenNum, InternalEvent *ie, DeviceIntPtr dev)
+{
+    assert(mieq_coalesce_count < ARRAY_SIZE(mieq_coalesce_types));
+    mieq_coalesce_types[mieq_coalesce_count++] = ie->any.type;
+    if (ie->any.type == ET_Motion && mieq_coalesce_count == 3)
+        mieq_coalesce_motion = *ie;
+}
+
+static void
+mieq_coalesce_enqueue(DeviceIntPtr dev, int type, int axis, double value)
+{
+    InternalEvent e;
+
+    memset(&e, 0, sizeof(e));
+    e.any.header = ET_Internal;
+    e.any.type = type;
+    if (type == ET_RawMotion) {
+        e.any.length = sizeof(RawDeviceEvent);
+        e.raw_event.deviceid = dev->id;
+    }
+    else {
+        e.any.length = sizeof(DeviceEvent);
+        e.device_event.deviceid = dev->id;
+        if (axis >= 0) {
+            SetBit(e.device_event.valuators.mask, axis);
+            e.device_event.valuators.data[axis] = value;
+        }
+    }
+    e.any.time = GetTimeInMillis();
+    mieqEnqueue(dev, &e);
+}
+
+static void
+mieq_coalesce_test(void)
+{
+    static DeviceIntRec dev;
+    static SpriteInfoRec spriteInfo;
+    static SpriteRec sprite;
+    const int expected[] = {
+        ET_RawMotion, ET_RawMotion, ET_Motion, ET_ButtonPress,
+        ET_RawMotion, ET_Motion
+    };
+    int i;
+
+    memset(&dev, 0, sizeof(dev));
+    dev.spriteInfo = &spriteInfo;
+    spriteInfo.sprite = &sprite;
+    dev.id = 2;
+    dev.enabled = 1;
+    dev.coalesce_motion = TRUE;
+
+    mieq_coalesce_count = 0;
+    mieqInit();
+    mieqSetHandler(ET_Motion, mieq_coalesce_handler);
+    mieqSetHandler(ET_RawMotion, mieq_coalesce_handler);
+    mieqSetHandler(ET_ButtonPress, mieq_coalesce_handler);
+
+    mieq_coalesce_enqueue(&dev, ET_RawMotion, -1, 0);
+    mieq_coalesce_enqueue(&dev, ET_Motion, 0, 10);
+    mieq_coalesce_enqueue(&dev, ET_RawMotion, -1, 0);
+    mieq_coalesce_enqueue(&dev, ET_Motion, 1, 20);
+    mieq_coalesce_enqueue(&dev, ET_ButtonPress, -1, 0);
+    mieq_coalesce_enqueue(&dev, ET_RawMotion, -1, 0);
+    mieq_coalesce_enqueue(&dev, ET_Motion, 0, 30);
+    mieqProcessInputEvents();
+
+    assert(mieq_coalesce_count == ARRAY_SIZE(expected));
+    for (i = 0; i < ARRAY_SIZE(expected); i++)
+        assert(mieq_coalesce_types[i] == expected[i]);
+    assert(BitIsOn(mieq_coalesce_motion.device_event.valuators.mask, 0));
+    assert(BitIsOn(mieq_coalesce_motion.device_event.valuators.mask, 1));
+    assert(mieq_coalesce_motion.device_event.valuators.data[0] == 10);
+    assert(mieq_coalesce_motion.device_event.valuators.data[1] == 20);
+    assert(mieqGetCoalescedMotionCount() == 1);
+
+    /* without the device policy nothing is merged across raw events */
+    dev.coalesce_motion = FALSE;
+    mieq_coalesce_count = 0;
+    mieq_coalesce_enqueue(&dev, ET_Motion, 0, 10);
+    mieq_coalesce_enqueue(&dev, ET_RawMotion, -1, 0);
+    mieq_coalesce_enqueue(&dev, ET_Motion, 1, 20);
+    mieqProcessInputEvents();
+    assert(mieq_coalesce_count == 3);
+    assert(mieqGetCoalescedMotionCount() == 1);
+
+    /* adjacent motion is still merged, but not counted */
+    mieq_coalesce_count = 0;
+    mieq_coalesce_enqueue(&dev, ET_Motion, 0, 10);
+    mieq_coalesce_enqueue(&dev, ET_Motion, 0, 20);
+    mieqProcessInputEvents();
+    assert(mieq_coalesce_count == 1);
+    assert(mieqGetCoalescedMotionCount() == 1);
+
+    mieqSetHandler(ET_Motion, NULL);
+    mieqSetHandler(ET_RawMotion, NULL);
+    mieqSetHandler(ET_ButtonPress, NULL);
     mieqFini();
 }
 
@@ -1931,6 +2051,7 @@ input_test(void)
     dix_get_master();
     input_option_test();
     mieq_test();
+    mieq_coalesce_test();
 
     return 0;
 }
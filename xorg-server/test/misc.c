@@ -33,6 +33,8 @@
 #include "scrnintstr.h"
 #include "dix.h"
 #include "dixstruct.h"
+#include "gcstruct.h"
+#include "privates.h"
 
 #include "tests-common.h"
 
@@ -223,6 +225,51 @@ bswap_test(void)
     assert(result_64 == expect_64);
 }
 
+static void
+dix_private_pools(void)
+{
+    DevPrivatePoolStatsRec before, after;
+    GCPtr gcs[4];
+    void *pixmaps[3];
+    int i;
+
+    assert(!dixGetPrivatePoolStats(PRIVATE_CLIENT, &before));
+    assert(dixGetPrivatePoolStats(PRIVATE_GC, &before));
+
+    for (i = 0; i < ARRAY_SIZE(gcs); i++)
+        gcs[i] = dixAllocateScreenObjectWithPrivates(NULL, GC, PRIVATE_GC);
+    for (i = 0; i < ARRAY_SIZE(gcs); i++)
+        dixFreeObjectWithPrivates(gcs[i], PRIVATE_GC);
+    assert(dixGetPrivatePoolStats(PRIVATE_GC, &after));
+    assert(after.allocations == before.allocations + ARRAY_SIZE(gcs));
+    assert(after.cached - before.cached ==
+           (int) (ARRAY_SIZE(gcs) - (after.reused - before.reused)));
+
+    /* freed objects are handed out again, most recently freed first */
+    before = after;
+    for (i = ARRAY_SIZE(gcs) - 1; i >= 0; i--) {
+        GCPtr pGC = dixAllocateScreenObjectWithPrivates(NULL, GC, PRIVATE_GC);
+
+        assert(pGC == gcs[i]);
+        assert(pGC->devPrivates == NULL);
+    }
+    assert(dixGetPrivatePoolStats(PRIVATE_GC, &after));
+    assert(after.reused == before.reused + ARRAY_SIZE(gcs));
+    assert(after.cached == before.cached - ARRAY_SIZE(gcs));
+    for (i = 0; i < ARRAY_SIZE(gcs); i++)
+        dixFreeObjectWithPrivates(gcs[i], PRIVATE_GC);
+
+    /* sizes are kept apart */
+    pixmaps[0] = dixAllocatePooledObject(PRIVATE_PIXMAP, 100);
+    pixmaps[1] = dixAllocatePooledObject(PRIVATE_PIXMAP, 200);
+    dixFreePooledObject(PRIVATE_PIXMAP, pixmaps[0]);
+    pixmaps[2] = dixAllocatePooledObject(PRIVATE_PIXMAP, 200);
+    assert(pixmaps[2] != pixmaps[0]);
+    memset(pixmaps[2], 0xff, 200);
+    for (i = 1; i < ARRAY_SIZE(pixmaps); i++)
+        dixFreePooledObject(PRIVATE_PIXMAP, pixmaps[i]);
+}
+
 int
 misc_test(void)
 {
@@ -230,6 +277,7 @@ misc_test(void)
     dix_update_desktop_dimensions();
     dix_request_size_checks();
     bswap_test();
+    dix_private_pools();
 
     return 0;
 }
@@ -0,0 +1,376 @@
+/**
+ * Copyright © 2026 agent <agent@local>
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice (including the next
+ *  paragraph) shall be included in all copies or substantial portions of the
+ *  Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "misc.h"
+#include "scrnintstr.h"
+#include "windowstr.h"
+#include "inputstr.h"
+#include "dixstruct.h"
+#include "mi.h"
+#include "mivalidate.h"
+
+#include "tests-common.h"
+
+/*
+ * Applies the same random configure, map and restack requests to two
+ * identical window trees, one validated incrementally and one with
+ * miValidateIncremental off, and checks that every window ends up with
+ * the same clipList, borderClip, visibility and exposures in both.
+ */
+
+#define TREES 2
+#define TOPLEVELS 16
+#define CHILDREN 3
+#define GRANDCHILDREN 2
+#define WINDOWS (TOPLEVELS * (1 + CHILDREN * (1 + GRANDCHILDREN)))
+#define OPERATIONS 2000
+
+typedef struct {
+    ScreenRec screen;
+    WindowRec root;
+    WindowOptRec root_optional;
+    WindowRec windows[WINDOWS];
+    RegionRec exposed[WINDOWS + 1];
+    RegionRec border_exposed[WINDOWS + 1];
+    int clip_notifies;
+} TreeRec, *TreePtr;
+
+static TreeRec trees[TREES];
+
+static int
+window_index(TreePtr tree, WindowPtr pWin)
+{
+    return pWin == &tree->root ? WINDOWS : pWin - tree->windows;
+}
+
+static TreePtr
+window_tree(WindowPtr pWin)
+{
+    return (TreePtr) ((char *) pWin->drawable.pScreen -
+                      offsetof(TreeRec, screen));
+}
+
+/* miHandleValidateExposures, recording the exposures instead of painting */
+static void
+record_exposures(WindowPtr pWin)
+{
+    TreePtr tree = window_tree(pWin);
+    WindowPtr pChild = pWin;
+    ValidatePtr val;
+
+    while (1) {
+        if ((val = pChild->valdata) && val != UnmapValData) {
+            int i = window_index(tree, pChild);
+
+            RegionUnion(&tree->border_exposed[i], &tree->border_exposed[i],
+                        &val->after.borderExposed);
+            RegionUnion(&tree->exposed[i], &tree->exposed[i],
+                        &val->after.exposed);
+            RegionUninit(&val->after.borderExposed);
+            RegionUninit(&val->after.exposed);
+            free(val);
+            pChild->valdata = NULL;
+            if (pChild->firstChild) {
+                pChild = pChild->firstChild;
+                continue;
+            }
+        }
+        while (!pChild->nextSib && (pChild != pWin))
+            pChild = pChild->parent;
+        if (pChild == pWin)
+            break;
+        pChild = pChild->nextSib;
+    }
+}
+
+static void
+count_clip_notify(WindowPtr pWin, int dx, int dy)
+{
+    window_tree(pWin)->clip_notifies++;
+}
+
+static Bool
+position_window(WindowPtr pWin, int x, int y)
+{
+    return TRUE;
+}
+
+static Bool
+realize_window(WindowPtr pWin)
+{
+    return TRUE;
+}
+
+static void
+copy_window(WindowPtr pWin, DDXPointRec oldOrigin, RegionPtr prgnSrc)
+{
+}
+
+static void
+init_window(WindowPtr pWin, WindowPtr pParent, ScreenPtr pScreen,
+            int x, int y, int w, int h, int bw)
+{
+    pWin->drawable.type = DRAWABLE_WINDOW;
+    pWin->drawable.class = InputOutput;
+    pWin->drawable.depth = 24;
+    pWin->drawable.pScreen = pScreen;
+    pWin->drawable.width = w;
+    pWin->drawable.height = h;
+    pWin->borderWidth = bw;
+    pWin->borderIsPixel = TRUE;
+    pWin->cursorIsNone = TRUE;
+    pWin->winGravity = NorthWestGravity;
+    pWin->visibility = VisibilityNotViewable;
+    RegionNull(&pWin->clipList);
+    RegionNull(&pWin->borderClip);
+    RegionNull(&pWin->winSize);
+    RegionNull(&pWin->borderSize);
+
+    if (!pParent)
+        return;
+    pWin->parent = pParent;
+    pWin->origin.x = x + bw;
+    pWin->origin.y = y + bw;
+    pWin->drawable.x = pParent->drawable.x + x + bw;
+    pWin->drawable.y = pParent->drawable.y + y + bw;
+    pWin->nextSib = pParent->firstChild;
+    if (pParent->firstChild)
+        pParent->firstChild->prevSib = pWin;
+    else
+        pParent->lastChild = pWin;
+    pParent->firstChild = pWin;
+    SetWinSize(pWin);
+    SetBorderSize(pWin);
+}
+
+static void
+init_tree(TreePtr tree, unsigned seed)
+{
+    ScreenPtr pScreen = &tree->screen;
+    WindowPtr pRoot = &tree->root;
+    BoxRec box = { 0, 0, 640, 480 };
+    int i, j, k, n = 0;
+
+    memset(tree, 0, sizeof(*tree));
+    pScreen->root = pRoot;
+    pScreen->MarkOverlappedWindows = miMarkOverlappedWindows;
+    pScreen->MarkWindow = miMarkWindow;
+    pScreen->ValidateTree = miValidateTree;
+    pScreen->HandleExposures = record_exposures;
+    pScreen->GetLayerWindow = miGetLayerWindow;
+    pScreen->MarkUnrealizedWindow = miMarkUnrealizedWindow;
+    pScreen->MoveWindow = miMoveWindow;
+    pScreen->ResizeWindow = miResizeWindow;
+    pScreen->ChangeBorderWidth = miChangeBorderWidth;
+    pScreen->PositionWindow = position_window;
+    pScreen->RealizeWindow = realize_window;
+    pScreen->UnrealizeWindow = realize_window;
+    pScreen->CopyWindow = copy_window;
+    pScreen->ClipNotify = count_clip_notify;
+
+    init_window(pRoot, NULL, pScreen, 0, 0, box.x2, box.y2, 0);
+    pRoot->optional = &tree->root_optional;
+    pRoot->mapped = pRoot->realized = pRoot->viewable = TRUE;
+    pRoot->visibility = VisibilityUnobscured;
+    RegionReset(&pRoot->winSize, &box);
+    RegionReset(&pRoot->borderSize, &box);
+    RegionReset(&pRoot->clipList, &box);
+    RegionReset(&pRoot->borderClip, &box);
+    for (i = 0; i <= WINDOWS; i++) {
+        RegionNull(&tree->exposed[i]);
+        RegionNull(&tree->border_exposed[i]);
+    }
+
+    srand(seed);
+    for (i = 0; i < TOPLEVELS; i++) {
+        WindowPtr top = &tree->windows[n++];
+
+        init_window(top, pRoot, pScreen, rand() % 560 - 40, rand() % 400 - 40,
+                    40 + rand() % 200, 40 + rand() % 160, rand() % 3);
+        for (j = 0; j < CHILDREN; j++) {
+            WindowPtr child = &tree->windows[n++];
+
+            init_window(child, top, pScreen, rand() % 120, rand() % 100,
+                        10 + rand() % 100, 10 + rand() % 80, rand() % 2);
+            for (k = 0; k < GRANDCHILDREN; k++)
+                init_window(&tree->windows[n++], child, pScreen,
+                            rand() % 60, rand() % 50,
+                            5 + rand() % 50, 5 + rand() % 40, 0);
+        }
+    }
+    assert(n == WINDOWS);
+}
+
+static void
+fini_tree(TreePtr tree)
+{
+    int i;
+
+    for (i = 0; i <= WINDOWS; i++) {
+        WindowPtr pWin = i < WINDOWS ? &tree->windows[i] : &tree->root;
+
+        RegionUninit(&pWin->clipList);
+        RegionUninit(&pWin->borderClip);
+        RegionUninit(&pWin->winSize);
+        RegionUninit(&pWin->borderSize);
+        RegionUninit(&tree->exposed[i]);
+        RegionUninit(&tree->border_exposed[i]);
+    }
+}
+
+/* empty regions compare equal whatever extents they were left with */
+static Bool
+same_region(RegionPtr a, RegionPtr b)
+{
+    if (RegionNil(a) || RegionNil(b))
+        return RegionNil(a) && RegionNil(b);
+    return RegionEqual(a, b);
+}
+
+static void
+compare_trees(TreePtr a, TreePtr b)
+{
+    int i;
+
+    for (i = 0; i <= WINDOWS; i++) {
+        WindowPtr wa = i < WINDOWS ? &a->windows[i] : &a->root;
+        WindowPtr wb = i < WINDOWS ? &b->windows[i] : &b->root;
+
+        assert(wa->viewable == wb->viewable);
+        assert(wa->visibility == wb->visibility);
+        assert(same_region(&wa->clipList, &wb->clipList));
+        assert(same_region(&wa->borderClip, &wb->borderClip));
+        assert(same_region(&a->exposed[i], &b->exposed[i]));
+        assert(same_region(&a->border_exposed[i], &b->border_exposed[i]));
+        RegionEmpty(&a->exposed[i]);
+        RegionEmpty(&b->exposed[i]);
+        RegionEmpty(&a->border_exposed[i]);
+        RegionEmpty(&b->border_exposed[i]);
+    }
+}
+
+static void
+random_request(TreePtr tree, unsigned r)
+{
+    WindowPtr pWin = &tree->windows[r % WINDOWS];
+    XID vlist[4];
+
+    r /= WINDOWS;
+    switch (r % 8) {
+    case 0:
+    case 1:
+        vlist[0] = (INT16) ((r >> 3) % 300) - 40;
+        vlist[1] = (INT16) ((r >> 12) % 200) - 40;
+        ConfigureWindow(pWin, CWX | CWY, vlist, serverClient);
+        break;
+    case 2:
+        vlist[0] = 5 + (r >> 3) % 150;
+        vlist[1] = 5 + (r >> 12) % 120;
+        ConfigureWindow(pWin, CWWidth | CWHeight, vlist, serverClient);
+        break;
+    case 3:
+        vlist[0] = (r >> 3) % 2 ? Above : Below;
+        ConfigureWindow(pWin, CWStackMode, vlist, serverClient);
+        break;
+    case 4:
+        vlist[0] = (r >> 3) % 4;
+        ConfigureWindow(pWin, CWBorderWidth, vlist, serverClient);
+        break;
+    case 5:
+        if (pWin->mapped)
+            UnmapWindow(pWin, FALSE);
+        else
+            MapWindow(pWin, serverClient);
+        break;
+    case 6:
+        if ((r >> 3) % 2)
+            MapSubwindows(pWin, serverClient);
+        else
+            UnmapSubwindows(pWin);
+        break;
+    case 7:
+        MapWindow(pWin, serverClient);
+        break;
+    }
+}
+
+static void
+mivaltree_random_trees(unsigned seed)
+{
+    Bool incremental = miValidateIncremental;
+    int i, t;
+
+    for (t = 0; t < TREES; t++) {
+        init_tree(&trees[t], seed);
+        /* map bottom-up, so most of the tree is realized in one go */
+        miValidateIncremental = t == 0;
+        for (i = WINDOWS - 1; i >= 0; i--)
+            MapWindow(&trees[t].windows[i], serverClient);
+    }
+    compare_trees(&trees[0], &trees[1]);
+
+    srand(seed);
+    for (i = 0; i < OPERATIONS; i++) {
+        unsigned r = rand();
+
+        for (t = 0; t < TREES; t++) {
+            miValidateIncremental = t == 0;
+            random_request(&trees[t], r);
+        }
+        compare_trees(&trees[0], &trees[1]);
+    }
+
+    /* windows that were passed over still get their clips notified */
+    assert(trees[0].clip_notifies == trees[1].clip_notifies);
+
+    miValidateIncremental = incremental;
+    for (t = 0; t < TREES; t++)
+        fini_tree(&trees[t]);
+}
+
+int
+mivaltree_test(void)
+{
+    InputInfo saved_input = inputInfo;
+    static DeviceIntRec core;
+    unsigned seed;
+
+    /* UnmapWindow looks for grabs on the core devices */
+    memset(&inputInfo, 0, sizeof(inputInfo));
+    inputInfo.pointer = inputInfo.keyboard = &core;
+
+    for (seed = 1; seed <= 8; seed++)
+        mivaltree_random_trees(seed);
+
+    inputInfo = saved_input;
+    return 0;
+}
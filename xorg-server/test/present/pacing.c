@@ -0,0 +1,193 @@
+/*
+ * Copyright © 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/** @file
+ *
+ * Checks the vblanks Present emulates on screens without hardware.  Run
+ * against a server started with -fakescreenfps 100, it waits for a series
+ * of MSCs and checks that every one is reported with a UST exactly 10ms
+ * apart and is never delivered before that time.  With the argument
+ * "unthrottled", for a server started with -fakescreenfps unthrottled, it
+ * checks that any MSC completes straight away.
+ *
+ * Pixmaps presented on consecutive MSCs must complete on them, exactly
+ * one frame apart.
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <xcb/present.h>
+
+#define FPS 100
+#define FRAMES 20
+#define UNTHROTTLED_MSC 100000
+
+struct complete {
+    uint64_t ust, msc;
+    uint64_t arrived;
+};
+
+static uint64_t
+now_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000ull + ts.tv_nsec / 1000;
+}
+
+/** Waits for the next CompleteNotify of the window */
+static void
+wait_complete(xcb_connection_t *c, uint8_t opcode, uint8_t kind,
+              uint32_t serial, struct complete *complete)
+{
+    xcb_generic_event_t *event;
+
+    while ((event = xcb_wait_for_event(c))) {
+        xcb_present_complete_notify_event_t *ce =
+            (xcb_present_complete_notify_event_t *) event;
+
+        if (event->response_type == XCB_GE_GENERIC &&
+            ce->extension == opcode &&
+            ce->event_type == XCB_PRESENT_EVENT_COMPLETE_NOTIFY) {
+            assert(ce->kind == kind);
+            assert(ce->serial == serial);
+            complete->ust = ce->ust;
+            complete->msc = ce->msc;
+            complete->arrived = now_us();
+            free(event);
+            return;
+        }
+        free(event);
+    }
+    assert(!"connection closed");
+}
+
+/** Presents a pixmap on each of the next FRAMES MSCs */
+static void
+check_pixmap_pacing(xcb_connection_t *c, uint8_t opcode, xcb_window_t window,
+                    uint64_t msc)
+{
+    xcb_screen_t *screen = xcb_setup_roots_iterator(xcb_get_setup(c)).data;
+    xcb_pixmap_t pixmap = xcb_generate_id(c);
+    struct complete first, frame;
+    int i;
+
+    xcb_create_pixmap(c, screen->root_depth, pixmap, window, 64, 64);
+    for (i = 1; i <= FRAMES; i++) {
+        xcb_present_pixmap(c, window, pixmap, 1000 + i, 0, 0, 0, 0, 0, 0, 0,
+                           0, msc + i, 0, 0, 0, NULL);
+        xcb_flush(c);
+        wait_complete(c, opcode, XCB_PRESENT_COMPLETE_KIND_PIXMAP, 1000 + i,
+                      &frame);
+        assert(frame.msc == msc + i);
+        if (i == 1)
+            first = frame;
+        assert(frame.ust - first.ust == (uint64_t) (i - 1) * 1000000 / FPS);
+    }
+    xcb_free_pixmap(c, pixmap);
+}
+
+int
+main(int argc, char **argv)
+{
+    xcb_connection_t *c = xcb_connect(NULL, NULL);
+    bool unthrottled = argc > 1 && !strcmp(argv[1], "unthrottled");
+    const xcb_query_extension_reply_t *ext;
+    xcb_screen_t *screen;
+    xcb_window_t window;
+    struct complete base, frame;
+    uint64_t start;
+    int i;
+
+    assert(!xcb_connection_has_error(c));
+    ext = xcb_get_extension_data(c, &xcb_present_id);
+    assert(ext && ext->present);
+    screen = xcb_setup_roots_iterator(xcb_get_setup(c)).data;
+
+    window = xcb_generate_id(c);
+    xcb_create_window(c, XCB_COPY_FROM_PARENT, window, screen->root,
+                      0, 0, 64, 64, 0, XCB_WINDOW_CLASS_INPUT_OUTPUT,
+                      XCB_COPY_FROM_PARENT, 0, NULL);
+    xcb_map_window(c, window);
+    xcb_present_select_input(c, xcb_generate_id(c), window,
+                             XCB_PRESENT_EVENT_MASK_COMPLETE_NOTIFY);
+
+    /* A past MSC completes at once with the current one */
+    xcb_present_notify_msc(c, window, 0, 0, 0, 0);
+    xcb_flush(c);
+    wait_complete(c, ext->major_opcode,
+                  XCB_PRESENT_COMPLETE_KIND_NOTIFY_MSC, 0, &base);
+
+    if (unthrottled) {
+        start = now_us();
+        xcb_present_notify_msc(c, window, 1, base.msc + UNTHROTTLED_MSC, 0, 0);
+        xcb_flush(c);
+        wait_complete(c, ext->major_opcode,
+                      XCB_PRESENT_COMPLETE_KIND_NOTIFY_MSC, 1, &frame);
+        assert(frame.msc == base.msc + UNTHROTTLED_MSC);
+        printf("msc %llu completed after %.3f ms\n",
+               (unsigned long long) frame.msc, (now_us() - start) / 1000.0);
+        assert(now_us() - start < 1000000);
+    } else {
+        uint64_t worst = 0;
+
+        /* One at a time, as a client pacing its frames would */
+        for (i = 1; i <= FRAMES; i++) {
+            xcb_present_notify_msc(c, window, i, base.msc + i, 0, 0);
+            xcb_flush(c);
+            wait_complete(c, ext->major_opcode,
+                          XCB_PRESENT_COMPLETE_KIND_NOTIFY_MSC, i, &frame);
+
+            assert(frame.msc == base.msc + i);
+            assert(frame.ust - base.ust == (uint64_t) i * 1000000 / FPS);
+            assert(frame.arrived >= frame.ust);
+            if (frame.arrived - frame.ust > worst)
+                worst = frame.arrived - frame.ust;
+        }
+        printf("%d frames, worst delivery latency %llu us\n", FRAMES,
+               (unsigned long long) worst);
+
+        /* Divisor and remainder land on the right vblank too */
+        xcb_present_notify_msc(c, window, 100, 0, 4, 3);
+        xcb_flush(c);
+        wait_complete(c, ext->major_opcode,
+                      XCB_PRESENT_COMPLETE_KIND_NOTIFY_MSC, 100, &frame);
+        assert(frame.msc % 4 == 3 && frame.msc > base.msc + FRAMES);
+        assert((frame.ust - base.ust) * FPS ==
+               (frame.msc - base.msc) * 1000000);
+
+        check_pixmap_pacing(c, ext->major_opcode, window, frame.msc);
+    }
+
+    assert(!xcb_connection_has_error(c));
+    xcb_disconnect(c);
+    return 0;
+}
@@ -0,0 +1,257 @@
+/**
+ * Copyright © 2026 agent <agent@local>
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice (including the next
+ *  paragraph) shall be included in all copies or substantial portions of the
+ *  Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <X11/X.h>
+#include <X11/Xproto.h>
+#include <X11/Xatom.h>
+#include "misc.h"
+#include "resource.h"
+#include "windowstr.h"
+#include "dixstruct.h"
+#include "propertyst.h"
+#include "../dix/dispatch.h"
+
+#include "tests-common.h"
+
+/*
+ * Checks that properties are found through the window's property index,
+ * both while it is an inline array and once it has become a hash table,
+ * and that the index follows deletions and RotateProperties.
+ */
+
+#define NPROPS 63               /* just short of growing the table again */
+#define NATOMS 1024
+
+static ClientRec server_client;
+static ClientRec client;
+static WindowRec root;
+static WindowOptRec root_optional;
+static Atom names[NPROPS];
+
+static void
+property_init(void)
+{
+    Atom atoms[NATOMS], tmp;
+    char name[32];
+    int i, j;
+
+    dixResetPrivates();
+    serverClient = &server_client;
+    InitClient(serverClient, 0, (void *) NULL);
+    if (!InitClientResources(serverClient))
+        FatalError("couldn't init server resources");
+    InitAtoms();
+
+    root.drawable.type = DRAWABLE_WINDOW;
+    root.drawable.id = FakeClientID(0);
+    root.optional = &root_optional;
+    assert(AddResource(root.drawable.id, RT_WINDOW, &root));
+
+    for (i = 0; i < NATOMS; i++) {
+        snprintf(name, sizeof(name), "PROPERTY_TEST_%d", i);
+        atoms[i] = MakeAtom(name, strlen(name), TRUE);
+        assert(atoms[i] != None);
+    }
+
+    /* Consecutive atoms hardly ever collide in the table, so pick the
+     * names at random to exercise probing and deletion.
+     */
+    srand(0);
+    for (i = 0; i < NPROPS; i++) {
+        j = i + rand() % (NATOMS - i);
+        tmp = atoms[i];
+        atoms[i] = atoms[j];
+        atoms[j] = tmp;
+        names[i] = atoms[i];
+    }
+}
+
+static void
+property_set(int i, CARD32 value)
+{
+    int rc = dixChangeWindowProperty(&client, &root, names[i], XA_INTEGER,
+                                     32, PropModeReplace, 1, &value, FALSE);
+
+    assert(rc == Success);
+}
+
+/* Return the value of property i, or -1 if it is not set */
+static int
+property_get(int i)
+{
+    PropertyPtr prop;
+    int rc;
+
+    rc = dixLookupProperty(&prop, &root, names[i], &client, DixReadAccess);
+    if (rc == BadMatch) {
+        assert(!prop);
+        return -1;
+    }
+    assert(rc == Success);
+    assert(prop->propertyName == names[i]);
+    assert(prop->size == 1);
+    return *(CARD32 *) prop->data;
+}
+
+static void
+property_delete(int i)
+{
+    assert(DeleteProperty(&client, &root, names[i]) == Success);
+}
+
+static void
+property_rotate(int first, int count, int positions)
+{
+    struct {
+        xRotatePropertiesReq req;
+        CARD32 atoms[NPROPS];
+    } request;
+    int i;
+
+    request.req.reqType = X_RotateProperties;
+    request.req.window = root.drawable.id;
+    request.req.nAtoms = count;
+    request.req.nPositions = positions;
+    for (i = 0; i < count; i++)
+        request.atoms[i] = names[first + i];
+    request.req.length = bytes_to_int32(sizeof(request.req)) + count;
+    client.requestBuffer = &request;
+    client.req_len = request.req.length;
+
+    assert(ProcRotateProperties(&client) == Success);
+}
+
+/* Properties must stay in the list newest first */
+static void
+property_check_order(void)
+{
+    PropertyPtr prop;
+    int i = NPROPS;
+
+    for (prop = wUserProps(&root); prop; prop = prop->next) {
+        while (--i >= 0 && names[i] != prop->propertyName);
+        assert(i >= 0);
+    }
+}
+
+static void
+property_lookup_delete(void)
+{
+    int i, j;
+
+    /* Grow the index past the inline array into a hash table */
+    for (i = 0; i < NPROPS; i++) {
+        property_set(i, i);
+        for (j = 0; j < NPROPS; j++)
+            assert(property_get(j) == (j <= i ? j : -1));
+    }
+    property_check_order();
+
+    /* Replacing a value leaves the property in place */
+    property_set(3, 1003);
+    assert(property_get(3) == 1003);
+    property_set(3, 3);
+    property_check_order();
+
+    /* Deleting every third property shifts back the others in the table */
+    for (i = 0; i < NPROPS; i += 3)
+        property_delete(i);
+    for (i = 0; i < NPROPS; i++)
+        assert(property_get(i) == (i % 3 ? i : -1));
+    property_check_order();
+
+    /* Deleting a missing property succeeds and changes nothing */
+    property_delete(0);
+    assert(property_get(1) == 1);
+
+    for (i = 0; i < NPROPS; i++)
+        if (i % 3)
+            property_delete(i);
+    for (i = 0; i < NPROPS; i++)
+        assert(property_get(i) == -1);
+
+    /* The index goes away with the last property */
+    assert(!root_optional.userProps);
+    assert(!root_optional.userPropIndex);
+
+    /* Deleting from the inline array moves the last name into the hole */
+    for (i = 0; i < 5; i++)
+        property_set(i, i);
+    property_delete(1);
+    property_delete(4);
+    for (i = 0; i < 5; i++)
+        assert(property_get(i) == (i == 1 || i == 4 ? -1 : i));
+    property_check_order();
+    property_delete(0);
+    property_delete(2);
+    property_delete(3);
+    assert(!root_optional.userPropIndex);
+}
+
+static void
+property_rotate_values(void)
+{
+    int i;
+
+    for (i = 0; i < NPROPS; i++)
+        property_set(i, i);
+
+    /* Rotation moves the values and keeps the names where they are */
+    property_rotate(10, 5, 1);
+    for (i = 0; i < NPROPS; i++)
+        assert(property_get(i) == (i < 10 || i >= 15 ? i :
+                                   i == 10 ? 14 : i - 1));
+    property_rotate(10, 5, -1);
+    for (i = 0; i < NPROPS; i++)
+        assert(property_get(i) == i);
+
+    /* A full turn changes nothing */
+    property_rotate(0, NPROPS, NPROPS);
+    for (i = 0; i < NPROPS; i++)
+        assert(property_get(i) == i);
+    property_check_order();
+
+    for (i = 0; i < NPROPS; i++)
+        property_delete(i);
+    assert(!root_optional.userPropIndex);
+}
+
+int
+property_test(void)
+{
+    property_init();
+    property_lookup_delete();
+    property_rotate_values();
+
+    FreeResourceByType(root.drawable.id, RT_WINDOW, TRUE);
+    return 0;
+}
@@ -0,0 +1,274 @@
+/*
+ * Copyright © 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/** @file
+ *
+ * Records the requests of one client through a RECORD context enabled
+ * with EnableContextFd, which writes the data into a ring buffer in shared
+ * memory.  With a ring large enough, every request must arrive; with a
+ * small ring nobody reads, the client must still run at full speed and
+ * the requests that did not fit must be counted as dropped.
+ */
+
+/* Test relies on assert() */
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <xcb/xcbext.h>
+#include <xcb/record.h>
+
+#define ENABLE_CONTEXT_FD 8
+#define CATEGORY_FROM_CLIENT 1
+#define CATEGORY_END_OF_DATA 5
+#define CATEGORY_RING_DATA 6
+#define REQUESTS 10000
+
+/** xRecordRingHeader */
+struct ring_header {
+    uint32_t size;
+    uint32_t head;
+    uint32_t dropped;
+    uint32_t dropped_bytes;
+    uint32_t pad0[12];
+    uint32_t tail;
+    uint32_t waiting;
+    uint32_t pad1[14];
+};
+
+/** xRecordEnableContextReply */
+struct record_reply {
+    uint8_t type;
+    uint8_t category;
+    uint16_t sequence;
+    uint32_t length;
+    uint8_t element_header;
+    uint8_t client_swapped;
+    uint16_t pad1;
+    uint32_t id_base;
+    uint32_t server_time;
+    uint32_t recorded_sequence;
+    uint32_t pad2[2];
+};
+
+struct ring {
+    struct ring_header *header;
+    uint8_t *data;
+    int fd;
+};
+
+static void
+ring_create(struct ring *ring, uint32_t size)
+{
+    ring->fd = memfd_create("record-ring", MFD_CLOEXEC);
+    assert(ring->fd >= 0);
+    assert(ftruncate(ring->fd, sizeof(struct ring_header) + size) == 0);
+    ring->header = mmap(NULL, sizeof(struct ring_header) + size,
+                        PROT_READ | PROT_WRITE, MAP_SHARED, ring->fd, 0);
+    assert(ring->header != MAP_FAILED);
+    ring->data = (uint8_t *) (ring->header + 1);
+    ring->header->waiting = 1;
+}
+
+static void
+ring_copy(struct ring *ring, uint32_t pos, void *dst, uint32_t len)
+{
+    uint32_t i;
+
+    for (i = 0; i < len; i++)
+        ((uint8_t *) dst)[i] = ring->data[(pos + i) & (ring->header->size - 1)];
+}
+
+/** Counts the core requests with the given opcode in the ring */
+static int
+ring_count_requests(struct ring *ring, uint8_t opcode)
+{
+    uint32_t head = __atomic_load_n(&ring->header->head, __ATOMIC_ACQUIRE);
+    uint32_t tail = ring->header->tail;
+    int count = 0;
+
+    while (tail != head) {
+        struct record_reply reply;
+        uint32_t pos, end;
+
+        ring_copy(ring, tail, &reply, sizeof(reply));
+        assert(reply.type == 1);  /* X_Reply */
+        pos = tail + sizeof(reply);
+        end = pos + reply.length * 4;
+
+        if (reply.category == CATEGORY_FROM_CLIENT) {
+            while (pos != end) {
+                uint8_t req[4];
+                uint16_t length;
+
+                ring_copy(ring, pos, req, sizeof(req));
+                memcpy(&length, req + 2, sizeof(length));
+                assert(length);
+                if (req[0] == opcode)
+                    count++;
+                pos += length * 4;
+            }
+        }
+        tail = end;
+    }
+
+    __atomic_store_n(&ring->header->tail, tail, __ATOMIC_RELEASE);
+    return count;
+}
+
+static unsigned int
+enable_context_fd(xcb_connection_t *c, xcb_record_context_t context,
+                  struct ring *ring, uint32_t size)
+{
+    struct {
+        uint8_t major, minor;
+        uint16_t length;
+        uint32_t context;
+        uint32_t size;
+    } req = { 0, ENABLE_CONTEXT_FD, 3, context, size };
+    xcb_protocol_request_t xr = {
+        .count = 2,
+        .ext = &xcb_record_id,
+        .opcode = ENABLE_CONTEXT_FD,
+        .isvoid = 0,
+    };
+    struct iovec parts[4];
+    int fds[1] = { ring->fd };
+
+    parts[2].iov_base = &req;
+    parts[2].iov_len = sizeof(req);
+    parts[3].iov_base = NULL;
+    parts[3].iov_len = 0;
+    return xcb_send_request_with_fds(c, XCB_REQUEST_CHECKED, parts + 2, &xr,
+                                     1, fds);
+}
+
+/** Returns the category of the next reply on the data connection */
+static int
+wait_reply(xcb_connection_t *c, unsigned int sequence)
+{
+    xcb_generic_error_t *error = NULL;
+    struct record_reply *reply = xcb_wait_for_reply(c, sequence, &error);
+    int category;
+
+    assert(reply && !error);
+    assert(reply->length == 0);
+    category = reply->category;
+    free(reply);
+    return category;
+}
+
+static void
+record(uint32_t size, int *recorded, uint32_t *dropped)
+{
+    xcb_connection_t *ctl = xcb_connect(NULL, NULL);
+    xcb_connection_t *data = xcb_connect(NULL, NULL);
+    xcb_connection_t *traffic = xcb_connect(NULL, NULL);
+    const xcb_query_extension_reply_t *ext;
+    xcb_record_query_version_reply_t *version;
+    xcb_record_context_t context;
+    xcb_record_client_spec_t spec;
+    xcb_record_range_t range = { 0 };
+    struct ring ring;
+    unsigned int sequence;
+    int i;
+
+    assert(!xcb_connection_has_error(ctl));
+    assert(!xcb_connection_has_error(data));
+    assert(!xcb_connection_has_error(traffic));
+    ext = xcb_get_extension_data(data, &xcb_record_id);
+    assert(ext && ext->present);
+    version = xcb_record_query_version_reply(data,
+                                             xcb_record_query_version(data, 1, 14),
+                                             NULL);
+    assert(version);
+    if (version->major_version == 1 && version->minor_version < 14) {
+        fprintf(stderr, "RECORD 1.14 not supported, skipping\n");
+        exit(77);
+    }
+    free(version);
+
+    /* All core requests, the common case */
+    context = xcb_generate_id(ctl);
+    spec = xcb_get_setup(traffic)->resource_id_base;
+    range.core_requests.first = 1;
+    range.core_requests.last = 127;
+    assert(!xcb_request_check(ctl,
+                              xcb_record_create_context_checked(ctl, context, 0,
+                                                                1, 1, &spec,
+                                                                &range)));
+
+    ring_create(&ring, size);
+    sequence = enable_context_fd(data, context, &ring, size);
+    xcb_flush(data);
+    close(ring.fd);
+
+    /* StartOfData is written at once, and we asked to be woken up */
+    assert(wait_reply(data, sequence) == CATEGORY_RING_DATA);
+
+    for (i = 0; i < REQUESTS; i++)
+        xcb_no_operation(traffic);
+    free(xcb_get_input_focus_reply(traffic, xcb_get_input_focus(traffic),
+                                   NULL));
+
+    xcb_record_disable_context(ctl, context);
+    xcb_flush(ctl);
+    while (wait_reply(data, sequence) != CATEGORY_END_OF_DATA)
+        ;
+
+    *recorded = ring_count_requests(&ring, XCB_NO_OPERATION);
+    *dropped = ring.header->dropped;
+
+    xcb_record_free_context(ctl, context);
+    assert(!xcb_connection_has_error(ctl));
+    assert(!xcb_connection_has_error(data));
+    xcb_disconnect(traffic);
+    xcb_disconnect(data);
+    xcb_disconnect(ctl);
+    munmap(ring.header, sizeof(struct ring_header) + size);
+}
+
+int
+main(int argc, char **argv)
+{
+    int recorded;
+    uint32_t dropped;
+
+    record(1 << 20, &recorded, &dropped);
+    printf("1M ring: %d recorded, %u dropped\n", recorded, dropped);
+    assert(recorded == REQUESTS && dropped == 0);
+
+    record(4096, &recorded, &dropped);
+    printf("4k ring: %d recorded, %u dropped\n", recorded, dropped);
+    assert(dropped > 0 && recorded < REQUESTS);
+    /* GetInputFocus and EndOfData may have been dropped too */
+    assert(recorded + dropped >= REQUESTS &&
+           recorded + dropped <= REQUESTS + 2);
+
+    return 0;
+}
@@ -0,0 +1,326 @@
+/*
+ * Copyright © 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/** @file
+ *
+ * Times full screen sized Render operations: a scaled, rotated and
+ * bilinear filtered composite, a set of large antialiased trapezoids and a
+ * screen full of text.  These are the operations fb splits into bands
+ * rendered by several threads, so running this against Xvfb started with
+ * different -renderthreads values shows how well they scale.
+ */
+
+/* Benchmark relies on assert() */
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <xcb/render.h>
+
+#define WIDTH 1920
+#define HEIGHT 1080
+#define SOURCE_SIZE 512
+#define NTRAPS 64
+#define NGLYPHS 94
+#define GLYPH_WIDTH 9
+#define GLYPH_HEIGHT 16
+#define ITERATIONS 20
+
+#define ARRAY_SIZE(x) (sizeof(x) / sizeof((x)[0]))
+
+/** GLYPHELT8 header, followed by the glyph ids */
+struct glyph_elt {
+    uint8_t len;
+    uint8_t pad[3];
+    int16_t deltax, deltay;
+};
+
+struct bench {
+    xcb_connection_t *c;
+    xcb_screen_t *screen;
+    xcb_render_pictformat_t argb32, a8;
+    xcb_render_picture_t dst, source, solid;
+    xcb_render_glyphset_t glyphset;
+};
+
+static xcb_render_fixed_t
+fixed(double d)
+{
+    return (xcb_render_fixed_t) (d * 65536);
+}
+
+static double
+now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/** Round trip, so that all queued rendering has been done. */
+static void
+sync_server(struct bench *b)
+{
+    free(xcb_get_input_focus_reply(b->c, xcb_get_input_focus(b->c), NULL));
+}
+
+static void
+find_formats(struct bench *b)
+{
+    xcb_render_query_pict_formats_reply_t *reply =
+        xcb_render_query_pict_formats_reply(b->c,
+                                            xcb_render_query_pict_formats(b->c),
+                                            NULL);
+    xcb_render_pictforminfo_iterator_t i;
+
+    assert(reply);
+    for (i = xcb_render_query_pict_formats_formats_iterator(reply);
+         i.rem; xcb_render_pictforminfo_next(&i)) {
+        xcb_render_directformat_t *d = &i.data->direct;
+
+        if (i.data->type != XCB_RENDER_PICT_TYPE_DIRECT)
+            continue;
+        if (i.data->depth == 32 && d->alpha_mask == 0xff &&
+            d->alpha_shift == 24 && d->red_shift == 16)
+            b->argb32 = i.data->id;
+        if (i.data->depth == 8 && d->alpha_mask == 0xff && !d->red_mask)
+            b->a8 = i.data->id;
+    }
+    free(reply);
+
+    assert(b->argb32 && b->a8);
+}
+
+static xcb_render_picture_t
+create_picture(struct bench *b, int width, int height)
+{
+    xcb_pixmap_t pixmap = xcb_generate_id(b->c);
+    xcb_render_picture_t picture = xcb_generate_id(b->c);
+
+    xcb_create_pixmap(b->c, 32, pixmap, b->screen->root, width, height);
+    xcb_render_create_picture(b->c, picture, pixmap, b->argb32, 0, NULL);
+    xcb_free_pixmap(b->c, pixmap);
+
+    return picture;
+}
+
+/**
+ * Fills the source with a gradient, and scales and rotates it so that
+ * every destination pixel goes through the bilinear fetcher.
+ */
+static void
+setup_source(struct bench *b)
+{
+    xcb_render_picture_t gradient = xcb_generate_id(b->c);
+    xcb_render_pointfix_t p1 = { 0, 0 };
+    xcb_render_pointfix_t p2 = { fixed(SOURCE_SIZE), fixed(SOURCE_SIZE) };
+    xcb_render_fixed_t stops[] = { 0, fixed(0.5), fixed(1) };
+    xcb_render_color_t colors[] = {
+        { 0xffff, 0x0000, 0x0000, 0xffff },
+        { 0x0000, 0xffff, 0x0000, 0x8000 },
+        { 0x0000, 0x0000, 0xffff, 0xffff },
+    };
+    xcb_render_transform_t transform = {
+        fixed(0.30), fixed(-0.10), 0,
+        fixed(0.10), fixed(0.30), 0,
+        0, 0, fixed(1),
+    };
+    uint32_t repeat = XCB_RENDER_REPEAT_NORMAL;
+
+    xcb_render_create_linear_gradient(b->c, gradient, p1, p2,
+                                      ARRAY_SIZE(stops), stops, colors);
+
+    b->source = create_picture(b, SOURCE_SIZE, SOURCE_SIZE);
+    xcb_render_composite(b->c, XCB_RENDER_PICT_OP_SRC, gradient, XCB_NONE,
+                         b->source, 0, 0, 0, 0, 0, 0,
+                         SOURCE_SIZE, SOURCE_SIZE);
+    xcb_render_free_picture(b->c, gradient);
+
+    xcb_render_set_picture_transform(b->c, b->source, transform);
+    xcb_render_set_picture_filter(b->c, b->source, strlen("bilinear"),
+                                  "bilinear", 0, NULL);
+    xcb_render_change_picture(b->c, b->source, XCB_RENDER_CP_REPEAT,
+                              &repeat);
+}
+
+static void
+setup_glyphs(struct bench *b)
+{
+    uint32_t ids[NGLYPHS];
+    xcb_render_glyphinfo_t info[NGLYPHS];
+    uint8_t *data;
+    int stride = (GLYPH_WIDTH + 3) & ~3;
+    int i, j;
+
+    data = malloc(NGLYPHS * stride * GLYPH_HEIGHT);
+    assert(data);
+
+    for (i = 0; i < NGLYPHS; i++) {
+        ids[i] = i;
+        info[i].width = GLYPH_WIDTH;
+        info[i].height = GLYPH_HEIGHT;
+        info[i].x = 0;
+        info[i].y = GLYPH_HEIGHT - 3;
+        info[i].x_off = GLYPH_WIDTH;
+        info[i].y_off = 0;
+    }
+    for (j = 0; j < NGLYPHS * stride * GLYPH_HEIGHT; j++)
+        data[j] = rand();
+
+    b->glyphset = xcb_generate_id(b->c);
+    xcb_render_create_glyph_set(b->c, b->glyphset, b->a8);
+    xcb_render_add_glyphs(b->c, b->glyphset, NGLYPHS, ids, info,
+                          NGLYPHS * stride * GLYPH_HEIGHT, data);
+    free(data);
+}
+
+static void
+setup(struct bench *b)
+{
+    xcb_render_color_t black = { 0x2000, 0x2000, 0x2000, 0xe000 };
+
+    b->c = xcb_connect(NULL, NULL);
+    assert(!xcb_connection_has_error(b->c));
+    b->screen = xcb_setup_roots_iterator(xcb_get_setup(b->c)).data;
+
+    find_formats(b);
+
+    b->dst = create_picture(b, WIDTH, HEIGHT);
+    b->solid = xcb_generate_id(b->c);
+    xcb_render_create_solid_fill(b->c, b->solid, black);
+
+    setup_source(b);
+    setup_glyphs(b);
+    sync_server(b);
+}
+
+static void
+draw_composite(struct bench *b)
+{
+    xcb_render_composite(b->c, XCB_RENDER_PICT_OP_OVER, b->source, XCB_NONE,
+                         b->dst, 0, 0, 0, 0, 0, 0, WIDTH, HEIGHT);
+}
+
+static void
+draw_trapezoids(struct bench *b)
+{
+    static xcb_render_trapezoid_t traps[NTRAPS];
+    static bool init;
+    int i;
+
+    if (!init) {
+        for (i = 0; i < NTRAPS; i++) {
+            double x = rand() % (WIDTH / 2), y = rand() % (HEIGHT / 2);
+            double w = WIDTH / 3 + rand() % (WIDTH / 3);
+            double h = HEIGHT / 3 + rand() % (HEIGHT / 3);
+            double slant = rand() % 200 - 100.5;
+
+            traps[i].top = fixed(y + 0.25);
+            traps[i].bottom = fixed(y + h + 0.75);
+            traps[i].left.p1.x = fixed(x + 0.5);
+            traps[i].left.p1.y = fixed(y);
+            traps[i].left.p2.x = fixed(x + slant);
+            traps[i].left.p2.y = fixed(y + h);
+            traps[i].right.p1.x = fixed(x + w);
+            traps[i].right.p1.y = fixed(y);
+            traps[i].right.p2.x = fixed(x + w - slant);
+            traps[i].right.p2.y = fixed(y + h);
+        }
+        init = true;
+    }
+
+    xcb_render_trapezoids(b->c, XCB_RENDER_PICT_OP_OVER, b->solid, b->dst,
+                          b->a8, 0, 0, NTRAPS, traps);
+}
+
+static void
+draw_glyphs(struct bench *b)
+{
+    /* One glyph element per line of text */
+    enum { PER_LINE = 200, LINES = HEIGHT / GLYPH_HEIGHT - 1 };
+    static uint8_t cmds[LINES * (sizeof(struct glyph_elt) + PER_LINE)];
+    static bool init;
+    int line, i;
+
+    if (!init) {
+        uint8_t *p = cmds;
+
+        for (line = 0; line < LINES; line++) {
+            struct glyph_elt *elt = (struct glyph_elt *) p;
+
+            elt->len = PER_LINE;
+            elt->deltax = line ? -PER_LINE * GLYPH_WIDTH : 4;
+            elt->deltay = GLYPH_HEIGHT;
+            p += sizeof(*elt);
+            for (i = 0; i < PER_LINE; i++)
+                *p++ = rand() % NGLYPHS;
+        }
+        init = true;
+    }
+
+    xcb_render_composite_glyphs_8(b->c, XCB_RENDER_PICT_OP_OVER, b->solid,
+                                  b->dst, b->a8, b->glyphset, 0, 0,
+                                  sizeof(cmds), cmds);
+}
+
+static void
+run(struct bench *b, const char *name, void (*draw)(struct bench *))
+{
+    double start;
+    int i;
+
+    draw(b);
+    sync_server(b);
+
+    start = now();
+    for (i = 0; i < ITERATIONS; i++) {
+        draw(b);
+        sync_server(b);
+    }
+
+    printf("%-12s %8.2f ms\n", name, (now() - start) * 1000 / ITERATIONS);
+}
+
+int
+main(int argc, char **argv)
+{
+    struct bench b = { 0 };
+
+    srand(1);
+    setup(&b);
+
+    printf("%dx%d, %d iterations\n", WIDTH, HEIGHT, ITERATIONS);
+    run(&b, "composite", draw_composite);
+    run(&b, "trapezoids", draw_trapezoids);
+    run(&b, "glyphs", draw_glyphs);
+
+    assert(!xcb_connection_has_error(b.c));
+    xcb_disconnect(b.c);
+
+    return 0;
+}
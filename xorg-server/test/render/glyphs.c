@@ -0,0 +1,170 @@
+/*
+ * Copyright © 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+/** @file
+ *
+ * Times glyph uploads the way text heavy clients do them: batches of
+ * AddGlyphs requests with new images, and the same images again in other
+ * glyph sets, which the server recognises as duplicates and shares.
+ */
+
+/* Benchmark relies on assert() */
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <xcb/render.h>
+
+#define GLYPH_WIDTH 12
+#define GLYPH_HEIGHT 20
+#define STRIDE ((GLYPH_WIDTH + 3) & ~3)
+#define GLYPH_BYTES (STRIDE * GLYPH_HEIGHT)
+#define BATCH 64
+#define NGLYPHS 100000
+#define NSETS 4
+
+struct bench {
+    xcb_connection_t *c;
+    xcb_render_pictformat_t a8;
+    uint8_t *images;
+};
+
+static double
+now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/** Round trip, so that all queued requests have been processed. */
+static void
+sync_server(struct bench *b)
+{
+    free(xcb_get_input_focus_reply(b->c, xcb_get_input_focus(b->c), NULL));
+}
+
+static void
+find_a8(struct bench *b)
+{
+    xcb_render_query_pict_formats_reply_t *reply =
+        xcb_render_query_pict_formats_reply(b->c,
+                                            xcb_render_query_pict_formats(b->c),
+                                            NULL);
+    xcb_render_pictforminfo_iterator_t i;
+
+    assert(reply);
+    for (i = xcb_render_query_pict_formats_formats_iterator(reply);
+         i.rem; xcb_render_pictforminfo_next(&i)) {
+        xcb_render_directformat_t *d = &i.data->direct;
+
+        if (i.data->type == XCB_RENDER_PICT_TYPE_DIRECT &&
+            i.data->depth == 8 && d->alpha_mask == 0xff && !d->red_mask)
+            b->a8 = i.data->id;
+    }
+    free(reply);
+
+    assert(b->a8);
+}
+
+/** Uploads all images to glyphset, returning microseconds per glyph. */
+static double
+upload(struct bench *b, xcb_render_glyphset_t glyphset)
+{
+    uint32_t ids[BATCH];
+    xcb_render_glyphinfo_t info[BATCH];
+    double start;
+    int i, j;
+
+    for (j = 0; j < BATCH; j++) {
+        info[j].width = GLYPH_WIDTH;
+        info[j].height = GLYPH_HEIGHT;
+        info[j].x = 0;
+        info[j].y = GLYPH_HEIGHT - 4;
+        info[j].x_off = GLYPH_WIDTH;
+        info[j].y_off = 0;
+    }
+
+    start = now();
+    for (i = 0; i < NGLYPHS; i += BATCH) {
+        for (j = 0; j < BATCH; j++)
+            ids[j] = i + j;
+        xcb_render_add_glyphs(b->c, glyphset, BATCH, ids, info,
+                              BATCH * GLYPH_BYTES,
+                              b->images + (size_t) i * GLYPH_BYTES);
+    }
+    sync_server(b);
+
+    return (now() - start) * 1e6 / NGLYPHS;
+}
+
+int
+main(int argc, char **argv)
+{
+    struct bench b = { 0 };
+    xcb_render_glyphset_t glyphsets[NSETS];
+    size_t size = (size_t) NGLYPHS * GLYPH_BYTES;
+    double start;
+    size_t i;
+    int set;
+
+    b.c = xcb_connect(NULL, NULL);
+    assert(!xcb_connection_has_error(b.c));
+    find_a8(&b);
+
+    /* Only whole batches are uploaded */
+    assert(NGLYPHS % BATCH == 0);
+    b.images = malloc(size);
+    assert(b.images);
+    srand(1);
+    for (i = 0; i < size; i++)
+        b.images[i] = rand();
+
+    printf("%d glyphs of %dx%d, %d per request\n",
+           NGLYPHS, GLYPH_WIDTH, GLYPH_HEIGHT, BATCH);
+
+    for (set = 0; set < NSETS; set++) {
+        glyphsets[set] = xcb_generate_id(b.c);
+        xcb_render_create_glyph_set(b.c, glyphsets[set], b.a8);
+        printf("%-10s %8.3f us/glyph\n", set ? "duplicate" : "new",
+               upload(&b, glyphsets[set]));
+    }
+
+    start = now();
+    for (set = 0; set < NSETS; set++)
+        xcb_render_free_glyph_set(b.c, glyphsets[set]);
+    sync_server(&b);
+    printf("%-10s %8.3f us/glyph\n", "free",
+           (now() - start) * 1e6 / NGLYPHS);
+
+    assert(!xcb_connection_has_error(b.c));
+    xcb_disconnect(b.c);
+    free(b.images);
+
+    return 0;
+}
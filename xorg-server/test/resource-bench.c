@@ -0,0 +1,140 @@
+/**
+ * Copyright © 2026 agent <agent@local>
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice (including the next
+ *  paragraph) shall be included in all copies or substantial portions of the
+ *  Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ */
+
+/* Benchmark relies on assert() */
+#undef NDEBUG
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "assert.h"
+#include "misc.h"
+#include "os.h"
+#include "resource.h"
+#include "dixstruct.h"
+
+/*
+ * Measures AddResource, dixLookupResourceByType and FreeResource
+ * throughput for a single client owning 1k, 100k and 1M resources.
+ * IDs are allocated sequentially like Xlib does, but looked up and freed
+ * in a scattered order, as requests rarely follow allocation order.
+ */
+
+#define LOOKUP_PASSES 4
+#define SCATTER 7919            /* prime, so i * SCATTER % count permutes */
+
+static ClientRec server_client;
+static ClientRec bench_client;
+static RESTYPE bench_type;
+static int deleted;
+
+static int
+bench_delete(void *value, XID id)
+{
+    deleted++;
+    return Success;
+}
+
+static void
+count_resource(void *value, XID id, void *cdata)
+{
+    (*(int *) cdata)++;
+}
+
+static double
+ns_per_op(CARD64 start, CARD64 end, int ops)
+{
+    return (end - start) * 1000.0 / ops;
+}
+
+static void
+bench_resources(int count)
+{
+    XID base = bench_client.clientAsMask;
+    CARD64 start, added, looked_up, iterated, freed;
+    void *value;
+    int i, pass, found = 0;
+
+    deleted = 0;
+
+    start = GetTimeInMicros();
+    for (i = 0; i < count; i++)
+        assert(AddResource(base + i, bench_type, (void *) (intptr_t) (i + 1)));
+    added = GetTimeInMicros();
+
+    for (pass = 0; pass < LOOKUP_PASSES; pass++) {
+        for (i = 0; i < count; i++) {
+            int n = (int) ((uint64_t) i * SCATTER % count);
+            int rc = dixLookupResourceByType(&value, base + n, bench_type,
+                                             NULL, DixReadAccess);
+
+            assert(rc == Success);
+            assert(value == (void *) (intptr_t) (n + 1));
+        }
+    }
+    looked_up = GetTimeInMicros();
+
+    FindClientResourcesByType(&bench_client, bench_type, count_resource,
+                              &found);
+    assert(found == count);
+    iterated = GetTimeInMicros();
+
+    for (i = 0; i < count; i++)
+        FreeResource(base + (XID) ((uint64_t) i * SCATTER % count), RT_NONE);
+    freed = GetTimeInMicros();
+    assert(deleted == count);
+
+    printf("%8d resources: insert %7.1f ns, lookup %7.1f ns, free %7.1f ns\n",
+           count,
+           ns_per_op(start, added, count),
+           ns_per_op(added, looked_up, count * LOOKUP_PASSES),
+           ns_per_op(iterated, freed, count));
+}
+
+int
+main(int argc, char **argv)
+{
+    serverClient = &server_client;
+    clients[0] = serverClient;
+    assert(InitClientResources(serverClient));
+
+    bench_client.index = 1;
+    bench_client.clientAsMask = ((Mask) 1) << CLIENTOFFSET;
+    clients[1] = &bench_client;
+    currentMaxClients = 2;
+    assert(InitClientResources(&bench_client));
+
+    bench_type = CreateNewResourceType(bench_delete, "BenchResource");
+    assert(bench_type);
+
+    bench_resources(1000);
+    bench_resources(100000);
+    bench_resources(1000000);
+
+    FreeClientResources(&bench_client);
+    return 0;
+}
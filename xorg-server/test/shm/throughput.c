@@ -0,0 +1,211 @@
+/*
+ * Copyright © 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/** @file
+ *
+ * Measures MIT-SHM frame throughput at 1080p and 4K: ShmPutImage and
+ * ShmGetImage of whole frames to and from a pixmap and a window, and a
+ * client attaching and detaching its segment around every frame like
+ * some toolkits do.
+ */
+
+/* Benchmark relies on assert() */
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <xcb/shm.h>
+
+#define ITERATIONS 20
+
+struct bench {
+    xcb_connection_t *c;
+    xcb_screen_t *screen;
+    xcb_gcontext_t gc;
+    xcb_shm_seg_t seg;
+    int shmid;
+    uint8_t *data;
+};
+
+static double
+now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/** Round trip, so that all queued requests have been processed. */
+static void
+sync_server(struct bench *b)
+{
+    free(xcb_get_input_focus_reply(b->c, xcb_get_input_focus(b->c), NULL));
+}
+
+static void
+setup(struct bench *b, int width, int height)
+{
+    const xcb_query_extension_reply_t *ext;
+    size_t size = (size_t) width * height * 4;
+    size_t i;
+
+    b->c = xcb_connect(NULL, NULL);
+    assert(!xcb_connection_has_error(b->c));
+    b->screen = xcb_setup_roots_iterator(xcb_get_setup(b->c)).data;
+
+    ext = xcb_get_extension_data(b->c, &xcb_shm_id);
+    assert(ext && ext->present);
+
+    b->shmid = shmget(IPC_PRIVATE, size, IPC_CREAT | 0600);
+    assert(b->shmid != -1);
+    b->data = shmat(b->shmid, NULL, 0);
+    assert(b->data != (void *) -1);
+    for (i = 0; i < size; i++)
+        b->data[i] = rand();
+
+    b->seg = xcb_generate_id(b->c);
+    xcb_shm_attach(b->c, b->seg, b->shmid, 0);
+
+    b->gc = xcb_generate_id(b->c);
+    xcb_create_gc(b->c, b->gc, b->screen->root, 0, NULL);
+    sync_server(b);
+}
+
+static void
+teardown(struct bench *b)
+{
+    xcb_shm_detach(b->c, b->seg);
+    sync_server(b);
+    assert(!xcb_connection_has_error(b->c));
+    xcb_disconnect(b->c);
+
+    shmdt(b->data);
+    shmctl(b->shmid, IPC_RMID, NULL);
+}
+
+static void
+put(struct bench *b, xcb_drawable_t drawable, int width, int height)
+{
+    xcb_shm_put_image(b->c, drawable, b->gc, width, height, 0, 0,
+                      width, height, 0, 0, b->screen->root_depth,
+                      XCB_IMAGE_FORMAT_Z_PIXMAP, 0, b->seg, 0);
+}
+
+static void
+get(struct bench *b, xcb_drawable_t drawable, int width, int height)
+{
+    xcb_shm_get_image_reply_t *reply =
+        xcb_shm_get_image_reply(b->c,
+                                xcb_shm_get_image(b->c, drawable, 0, 0,
+                                                  width, height, ~0,
+                                                  XCB_IMAGE_FORMAT_Z_PIXMAP,
+                                                  b->seg, 0),
+                                NULL);
+
+    assert(reply);
+    free(reply);
+}
+
+/** Attach, put one frame and detach again, with a new segment id each time */
+static void
+attach_put(struct bench *b, xcb_drawable_t drawable, int width, int height)
+{
+    xcb_shm_seg_t seg = b->seg;
+
+    b->seg = xcb_generate_id(b->c);
+    xcb_shm_attach(b->c, b->seg, b->shmid, 0);
+    put(b, drawable, width, height);
+    xcb_shm_detach(b->c, b->seg);
+    b->seg = seg;
+}
+
+static void
+run(struct bench *b, const char *name, xcb_drawable_t drawable,
+    int width, int height,
+    void (*op)(struct bench *, xcb_drawable_t, int, int))
+{
+    double start, elapsed;
+    int i;
+
+    op(b, drawable, width, height);
+    sync_server(b);
+
+    start = now();
+    for (i = 0; i < ITERATIONS; i++) {
+        op(b, drawable, width, height);
+        sync_server(b);
+    }
+    elapsed = (now() - start) / ITERATIONS;
+
+    printf("%4dx%-4d %-20s %8.2f ms %8.1f MB/s\n", width, height, name,
+           elapsed * 1000, width * height * 4 / elapsed / (1024 * 1024));
+}
+
+static void
+bench_size(int width, int height)
+{
+    struct bench b = { 0 };
+    xcb_pixmap_t pixmap;
+    xcb_window_t window;
+
+    setup(&b, width, height);
+
+    pixmap = xcb_generate_id(b.c);
+    xcb_create_pixmap(b.c, b.screen->root_depth, pixmap, b.screen->root,
+                      width, height);
+
+    window = xcb_generate_id(b.c);
+    xcb_create_window(b.c, XCB_COPY_FROM_PARENT, window, b.screen->root,
+                      0, 0, width, height, 0,
+                      XCB_WINDOW_CLASS_INPUT_OUTPUT,
+                      b.screen->root_visual, 0, NULL);
+    xcb_map_window(b.c, window);
+
+    run(&b, "put pixmap", pixmap, width, height, put);
+    run(&b, "get pixmap", pixmap, width, height, get);
+    run(&b, "put window", window, width, height, put);
+    run(&b, "get window", window, width, height, get);
+    run(&b, "attach+put pixmap", pixmap, width, height, attach_put);
+
+    xcb_free_pixmap(b.c, pixmap);
+    xcb_destroy_window(b.c, window);
+    teardown(&b);
+}
+
+int
+main(int argc, char **argv)
+{
+    srand(1);
+
+    printf("%d iterations\n", ITERATIONS);
+    bench_size(1920, 1080);
+    bench_size(3840, 2160);
+
+    return 0;
+}
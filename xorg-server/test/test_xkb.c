@@ -35,6 +35,8 @@
 #include <ctype.h>
 #include <unistd.h>
 #include <math.h>
+#include <dirent.h>
+#include <sys/stat.h>
 #include <X11/X.h>
 #include <X11/Xproto.h>
 #include <X11/keysym.h>
@@ -168,12 +170,176 @@ xkb_set_get_rules_test(void)
     assert(strcmp(rmlvo.options, rmlvo_backup.options) == 0);
 }
 
+static void
+xkb_cache_write(const char *dir, const char *name, const char *text)
+{
+    char path[PATH_MAX];
+    FILE *file;
+
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    file = fopen(path, "w");
+    assert(file);
+    fputs(text, file);
+    assert(fclose(file) == 0);
+}
+
+/* The keysym on keycode 10, or NoSymbol if the keymap didn't compile */
+static KeySym
+xkb_cache_compile(DeviceIntPtr dev)
+{
+    static const char keymap[] =
+        "xkb_keymap {"
+        " xkb_keycodes { include \"test\" };"
+        " xkb_types { include \"test\" };"
+        " xkb_compat { include \"test\" };"
+        " xkb_symbols { include \"test\" }; };";
+    XkbDescPtr xkb;
+    KeySym sym = NoSymbol;
+
+    xkb = XkbCompileKeymapFromString(dev, keymap, strlen(keymap));
+    if (!xkb)
+        return NoSymbol;
+    if (XkbKeyNumSyms(xkb, 10) > 0)
+        sym = XkbKeySym(xkb, 10, 0);
+    XkbFreeKeyboard(xkb, 0, TRUE);
+    return sym;
+}
+
+/* Find the one keymap in the cache directory, or return 0 */
+static ino_t
+xkb_cache_file(const char *dir)
+{
+    char path[PATH_MAX];
+    struct dirent *entry;
+    struct stat st;
+    int nxkm = 0, ndeps = 0;
+    ino_t ino = 0;
+    DIR *d;
+
+    d = opendir(dir);
+    assert(d);
+    while ((entry = readdir(d))) {
+        const char *suffix = strrchr(entry->d_name, '.');
+
+        if (suffix && strcmp(suffix, ".deps") == 0)
+            ndeps++;
+        if (!suffix || strcmp(suffix, ".xkm") != 0)
+            continue;
+        snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+        assert(stat(path, &st) == 0);
+        ino = st.st_ino;
+        nxkm++;
+    }
+    closedir(d);
+
+    assert(nxkm == ndeps);
+    assert(nxkm <= 1);
+    return ino;
+}
+
+static void
+xkb_cache_remove(const char *dir)
+{
+    char path[PATH_MAX];
+    struct dirent *entry;
+    DIR *d;
+
+    d = opendir(dir);
+    if (!d)
+        return;
+    while ((entry = readdir(d))) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+            continue;
+        snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+        if (unlink(path) != 0)
+            xkb_cache_remove(path);
+    }
+    closedir(d);
+    rmdir(dir);
+}
+
+/**
+ * Compile a keymap from a private XKB directory twice, then edit a
+ * symbols file that is only reached through an include and compile it
+ * again.
+ *
+ * Result: the second keymap comes from the cache, the third one is
+ * compiled again and has the edited symbols.
+ */
+static void
+xkb_keymap_cache_test(void)
+{
+    const char *base = XkbBaseDirectory;
+    const char *cache = XkbKeymapCacheDirectory;
+    DeviceIntRec dev = { .name = (char *) "cache test keyboard" };
+    char dir[] = "/tmp/xkb-cache-test-XXXXXX", path[PATH_MAX];
+    static const char *const subdirs[] = {
+        "keycodes", "types", "compat", "symbols", "cache"
+    };
+    KeySym sym;
+    ino_t ino;
+    int i;
+
+    assert(mkdtemp(dir));
+    for (i = 0; i < ARRAY_SIZE(subdirs); i++) {
+        snprintf(path, sizeof(path), "%s/%s", dir, subdirs[i]);
+        assert(mkdir(path, 0700) == 0);
+    }
+    xkb_cache_write(dir, "keycodes/test",
+                    "xkb_keycodes \"test\" {\n"
+                    "    minimum = 8; maximum = 255;\n"
+                    "    <AE01> = 10;\n"
+                    "};\n");
+    xkb_cache_write(dir, "types/test",
+                    "xkb_types \"test\" { virtual_modifiers NumLock; };\n");
+    xkb_cache_write(dir, "compat/test",
+                    "xkb_compatibility \"test\" {\n"
+                    "    virtual_modifiers NumLock;\n"
+                    "    interpret Num_Lock {\n"
+                    "        action = LockMods(modifiers = NumLock);\n"
+                    "    };\n"
+                    "};\n");
+    xkb_cache_write(dir, "symbols/test",
+                    "xkb_symbols \"test\" { include \"inc\" };\n");
+    xkb_cache_write(dir, "symbols/inc",
+                    "xkb_symbols \"inc\" { key <AE01> { [ a ] }; };\n");
+
+    XkbBaseDirectory = dir;
+    snprintf(path, sizeof(path), "%s/cache", dir);
+    XkbKeymapCacheDirectory = path;
+
+    sym = xkb_cache_compile(&dev);
+    if (sym == NoSymbol) {
+        printf("xkbcomp is not available, skipping the keymap cache test\n");
+        goto out;
+    }
+    assert(sym == XK_a);
+    ino = xkb_cache_file(path);
+    assert(ino);
+
+    /* The cached keymap is used, the file in the cache stays */
+    assert(xkb_cache_compile(&dev) == XK_a);
+    assert(xkb_cache_file(path) == ino);
+
+    /* An included file edited in place is noticed */
+    xkb_cache_write(dir, "symbols/inc",
+                    "xkb_symbols \"inc\" { key <AE01> { [ b, B ] }; };\n");
+    assert(xkb_cache_compile(&dev) == XK_b);
+    assert(xkb_cache_file(path) != ino);
+
+ out:
+    XkbBaseDirectory = base;
+    XkbKeymapCacheDirectory = cache;
+    xkb_cache_remove(dir);
+}
+
 int
 xkb_test(void)
 {
     xkb_set_get_rules_test();
     xkb_get_rules_test();
     xkb_set_rules_test();
+    xkb_keymap_cache_test();
 
     return 0;
 }
@@ -12,6 +12,8 @@ main(int argc, char **argv)
     run_test(fixes_test);
     run_test(input_test);
     run_test(misc_test);
+    run_test(mivaltree_test);
+    run_test(property_test);
     run_test(signal_logging_test);
     run_test(touch_test);
     run_test(xfree86_test);
@@ -23,6 +25,8 @@ main(int argc, char **argv)
 #endif
 
 #ifdef LDWRAP_TESTS
+    run_test(atom_test);
+
     run_test(protocol_xchangedevicecontrol_test);
 
     run_test(protocol_xiqueryversion_test);
@@ -6,6 +6,8 @@ int hashtabletest_test(void);
 int input_test(void);
 int list_test(void);
 int misc_test(void);
+int mivaltree_test(void);
+int property_test(void);
 int signal_logging_test(void);
 int string_test(void);
 int touch_test(void);
@@ -13,6 +15,8 @@ int xfree86_test(void);
 int xkb_test(void);
 int xtest_test(void);
 
+int atom_test(void);
+
 int protocol_xchangedevicecontrol_test(void);
 
 int protocol_xiqueryversion_test(void);
@@ -0,0 +1,136 @@
+/**
+ * Copyright © 2026 agent <agent@local>
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice (including the next
+ *  paragraph) shall be included in all copies or substantial portions of the
+ *  Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ */
+
+/* Benchmark relies on assert() */
+#undef NDEBUG
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "assert.h"
+#include "misc.h"
+#include "os.h"
+
+/*
+ * Keeps 100k timers armed, as with many clients holding SYNC alarms,
+ * and measures the cost of arming, re-arming and cancelling one of them
+ * as well as the per-iteration TimerCheck() overhead the dispatch loop
+ * pays.  Also checks that a batch of short timers fires in expiry order.
+ */
+
+#define ARMED 100000
+#define CHECKS 1000000
+#define FIRED 1000
+#define SCATTER 7919            /* prime, so i * SCATTER % count permutes */
+
+static OsTimerPtr timers[ARMED];
+static CARD32 last_expiry;
+static int fired;
+
+static CARD32
+idle_callback(OsTimerPtr timer, CARD32 now, void *arg)
+{
+    assert(!"armed timer fired");
+    return 0;
+}
+
+static CARD32
+fire_callback(OsTimerPtr timer, CARD32 now, void *arg)
+{
+    CARD32 expiry = (CARD32) (intptr_t) arg;
+
+    assert(fired == 0 || (int) (expiry - last_expiry) >= 0);
+    last_expiry = expiry;
+    fired++;
+    return 0;
+}
+
+static double
+ns_per_op(CARD64 start, CARD64 end, int ops)
+{
+    return (end - start) * 1000.0 / ops;
+}
+
+int
+main(int argc, char **argv)
+{
+    OsTimerPtr short_timers[FIRED];
+    CARD64 start, armed, rearmed, checked, cancel_start, cancelled;
+    CARD32 now;
+    int i;
+
+    TimerInit();
+
+    start = GetTimeInMicros();
+    for (i = 0; i < ARMED; i++) {
+        timers[i] = TimerSet(NULL, 0, 600000 + (i * SCATTER) % ARMED,
+                             idle_callback, NULL);
+        assert(timers[i]);
+    }
+    armed = GetTimeInMicros();
+
+    for (i = 0; i < ARMED; i++)
+        TimerSet(timers[(i * SCATTER) % ARMED], 0, 600000 + i,
+                 idle_callback, NULL);
+    rearmed = GetTimeInMicros();
+
+    for (i = 0; i < CHECKS; i++)
+        TimerCheck();
+    checked = GetTimeInMicros();
+
+    /* short timers in scattered order must still fire by expiry */
+    now = GetTimeInMillis();
+    for (i = 0; i < FIRED; i++) {
+        CARD32 expiry = now + 200 + (i * SCATTER) % 50;
+
+        short_timers[i] = TimerSet(NULL, TimerAbsolute, expiry,
+                                   fire_callback, (void *) (intptr_t) expiry);
+        assert(short_timers[i]);
+    }
+    while (fired < FIRED) {
+        assert((int) (GetTimeInMillis() - now) < 10000);
+        TimerCheck();
+    }
+
+    cancel_start = GetTimeInMicros();
+    for (i = 0; i < ARMED; i++)
+        TimerCancel(timers[(i * SCATTER) % ARMED]);
+    cancelled = GetTimeInMicros();
+
+    for (i = 0; i < ARMED; i++)
+        TimerFree(timers[i]);
+    for (i = 0; i < FIRED; i++)
+        TimerFree(short_timers[i]);
+
+    printf("%d armed timers: set %.1f ns, re-arm %.1f ns, "
+           "check %.1f ns, cancel %.1f ns\n", ARMED,
+           ns_per_op(start, armed, ARMED),
+           ns_per_op(armed, rearmed, ARMED),
+           ns_per_op(rearmed, checked, CHECKS),
+           ns_per_op(cancel_start, cancelled, ARMED));
+    return 0;
+}
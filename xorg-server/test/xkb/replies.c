@@ -0,0 +1,199 @@
+/*
+ * Copyright © 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/** @file
+ *
+ * Times the XKB requests every toolkit makes at startup: GetMap with all
+ * components, GetNames and GetCompatMap.  Each one is timed twice, once
+ * with the keymap unchanged, so that the server can answer from its copy
+ * of the serialized reply, and once with a core ChangeKeyboardMapping of
+ * one key to its own keysyms in front of every request, which throws that
+ * copy away.  The time of the ChangeKeyboardMapping round trip alone is
+ * subtracted from the second figure.
+ */
+
+/* Benchmark relies on assert() */
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <xcb/xkb.h>
+
+#define ITERATIONS 2000
+#define KEYCODE 38
+
+#define ALL_MAP_PARTS (XCB_XKB_MAP_PART_KEY_TYPES | \
+                       XCB_XKB_MAP_PART_KEY_SYMS | \
+                       XCB_XKB_MAP_PART_MODIFIER_MAP | \
+                       XCB_XKB_MAP_PART_EXPLICIT_COMPONENTS | \
+                       XCB_XKB_MAP_PART_KEY_ACTIONS | \
+                       XCB_XKB_MAP_PART_KEY_BEHAVIORS | \
+                       XCB_XKB_MAP_PART_VIRTUAL_MODS | \
+                       XCB_XKB_MAP_PART_VIRTUAL_MOD_MAP)
+
+struct bench {
+    xcb_connection_t *c;
+    xcb_get_keyboard_mapping_reply_t *mapping;
+};
+
+static double
+now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void
+get_map(struct bench *b)
+{
+    xcb_xkb_get_map_reply_t *reply =
+        xcb_xkb_get_map_reply(b->c,
+                              xcb_xkb_get_map(b->c, XCB_XKB_ID_USE_CORE_KBD,
+                                              ALL_MAP_PARTS, 0,
+                                              0, 0, 0, 0, 0, 0, 0, 0,
+                                              0, 0, 0, 0, 0, 0, 0),
+                              NULL);
+
+    assert(reply);
+    free(reply);
+}
+
+static void
+get_names(struct bench *b)
+{
+    xcb_xkb_get_names_reply_t *reply =
+        xcb_xkb_get_names_reply(b->c,
+                                xcb_xkb_get_names(b->c,
+                                                  XCB_XKB_ID_USE_CORE_KBD,
+                                                  0x3fff),
+                                NULL);
+
+    assert(reply);
+    free(reply);
+}
+
+static void
+get_compat_map(struct bench *b)
+{
+    xcb_xkb_get_compat_map_reply_t *reply =
+        xcb_xkb_get_compat_map_reply(b->c,
+                                     xcb_xkb_get_compat_map(b->c,
+                                                            XCB_XKB_ID_USE_CORE_KBD,
+                                                            0xff, 1, 0, 0),
+                                     NULL);
+
+    assert(reply);
+    free(reply);
+}
+
+/** Round trip ChangeKeyboardMapping, leaving the key as it was. */
+static void
+change_mapping(struct bench *b)
+{
+    xcb_void_cookie_t cookie =
+        xcb_change_keyboard_mapping_checked(b->c, 1, KEYCODE,
+            b->mapping->keysyms_per_keycode,
+            xcb_get_keyboard_mapping_keysyms(b->mapping));
+
+    assert(!xcb_request_check(b->c, cookie));
+}
+
+static void
+setup(struct bench *b)
+{
+    xcb_xkb_use_extension_reply_t *use;
+
+    b->c = xcb_connect(NULL, NULL);
+    assert(!xcb_connection_has_error(b->c));
+
+    use = xcb_xkb_use_extension_reply(b->c,
+                                      xcb_xkb_use_extension(b->c, 1, 0),
+                                      NULL);
+    assert(use && use->supported);
+    free(use);
+
+    b->mapping =
+        xcb_get_keyboard_mapping_reply(b->c,
+                                       xcb_get_keyboard_mapping(b->c,
+                                                                KEYCODE, 1),
+                                       NULL);
+    assert(b->mapping);
+}
+
+static double
+time_loop(struct bench *b, void (*request)(struct bench *), int change)
+{
+    double start;
+    int i;
+
+    start = now();
+    for (i = 0; i < ITERATIONS; i++) {
+        if (change)
+            change_mapping(b);
+        if (request)
+            request(b);
+    }
+
+    return (now() - start) * 1e6 / ITERATIONS;
+}
+
+static void
+run(struct bench *b, const char *name, void (*request)(struct bench *),
+    double change_only)
+{
+    double unchanged, changed;
+
+    request(b);
+    unchanged = time_loop(b, request, 0);
+    changed = time_loop(b, request, 1) - change_only;
+
+    printf("%-14s unchanged %7.1f us, after change %7.1f us\n",
+           name, unchanged, changed);
+}
+
+int
+main(int argc, char **argv)
+{
+    struct bench b = { 0 };
+    double change_only;
+
+    setup(&b);
+
+    change_only = time_loop(&b, NULL, 1);
+    printf("%d iterations, ChangeKeyboardMapping %.1f us\n",
+           ITERATIONS, change_only);
+
+    run(&b, "GetMap", get_map, change_only);
+    run(&b, "GetNames", get_names, change_only);
+    run(&b, "GetCompatMap", get_compat_map, change_only);
+
+    assert(!xcb_connection_has_error(b.c));
+    free(b.mapping);
+    xcb_disconnect(b.c);
+
+    return 0;
+}
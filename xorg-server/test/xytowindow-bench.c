@@ -0,0 +1,246 @@
+/**
+ * Copyright © 2026 agent <agent@local>
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice (including the next
+ *  paragraph) shall be included in all copies or substantial portions of the
+ *  Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ */
+
+/* Benchmark relies on assert() */
+#undef NDEBUG
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "assert.h"
+#include "misc.h"
+#include "os.h"
+#include "scrnintstr.h"
+#include "windowstr.h"
+#include "inputstr.h"
+#include "mi.h"
+
+/*
+ * Moves the pointer over 1000 stacked toplevels, each holding a client
+ * window like a reparenting window manager's frame would, and compares
+ * miXYToWindow against a plain walk of the stacking list.  Also measured
+ * are motion while some window is raised or moved every so often, and
+ * motion while dragging a window, which invalidates the root's child
+ * index on every event.  Every result is checked against the walk.
+ */
+
+#define TOPLEVELS 1000
+#define MOTIONS 200000
+#define RESTACK_INTERVAL 1000
+#define SCREEN_WIDTH 3840
+#define SCREEN_HEIGHT 2160
+
+static ScreenRec screen;
+static WindowRec root;
+static WindowOptRec root_optional;
+static WindowRec frames[TOPLEVELS];
+static WindowRec client_windows[TOPLEVELS];
+static SpriteRec sprite;
+static WindowPtr reference_trace[8];
+
+static void
+init_window(WindowPtr pWin, WindowPtr pParent, int x, int y, int w, int h,
+            int bw)
+{
+    pWin->drawable.pScreen = &screen;
+    pWin->parent = pParent;
+    pWin->origin.x = x + bw;
+    pWin->origin.y = y + bw;
+    pWin->drawable.x = pParent->drawable.x + x + bw;
+    pWin->drawable.y = pParent->drawable.y + y + bw;
+    pWin->drawable.width = w;
+    pWin->drawable.height = h;
+    pWin->borderWidth = bw;
+    pWin->mapped = TRUE;
+
+    /* new windows go on top */
+    pWin->nextSib = pParent->firstChild;
+    if (pParent->firstChild)
+        pParent->firstChild->prevSib = pWin;
+    else
+        pParent->lastChild = pWin;
+    pParent->firstChild = pWin;
+}
+
+static void
+move_window(WindowPtr pWin, int x, int y)
+{
+    int bw = wBorderWidth(pWin);
+    int dx = x + bw - pWin->origin.x, dy = y + bw - pWin->origin.y;
+    WindowPtr pChild;
+
+    /* what miMoveWindow does to the tree */
+    pWin->origin.x += dx;
+    pWin->origin.y += dy;
+    pWin->drawable.x += dx;
+    pWin->drawable.y += dy;
+    for (pChild = pWin->firstChild; pChild; pChild = pChild->nextSib) {
+        pChild->drawable.x += dx;
+        pChild->drawable.y += dy;
+    }
+    MoveWindowInStack(pWin, pWin->nextSib);
+}
+
+/* The lookup as miSpriteTrace did it before the child index */
+static int
+reference_xy_to_window(int x, int y)
+{
+    WindowPtr pWin = root.firstChild;
+    int depth = 1;
+
+    reference_trace[0] = &root;
+    while (pWin) {
+        if (pWin->mapped &&
+            x >= pWin->drawable.x - wBorderWidth(pWin) &&
+            x < pWin->drawable.x + (int) pWin->drawable.width +
+            wBorderWidth(pWin) &&
+            y >= pWin->drawable.y - wBorderWidth(pWin) &&
+            y < pWin->drawable.y + (int) pWin->drawable.height +
+            wBorderWidth(pWin)) {
+            reference_trace[depth++] = pWin;
+            pWin = pWin->firstChild;
+        }
+        else
+            pWin = pWin->nextSib;
+    }
+    return depth;
+}
+
+static void
+check_xy_to_window(int x, int y)
+{
+    int depth = reference_xy_to_window(x, y), i;
+    WindowPtr pWin = miXYToWindow(&screen, &sprite, x, y);
+
+    assert(pWin == reference_trace[depth - 1]);
+    assert(sprite.spriteTraceGood == depth);
+    for (i = 0; i < depth; i++)
+        assert(sprite.spriteTrace[i] == reference_trace[i]);
+}
+
+static double
+ns_per_op(CARD64 start, CARD64 end, int ops)
+{
+    return (end - start) * 1000.0 / ops;
+}
+
+/* A pointer path that wanders across the whole screen */
+static void
+motion(int i, int *x, int *y)
+{
+    *x = (int) ((uint64_t) i * 7919 % SCREEN_WIDTH);
+    *y = (int) ((uint64_t) i * 104729 / 53 % SCREEN_HEIGHT);
+}
+
+int
+main(int argc, char **argv)
+{
+    CARD64 start, walked, indexed, restacked, dragged;
+    WindowPtr pWin;
+    int i, x, y, sink = 0;
+
+    srand(1);
+    root.drawable.pScreen = &screen;
+    root.drawable.width = SCREEN_WIDTH;
+    root.drawable.height = SCREEN_HEIGHT;
+    root.mapped = root.realized = TRUE;
+    root.optional = &root_optional;
+    screen.root = &root;
+
+    for (i = 0; i < TOPLEVELS; i++) {
+        int w = 50 + rand() % 400, h = 40 + rand() % 300;
+
+        init_window(&frames[i], &root,
+                    rand() % (SCREEN_WIDTH - w / 2) - w / 4,
+                    rand() % (SCREEN_HEIGHT - h / 2) - h / 4, w, h, 1);
+        init_window(&client_windows[i], &frames[i], 4, 24, w - 8, h - 28, 0);
+    }
+
+    sprite.spriteTraceSize = 1;
+    sprite.spriteTrace = calloc(1, sizeof(WindowPtr));
+    sprite.spriteTrace[0] = &root;
+    sprite.spriteTraceGood = 1;
+
+    /* the first lookup that walks past many toplevels sets up the index */
+    for (i = 0; i < 1000; i++) {
+        motion(i, &x, &y);
+        check_xy_to_window(x, y);
+    }
+    assert(root_optional.childIndex);
+
+    start = GetTimeInMicros();
+    for (i = 0; i < MOTIONS; i++) {
+        motion(i, &x, &y);
+        sink += reference_xy_to_window(x, y);
+    }
+    walked = GetTimeInMicros();
+    for (i = 0; i < MOTIONS; i++) {
+        motion(i, &x, &y);
+        sink += miXYToWindow(&screen, &sprite, x, y) == &root;
+    }
+    indexed = GetTimeInMicros();
+    for (i = 0; i < MOTIONS; i++) {
+        motion(i, &x, &y);
+        if (i % RESTACK_INTERVAL == 0) {
+            pWin = &frames[rand() % TOPLEVELS];
+            if (i % (2 * RESTACK_INTERVAL))
+                MoveWindowInStack(pWin, root.firstChild);
+            else
+                move_window(pWin, x - 10, y - 10);
+        }
+        sink += miXYToWindow(&screen, &sprite, x, y) == &root;
+    }
+    restacked = GetTimeInMicros();
+    pWin = &frames[0];
+    for (i = 0; i < MOTIONS; i++) {
+        motion(i, &x, &y);
+        move_window(pWin, x - 10, y - 10);
+        sink += miXYToWindow(&screen, &sprite, x, y) == &root;
+    }
+    dragged = GetTimeInMicros();
+
+    for (i = 0; i < 20000; i++) {
+        motion(i * 13, &x, &y);
+        check_xy_to_window(x, y);
+        if (i % 7 == 0)
+            MoveWindowInStack(&frames[rand() % TOPLEVELS], NULL);
+        if (i % 11 == 0)
+            move_window(&frames[rand() % TOPLEVELS], x - 20, y - 20);
+    }
+
+    printf("%d toplevels: walk %7.1f ns, indexed %7.1f ns, "
+           "restack every %d motions %7.1f ns, drag %7.1f ns (%d)\n",
+           TOPLEVELS,
+           ns_per_op(start, walked, MOTIONS),
+           ns_per_op(walked, indexed, MOTIONS),
+           RESTACK_INTERVAL,
+           ns_per_op(indexed, restacked, MOTIONS),
+           ns_per_op(restacked, dragged, MOTIONS), sink);
+
+    free(sprite.spriteTrace);
+    return 0;
+}
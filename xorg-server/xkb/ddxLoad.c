@@ -32,6 +32,7 @@ THE USE OR PERFORMANCE OF THIS SOFTWARE.
 
 #include <stdio.h>
 #include <ctype.h>
+#include <sys/stat.h>
 #include <X11/X.h>
 #include <X11/Xos.h>
 #include <X11/Xproto.h>
@@ -44,6 +45,7 @@ THE USE OR PERFORMANCE OF THIS SOFTWARE.
 #include <xkbsrv.h>
 #include <X11/extensions/XI.h>
 #include "xkb.h"
+#include "xsha1.h"
 
 #define	PRE_ERROR_MSG "\"The XKEYBOARD keymap compiler (xkbcomp) reports:\""
 #define	ERROR_PREFIX	"\"> \""
@@ -224,35 +226,6 @@ xkb_write_keymap_for_names_cb(FILE *out, void *userdata)
     XkbWriteXKBKeymapForNames(out, ctx->names, ctx->xkb, ctx->want, ctx->need);
 }
 
-static Bool
-XkbDDXCompileKeymapByNames(XkbDescPtr xkb,
-                           XkbComponentNamesPtr names,
-                           unsigned want,
-                           unsigned need, char *nameRtrn, int nameRtrnLen)
-{
-    char *keymap;
-    Bool rc = FALSE;
-    XkbKeymapNamesCtx ctx = {
-        .xkb = xkb,
-        .names = names,
-        .want = want,
-        .need = need
-    };
-
-    keymap = RunXkbComp(xkb_write_keymap_for_names_cb, &ctx);
-
-    if (keymap) {
-        if(nameRtrn)
-            strlcpy(nameRtrn, keymap, nameRtrnLen);
-
-        free(keymap);
-        rc = TRUE;
-    } else if (nameRtrn)
-        *nameRtrn = '\0';
-
-    return rc;
-}
-
 typedef struct {
     const char *keymap;
     size_t len;
@@ -265,34 +238,6 @@ xkb_write_keymap_string_cb(FILE *out, void *userdata)
     fwrite(s->keymap, s->len, 1, out);
 }
 
-static unsigned int
-XkbDDXLoadKeymapFromString(DeviceIntPtr keybd,
-                          const char *keymap, int keymap_length,
-                          unsigned int want,
-                          unsigned int need,
-                          XkbDescPtr *xkbRtrn)
-{
-    unsigned int have;
-    char *map_name;
-    XkbKeymapString map = {
-        .keymap = keymap,
-        .len = keymap_length
-    };
-
-    *xkbRtrn = NULL;
-
-    map_name = RunXkbComp(xkb_write_keymap_string_cb, &map);
-    if (!map_name) {
-        LogMessage(X_ERROR, "XKB: Couldn't compile keymap\n");
-        return 0;
-    }
-
-    have = LoadXKM(want, need, map_name, xkbRtrn);
-    free(map_name);
-
-    return have;
-}
-
 static FILE *
 XkbDDXOpenConfigFile(const char *mapName, char *fileNameRtrn, int fileNameRtrnLen)
 {
@@ -358,21 +303,813 @@ LoadXKM(unsigned want, unsigned need, const char *keymap, XkbDescPtr *xkbRtrn)
     return (need | want) & (~missing);
 }
 
-unsigned
-XkbDDXLoadKeymapByNames(DeviceIntPtr keybd,
-                        XkbComponentNamesPtr names,
-                        unsigned want,
-                        unsigned need,
-                        XkbDescPtr *xkbRtrn, char *nameRtrn, int nameRtrnLen)
+/***====================================================================***/
+
+/*
+ * Compiled keymaps are cached by the configuration they were compiled
+ * from, so that another keyboard with the same layout, a server reset or
+ * running the same setxkbmap again does not have to start xkbcomp.
+ *
+ * The key is a SHA1 of the RMLVO names, the component names or the keymap
+ * text.  Each entry also keeps a stamp of every file the keymap was
+ * compiled from: the rules file, the component files and the files they
+ * include, and xkbcomp itself.  An entry is only used while none of them
+ * has changed.  With -xkbcachedir the compiled .xkm files are also kept on
+ * disk along with these stamps, which lets them outlive the server.
+ */
+
+#define XKB_KEYMAP_CACHE_SIZE	8
+#define XKB_KEYMAP_KEY_SIZE	20
+#define XKB_KEYMAP_MAX_DEPS	256
+#define XKB_KEYMAP_MAX_SOURCE	(1 << 20)
+
+/*
+ * Size, modification time and inode of a file, or all -1 if it does not
+ * exist.  Editing a file in place changes its modification time; package
+ * managers rename new files into place, possibly with the modification
+ * time they had in the package, which changes the inode.
+ */
+typedef struct {
+    int64_t size;
+    int64_t mtime;
+    int64_t mtime_nsec;
+    int64_t ino;
+} XkbKeymapStampRec;
+
+typedef struct {
+    char *path;
+    const char *dir;            /* component directory, if it is source */
+    XkbKeymapStampRec stamp;
+} XkbKeymapDepRec, *XkbKeymapDepPtr;
+
+typedef struct {
+    XkbKeymapDepPtr deps;
+    int num;
+    int size;
+    Bool incomplete;            /* some files could not be found out */
+} XkbKeymapDepsRec, *XkbKeymapDepsPtr;
+
+typedef struct {
+    unsigned char key[XKB_KEYMAP_KEY_SIZE];
+    XkbDescPtr xkb;             /* NULL if the entry is unused */
+    unsigned provided;
+    unsigned long used;
+    XkbKeymapDepsRec deps;
+} XkbKeymapCacheRec, *XkbKeymapCachePtr;
+
+static XkbKeymapCacheRec xkbKeymapCache[XKB_KEYMAP_CACHE_SIZE];
+static unsigned long xkbKeymapCacheClock;
+
+static void
+XkbKeymapStampFile(const char *path, XkbKeymapStampRec *stamp)
 {
-    XkbDescPtr xkb;
+    struct stat st;
+
+    if (stat(path, &st) != 0) {
+        stamp->size = stamp->mtime = stamp->mtime_nsec = stamp->ino = -1;
+        return;
+    }
+    stamp->size = st.st_size;
+    stamp->mtime = st.st_mtime;
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+    stamp->mtime_nsec = st.st_mtim.tv_nsec;
+#else
+    stamp->mtime_nsec = 0;
+#endif
+    stamp->ino = st.st_ino;
+}
+
+static void
+XkbKeymapDepsFree(XkbKeymapDepsPtr deps)
+{
+    int i;
+
+    for (i = 0; i < deps->num; i++)
+        free(deps->deps[i].path);
+    free(deps->deps);
+    memset(deps, 0, sizeof(*deps));
+}
+
+/*
+ * Add a file and take its stamp, unless it is there already.  Files
+ * with a component directory are scanned for includes later.
+ */
+static void
+XkbKeymapDepsAdd(XkbKeymapDepsPtr deps, const char *dir, const char *path,
+                 const XkbKeymapStampRec *stamp)
+{
+    XkbKeymapDepPtr dep;
+    int i;
+
+    for (i = 0; i < deps->num; i++) {
+        if (strcmp(deps->deps[i].path, path) == 0)
+            return;
+    }
+
+    if (deps->num == deps->size) {
+        int size = deps->size ? deps->size * 2 : 16;
+
+        if (size > XKB_KEYMAP_MAX_DEPS ||
+            !(dep = reallocarray(deps->deps, size, sizeof(*dep)))) {
+            deps->incomplete = TRUE;
+            return;
+        }
+        deps->deps = dep;
+        deps->size = size;
+    }
+
+    dep = &deps->deps[deps->num];
+    dep->path = strdup(path);
+    if (!dep->path) {
+        deps->incomplete = TRUE;
+        return;
+    }
+    dep->dir = dir;
+    if (stamp)
+        dep->stamp = *stamp;
+    else
+        XkbKeymapStampFile(path, &dep->stamp);
+    deps->num++;
+}
+
+/*
+ * Add the files named by a component expression such as
+ * "pc+us(intl)+inet(evdev):2", which xkbcomp looks for in the given
+ * component directory.
+ */
+static void
+XkbKeymapDepsAddNames(XkbKeymapDepsPtr deps, const char *dir,
+                      const char *names)
+{
+    char path[PATH_MAX];
+    size_t len, n;
+    int written;
+
+    while (names && *names) {
+        len = strcspn(names, "+|");
+        n = strcspn(names, "+|(:");
+        if (n > 0) {
+            if (names[0] == '/')
+                written = snprintf(path, sizeof(path), "%.*s", (int) n, names);
+            else
+                written = snprintf(path, sizeof(path), "%s/%s/%.*s",
+                                   XkbBaseDirectory, dir, (int) n, names);
+            if (memchr(names, '%', n) || written >= sizeof(path))
+                deps->incomplete = TRUE;
+            else
+                XkbKeymapDepsAdd(deps, dir, path, NULL);
+        }
+        names += len;
+        if (*names)
+            names++;
+    }
+}
+
+/*
+ * Add the files the include statements in keymap source refer to.  The
+ * section keywords tell which component directory they are in; in a
+ * component file it is the file's own directory.  Anything but a string
+ * between a merge keyword and its string is not an include.  All the
+ * includes of a file count, not just those of the map that is used, so a
+ * few more files than necessary are stamped.
+ */
+static void
+XkbKeymapDepsScan(XkbKeymapDepsPtr deps, const char *dir,
+                  const char *text, size_t len)
+{
+    static const char *const merges[] = {
+        "include", "augment", "override", "replace", "alternate"
+    };
+    static const struct {
+        const char *keyword;
+        const char *dir;
+    } sections[] = {
+        { "xkb_keycodes", "keycodes" },
+        { "xkb_types", "types" },
+        { "xkb_compat", "compat" },
+        { "xkb_compat_map", "compat" },
+        { "xkb_compatibility", "compat" },
+        { "xkb_compatibility_map", "compat" },
+        { "xkb_symbols", "symbols" },
+        { "xkb_geometry", "geometry" },
+    };
+    const char *p = text, *end = text + len, *start;
+    char word[32], names[PATH_MAX];
+    Bool include = FALSE;
+    size_t n;
+    int i;
+
+    while (p < end) {
+        if (isspace((unsigned char) *p)) {
+            p++;
+        }
+        else if (*p == '#' || (*p == '/' && p + 1 < end && p[1] == '/')) {
+            while (p < end && *p != '\n')
+                p++;
+        }
+        else if (*p == '/' && p + 1 < end && p[1] == '*') {
+            for (p += 2; p + 1 < end && !(p[0] == '*' && p[1] == '/'); p++);
+            p = p + 1 < end ? p + 2 : end;
+        }
+        else if (*p == '"') {
+            for (start = ++p; p < end && *p != '"'; p++) {
+                if (*p == '\\' && p + 1 < end)
+                    p++;
+            }
+            n = p - start;
+            if (p < end)
+                p++;
+            if (include && !dir)
+                deps->incomplete = TRUE;
+            else if (include && n < sizeof(names)) {
+                memcpy(names, start, n);
+                names[n] = '\0';
+                XkbKeymapDepsAddNames(deps, dir, names);
+            }
+            else if (include)
+                deps->incomplete = TRUE;
+            include = FALSE;
+        }
+        else if (isalpha((unsigned char) *p) || *p == '_') {
+            for (start = p; p < end && (isalnum((unsigned char) *p) ||
+                                        *p == '_'); p++);
+            n = p - start;
+            include = FALSE;
+            if (n >= sizeof(word))
+                continue;
+            memcpy(word, start, n);
+            word[n] = '\0';
+            for (i = 0; i < ARRAY_SIZE(merges); i++) {
+                if (strcasecmp(word, merges[i]) == 0)
+                    include = TRUE;
+            }
+            for (i = 0; i < ARRAY_SIZE(sections); i++) {
+                if (strcasecmp(word, sections[i].keyword) == 0)
+                    dir = sections[i].dir;
+            }
+        }
+        else {
+            include = FALSE;
+            p++;
+        }
+    }
+}
+
+static void
+XkbKeymapDepsScanFile(XkbKeymapDepsPtr deps, const char *dir,
+                      const char *path)
+{
+    FILE *file;
+    char *text;
+    size_t len;
+
+    file = fopen(path, "r");
+    if (!file)
+        return;                 /* stamped as missing */
+
+    text = malloc(XKB_KEYMAP_MAX_SOURCE);
+    if (text) {
+        len = fread(text, 1, XKB_KEYMAP_MAX_SOURCE, file);
+        if (len == XKB_KEYMAP_MAX_SOURCE || ferror(file))
+            deps->incomplete = TRUE;
+        else
+            XkbKeymapDepsScan(deps, dir, text, len);
+        free(text);
+    }
+    else
+        deps->incomplete = TRUE;
+    fclose(file);
+}
+
+/*
+ * Find out which files a keymap is about to be compiled from: the rules
+ * file if any, the component files named or included by the names or the
+ * keymap text, and whatever those include in turn.  Returns FALSE if they
+ * cannot all be found out; such keymaps are not cached.
+ */
+static Bool
+XkbKeymapDepsCollect(XkbKeymapDepsPtr deps, const char *rules,
+                     XkbComponentNamesPtr names,
+                     const char *keymap, int keymap_length)
+{
+    char path[PATH_MAX];
+    int i;
+
+    memset(deps, 0, sizeof(*deps));
+
+#ifdef WIN32
+    if (snprintf(path, sizeof(path), "%s/xkbcomp.exe", XkbBinDirectory)
+#else
+    if (snprintf(path, sizeof(path), "%s/xkbcomp", XkbBinDirectory)
+#endif
+        < sizeof(path))
+        XkbKeymapDepsAdd(deps, NULL, path, NULL);
+    else
+        deps->incomplete = TRUE;
+
+    if (rules) {
+        if (snprintf(path, sizeof(path), "%s/rules/%s", XkbBaseDirectory,
+                     rules) < sizeof(path))
+            XkbKeymapDepsAdd(deps, NULL, path, NULL);
+        else
+            deps->incomplete = TRUE;
+    }
+
+    if (names) {
+        XkbKeymapDepsAddNames(deps, "keycodes", names->keycodes);
+        XkbKeymapDepsAddNames(deps, "types", names->types);
+        XkbKeymapDepsAddNames(deps, "compat", names->compat);
+        XkbKeymapDepsAddNames(deps, "symbols", names->symbols);
+        XkbKeymapDepsAddNames(deps, "geometry", names->geometry);
+    }
+    if (keymap)
+        XkbKeymapDepsScan(deps, NULL, keymap, keymap_length);
+
+    /* Files found while scanning are added at the end and scanned in turn */
+    for (i = 0; i < deps->num && !deps->incomplete; i++) {
+        if (deps->deps[i].dir)
+            XkbKeymapDepsScanFile(deps, deps->deps[i].dir,
+                                  deps->deps[i].path);
+    }
+
+    if (deps->incomplete) {
+        XkbKeymapDepsFree(deps);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/* Whether none of the files has changed since it was stamped */
+static Bool
+XkbKeymapDepsValid(XkbKeymapDepsPtr deps)
+{
+    XkbKeymapStampRec stamp;
+    int i;
+
+    for (i = 0; i < deps->num; i++) {
+        XkbKeymapStampFile(deps->deps[i].path, &stamp);
+        if (memcmp(&stamp, &deps->deps[i].stamp, sizeof(stamp)) != 0)
+            return FALSE;
+    }
+    return TRUE;
+}
+
+static void
+XkbKeymapKeyString(void *ctx, const char *str)
+{
+    /* Include the terminator so that adjacent strings cannot run into
+     * each other, and tell NULL apart from "" */
+    if (str)
+        x_sha1_update(ctx, (void *) str, strlen(str) + 1);
+    else
+        x_sha1_update(ctx, (void *) "\377", 1);
+}
+
+static Bool
+XkbKeymapKeyFinal(void *ctx, unsigned want, unsigned need,
+                  unsigned char *key)
+{
+    CARD32 masks[2] = { want, need };
+
+    /* The same names mean different files in another XKB directory */
+    XkbKeymapKeyString(ctx, XkbBaseDirectory);
+    XkbKeymapKeyString(ctx, XkbBinDirectory);
+    x_sha1_update(ctx, masks, sizeof(masks));
+    return x_sha1_final(ctx, key);
+}
+
+static Bool
+XkbKeymapKeyRMLVO(XkbRMLVOSet * rmlvo, unsigned want, unsigned need,
+                  unsigned char *key)
+{
+    void *ctx;
+
+    if (!XkbWantKeymapCache || !(ctx = x_sha1_init()))
+        return FALSE;
+
+    XkbKeymapKeyString(ctx, "rmlvo");
+    XkbKeymapKeyString(ctx, rmlvo->rules);
+    XkbKeymapKeyString(ctx, rmlvo->model);
+    XkbKeymapKeyString(ctx, rmlvo->layout);
+    XkbKeymapKeyString(ctx, rmlvo->variant);
+    XkbKeymapKeyString(ctx, rmlvo->options);
+
+    return XkbKeymapKeyFinal(ctx, want, need, key);
+}
+
+#define	NEED_DESC(n) ((!n)||((n)[0]=='+')||((n)[0]=='|')||(strchr((n),'%')))
+#define	COMPLETE(n)  ((n)&&(!NEED_DESC(n)))
+
+/*
+ * The keymap XkbWriteXKBKeymapForNames() writes depends on the device's
+ * current keymap unless the names cover every component wanted; only
+ * keymaps that depend on the names alone can be cached.  This follows the
+ * way XkbWriteXKBKeymapForNames() works out what it has to write.
+ */
+static Bool
+XkbKeymapKeyNames(XkbComponentNamesPtr names, unsigned want, unsigned need,
+                  unsigned char *key)
+{
+    unsigned complete = 0;
+    void *ctx;
+
+    if (COMPLETE(names->keycodes))
+        complete |= XkmKeyNamesMask;
+    if (COMPLETE(names->types))
+        complete |= XkmTypesMask;
+    if (COMPLETE(names->compat))
+        complete |= XkmCompatMapMask;
+    if (COMPLETE(names->symbols))
+        complete |= XkmSymbolsMask;
+    if (COMPLETE(names->geometry))
+        complete |= XkmGeometryMask;
+    if (complete & XkmCompatMapMask)
+        complete |= XkmIndicatorsMask | XkmVirtualModsMask;
+    else if (complete & (XkmSymbolsMask | XkmTypesMask))
+        complete |= XkmVirtualModsMask;
+
+    want |= need;
+    if (want & XkmSymbolsMask)
+        want |= XkmKeyNamesMask | XkmTypesMask;
+    if (want & ~complete)
+        return FALSE;
+
+    if (!XkbWantKeymapCache || !(ctx = x_sha1_init()))
+        return FALSE;
+
+    XkbKeymapKeyString(ctx, "kccgst");
+    XkbKeymapKeyString(ctx, names->keycodes);
+    XkbKeymapKeyString(ctx, names->types);
+    XkbKeymapKeyString(ctx, names->compat);
+    XkbKeymapKeyString(ctx, names->symbols);
+    XkbKeymapKeyString(ctx, names->geometry);
+
+    return XkbKeymapKeyFinal(ctx, want, need, key);
+}
+
+static Bool
+XkbKeymapKeyText(const char *keymap, int keymap_length, unsigned want,
+                 unsigned need, unsigned char *key)
+{
+    void *ctx;
+
+    if (!XkbWantKeymapCache || !(ctx = x_sha1_init()))
+        return FALSE;
+
+    XkbKeymapKeyString(ctx, "keymap");
+    x_sha1_update(ctx, (void *) keymap, keymap_length);
+
+    return XkbKeymapKeyFinal(ctx, want, need, key);
+}
+
+static Bool
+XkbKeymapCacheFileName(const unsigned char *key, const char *suffix,
+                       char *path, size_t size)
+{
+    char hex[2 * XKB_KEYMAP_KEY_SIZE + 1];
+    int i;
+
+    if (!XkbKeymapCacheDirectory)
+        return FALSE;
+
+    for (i = 0; i < XKB_KEYMAP_KEY_SIZE; i++)
+        snprintf(hex + 2 * i, 3, "%02x", key[i]);
+
+    return snprintf(path, size, "%s/xkb-%s.%s", XkbKeymapCacheDirectory,
+                    hex, suffix) < size;
+}
+
+static XkbDescPtr
+XkbKeymapCacheCopy(XkbDescPtr src)
+{
+    XkbDescPtr xkb = XkbAllocKeyboard();
+
+    if (!xkb)
+        return NULL;
+
+    if (!XkbCopyKeymap(xkb, src)) {
+        XkbFreeKeyboard(xkb, 0, TRUE);
+        return NULL;
+    }
+    xkb->defined = src->defined;
+    xkb->flags = src->flags;
+    xkb->device_spec = src->device_spec;
+
+    return xkb;
+}
+
+static void
+XkbKeymapCacheRemove(XkbKeymapCachePtr entry)
+{
+    XkbFreeKeyboard(entry->xkb, 0, TRUE);
+    entry->xkb = NULL;
+    XkbKeymapDepsFree(&entry->deps);
+}
+
+/*
+ * Keep a copy of a keymap the caller just loaded, replacing the least
+ * recently used entry if the cache is full.  The cache takes over the
+ * files the keymap was compiled from.
+ */
+static void
+XkbKeymapCacheInsert(const unsigned char *key, XkbDescPtr xkb,
+                     unsigned provided, XkbKeymapDepsPtr deps)
+{
+    XkbKeymapCachePtr entry = &xkbKeymapCache[0];
+    XkbDescPtr copy;
+    int i;
+
+    for (i = 1; i < XKB_KEYMAP_CACHE_SIZE && entry->xkb; i++) {
+        if (!xkbKeymapCache[i].xkb || xkbKeymapCache[i].used < entry->used)
+            entry = &xkbKeymapCache[i];
+    }
+
+    copy = XkbKeymapCacheCopy(xkb);
+    if (!copy) {
+        XkbKeymapDepsFree(deps);
+        return;
+    }
+
+    XkbKeymapCacheRemove(entry);
+    memcpy(entry->key, key, XKB_KEYMAP_KEY_SIZE);
+    entry->xkb = copy;
+    entry->provided = provided;
+    entry->used = ++xkbKeymapCacheClock;
+    entry->deps = *deps;
+    memset(deps, 0, sizeof(*deps));
+}
+
+/*
+ * Read the stamps written next to a cached .xkm, one file per line.
+ */
+static Bool
+XkbKeymapCacheReadDeps(const char *path, XkbKeymapDepsPtr deps)
+{
+    XkbKeymapStampRec stamp;
+    char line[PATH_MAX + 128];
+    long long size, mtime, mtime_nsec, ino;
+    FILE *file;
+    size_t len;
+    int n;
+
+    memset(deps, 0, sizeof(*deps));
+    file = fopen(path, "r");
+    if (!file)
+        return FALSE;
+
+    while (fgets(line, sizeof(line), file)) {
+        len = strlen(line);
+        if (len == 0 || line[len - 1] != '\n' ||
+            sscanf(line, "%lld %lld %lld %lld %n",
+                   &size, &mtime, &mtime_nsec, &ino, &n) != 4) {
+            deps->incomplete = TRUE;
+            break;
+        }
+        line[len - 1] = '\0';
+        stamp.size = size;
+        stamp.mtime = mtime;
+        stamp.mtime_nsec = mtime_nsec;
+        stamp.ino = ino;
+        XkbKeymapDepsAdd(deps, NULL, line + n, &stamp);
+    }
+    if (ferror(file) || deps->num == 0)
+        deps->incomplete = TRUE;
+    fclose(file);
+
+    if (deps->incomplete) {
+        XkbKeymapDepsFree(deps);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/*
+ * Look a keymap up in memory, then in the cache directory.  On a hit,
+ * returns TRUE with a copy of the keymap for the caller in xkbRtrn and
+ * the components it has in providedRtrn.  Entries whose files have
+ * changed are dropped.
+ */
+static Bool
+XkbKeymapCacheLookup(const unsigned char *key, unsigned want, unsigned need,
+                     XkbDescPtr *xkbRtrn, unsigned *providedRtrn)
+{
+    CARD64 start = GetTimeInMicros();
+    char path[PATH_MAX], depsPath[PATH_MAX];
+    XkbKeymapDepsRec deps;
+    unsigned missing;
+    FILE *file;
+    int i;
+
+    *xkbRtrn = NULL;
+
+    for (i = 0; i < XKB_KEYMAP_CACHE_SIZE; i++) {
+        XkbKeymapCachePtr entry = &xkbKeymapCache[i];
+
+        if (!entry->xkb || memcmp(entry->key, key, XKB_KEYMAP_KEY_SIZE) != 0)
+            continue;
+
+        if (!XkbKeymapDepsValid(&entry->deps)) {
+            LogMessageVerb(X_INFO, 3, "XKB: Dropping cached keymap, "
+                           "its files have changed\n");
+            XkbKeymapCacheRemove(entry);
+            break;
+        }
+
+        *xkbRtrn = XkbKeymapCacheCopy(entry->xkb);
+        if (!*xkbRtrn)
+            return FALSE;
+        entry->used = ++xkbKeymapCacheClock;
+        *providedRtrn = entry->provided;
+        LogMessageVerb(X_INFO, 3, "XKB: Reused cached keymap in %u us\n",
+                       (unsigned) (GetTimeInMicros() - start));
+        return TRUE;
+    }
+
+    if (!XkbKeymapCacheFileName(key, "xkm", path, sizeof(path)) ||
+        !XkbKeymapCacheFileName(key, "deps", depsPath, sizeof(depsPath)))
+        return FALSE;
+    file = fopen(path, "rb");
+    if (!file)
+        return FALSE;
+
+    /* A keymap without stamps cannot be trusted either */
+    if (!XkbKeymapCacheReadDeps(depsPath, &deps) ||
+        !XkbKeymapDepsValid(&deps)) {
+        fclose(file);
+        XkbKeymapDepsFree(&deps);
+        LogMessageVerb(X_INFO, 3, "XKB: Removing outdated cached keymap %s\n",
+                       path);
+        (void) unlink(path);
+        (void) unlink(depsPath);
+        return FALSE;
+    }
+
+    missing = XkmReadFile(file, need, want, xkbRtrn);
+    fclose(file);
+    if (!*xkbRtrn) {
+        LogMessage(X_WARNING, "XKB: Removing unreadable cached keymap %s\n",
+                   path);
+        XkbKeymapDepsFree(&deps);
+        (void) unlink(path);
+        (void) unlink(depsPath);
+        return FALSE;
+    }
+
+    *providedRtrn = (need | want) & ~missing;
+    XkbKeymapCacheInsert(key, *xkbRtrn, *providedRtrn, &deps);
+    LogMessageVerb(X_INFO, 3, "XKB: Loaded cached keymap %s in %u us\n",
+                   path, (unsigned) (GetTimeInMicros() - start));
+    return TRUE;
+}
+
+/*
+ * Open a cache file under a temporary name, to be moved into place by
+ * XkbKeymapCacheRename().  Other servers sharing the directory never see
+ * a partial file.
+ */
+static FILE *
+XkbKeymapCacheCreate(const char *path, char *tmp, size_t size)
+{
+    FILE *file;
+
+    if (snprintf(tmp, size, "%s.%s", path, display) >= size)
+        return NULL;
+    file = fopen(tmp, "wb");
+    if (!file)
+        LogMessageVerb(X_WARNING, 1, "XKB: Couldn't create %s\n", tmp);
+    return file;
+}
+
+static Bool
+XkbKeymapCacheRename(FILE *file, Bool ok, const char *tmp, const char *path)
+{
+    if (fclose(file) != 0)
+        ok = FALSE;
+    if (!ok || rename(tmp, path) != 0) {
+        LogMessageVerb(X_WARNING, 1, "XKB: Couldn't write %s\n", path);
+        (void) unlink(tmp);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/*
+ * Copy the .xkm xkbcomp just wrote into the cache directory, followed by
+ * the stamps of the files it was compiled from.  The stamps go last, so
+ * that new stamps are never paired with an older keymap.
+ */
+static void
+XkbKeymapCacheWriteFile(const unsigned char *key, const char *keymap,
+                        XkbKeymapDepsPtr deps)
+{
+    char path[PATH_MAX], tmp[PATH_MAX], xkm[PATH_MAX], buf[4096];
+    XkbKeymapStampRec *stamp;
+    FILE *in, *out;
+    size_t n;
+    Bool ok = TRUE;
+    int i;
+
+    if (!XkbKeymapCacheFileName(key, "xkm", path, sizeof(path)))
+        return;
+
+    in = XkbDDXOpenConfigFile(keymap, xkm, sizeof(xkm));
+    if (!in)
+        return;
+    out = XkbKeymapCacheCreate(path, tmp, sizeof(tmp));
+    if (!out) {
+        fclose(in);
+        return;
+    }
+
+    while (ok && (n = fread(buf, 1, sizeof(buf), in)) > 0)
+        ok = fwrite(buf, 1, n, out) == n;
+    if (ferror(in))
+        ok = FALSE;
+    fclose(in);
+    if (!XkbKeymapCacheRename(out, ok, tmp, path))
+        return;
+
+    if (!XkbKeymapCacheFileName(key, "deps", path, sizeof(path)) ||
+        !(out = XkbKeymapCacheCreate(path, tmp, sizeof(tmp))))
+        return;
+    for (i = 0; i < deps->num; i++) {
+        stamp = &deps->deps[i].stamp;
+        if (fprintf(out, "%lld %lld %lld %lld %s\n",
+                    (long long) stamp->size, (long long) stamp->mtime,
+                    (long long) stamp->mtime_nsec, (long long) stamp->ino,
+                    deps->deps[i].path) < 0)
+            ok = FALSE;
+    }
+    XkbKeymapCacheRename(out, ok, tmp, path);
+}
+
+/*
+ * Run xkbcomp on the keymap the callback writes and load the result.  If
+ * a cache key is given, the keymap is added to the cache together with
+ * deps, the files it is compiled from.
+ */
+static unsigned
+XkbDDXCompileAndLoad(xkbcomp_buffer_callback callback, void *userdata,
+                     const unsigned char *key, XkbKeymapDepsPtr deps,
+                     unsigned want, unsigned need,
+                     XkbDescPtr *xkbRtrn, char *nameRtrn, int nameRtrnLen)
+{
+    CARD64 start = GetTimeInMicros();
+    unsigned provided;
+    char *keymap;
+
+    *xkbRtrn = NULL;
+    if (nameRtrn)
+        *nameRtrn = '\0';
+
+    keymap = RunXkbComp(callback, userdata);
+    if (!keymap) {
+        LogMessage(X_ERROR, "XKB: Couldn't compile keymap\n");
+        if (key)
+            XkbKeymapDepsFree(deps);
+        return 0;
+    }
+
+    if (key)
+        XkbKeymapCacheWriteFile(key, keymap, deps);
+
+    provided = LoadXKM(want, need, keymap, xkbRtrn);
+    if (nameRtrn)
+        strlcpy(nameRtrn, keymap, nameRtrnLen);
+    free(keymap);
+
+    LogMessageVerb(X_INFO, 3, "XKB: Compiled keymap in %u ms\n",
+                   (unsigned) ((GetTimeInMicros() - start) / 1000));
+
+    if (key && *xkbRtrn)
+        XkbKeymapCacheInsert(key, *xkbRtrn, provided, deps);
+    else if (key)
+        XkbKeymapDepsFree(deps);
+
+    return provided;
+}
+
+static unsigned
+XkbDDXLoadKeymapByNamesKey(DeviceIntPtr keybd,
+                           XkbComponentNamesPtr names,
+                           unsigned want,
+                           unsigned need,
+                           const unsigned char *key, const char *rules,
+                           XkbDescPtr *xkbRtrn, char *nameRtrn, int nameRtrnLen)
+{
+    XkbKeymapNamesCtx ctx = {
+        .names = names,
+        .want = want,
+        .need = need
+    };
+    XkbKeymapDepsRec deps;
 
     *xkbRtrn = NULL;
     if ((keybd == NULL) || (keybd->key == NULL) ||
         (keybd->key->xkbInfo == NULL))
-        xkb = NULL;
+        ctx.xkb = NULL;
     else
-        xkb = keybd->key->xkbInfo->desc;
+        ctx.xkb = keybd->key->xkbInfo->desc;
     if ((names->keycodes == NULL) && (names->types == NULL) &&
         (names->compat == NULL) && (names->symbols == NULL) &&
         (names->geometry == NULL)) {
@@ -380,13 +1117,64 @@ XkbDDXLoadKeymapByNames(DeviceIntPtr keybd,
                    keybd->name ? keybd->name : "(unnamed keyboard)");
         return 0;
     }
-    else if (!XkbDDXCompileKeymapByNames(xkb, names, want, need,
-                                         nameRtrn, nameRtrnLen)) {
-        LogMessage(X_ERROR, "XKB: Couldn't compile keymap\n");
-        return 0;
+
+    if (key && !XkbKeymapDepsCollect(&deps, rules, names, NULL, 0))
+        key = NULL;
+
+    return XkbDDXCompileAndLoad(xkb_write_keymap_for_names_cb, &ctx,
+                                key, &deps, want, need,
+                                xkbRtrn, nameRtrn, nameRtrnLen);
+}
+
+unsigned
+XkbDDXLoadKeymapByNames(DeviceIntPtr keybd,
+                        XkbComponentNamesPtr names,
+                        unsigned want,
+                        unsigned need,
+                        XkbDescPtr *xkbRtrn, char *nameRtrn, int nameRtrnLen)
+{
+    unsigned char key[XKB_KEYMAP_KEY_SIZE];
+    unsigned provided;
+    Bool cache;
+
+    cache = XkbKeymapKeyNames(names, want, need, key);
+    if (cache && XkbKeymapCacheLookup(key, want, need, xkbRtrn, &provided)) {
+        if (nameRtrn)
+            *nameRtrn = '\0';
+        return provided;
     }
 
-    return LoadXKM(want, need, nameRtrn, xkbRtrn);
+    return XkbDDXLoadKeymapByNamesKey(keybd, names, want, need,
+                                      cache ? key : NULL, NULL,
+                                      xkbRtrn, nameRtrn, nameRtrnLen);
+}
+
+static unsigned int
+XkbDDXLoadKeymapFromString(DeviceIntPtr keybd,
+                          const char *keymap, int keymap_length,
+                          unsigned int want,
+                          unsigned int need,
+                          XkbDescPtr *xkbRtrn)
+{
+    unsigned char key[XKB_KEYMAP_KEY_SIZE];
+    unsigned int provided;
+    char map_name[PATH_MAX];
+    XkbKeymapString map = {
+        .keymap = keymap,
+        .len = keymap_length
+    };
+    XkbKeymapDepsRec deps;
+    Bool cache;
+
+    cache = XkbKeymapKeyText(keymap, keymap_length, want, need, key);
+    if (cache && XkbKeymapCacheLookup(key, want, need, xkbRtrn, &provided))
+        return provided;
+    if (cache)
+        cache = XkbKeymapDepsCollect(&deps, NULL, NULL, keymap, keymap_length);
+
+    return XkbDDXCompileAndLoad(xkb_write_keymap_string_cb, &map,
+                                cache ? key : NULL, &deps, want, need,
+                                xkbRtrn, map_name, sizeof(map_name));
 }
 
 Bool
@@ -462,19 +1250,27 @@ static XkbDescPtr
 XkbCompileKeymapForDevice(DeviceIntPtr dev, XkbRMLVOSet * rmlvo, int need)
 {
     XkbDescPtr xkb = NULL;
-    unsigned int provided;
+    unsigned int provided = 0;
     XkbComponentNamesRec kccgst = { 0 };
     char name[PATH_MAX];
-
-    if (XkbRMLVOtoKcCGST(dev, rmlvo, &kccgst)) {
+    unsigned char key[XKB_KEYMAP_KEY_SIZE];
+    Bool cache;
+
+    /* A cached keymap saves parsing the rules as well as running xkbcomp */
+    cache = XkbKeymapKeyRMLVO(rmlvo, XkmAllIndicesMask, need, key);
+    if (cache &&
+        XkbKeymapCacheLookup(key, XkmAllIndicesMask, need, &xkb, &provided))
+        ;
+    else if (XkbRMLVOtoKcCGST(dev, rmlvo, &kccgst))
         provided =
-            XkbDDXLoadKeymapByNames(dev, &kccgst, XkmAllIndicesMask, need, &xkb,
-                                    name, PATH_MAX);
-        if ((need & provided) != need) {
-            if (xkb) {
-                XkbFreeKeyboard(xkb, 0, TRUE);
-                xkb = NULL;
-            }
+            XkbDDXLoadKeymapByNamesKey(dev, &kccgst, XkmAllIndicesMask, need,
+                                       cache ? key : NULL, rmlvo->rules,
+                                       &xkb, name, PATH_MAX);
+
+    if ((need & provided) != need) {
+        if (xkb) {
+            XkbFreeKeyboard(xkb, 0, TRUE);
+            xkb = NULL;
         }
     }
 
@@ -1384,6 +1384,141 @@ XkbWriteVirtualModMap(XkbDescPtr xkb, xkbGetMapReply * rep, char *buf,
     return (char *) wire;
 }
 
+/***====================================================================***/
+
+/*
+ * Most clients ask for the same parts of the keymap when they start, so
+ * the GetMap, GetCompatMap, GetNames and GetGeometry replies for a
+ * device's keymap are kept once they have been serialized, separately for
+ * each byte order.  Everything that changes a keymap calls
+ * XkbInvalidateReplies(), which makes all of them stale.
+ */
+
+#define XKB_MAX_CACHED_REPLIES	8
+
+typedef struct _XkbCachedReply {
+    struct _XkbCachedReply *next;
+    CARD32 version;
+    XkbDescPtr desc;
+    CARD8 request;
+    Bool swapped;
+    CARD32 params[2];           /* request fields the reply depends on */
+    int size;                   /* of the reply */
+    int len;                    /* of the data following it */
+    char data[];
+} XkbCachedReplyRec, *XkbCachedReplyPtr;
+
+typedef struct {
+    XkbSrvInfoPtr xkbi;
+    CARD8 request;
+    CARD32 params[2];
+} XkbReplyKeyRec, *XkbReplyKeyPtr;
+
+static CARD32 xkbReplyVersion;
+
+void
+XkbInvalidateReplies(void)
+{
+    xkbReplyVersion++;
+}
+
+void
+XkbFreeCachedReplies(XkbSrvInfoPtr xkbi)
+{
+    XkbCachedReplyPtr reply, next;
+
+    for (reply = xkbi->replies; reply; reply = next) {
+        next = reply->next;
+        free(reply);
+    }
+    xkbi->replies = NULL;
+}
+
+/*
+ * Send the cached reply for key if there is a current one, dropping stale
+ * ones on the way.
+ */
+static Bool
+XkbSendCachedReply(ClientPtr client, XkbReplyKeyPtr key)
+{
+    XkbCachedReplyPtr reply, *prev;
+    CARD32 header[SIZEOF(xkbGetMapReply) / 4];
+    xGenericReply *rep = (xGenericReply *) header;
+
+    for (prev = &key->xkbi->replies; (reply = *prev);) {
+        if (reply->version != xkbReplyVersion ||
+            reply->desc != key->xkbi->desc) {
+            *prev = reply->next;
+            free(reply);
+            continue;
+        }
+        if (reply->request == key->request &&
+            reply->swapped == client->swapped &&
+            reply->params[0] == key->params[0] &&
+            reply->params[1] == key->params[1])
+            break;
+        prev = &reply->next;
+    }
+    if (!reply)
+        return FALSE;
+
+    /* Keep the most recently used reply first */
+    *prev = reply->next;
+    reply->next = key->xkbi->replies;
+    key->xkbi->replies = reply;
+
+    memcpy(header, reply->data, reply->size);
+    rep->sequenceNumber = client->sequence;
+    if (client->swapped)
+        swaps(&rep->sequenceNumber);
+    WriteToClient(client, reply->size, header);
+    if (reply->len > 0)
+        WriteToClient(client, reply->len, reply->data + reply->size);
+    return TRUE;
+}
+
+/*
+ * Keep a copy of a reply that has just been serialized for the client,
+ * as it was written.
+ */
+static void
+XkbCacheReply(ClientPtr client, XkbReplyKeyPtr key,
+              void *rep, int size, void *data, int len)
+{
+    XkbCachedReplyPtr reply, *prev;
+    int n;
+
+    reply = malloc(sizeof(XkbCachedReplyRec) + size + len);
+    if (!reply)
+        return;
+
+    reply->version = xkbReplyVersion;
+    reply->desc = key->xkbi->desc;
+    reply->request = key->request;
+    reply->swapped = client->swapped;
+    reply->params[0] = key->params[0];
+    reply->params[1] = key->params[1];
+    reply->size = size;
+    reply->len = len;
+    memcpy(reply->data, rep, size);
+    if (len > 0)
+        memcpy(reply->data + size, data, len);
+
+    reply->next = key->xkbi->replies;
+    key->xkbi->replies = reply;
+
+    for (n = 1, prev = &reply->next; *prev; n++) {
+        if (n < XKB_MAX_CACHED_REPLIES) {
+            prev = &(*prev)->next;
+        }
+        else {
+            reply = *prev;
+            *prev = reply->next;
+            free(reply);
+        }
+    }
+}
+
 static Status
 XkbComputeGetMapReplySize(XkbDescPtr xkb, xkbGetMapReply * rep)
 {
@@ -1404,7 +1539,8 @@ XkbComputeGetMapReplySize(XkbDescPtr xkb, xkbGetMapReply * rep)
 }
 
 static int
-XkbSendMap(ClientPtr client, XkbDescPtr xkb, xkbGetMapReply * rep)
+XkbSendMap(ClientPtr client, XkbDescPtr xkb, xkbGetMapReply * rep,
+           XkbReplyKeyPtr key)
 {
     unsigned i, len;
     char *desc, *start;
@@ -1451,6 +1587,8 @@ XkbSendMap(ClientPtr client, XkbDescPtr xkb, xkbGetMapReply * rep)
     }
     WriteToClient(client, (i = SIZEOF(xkbGetMapReply)), rep);
     WriteToClient(client, len, start);
+    if (key)
+        XkbCacheReply(client, key, rep, SIZEOF(xkbGetMapReply), start, len);
     free((char *) start);
     return Success;
 }
@@ -1461,6 +1599,7 @@ ProcXkbGetMap(ClientPtr client)
     DeviceIntPtr dev;
     xkbGetMapReply rep;
     XkbDescRec *xkb;
+    XkbReplyKeyRec key;
     int n, status;
 
     REQUEST(xkbGetMapReq);
@@ -1474,6 +1613,14 @@ ProcXkbGetMap(ClientPtr client)
     CHK_MASK_LEGAL(0x02, stuff->full, XkbAllMapComponentsMask);
     CHK_MASK_LEGAL(0x03, stuff->partial, XkbAllMapComponentsMask);
 
+    /* Only replies covering complete components are worth keeping */
+    key.xkbi = dev->key->xkbInfo;
+    key.request = X_kbGetMap;
+    key.params[0] = stuff->full;
+    key.params[1] = 0;
+    if (!stuff->partial && XkbSendCachedReply(client, &key))
+        return Success;
+
     xkb = dev->key->xkbInfo->desc;
     memset(&rep, 0, sizeof(xkbGetMapReply));
     rep.type = X_Reply;
@@ -1586,7 +1733,7 @@ ProcXkbGetMap(ClientPtr client)
 
     if ((status = XkbComputeGetMapReplySize(xkb, &rep)) != Success)
         return status;
-    return XkbSendMap(client, xkb, &rep);
+    return XkbSendMap(client, xkb, &rep, stuff->partial ? NULL : &key);
 }
 
 /***====================================================================***/
@@ -2828,7 +2975,8 @@ XkbComputeGetCompatMapReplySize(XkbCompatMapPtr compat,
 
 static int
 XkbSendCompatMap(ClientPtr client,
-                 XkbCompatMapPtr compat, xkbGetCompatMapReply * rep)
+                 XkbCompatMapPtr compat, xkbGetCompatMapReply * rep,
+                 XkbReplyKeyPtr key)
 {
     char *data;
     int size;
@@ -2886,10 +3034,12 @@ XkbSendCompatMap(ClientPtr client,
     }
 
     WriteToClient(client, SIZEOF(xkbGetCompatMapReply), rep);
-    if (data) {
+    if (data)
         WriteToClient(client, size, data);
-        free((char *) data);
-    }
+    if (key)
+        XkbCacheReply(client, key, rep, SIZEOF(xkbGetCompatMapReply),
+                      data, data ? size : 0);
+    free(data);
     return Success;
 }
 
@@ -2900,6 +3050,7 @@ ProcXkbGetCompatMap(ClientPtr client)
     DeviceIntPtr dev;
     XkbDescPtr xkb;
     XkbCompatMapPtr compat;
+    XkbReplyKeyRec key;
 
     REQUEST(xkbGetCompatMapReq);
     REQUEST_SIZE_MATCH(xkbGetCompatMapReq);
@@ -2931,8 +3082,16 @@ ProcXkbGetCompatMap(ClientPtr client)
     }
     rep.nTotalSI = compat->num_si;
     rep.groups = stuff->groups;
+
+    key.xkbi = dev->key->xkbInfo;
+    key.request = X_kbGetCompatMap;
+    key.params[0] = stuff->getAllSI ? ~0 : stuff->firstSI | (stuff->nSI << 16);
+    key.params[1] = stuff->groups;
+    if (XkbSendCachedReply(client, &key))
+        return Success;
+
     XkbComputeGetCompatMapReplySize(compat, &rep);
-    return XkbSendCompatMap(client, compat, &rep);
+    return XkbSendCompatMap(client, compat, &rep, &key);
 }
 
 /**
@@ -3861,7 +4020,8 @@ XkbComputeGetNamesReplySize(XkbDescPtr xkb, xkbGetNamesReply * rep)
 }
 
 static int
-XkbSendNames(ClientPtr client, XkbDescPtr xkb, xkbGetNamesReply * rep)
+XkbSendNames(ClientPtr client, XkbDescPtr xkb, xkbGetNamesReply * rep,
+             XkbReplyKeyPtr key)
 {
     register unsigned i, length, which;
     char *start;
@@ -4008,6 +4168,9 @@ XkbSendNames(ClientPtr client, XkbDescPtr xkb, xkbGetNamesReply * rep)
     }
     WriteToClient(client, SIZEOF(xkbGetNamesReply), rep);
     WriteToClient(client, length, start);
+    if (key)
+        XkbCacheReply(client, key, rep, SIZEOF(xkbGetNamesReply),
+                      start, length);
     free((char *) start);
     return Success;
 }
@@ -4018,6 +4181,7 @@ ProcXkbGetNames(ClientPtr client)
     DeviceIntPtr dev;
     XkbDescPtr xkb;
     xkbGetNamesReply rep;
+    XkbReplyKeyRec key;
 
     REQUEST(xkbGetNamesReq);
     REQUEST_SIZE_MATCH(xkbGetNamesReq);
@@ -4028,6 +4192,13 @@ ProcXkbGetNames(ClientPtr client)
     CHK_KBD_DEVICE(dev, stuff->deviceSpec, client, DixGetAttrAccess);
     CHK_MASK_LEGAL(0x01, stuff->which, XkbAllNamesMask);
 
+    key.xkbi = dev->key->xkbInfo;
+    key.request = X_kbGetNames;
+    key.params[0] = stuff->which;
+    key.params[1] = 0;
+    if (XkbSendCachedReply(client, &key))
+        return Success;
+
     xkb = dev->key->xkbInfo->desc;
     memset(&rep, 0, sizeof(xkbGetNamesReply));
     rep.type = X_Reply;
@@ -4042,7 +4213,7 @@ ProcXkbGetNames(ClientPtr client)
     rep.nRadioGroups = xkb->names ? xkb->names->num_rg : 0;
     
     XkbComputeGetNamesReplySize(xkb, &rep);
-    return XkbSendNames(client, xkb, &rep);
+    return XkbSendNames(client, xkb, &rep, &key);
 }
 
 /***====================================================================***/
@@ -5034,7 +5205,8 @@ XkbComputeGetGeometryReplySize(XkbGeometryPtr geom,
 }
 static int
 XkbSendGeometry(ClientPtr client,
-                XkbGeometryPtr geom, xkbGetGeometryReply * rep, Bool freeGeom)
+                XkbGeometryPtr geom, xkbGetGeometryReply * rep, Bool freeGeom,
+                XkbReplyKeyPtr key)
 {
     char *desc, *start;
     int len;
@@ -5084,6 +5256,9 @@ XkbSendGeometry(ClientPtr client,
     WriteToClient(client, SIZEOF(xkbGetGeometryReply), rep);
     if (len > 0)
         WriteToClient(client, len, start);
+    if (key)
+        XkbCacheReply(client, key, rep, SIZEOF(xkbGetGeometryReply),
+                      start, len);
     if (start != NULL)
         free((char *) start);
     if (freeGeom)
@@ -5099,6 +5274,7 @@ ProcXkbGetGeometry(ClientPtr client)
     XkbGeometryPtr geom;
     Bool shouldFree;
     Status status;
+    XkbReplyKeyRec key;
 
     REQUEST(xkbGetGeometryReq);
     REQUEST_SIZE_MATCH(xkbGetGeometryReq);
@@ -5109,6 +5285,13 @@ ProcXkbGetGeometry(ClientPtr client)
     CHK_KBD_DEVICE(dev, stuff->deviceSpec, client, DixGetAttrAccess);
     CHK_ATOM_OR_NONE(stuff->name);
 
+    key.xkbi = dev->key->xkbInfo;
+    key.request = X_kbGetGeometry;
+    key.params[0] = stuff->name;
+    key.params[1] = 0;
+    if (XkbSendCachedReply(client, &key))
+        return Success;
+
     geom = XkbLookupNamedGeometry(dev, stuff->name, &shouldFree);
 
     rep.type = X_Reply;
@@ -5120,7 +5303,7 @@ ProcXkbGetGeometry(ClientPtr client)
     if (status != Success)
         return status;
     else
-        return XkbSendGeometry(client, geom, &rep, shouldFree);
+        return XkbSendGeometry(client, geom, &rep, shouldFree, &key);
 }
 
 /***====================================================================***/
@@ -6126,15 +6309,15 @@ ProcXkbGetKbdByName(ClientPtr client)
     }
     WriteToClient(client, SIZEOF(xkbGetKbdByNameReply), &rep);
     if (reported & (XkbGBN_SymbolsMask | XkbGBN_TypesMask))
-        XkbSendMap(client, new, &mrep);
+        XkbSendMap(client, new, &mrep, NULL);
     if (reported & XkbGBN_CompatMapMask)
-        XkbSendCompatMap(client, new->compat, &crep);
+        XkbSendCompatMap(client, new->compat, &crep, NULL);
     if (reported & XkbGBN_IndicatorMapMask)
         XkbSendIndicatorMap(client, new->indicators, &irep);
     if (reported & (XkbGBN_KeyNamesMask | XkbGBN_OtherNamesMask))
-        XkbSendNames(client, new, &nrep);
+        XkbSendNames(client, new, &nrep, NULL);
     if (reported & XkbGBN_GeometryMask)
-        XkbSendGeometry(client, new->geom, &grep, FALSE);
+        XkbSendGeometry(client, new->geom, &grep, FALSE, NULL);
     if (rep.loaded) {
         XkbDescPtr old_xkb;
         xkbNewKeyboardNotify nkn;
@@ -163,6 +163,8 @@ XkbSendNewKeyboardNotify(DeviceIntPtr kbd, xkbNewKeyboardNotify * pNKN)
     Time time = GetTimeInMillis();
     CARD16 changed = pNKN->changed;
 
+    XkbInvalidateReplies();
+
     pNKN->type = XkbEventCode + XkbEventBase;
     pNKN->xkbType = XkbNewKeyboardNotify;
 
@@ -268,6 +270,8 @@ XkbSendMapNotify(DeviceIntPtr kbd, xkbMapNotify * pMN)
     CARD16 changed = pMN->changed;
     XkbSrvInfoPtr xkbi = kbd->key->xkbInfo;
 
+    XkbInvalidateReplies();
+
     pMN->minKeyCode = xkbi->desc->min_key_code;
     pMN->maxKeyCode = xkbi->desc->max_key_code;
     pMN->type = XkbEventCode + XkbEventBase;
@@ -610,6 +614,8 @@ XkbSendNamesNotify(DeviceIntPtr kbd, xkbNamesNotify * pEv)
     CARD16 changed, changedVirtualMods;
     CARD32 changedIndicators;
 
+    XkbInvalidateReplies();
+
     interest = kbd->xkb_interest;
     if (!interest)
         return;
@@ -656,6 +662,8 @@ XkbSendCompatMapNotify(DeviceIntPtr kbd, xkbCompatMapNotify * pEv)
     Time time = 0;
     CARD16 firstSI = 0, nSI = 0, nTotalSI = 0;
 
+    XkbInvalidateReplies();
+
     interest = kbd->xkb_interest;
     if (!interest)
         return;
@@ -89,6 +89,8 @@ typedef struct _SrvXkmInfo {
 
 const char *XkbBaseDirectory = XKB_BASE_DIRECTORY;
 const char *XkbBinDirectory = XKB_BIN_DIRECTORY;
+const char *XkbKeymapCacheDirectory = NULL;
+Bool XkbWantKeymapCache = TRUE;
 static int XkbWantAccessX = 0;
 
 static char *XkbRulesDflt = NULL;
@@ -725,6 +727,7 @@ XkbFreeInfo(XkbSrvInfoPtr xkbi)
         XkbFreeKeyboard(xkbi->desc, XkbAllComponentsMask, TRUE);
         xkbi->desc = NULL;
     }
+    XkbFreeCachedReplies(xkbi);
     free(xkbi);
     return;
 }
@@ -767,6 +770,35 @@ XkbProcessArguments(int argc, char *argv[], int i)
             return -1;
         }
     }
+    else if (strcmp(argv[i], "-xkbcachedir") == 0) {
+        if (++i < argc) {
+#if !defined(WIN32) && !defined(__CYGWIN__)
+            if (getuid() != geteuid()) {
+                LogMessage(X_WARNING,
+                           "-xkbcachedir is not available for setuid X servers\n");
+                return -1;
+            }
+            else
+#endif
+            {
+                if (strlen(argv[i]) < PATH_MAX) {
+                    XkbKeymapCacheDirectory = argv[i];
+                    return 2;
+                }
+                else {
+                    LogMessage(X_ERROR, "-xkbcachedir pathname too long\n");
+                    return -1;
+                }
+            }
+        }
+        else {
+            return -1;
+        }
+    }
+    else if (strcmp(argv[i], "-noxkbcache") == 0) {
+        XkbWantKeymapCache = FALSE;
+        return 1;
+    }
     else if ((strncmp(argv[i], "-accessx", 8) == 0) ||
              (strncmp(argv[i], "+accessx", 8) == 0)) {
         int j = 1;
@@ -831,6 +863,8 @@ XkbUseMsg(void)
     ErrorF
         ("[+-]accessx [ timeout [ timeout_mask [ feedback [ options_mask] ] ] ]\n");
     ErrorF("                       enable/disable accessx key sequences\n");
+    ErrorF("-xkbcachedir dir       keep compiled keymaps in dir\n");
+    ErrorF("-noxkbcache            always run xkbcomp to compile keymaps\n");
 #ifndef _MSC_VER
     ErrorF("-ardelay               set XKB autorepeat delay\n");
     ErrorF("-arinterval            set XKB autorepeat interval\n");
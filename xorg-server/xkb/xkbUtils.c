@@ -1965,6 +1965,8 @@ XkbCopyKeymap(XkbDescPtr dst, XkbDescPtr src)
     if (src == dst)
         return TRUE;
 
+    XkbInvalidateReplies();
+
     if (!_XkbCopyClientMap(src, dst)) {
         DebugF("XkbCopyKeymap: failed to copy client map\n");
         return FALSE;